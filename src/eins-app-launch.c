@@ -0,0 +1,613 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-app-launch.h"
+#include "eins-config.h"
+#include "eins-recorder.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <glib/gstdio.h>
+#include <glib-unix.h>
+
+/*
+ * Application launch time event, recorded once a day if any app was
+ * launched, with payload "a(s(tttau))".
+ *
+ * Field   | Description
+ * --------+------------------------------------------------------------
+ *       s | Application ID, or "" for apps beyond the first
+ *         | EINS_APP_LAUNCH_MAX_APPS seen that day
+ * (tttau) | Histogram of the app's launch times, in milliseconds; see
+ *         | eins-stats.h
+ *
+ * GNOME Shell, and flatpak itself, start each app in a transient
+ * app-[<launcher>-]<app ID>-<random>.scope unit in the user's systemd
+ * instance. The daemon runs on the system bus, where those units and their
+ * jobs are not visible, so it watches for the units' cgroups being created
+ * instead. That needs one inotify watch per logged-in user per level of
+ * user.slice/user-<uid>.slice/user@<uid>.service/app.slice.
+ *
+ * A launch is taken to be complete when the app first goes idle: when its
+ * scope uses less than LAUNCH_IDLE_PERCENT of a CPU over a sampling
+ * interval, having used more than that over an earlier one. An app which
+ * starts out blocked on I/O, as on slow storage, uses little CPU until it
+ * has read what it needs, so those first intervals don't count as going
+ * idle, and no launch is ever taken to be instant. Apps which exit or move
+ * to another scope before then, or haven't gone idle after
+ * LAUNCH_TIMEOUT_SECONDS, are not counted. Both can be changed with
+ * idle-percent and timeout in the [app-launch] group of the configuration.
+ */
+
+#define APP_LAUNCH_EVENT "a7b91685-903a-473e-902f-135840d244ac"
+
+/* 24 hours */
+#define APP_LAUNCH_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+#define CGROUP_USER_SLICE "/sys/fs/cgroup/user.slice"
+
+#define LAUNCH_SAMPLE_INTERVAL_MS 250
+#define LAUNCH_IDLE_PERCENT 5
+#define LAUNCH_TIMEOUT_SECONDS 60
+
+/* Further apps launched while this many are starting are not measured */
+#define MAX_PENDING_LAUNCHES 16
+
+/* Depth of a watched directory below user.slice */
+typedef enum {
+  LEVEL_USER_SLICE,
+  LEVEL_USER,
+  LEVEL_USER_MANAGER,
+  LEVEL_APP_SLICE,
+} Level;
+
+typedef struct {
+  gchar *path;
+  Level level;
+} Watch;
+
+typedef struct {
+  gchar *app_id;
+  gchar *path;
+  /* cpu.stat of the scope */
+  int fd;
+  EinsAppLaunchProgress progress;
+  /* Of the timeout which samples it, and owns it */
+  guint source_id;
+} Launch;
+
+static int inotify_fd = -1;
+
+/* Map from watch descriptor to Watch (owned) */
+static GHashTable *watches;
+
+static guint inotify_source_id;
+
+/* Launches being measured (borrowed) */
+static GPtrArray *launches;
+
+/* Map from app ID (owned) to EinsHistogram (owned) */
+static GHashTable *histograms;
+
+static gchar *
+unescape_unit_name (const gchar *escaped)
+{
+  GString *unescaped = g_string_sized_new (strlen (escaped));
+
+  for (const gchar *p = escaped; *p != '\0'; p++)
+    {
+      if (p[0] == '\\' && p[1] == 'x' &&
+          g_ascii_isxdigit (p[2]) && g_ascii_isxdigit (p[3]))
+        {
+          g_string_append_c (unescaped, (g_ascii_xdigit_value (p[2]) << 4) |
+                                        g_ascii_xdigit_value (p[3]));
+          p += 3;
+        }
+      else
+        {
+          g_string_append_c (unescaped, *p);
+        }
+    }
+
+  return g_string_free (unescaped, FALSE);
+}
+
+/**
+ * eins_app_launch_parse_scope:
+ * @scope_name: the name of a systemd scope unit
+ *
+ * Returns: (transfer full) (nullable): the ID of the app the scope was
+ *   created for, or %NULL if it is not an app scope
+ */
+gchar *
+eins_app_launch_parse_scope (const gchar *scope_name)
+{
+  g_autofree gchar *middle = NULL;
+  const gchar *app_id;
+  gchar *dash;
+
+  g_return_val_if_fail (scope_name != NULL, NULL);
+
+  if (!g_str_has_prefix (scope_name, "app-") ||
+      !g_str_has_suffix (scope_name, ".scope"))
+    return NULL;
+
+  middle = g_strndup (scope_name + strlen ("app-"),
+                      strlen (scope_name) - strlen ("app-") -
+                      strlen (".scope"));
+
+  /* The random suffix is required for scopes */
+  dash = strrchr (middle, '-');
+  if (dash == NULL)
+    return NULL;
+  *dash = '\0';
+
+  /* Dashes in the app ID are escaped, so any left follow the launcher */
+  dash = strchr (middle, '-');
+  app_id = dash != NULL ? dash + 1 : middle;
+  if (*app_id == '\0')
+    return NULL;
+
+  return unescape_unit_name (app_id);
+}
+
+/**
+ * eins_app_launch_add:
+ * @app_id: the ID of the app which was launched
+ * @duration_us: how long it took to launch
+ *
+ * Adds a launch to the summary. Memory use is bounded by counting apps
+ * beyond the first %EINS_APP_LAUNCH_MAX_APPS together.
+ */
+void
+eins_app_launch_add (const gchar *app_id,
+                     gint64       duration_us)
+{
+  EinsHistogram *histogram;
+
+  g_return_if_fail (app_id != NULL);
+
+  if (histograms == NULL)
+    histograms = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, g_free);
+
+  histogram = g_hash_table_lookup (histograms, app_id);
+
+  if (histogram == NULL &&
+      g_hash_table_size (histograms) >= EINS_APP_LAUNCH_MAX_APPS)
+    {
+      app_id = "";
+      histogram = g_hash_table_lookup (histograms, app_id);
+    }
+
+  if (histogram == NULL)
+    {
+      histogram = g_new0 (EinsHistogram, 1);
+      g_hash_table_insert (histograms, g_strdup (app_id), histogram);
+    }
+
+  eins_histogram_add (histogram, MAX (duration_us, 0) / 1000);
+}
+
+/**
+ * eins_app_launch_take_summary:
+ *
+ * Returns: (transfer floating) (nullable): the payload of the event for the
+ *   launches added since the last call, or %NULL if there were none
+ */
+GVariant *
+eins_app_launch_take_summary (void)
+{
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  const gchar *app_id;
+  const EinsHistogram *histogram;
+
+  if (histograms == NULL || g_hash_table_size (histograms) == 0)
+    return NULL;
+
+  g_variant_builder_init (&builder,
+                          G_VARIANT_TYPE ("a(s" EINS_HISTOGRAM_TYPE_STRING ")"));
+
+  g_hash_table_iter_init (&iter, histograms);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &app_id,
+                                 (gpointer *) &histogram))
+    g_variant_builder_add (&builder, "(s@" EINS_HISTOGRAM_TYPE_STRING ")",
+                           app_id, eins_histogram_to_variant (histogram));
+
+  g_hash_table_remove_all (histograms);
+
+  return g_variant_builder_end (&builder);
+}
+
+static void
+launch_free (Launch *launch)
+{
+  g_free (launch->app_id);
+  g_free (launch->path);
+  close (launch->fd);
+  g_ptr_array_remove_fast (launches, launch);
+  g_free (launch);
+}
+
+/**
+ * eins_app_launch_read_cpu_usage:
+ * @fd: a descriptor for the cpu.stat file of a cgroup
+ * @usage_us: (out): return location for the CPU time used by the cgroup, in
+ *   microseconds
+ *
+ * Reads the file from the start, so the descriptor can be kept open and read
+ * again for each sample.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+eins_app_launch_read_cpu_usage (int      fd,
+                                guint64 *usage_us)
+{
+  gchar buffer[512];
+
+  if (eins_read_fd (fd, buffer, sizeof (buffer)) < 0)
+    return FALSE;
+
+  return sscanf (buffer, "usage_usec %" G_GUINT64_FORMAT, usage_us) == 1;
+}
+
+static gboolean
+is_populated (const gchar *scope_path)
+{
+  g_autofree gchar *path = g_build_filename (scope_path, "cgroup.events",
+                                             NULL);
+  g_autofree gchar *contents = NULL;
+
+  if (!g_file_get_contents (path, &contents, NULL, NULL))
+    return FALSE;
+
+  return strstr (contents, "populated 1") != NULL;
+}
+
+/**
+ * eins_app_launch_progress_init:
+ * @progress: the progress of a launch
+ * @start_time: monotonic time at which the app's scope was created
+ */
+void
+eins_app_launch_progress_init (EinsAppLaunchProgress *progress,
+                               gint64                 start_time)
+{
+  memset (progress, 0, sizeof (*progress));
+  progress->start_time = start_time;
+  progress->last_sample_time = start_time;
+}
+
+/**
+ * eins_app_launch_progress_update:
+ * @progress: the progress of a launch
+ * @now: monotonic time of the sample
+ * @usage_us: CPU time used by the app's scope so far
+ * @idle_percent: share of a CPU below which the app is idle
+ * @duration_us: (out): return location for how long the launch took
+ *
+ * Returns: %TRUE if the launch is complete, with @duration_us set to a
+ *   positive duration
+ */
+gboolean
+eins_app_launch_progress_update (EinsAppLaunchProgress *progress,
+                                 gint64                 now,
+                                 guint64                usage_us,
+                                 guint64                idle_percent,
+                                 gint64                *duration_us)
+{
+  gint64 interval_us = now - progress->last_sample_time;
+  guint64 used_us = usage_us - MIN (progress->last_usage_us, usage_us);
+  gboolean idle = used_us * 100 < (guint64) MAX (interval_us, 0) * idle_percent;
+
+  /* Ends at the start of the idle interval, so it is positive once the
+   * app has been busy over an interval */
+  if (idle && progress->busy)
+    {
+      *duration_us = progress->last_sample_time - progress->start_time;
+      return *duration_us > 0;
+    }
+
+  if (!idle)
+    progress->busy = TRUE;
+
+  progress->last_sample_time = now;
+  progress->last_usage_us = usage_us;
+
+  return FALSE;
+}
+
+static gboolean
+sample_launch (gpointer user_data)
+{
+  Launch *launch = user_data;
+  gint64 now = g_get_monotonic_time ();
+  guint64 idle_percent, timeout_s;
+  guint64 usage_us;
+  gint64 duration_us;
+
+  /* The scope has gone */
+  if (!eins_app_launch_read_cpu_usage (launch->fd, &usage_us))
+    return G_SOURCE_REMOVE;
+
+  idle_percent = eins_config_get_uint64 ("app-launch", "idle-percent",
+                                         LAUNCH_IDLE_PERCENT);
+  if (eins_app_launch_progress_update (&launch->progress, now, usage_us,
+                                       idle_percent, &duration_us))
+    {
+      if (is_populated (launch->path))
+        eins_app_launch_add (launch->app_id, duration_us);
+
+      return G_SOURCE_REMOVE;
+    }
+
+  timeout_s = eins_config_get_uint64 ("app-launch", "timeout",
+                                      LAUNCH_TIMEOUT_SECONDS);
+  if ((guint64) (now - launch->progress.start_time) >
+      timeout_s * G_USEC_PER_SEC)
+    {
+      g_debug ("%s hadn't gone idle %" G_GUINT64_FORMAT " seconds after it "
+               "was launched", launch->app_id, timeout_s);
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+start_launch (const gchar *app_slice_path,
+              const gchar *scope_name)
+{
+  g_autofree gchar *app_id = eins_app_launch_parse_scope (scope_name);
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *cpu_stat_path = NULL;
+  Launch *launch;
+  int fd;
+
+  if (app_id == NULL || launches->len >= MAX_PENDING_LAUNCHES)
+    return;
+
+  path = g_build_filename (app_slice_path, scope_name, NULL);
+  cpu_stat_path = g_build_filename (path, "cpu.stat", NULL);
+
+  fd = g_open (cpu_stat_path, O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0)
+    {
+      g_debug ("Failed to open %s: %s", cpu_stat_path, g_strerror (errno));
+      return;
+    }
+
+  launch = g_new0 (Launch, 1);
+  launch->app_id = g_steal_pointer (&app_id);
+  launch->path = g_steal_pointer (&path);
+  launch->fd = fd;
+  eins_app_launch_progress_init (&launch->progress, g_get_monotonic_time ());
+  g_ptr_array_add (launches, launch);
+
+  launch->source_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                          LAUNCH_SAMPLE_INTERVAL_MS,
+                                          sample_launch, launch,
+                                          (GDestroyNotify) launch_free);
+}
+
+static gboolean
+is_child_watched (Level        level,
+                  const gchar *name)
+{
+  switch (level)
+    {
+    case LEVEL_USER_SLICE:
+      return g_str_has_prefix (name, "user-") &&
+        g_str_has_suffix (name, ".slice");
+    case LEVEL_USER:
+      return g_str_has_prefix (name, "user@") &&
+        g_str_has_suffix (name, ".service");
+    case LEVEL_USER_MANAGER:
+      return strcmp (name, "app.slice") == 0;
+    case LEVEL_APP_SLICE:
+    default:
+      return FALSE;
+    }
+}
+
+static void
+add_watch (const gchar *path,
+           Level        level)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+  Watch *watch;
+  int wd;
+
+  wd = inotify_add_watch (inotify_fd, path, IN_CREATE | IN_ONLYDIR);
+  if (wd < 0)
+    {
+      g_debug ("Failed to watch %s: %s", path, g_strerror (errno));
+      return;
+    }
+
+  watch = g_new0 (Watch, 1);
+  watch->path = g_strdup (path);
+  watch->level = level;
+  g_hash_table_replace (watches, GINT_TO_POINTER (wd), watch);
+
+  /* Scopes which already exist were launched before the daemon started */
+  if (level == LEVEL_APP_SLICE)
+    return;
+
+  /* The watch was added first so that no children can be missed */
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      if (is_child_watched (level, name))
+        {
+          g_autofree gchar *child_path = g_build_filename (path, name, NULL);
+
+          add_watch (child_path, level + 1);
+        }
+    }
+}
+
+static void
+handle_event (const struct inotify_event *event)
+{
+  Watch *watch = g_hash_table_lookup (watches, GINT_TO_POINTER (event->wd));
+
+  if (watch == NULL)
+    return;
+
+  /* The directory was removed, so the watch was too */
+  if (event->mask & IN_IGNORED)
+    {
+      g_hash_table_remove (watches, GINT_TO_POINTER (event->wd));
+      return;
+    }
+
+  if (!(event->mask & IN_CREATE) || !(event->mask & IN_ISDIR) ||
+      event->len == 0)
+    return;
+
+  if (watch->level == LEVEL_APP_SLICE)
+    {
+      start_launch (watch->path, event->name);
+    }
+  else if (is_child_watched (watch->level, event->name))
+    {
+      g_autofree gchar *child_path = g_build_filename (watch->path,
+                                                       event->name, NULL);
+
+      add_watch (child_path, watch->level + 1);
+    }
+}
+
+static gboolean
+inotify_readable_cb (gint         fd,
+                     GIOCondition condition G_GNUC_UNUSED,
+                     gpointer     user_data G_GNUC_UNUSED)
+{
+  gchar buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+
+  while (TRUE)
+    {
+      ssize_t len = read (fd, buf, sizeof buf);
+
+      if (len < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          if (errno != EAGAIN)
+            g_warning ("Failed to read inotify events: %s", g_strerror (errno));
+
+          return G_SOURCE_CONTINUE;
+        }
+
+      for (gchar *p = buf; p < buf + len; )
+        {
+          const struct inotify_event *event = (const struct inotify_event *) p;
+
+          handle_event (event);
+          p += sizeof (struct inotify_event) + event->len;
+        }
+    }
+}
+
+static void
+watch_free (Watch *watch)
+{
+  g_free (watch->path);
+  g_free (watch);
+}
+
+static void
+record_app_launches (gpointer user_data G_GNUC_UNUSED)
+{
+  GVariant *summary = eins_app_launch_take_summary ();
+
+  if (summary != NULL)
+    {
+      eins_recorder_record_event (APP_LAUNCH_EVENT, summary);
+      eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+    }
+}
+
+void
+eins_app_launch_start (void)
+{
+  /* Needs the unified cgroup hierarchy */
+  if (!g_file_test (CGROUP_USER_SLICE, G_FILE_TEST_IS_DIR))
+    {
+      g_debug ("%s not found; not measuring app launches", CGROUP_USER_SLICE);
+      return;
+    }
+
+  inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0)
+    {
+      g_warning ("Failed to initialize inotify: %s", g_strerror (errno));
+      return;
+    }
+
+  watches = g_hash_table_new_full (NULL, NULL, NULL,
+                                   (GDestroyNotify) watch_free);
+  launches = g_ptr_array_new ();
+  add_watch (CGROUP_USER_SLICE, LEVEL_USER_SLICE);
+
+  inotify_source_id = g_unix_fd_add (inotify_fd, G_IO_IN, inotify_readable_cb,
+                                     NULL);
+  eins_schedule_add ("app-launch", APP_LAUNCH_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_app_launches,
+                     NULL);
+}
+
+/* Launch times not yet recorded are dropped. */
+void
+eins_app_launch_stop (void)
+{
+  eins_schedule_remove ("app-launch");
+  g_clear_handle_id (&inotify_source_id, g_source_remove);
+
+  /* Each launch is freed, and removed from the array, with its source */
+  while (launches != NULL && launches->len > 0)
+    {
+      Launch *launch = g_ptr_array_index (launches, 0);
+
+      g_source_remove (launch->source_id);
+    }
+
+  g_clear_pointer (&launches, g_ptr_array_unref);
+  g_clear_pointer (&watches, g_hash_table_unref);
+  g_clear_pointer (&histograms, g_hash_table_unref);
+
+  if (inotify_fd >= 0)
+    g_close (inotify_fd, NULL);
+  inotify_fd = -1;
+}
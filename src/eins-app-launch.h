@@ -0,0 +1,53 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_app_launch_start (void);
+void eins_app_launch_stop (void);
+
+gboolean eins_app_launch_read_cpu_usage (int      fd,
+                                         guint64 *usage_us);
+
+/* For tests */
+
+/* Launch times of any further apps are counted together, under "" */
+#define EINS_APP_LAUNCH_MAX_APPS 64
+
+gchar *eins_app_launch_parse_scope (const gchar *scope_name);
+void eins_app_launch_add (const gchar *app_id,
+                          gint64       duration_us);
+GVariant *eins_app_launch_take_summary (void);
+
+typedef struct {
+  gint64 start_time;
+  gint64 last_sample_time;
+  guint64 last_usage_us;
+  /* Whether the app has been above the idle threshold over an interval */
+  gboolean busy;
+} EinsAppLaunchProgress;
+
+void eins_app_launch_progress_init (EinsAppLaunchProgress *progress,
+                                    gint64                 start_time);
+gboolean eins_app_launch_progress_update (EinsAppLaunchProgress *progress,
+                                          gint64                 now,
+                                          guint64                usage_us,
+                                          guint64                idle_percent,
+                                          gint64                *duration_us);
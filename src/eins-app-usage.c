@@ -0,0 +1,494 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-app-usage.h"
+#include "eins-app-launch.h"
+#include "eins-boottime-source.h"
+#include "eins-helper.h"
+#include "eins-recorder.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+/*
+ * Application resource usage event, recorded once a day if any app was
+ * running, with payload "a(sttu)".
+ *
+ * Field | Description
+ * ------+----------------------------------------------------------------
+ *     s | Flatpak ref of the app, such as
+ *       | "app/org.gnome.Calculator/x86_64/stable", or its ID if it is not
+ *       | a flatpak from the system installation or its ref could not be
+ *       | looked up; or "" for apps beyond the first
+ *       | EINS_APP_USAGE_MAX_APPS seen that day
+ *     t | CPU time used, in milliseconds
+ *     t | Highest memory use of any one instance, in bytes
+ *     u | Number of instances first seen that day
+ *
+ * Each app runs in an app-[<launcher>-]<app ID>-<random>.scope in
+ * user.slice/user-<uid>.slice/user@<uid>.service/app.slice; see
+ * eins-app-launch.c. Those are listed once a minute, and cpu.stat and
+ * memory.peak are kept open for as long as each scope is, to be read with
+ * pread() rather than reopened. CPU time used by a scope in the minute
+ * before it goes away is missed, as is any app which runs for less than a
+ * minute. memory.peak covers the scope's whole lifetime, so an instance
+ * running across two days reports its peak on both; it needs Linux 5.19,
+ * and is reported as 0 before that.
+ *
+ * Scopes which already exist when the daemon starts only count CPU time used
+ * from then on.
+ *
+ * Apps are tracked by ID. The refs of those which ran as flatpaks are looked
+ * up by eos-metrics-collect when the event is recorded, so that the daemon
+ * doesn't keep libflatpak and the system installation loaded for its whole
+ * uptime to do so once a day.
+ */
+
+#define APP_USAGE_EVENT "a0080a87-6066-48d0-b4bc-491ceb183ccb"
+
+#define APP_USAGE_SAMPLE_INTERVAL_USECONDS (60 * G_USEC_PER_SEC)
+
+/* 24 hours */
+#define APP_USAGE_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+#define CGROUP_USER_SLICE "/sys/fs/cgroup/user.slice"
+
+typedef struct {
+  /* ID of the app */
+  gchar *app;
+  gboolean flatpak;
+  int cpu_fd;
+  /* -1 if the kernel doesn't have memory.peak */
+  int memory_fd;
+  guint64 last_usage_us;
+  /* Number of the last sample the scope was listed in */
+  guint64 last_seen;
+} Scope;
+
+typedef struct {
+  guint64 cpu_us;
+  guint64 memory_peak;
+  guint32 n_instances;
+  gboolean flatpak;
+} Usage;
+
+/* Map from the scope's path (owned) to Scope (owned) */
+static GHashTable *scopes;
+/* Number of the last sample taken, counting from 1 */
+static guint64 sample_number;
+static guint sample_source_id;
+
+/* Map from app ID (owned) to Usage (owned) */
+static GHashTable *usage;
+
+/**
+ * eins_app_usage_add:
+ * @app: the ID of the app
+ * @flatpak: whether the instance runs as a flatpak
+ * @cpu_us: CPU time used by one of its instances since the last sample
+ * @memory_peak: the highest memory use of that instance, in bytes
+ * @new_instance: whether the instance hasn't been sampled before
+ *
+ * Adds a sample to the summary. Memory use is bounded by counting apps
+ * beyond the first %EINS_APP_USAGE_MAX_APPS together.
+ */
+void
+eins_app_usage_add (const gchar *app,
+                    gboolean     flatpak,
+                    guint64      cpu_us,
+                    guint64      memory_peak,
+                    gboolean     new_instance)
+{
+  Usage *app_usage;
+
+  g_return_if_fail (app != NULL);
+
+  if (usage == NULL)
+    usage = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  app_usage = g_hash_table_lookup (usage, app);
+
+  if (app_usage == NULL &&
+      g_hash_table_size (usage) >= EINS_APP_USAGE_MAX_APPS)
+    {
+      app = "";
+      app_usage = g_hash_table_lookup (usage, app);
+    }
+
+  if (app_usage == NULL)
+    {
+      app_usage = g_new0 (Usage, 1);
+      g_hash_table_insert (usage, g_strdup (app), app_usage);
+    }
+
+  app_usage->cpu_us += cpu_us;
+  app_usage->memory_peak = MAX (app_usage->memory_peak, memory_peak);
+  if (new_instance)
+    app_usage->n_instances++;
+  if (flatpak && *app != '\0')
+    app_usage->flatpak = TRUE;
+}
+
+/**
+ * eins_app_usage_take_summary:
+ * @flatpak_apps: (out) (transfer full) (array zero-terminated=1): return
+ *   location for the IDs of the apps in the summary which ran as flatpaks
+ *
+ * Returns: (transfer floating) (nullable): the payload of the event for the
+ *   usage added since the last call, with apps reported by ID; or %NULL if
+ *   there was none, in which case @flatpak_apps is set to %NULL
+ */
+GVariant *
+eins_app_usage_take_summary (GStrv *flatpak_apps)
+{
+  GVariantBuilder builder;
+  g_autoptr(GPtrArray) flatpaks = NULL;
+  GHashTableIter iter;
+  const gchar *app;
+  const Usage *app_usage;
+
+  g_return_val_if_fail (flatpak_apps != NULL, NULL);
+
+  *flatpak_apps = NULL;
+
+  if (usage == NULL || g_hash_table_size (usage) == 0)
+    return NULL;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sttu)"));
+  flatpaks = g_ptr_array_new_with_free_func (g_free);
+
+  g_hash_table_iter_init (&iter, usage);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &app,
+                                 (gpointer *) &app_usage))
+    {
+      g_variant_builder_add (&builder, "(sttu)", app,
+                             app_usage->cpu_us / 1000, app_usage->memory_peak,
+                             app_usage->n_instances);
+      /* The ID comes from the scope's name, which the user chose, and is
+       * passed to eos-metrics-collect on its command line */
+      if (app_usage->flatpak && g_application_id_is_valid (app))
+        g_ptr_array_add (flatpaks, g_strdup (app));
+    }
+
+  g_hash_table_remove_all (usage);
+
+  g_ptr_array_add (flatpaks, NULL);
+  *flatpak_apps = (GStrv) g_ptr_array_free (g_steal_pointer (&flatpaks),
+                                            FALSE);
+
+  return g_variant_builder_end (&builder);
+}
+
+/**
+ * eins_app_usage_apply_refs:
+ * @summary: a summary from eins_app_usage_take_summary()
+ * @refs: a map of type "a{ss}" from app ID to flatpak ref
+ *
+ * Returns: (transfer floating): @summary, with the apps in @refs reported
+ *   by their refs rather than their IDs
+ */
+GVariant *
+eins_app_usage_apply_refs (GVariant *summary,
+                           GVariant *refs)
+{
+  GVariantBuilder builder;
+  GVariantIter iter;
+  const gchar *app;
+  guint64 cpu_ms;
+  guint64 memory_peak;
+  guint32 n_instances;
+
+  g_return_val_if_fail (g_variant_is_of_type (summary,
+                                              G_VARIANT_TYPE ("a(sttu)")),
+                        NULL);
+  g_return_val_if_fail (g_variant_is_of_type (refs, G_VARIANT_TYPE ("a{ss}")),
+                        NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sttu)"));
+
+  g_variant_iter_init (&iter, summary);
+  while (g_variant_iter_next (&iter, "(&sttu)", &app, &cpu_ms, &memory_peak,
+                              &n_instances))
+    {
+      const gchar *ref = NULL;
+
+      g_variant_lookup (refs, app, "&s", &ref);
+      g_variant_builder_add (&builder, "(sttu)", ref != NULL ? ref : app,
+                             cpu_ms, memory_peak, n_instances);
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static void
+scope_free (Scope *scope)
+{
+  g_free (scope->app);
+  close (scope->cpu_fd);
+  if (scope->memory_fd >= 0)
+    close (scope->memory_fd);
+  g_free (scope);
+}
+
+static guint64
+read_memory_peak (int fd)
+{
+  gint64 peak;
+
+  if (!eins_read_fd_int64 (fd, &peak))
+    return 0;
+
+  return MAX (peak, 0);
+}
+
+static Scope *
+scope_new (const gchar *path,
+           const gchar *scope_name)
+{
+  g_autofree gchar *app = NULL;
+  g_autofree gchar *cpu_path = NULL;
+  g_autofree gchar *memory_path = NULL;
+  Scope *scope;
+  int cpu_fd;
+
+  app = eins_app_launch_parse_scope (scope_name);
+  if (app == NULL)
+    return NULL;
+
+  cpu_path = g_build_filename (path, "cpu.stat", NULL);
+  cpu_fd = g_open (cpu_path, O_RDONLY | O_CLOEXEC, 0);
+  if (cpu_fd < 0)
+    {
+      g_debug ("Failed to open %s: %s", cpu_path, g_strerror (errno));
+      return NULL;
+    }
+
+  memory_path = g_build_filename (path, "memory.peak", NULL);
+
+  scope = g_new0 (Scope, 1);
+  scope->app = g_steal_pointer (&app);
+  scope->flatpak = g_str_has_prefix (scope_name, "app-flatpak-");
+  scope->cpu_fd = cpu_fd;
+  scope->memory_fd = g_open (memory_path, O_RDONLY | O_CLOEXEC, 0);
+
+  return scope;
+}
+
+static void
+sample_scope (const gchar *path,
+              const gchar *scope_name)
+{
+  Scope *scope = g_hash_table_lookup (scopes, path);
+  gboolean new_instance = FALSE;
+  guint64 usage_us;
+
+  if (scope == NULL)
+    {
+      scope = scope_new (path, scope_name);
+      if (scope == NULL)
+        return;
+
+      g_hash_table_insert (scopes, g_strdup (path), scope);
+      new_instance = TRUE;
+    }
+
+  scope->last_seen = sample_number;
+
+  if (!eins_app_launch_read_cpu_usage (scope->cpu_fd, &usage_us))
+    return;
+
+  /* Take a baseline for scopes which were running before the first
+   * sample, since they may have been for days. */
+  if (new_instance && sample_number == 1)
+    scope->last_usage_us = usage_us;
+
+  eins_app_usage_add (scope->app, scope->flatpak,
+                      usage_us - MIN (scope->last_usage_us, usage_us),
+                      read_memory_peak (scope->memory_fd),
+                      new_instance);
+  scope->last_usage_us = usage_us;
+}
+
+/* Calls func for each entry of dir with the given prefix and suffix. */
+static void
+foreach_child (const gchar *dir_path,
+               const gchar *prefix,
+               const gchar *suffix,
+               void       (*func) (const gchar *path,
+                                   const gchar *name))
+{
+  g_autoptr(GDir) dir = g_dir_open (dir_path, 0, NULL);
+  const gchar *name;
+
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *path = NULL;
+
+      if (!g_str_has_prefix (name, prefix) || !g_str_has_suffix (name, suffix))
+        continue;
+
+      path = g_build_filename (dir_path, name, NULL);
+      func (path, name);
+    }
+}
+
+static void
+sample_user_manager (const gchar *path,
+                     const gchar *name G_GNUC_UNUSED)
+{
+  g_autofree gchar *app_slice = g_build_filename (path, "app.slice", NULL);
+
+  foreach_child (app_slice, "app-", ".scope", sample_scope);
+}
+
+static void
+sample_user_slice (const gchar *path,
+                   const gchar *name G_GNUC_UNUSED)
+{
+  foreach_child (path, "user@", ".service", sample_user_manager);
+}
+
+/**
+ * eins_app_usage_sample:
+ * @user_slice_path: path to user.slice in the cgroup hierarchy
+ *
+ * Adds the usage of each app scope since the last call to the summary, and
+ * forgets the scopes which have gone away.
+ */
+void
+eins_app_usage_sample (const gchar *user_slice_path)
+{
+  GHashTableIter iter;
+  Scope *scope;
+
+  g_return_if_fail (user_slice_path != NULL);
+
+  if (scopes == NULL)
+    scopes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                    (GDestroyNotify) scope_free);
+
+  sample_number++;
+  foreach_child (user_slice_path, "user-", ".slice", sample_user_slice);
+
+  g_hash_table_iter_init (&iter, scopes);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &scope))
+    {
+      if (scope->last_seen != sample_number)
+        g_hash_table_iter_remove (&iter);
+    }
+}
+
+static gboolean
+sample_app_usage (gpointer user_data G_GNUC_UNUSED)
+{
+  eins_app_usage_sample (CGROUP_USER_SLICE);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+got_app_refs_cb (GObject      *source G_GNUC_UNUSED,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  g_autoptr(GVariant) summary = user_data;
+  g_autoptr(GVariant) refs = NULL;
+  g_autoptr(GError) error = NULL;
+
+  refs = eins_helper_collect_finish (result, &error);
+  if (refs == NULL)
+    {
+      g_warning ("Failed to look up flatpak refs: %s", error->message);
+    }
+  else if (!g_variant_is_of_type (refs, G_VARIANT_TYPE ("a{ss}")))
+    {
+      g_warning ("Flatpak refs have unexpected type %s",
+                 g_variant_get_type_string (refs));
+    }
+  else
+    {
+      eins_recorder_record_event (APP_USAGE_EVENT,
+                                  eins_app_usage_apply_refs (summary, refs));
+      eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+      return;
+    }
+
+  /* Better to report the apps by ID than not at all */
+  eins_recorder_record_event (APP_USAGE_EVENT, summary);
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+static void
+record_app_usage (gpointer user_data G_GNUC_UNUSED)
+{
+  g_auto(GStrv) flatpak_apps = NULL;
+  GVariant *summary = eins_app_usage_take_summary (&flatpak_apps);
+
+  if (summary == NULL)
+    return;
+
+  if (flatpak_apps[0] == NULL)
+    {
+      eins_recorder_record_event (APP_USAGE_EVENT, summary);
+      eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+      return;
+    }
+
+  eins_helper_collect_async ("flatpak-refs",
+                             (const gchar * const *) flatpak_apps, NULL,
+                             got_app_refs_cb, g_variant_ref_sink (summary));
+}
+
+void
+eins_app_usage_start (void)
+{
+  /* Needs the unified cgroup hierarchy */
+  if (!g_file_test (CGROUP_USER_SLICE, G_FILE_TEST_IS_DIR))
+    {
+      g_debug ("%s not found; not measuring app usage", CGROUP_USER_SLICE);
+      return;
+    }
+
+  eins_app_usage_sample (CGROUP_USER_SLICE);
+  sample_source_id = eins_boottimeout_add_useconds (APP_USAGE_SAMPLE_INTERVAL_USECONDS,
+                                                    sample_app_usage, NULL);
+  eins_schedule_add ("app-usage", APP_USAGE_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_app_usage, NULL);
+}
+
+/* Usage not yet recorded is dropped. Once it is started again, CPU time is
+ * counted from then, as for scopes which existed when the daemon started. */
+void
+eins_app_usage_stop (void)
+{
+  eins_schedule_remove ("app-usage");
+  g_clear_handle_id (&sample_source_id, g_source_remove);
+  g_clear_pointer (&scopes, g_hash_table_unref);
+  g_clear_pointer (&usage, g_hash_table_unref);
+  sample_number = 0;
+}
@@ -0,0 +1,39 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_app_usage_start (void);
+void eins_app_usage_stop (void);
+
+/* For tests */
+
+/* Usage of any further apps is counted together, under "" */
+#define EINS_APP_USAGE_MAX_APPS 64
+
+void eins_app_usage_add (const gchar *app,
+                         gboolean     flatpak,
+                         guint64      cpu_us,
+                         guint64      memory_peak,
+                         gboolean     new_instance);
+void eins_app_usage_sample (const gchar *user_slice_path);
+GVariant *eins_app_usage_take_summary (GStrv *flatpak_apps);
+GVariant *eins_app_usage_apply_refs (GVariant *summary,
+                                     GVariant *refs);
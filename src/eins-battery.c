@@ -0,0 +1,517 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-battery.h"
+#include "eins-boottime-source.h"
+#include "eins-recorder.h"
+#include "eins-ring-store.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+#include "eins-uevent-monitor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+/*
+ * Battery event, recorded once a day on systems with a battery, with
+ * payload "a(squuuuu)".
+ *
+ * Field      | Description
+ * -----------+------------------------------------------------------
+ * a(squuuuu) | One entry per system battery:
+ *            |   s: the kernel's name for it, such as 'BAT0'
+ *            |   q: its full capacity, in ‰ of its design capacity; or 0
+ *            |      if either is unknown
+ *            |   u: its charge cycle count; or 0 if unknown
+ *            |   u: number of samples taken while it was discharging
+ *            |   u: median discharge rate, in mW
+ *            |   u: 90th percentile of the same
+ *            |   u: 99th percentile of the same
+ *
+ * Rates are rounded down to EINS_BATTERY_BUCKET_MILLIWATTS and clamped to
+ * below 100 W. Batteries which only report charge, in µAh, rather than
+ * energy, in µWh, are supported: their capacity ratio is the same, and
+ * their discharge rate is their current times their voltage.
+ *
+ * Samples are only taken while a battery is discharging: a power_supply
+ * uevent, as sent when the charger is plugged or unplugged, starts or stops
+ * the sampling timer, so an idle system on AC power is never woken. Each
+ * file is read with a single pread() on a descriptor opened once, as for the
+ * thermal counters. The rates are kept in a ring store in the cache until
+ * the event is recorded, so restarting the daemon or rebooting doesn't lose
+ * the day's samples so far.
+ *
+ * Batteries of peripherals, such as wireless mice, are left out, as are
+ * batteries added after the daemon started.
+ */
+
+#define BATTERY_EVENT "4b239e21-f6a3-4087-8876-60e5a50fef5e"
+
+#define BATTERY_SAMPLE_INTERVAL_USECONDS (60 * G_USEC_PER_SEC)
+
+/* 24 hours */
+#define BATTERY_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+#define SYSFS_ROOT "/sys"
+
+#define BATTERY_STORE_FILE_PATH INSTRUMENTATION_CACHE_DIR "/battery-samples"
+#define BATTERY_STORE_N_SERIES 8
+/* A day and a half of samples, in case the event is late */
+#define BATTERY_STORE_CAPACITY 2160
+
+typedef struct {
+  gchar *name;
+  int status_fd;
+  /* energy_* in µWh, or charge_* in µAh */
+  int full_fd;
+  int full_design_fd;
+  int cycle_count_fd;
+  /* power_now in µW, or current_now in µA and voltage_now in µV */
+  int power_fd;
+  int current_fd;
+  int voltage_fd;
+  /* Index of its series in the store, or -1 */
+  gint series;
+} Battery;
+
+static GPtrArray *batteries;
+static EinsRingStore *store;
+static guint sample_id;
+static guint uevent_watch_id;
+
+/**
+ * eins_battery_summary_add:
+ * @summary: a summary
+ * @milliwatts: the rate at which a battery was discharging
+ */
+void
+eins_battery_summary_add (EinsBatterySummary *summary,
+                          guint64             milliwatts)
+{
+  guint64 bucket = MIN (milliwatts / EINS_BATTERY_BUCKET_MILLIWATTS,
+                        EINS_BATTERY_N_BUCKETS - 1);
+
+  summary->buckets[bucket]++;
+  summary->n_samples++;
+}
+
+/**
+ * eins_battery_summary_percentile:
+ * @summary: a summary
+ * @percentile: between 0 and 100
+ *
+ * Returns: the given percentile of the discharge rates added to @summary,
+ *   in mW; or 0 if none have been added
+ */
+guint32
+eins_battery_summary_percentile (const EinsBatterySummary *summary,
+                                 guint                     percentile)
+{
+  g_return_val_if_fail (percentile <= 100, 0);
+
+  return eins_buckets_percentile (summary->buckets, EINS_BATTERY_N_BUCKETS,
+                                  percentile) * EINS_BATTERY_BUCKET_MILLIWATTS;
+}
+
+static gboolean
+is_discharging (Battery *battery)
+{
+  static const gchar discharging[] = "Discharging\n";
+  gchar buffer[32];
+
+  if (eins_read_fd (battery->status_fd, buffer, sizeof (buffer)) <= 0)
+    return FALSE;
+
+  return strcmp (buffer, discharging) == 0;
+}
+
+static int
+open_file (const gchar *dir,
+           const gchar *name)
+{
+  g_autofree gchar *path = g_build_filename (dir, name, NULL);
+  int fd = g_open (path, O_RDONLY | O_CLOEXEC, 0);
+
+  if (fd < 0 && errno != ENOENT)
+    g_debug ("Failed to open %s: %s", path, g_strerror (errno));
+
+  return fd;
+}
+
+static void
+close_fd (int fd)
+{
+  if (fd >= 0)
+    close (fd);
+}
+
+static void
+battery_free (Battery *battery)
+{
+  g_free (battery->name);
+  close_fd (battery->status_fd);
+  close_fd (battery->full_fd);
+  close_fd (battery->full_design_fd);
+  close_fd (battery->cycle_count_fd);
+  close_fd (battery->power_fd);
+  close_fd (battery->current_fd);
+  close_fd (battery->voltage_fd);
+  g_free (battery);
+}
+
+/* Whether the power supply is a battery powering the system, rather than a
+ * charger or a peripheral's battery. */
+static gboolean
+is_system_battery (const gchar *path)
+{
+  g_autofree gchar *type_path = g_build_filename (path, "type", NULL);
+  g_autofree gchar *scope_path = g_build_filename (path, "scope", NULL);
+  g_autofree gchar *type = NULL;
+  g_autofree gchar *scope = NULL;
+
+  if (!g_file_get_contents (type_path, &type, NULL, NULL) ||
+      strcmp (g_strstrip (type), "Battery") != 0)
+    return FALSE;
+
+  return !g_file_get_contents (scope_path, &scope, NULL, NULL) ||
+         strcmp (g_strstrip (scope), "Device") != 0;
+}
+
+static Battery *
+battery_new (const gchar *path,
+             const gchar *name)
+{
+  Battery *battery;
+  int status_fd = open_file (path, "status");
+
+  if (status_fd < 0)
+    return NULL;
+
+  battery = g_new0 (Battery, 1);
+  battery->name = g_strdup (name);
+  battery->status_fd = status_fd;
+  battery->cycle_count_fd = open_file (path, "cycle_count");
+  battery->current_fd = -1;
+  battery->voltage_fd = -1;
+  battery->series = -1;
+
+  battery->full_fd = open_file (path, "energy_full");
+  if (battery->full_fd >= 0)
+    {
+      battery->full_design_fd = open_file (path, "energy_full_design");
+    }
+  else
+    {
+      battery->full_fd = open_file (path, "charge_full");
+      battery->full_design_fd = open_file (path, "charge_full_design");
+    }
+
+  battery->power_fd = open_file (path, "power_now");
+  if (battery->power_fd < 0)
+    {
+      battery->current_fd = open_file (path, "current_now");
+      battery->voltage_fd = open_file (path, "voltage_now");
+    }
+
+  return battery;
+}
+
+static gint
+compare_batteries (gconstpointer a,
+                   gconstpointer b)
+{
+  const Battery *battery_a = *(Battery * const *) a;
+  const Battery *battery_b = *(Battery * const *) b;
+
+  return strcmp (battery_a->name, battery_b->name);
+}
+
+static void
+open_store (const gchar *store_path)
+{
+  g_autoptr(GHashTable) names = g_hash_table_new (g_str_hash, g_str_equal);
+  g_autoptr(GError) error = NULL;
+
+  store = eins_ring_store_open (store_path, BATTERY_STORE_N_SERIES,
+                                BATTERY_STORE_CAPACITY, &error);
+  if (store == NULL)
+    {
+      g_warning ("Failed to open battery sample store: %s", error->message);
+      return;
+    }
+
+  for (guint i = 0; i < batteries->len; i++)
+    {
+      Battery *battery = g_ptr_array_index (batteries, i);
+
+      g_hash_table_add (names, battery->name);
+    }
+
+  /* Samples of batteries which are gone would never be taken */
+  eins_ring_store_prune (store, names);
+
+  for (guint i = 0; i < batteries->len; i++)
+    {
+      Battery *battery = g_ptr_array_index (batteries, i);
+
+      if (strlen (battery->name) <= EINS_RING_STORE_MAX_NAME_LENGTH)
+        battery->series = eins_ring_store_get_series (store, battery->name);
+    }
+}
+
+/**
+ * eins_battery_open:
+ * @sysfs_root: path to the sysfs mount, normally /sys
+ * @store_path: path of the store which keeps samples until they are
+ *   recorded
+ *
+ * Returns: %TRUE if any system battery was found
+ */
+gboolean
+eins_battery_open (const gchar *sysfs_root,
+                   const gchar *store_path)
+{
+  g_autofree gchar *supplies_path = NULL;
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  g_return_val_if_fail (batteries == NULL, FALSE);
+
+  batteries = g_ptr_array_new_with_free_func ((GDestroyNotify) battery_free);
+
+  supplies_path = g_build_filename (sysfs_root, "class", "power_supply", NULL);
+  dir = g_dir_open (supplies_path, 0, NULL);
+  if (dir == NULL)
+    return FALSE;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *path = g_build_filename (supplies_path, name, NULL);
+      Battery *battery;
+
+      if (!is_system_battery (path))
+        continue;
+
+      battery = battery_new (path, name);
+      if (battery != NULL)
+        g_ptr_array_add (batteries, battery);
+    }
+
+  g_ptr_array_sort (batteries, compare_batteries);
+
+  if (batteries->len == 0)
+    return FALSE;
+
+  open_store (store_path);
+
+  return TRUE;
+}
+
+void
+eins_battery_close (void)
+{
+  g_clear_pointer (&batteries, g_ptr_array_unref);
+  g_clear_pointer (&store, eins_ring_store_free);
+}
+
+static void
+add_sample (Battery *battery,
+            guint64  milliwatts)
+{
+  if (battery->series >= 0)
+    eins_ring_store_append (store, battery->series, g_get_real_time (),
+                            milliwatts);
+}
+
+/**
+ * eins_battery_sample:
+ *
+ * Adds the discharge rate of each battery which is discharging to the
+ * store.
+ *
+ * Returns: %TRUE if any battery is discharging
+ */
+gboolean
+eins_battery_sample (void)
+{
+  gboolean any_discharging = FALSE;
+
+  for (guint i = 0; i < batteries->len; i++)
+    {
+      Battery *battery = g_ptr_array_index (batteries, i);
+      gint64 power_uw, current_ua, voltage_uv;
+
+      if (!is_discharging (battery))
+        continue;
+
+      any_discharging = TRUE;
+
+      /* Some drivers report discharge as negative */
+      if (eins_read_fd_int64 (battery->power_fd, &power_uw))
+        add_sample (battery, ABS (power_uw) / 1000);
+      else if (eins_read_fd_int64 (battery->current_fd, &current_ua) &&
+               eins_read_fd_int64 (battery->voltage_fd, &voltage_uv))
+        add_sample (battery,
+                    ABS (current_ua) / 1000 * ABS (voltage_uv) / 1000 / 1000);
+    }
+
+  return any_discharging;
+}
+
+/**
+ * eins_battery_take_summary:
+ *
+ * Returns: (transfer floating): the payload of the event, with the
+ *   discharge rates sampled since the last call, including those stored
+ *   before the daemon was restarted
+ */
+GVariant *
+eins_battery_take_summary (void)
+{
+  GVariantBuilder builder;
+  EinsBatterySummary summary;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(squuuuu)"));
+
+  for (guint i = 0; i < batteries->len; i++)
+    {
+      Battery *battery = g_ptr_array_index (batteries, i);
+      gint64 full, full_design, cycle_count;
+      guint16 health_permille = 0;
+
+      memset (&summary, 0, sizeof (summary));
+
+      if (battery->series >= 0)
+        {
+          g_autoptr(GArray) samples = eins_ring_store_take (store,
+                                                            battery->series);
+
+          for (guint j = 0; j < samples->len; j++)
+            eins_battery_summary_add (&summary,
+                                      g_array_index (samples, EinsRingSample,
+                                                     j).value);
+        }
+
+      if (eins_read_fd_int64 (battery->full_fd, &full) &&
+          eins_read_fd_int64 (battery->full_design_fd, &full_design) &&
+          full > 0 && full_design > 0)
+        health_permille = MIN (full * 1000 / full_design, G_MAXUINT16);
+
+      if (!eins_read_fd_int64 (battery->cycle_count_fd, &cycle_count) ||
+          cycle_count < 0)
+        cycle_count = 0;
+
+      g_variant_builder_add (&builder, "(squuuuu)", battery->name,
+                             health_permille,
+                             (guint32) MIN (cycle_count, G_MAXUINT32),
+                             summary.n_samples,
+                             eins_battery_summary_percentile (&summary, 50),
+                             eins_battery_summary_percentile (&summary, 90),
+                             eins_battery_summary_percentile (&summary, 99));
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static gboolean
+sample_battery (gpointer user_data G_GNUC_UNUSED)
+{
+  if (eins_battery_sample ())
+    return G_SOURCE_CONTINUE;
+
+  /* Plugged in without a uevent reaching us */
+  sample_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+is_any_discharging (void)
+{
+  for (guint i = 0; i < batteries->len; i++)
+    {
+      if (is_discharging (g_ptr_array_index (batteries, i)))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Starts sampling if a battery is discharging, or stops if none is. Samples
+ * are only taken by the timer: batteries also send uevents as their charge
+ * changes, which would skew the count. */
+static void
+update_sampling (void)
+{
+  gboolean discharging = is_any_discharging ();
+
+  if (discharging && sample_id == 0)
+    {
+      sample_id = eins_boottimeout_add_useconds (BATTERY_SAMPLE_INTERVAL_USECONDS,
+                                                 sample_battery, NULL);
+    }
+  else if (!discharging && sample_id != 0)
+    {
+      g_source_remove (sample_id);
+      sample_id = 0;
+    }
+}
+
+static void
+power_supply_changed_cb (GHashTable *properties G_GNUC_UNUSED,
+                         gpointer    user_data G_GNUC_UNUSED)
+{
+  update_sampling ();
+}
+
+static void
+record_battery (gpointer user_data G_GNUC_UNUSED)
+{
+  eins_recorder_record_event (BATTERY_EVENT, eins_battery_take_summary ());
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+void
+eins_battery_start (void)
+{
+  if (!eins_battery_open (SYSFS_ROOT, BATTERY_STORE_FILE_PATH))
+    {
+      g_debug ("No system battery found");
+      eins_battery_close ();
+      return;
+    }
+
+  update_sampling ();
+  uevent_watch_id = eins_uevent_monitor_add ("power_supply",
+                                             power_supply_changed_cb, NULL);
+  eins_schedule_add ("battery", BATTERY_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_battery, NULL);
+}
+
+/* Samples already in the store are recorded once it is started again. */
+void
+eins_battery_stop (void)
+{
+  eins_schedule_remove ("battery");
+  g_clear_handle_id (&uevent_watch_id, eins_uevent_monitor_remove);
+  g_clear_handle_id (&sample_id, g_source_remove);
+  eins_battery_close ();
+}
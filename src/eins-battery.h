@@ -0,0 +1,46 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_battery_start (void);
+void eins_battery_stop (void);
+
+/* For tests */
+
+/* Discharge rates are counted in buckets of 100 mW, up to 100 W */
+#define EINS_BATTERY_BUCKET_MILLIWATTS 100
+#define EINS_BATTERY_N_BUCKETS 1000
+
+typedef struct {
+  guint32 n_samples;
+  guint32 buckets[EINS_BATTERY_N_BUCKETS];
+} EinsBatterySummary;
+
+void eins_battery_summary_add (EinsBatterySummary *summary,
+                               guint64             milliwatts);
+guint32 eins_battery_summary_percentile (const EinsBatterySummary *summary,
+                                         guint                     percentile);
+
+gboolean eins_battery_open (const gchar *sysfs_root,
+                           const gchar *store_path);
+gboolean eins_battery_sample (void);
+GVariant *eins_battery_take_summary (void);
+void eins_battery_close (void);
@@ -0,0 +1,568 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-boot-blame.h"
+#include "eins-boot-id.h"
+#include "eins-recorder.h"
+#include "eins-stats.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+/*
+ * Boot blame event, recorded once per boot after startup has finished, with
+ * payload "(a(su)a(suu))".
+ *
+ * Field  | Description
+ * -------+----------------------------------------------------------------
+ *  a(su) | The slowest units to activate, slowest first: the unit's name
+ *        | and how long it took to activate, in milliseconds.
+ * a(suu) | The critical chain, starting from the default target and
+ *        | working back towards the start of userspace: the unit's name,
+ *        | when it became active relative to the start of userspace, and
+ *        | how long it took to activate, both in milliseconds.
+ *
+ * A unit's activation time is the time between it leaving the inactive state
+ * and entering the active state, as shown by systemd-analyze blame. The
+ * critical chain is found the same way as by systemd-analyze critical-chain:
+ * each unit is followed by whichever of the units it is ordered after became
+ * active last, before the unit itself started activating.
+ *
+ * systemd has no call returning the properties of many units, so each loaded
+ * unit's are fetched with its own Properties.GetAll call. Up to
+ * BOOT_BLAME_MAX_PENDING_CALLS of these are in flight at once, with the next
+ * sent as each reply arrives: enough to hide the round trips, without going
+ * past the bus's limit on replies pending per connection, which would fail
+ * the excess calls. If any call fails, nothing is recorded for this boot
+ * rather than a blame list missing some units' times.
+ */
+
+#define BOOT_BLAME_EVENT "6ecb67a1-7651-47af-83bc-da80dd23ea14"
+
+#define BOOT_BLAME_TYPE_STRING "(a(su)a(suu))"
+
+#define BOOT_BLAME_N_SLOWEST 10
+
+/* Bounds the number of Properties.GetAll calls awaiting a reply, well below
+ * dbus-daemon's default max_replies_per_connection. */
+#define BOOT_BLAME_MAX_PENDING_CALLS 32
+
+/* Bounds the chain in case of a pathological ordering graph. */
+#define BOOT_BLAME_MAX_CHAIN_LENGTH 32
+
+/* The path of a file holding the boot ID of the last boot reported. */
+#define BOOT_BLAME_FILE_PATH INSTRUMENTATION_CACHE_DIR "/boot-blame"
+
+#define SYSTEMD_BUS_NAME "org.freedesktop.systemd1"
+#define SYSTEMD_OBJECT_PATH "/org/freedesktop/systemd1"
+#define SYSTEMD_MANAGER_INTERFACE "org.freedesktop.systemd1.Manager"
+#define SYSTEMD_UNIT_INTERFACE "org.freedesktop.systemd1.Unit"
+
+typedef struct {
+  GDBusConnection *connection;
+  /* Cancelled when the collection is freed, so that replies still pending
+   * don't touch it */
+  GCancellable *cancellable;
+  gchar boot_id[EINS_BOOT_ID_LENGTH + 1];
+  guint64 userspace_start;
+  gchar *default_target;
+  /* Element type: EinsBootUnit */
+  GPtrArray *units;
+  /* Object path of each unit in @units; element type: gchar* */
+  GPtrArray *object_paths;
+  /* Index in @units of the next unit to ask for the properties of */
+  guint next_unit;
+  /* Number of Properties.GetAll calls awaiting a reply */
+  guint n_pending;
+} Collection;
+
+/* Non-NULL while a collection is in progress */
+static Collection *collection;
+
+/* Whether this boot has already been reported */
+static gboolean collected;
+
+void
+eins_boot_unit_free (EinsBootUnit *unit)
+{
+  g_free (unit->name);
+  g_strfreev (unit->after);
+  g_free (unit);
+}
+
+static guint32
+usec_to_msec (guint64 usec)
+{
+  return MIN ((usec + 500) / 1000, G_MAXUINT32);
+}
+
+static guint64
+activation_time (const EinsBootUnit *unit)
+{
+  if (unit->activating == 0 || unit->activated < unit->activating)
+    return 0;
+
+  return unit->activated - unit->activating;
+}
+
+static gint
+compare_activation_time (gconstpointer a,
+                         gconstpointer b)
+{
+  const EinsBootUnit *unit_a = *(const EinsBootUnit **) a;
+  const EinsBootUnit *unit_b = *(const EinsBootUnit **) b;
+  guint64 time_a = activation_time (unit_a);
+  guint64 time_b = activation_time (unit_b);
+
+  if (time_a != time_b)
+    return time_a > time_b ? -1 : 1;
+
+  return strcmp (unit_a->name, unit_b->name);
+}
+
+/*
+ * Returns the unit in @after which became active last, but no later than
+ * @before, ignoring those in @visited.
+ */
+static EinsBootUnit *
+find_blocking_unit (GHashTable         *unit_by_name,
+                    GHashTable         *visited,
+                    const gchar *const *after,
+                    guint64             before)
+{
+  EinsBootUnit *blocking = NULL;
+
+  for (gsize i = 0; after != NULL && after[i] != NULL; i++)
+    {
+      EinsBootUnit *dep = g_hash_table_lookup (unit_by_name, after[i]);
+
+      if (dep == NULL || g_hash_table_contains (visited, dep) ||
+          dep->activated == 0 || dep->activated > before)
+        continue;
+
+      if (blocking == NULL || dep->activated > blocking->activated)
+        blocking = dep;
+    }
+
+  return blocking;
+}
+
+/**
+ * eins_boot_blame_compute:
+ * @units: (element-type EinsBootUnit): every loaded unit
+ * @default_target: name of the unit the system booted into
+ * @userspace_start: CLOCK_MONOTONIC time at which userspace started, in
+ *   microseconds
+ * @n_slowest: how many of the slowest units to report
+ *
+ * Returns: (transfer floating): the payload of the boot blame event
+ */
+GVariant *
+eins_boot_blame_compute (GPtrArray   *units,
+                         const gchar *default_target,
+                         guint64      userspace_start,
+                         guint        n_slowest)
+{
+  g_autoptr(GPtrArray) slowest = g_ptr_array_new ();
+  g_autoptr(GHashTable) unit_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+  g_autoptr(GHashTable) visited = g_hash_table_new (NULL, NULL);
+  GVariantBuilder slowest_builder, chain_builder;
+  EinsBootUnit *unit;
+
+  g_return_val_if_fail (units != NULL, NULL);
+  g_return_val_if_fail (default_target != NULL, NULL);
+
+  for (guint i = 0; i < units->len; i++)
+    {
+      unit = g_ptr_array_index (units, i);
+      g_hash_table_insert (unit_by_name, unit->name, unit);
+
+      if (activation_time (unit) > 0)
+        g_ptr_array_add (slowest, unit);
+    }
+
+  g_ptr_array_sort (slowest, compare_activation_time);
+
+  g_variant_builder_init (&slowest_builder, G_VARIANT_TYPE ("a(su)"));
+  for (guint i = 0; i < slowest->len && i < n_slowest; i++)
+    {
+      unit = g_ptr_array_index (slowest, i);
+      g_variant_builder_add (&slowest_builder, "(su)", unit->name,
+                             usec_to_msec (activation_time (unit)));
+    }
+
+  g_variant_builder_init (&chain_builder, G_VARIANT_TYPE ("a(suu)"));
+  unit = g_hash_table_lookup (unit_by_name, default_target);
+  for (guint i = 0; unit != NULL && i < BOOT_BLAME_MAX_CHAIN_LENGTH; i++)
+    {
+      guint64 since_userspace = unit->activated > userspace_start ?
+        unit->activated - userspace_start : 0;
+
+      g_variant_builder_add (&chain_builder, "(suu)", unit->name,
+                             usec_to_msec (since_userspace),
+                             usec_to_msec (activation_time (unit)));
+      g_hash_table_add (visited, unit);
+
+      unit = find_blocking_unit (unit_by_name, visited,
+                                 (const gchar * const *) unit->after,
+                                 unit->activating != 0 ?
+                                 unit->activating : unit->activated);
+    }
+
+  return g_variant_new (BOOT_BLAME_TYPE_STRING, &slowest_builder,
+                        &chain_builder);
+}
+
+static gboolean
+already_collected (const gchar *boot_id)
+{
+  g_autofree gchar *contents = NULL;
+
+  if (!g_file_get_contents (BOOT_BLAME_FILE_PATH, &contents, NULL, NULL))
+    return FALSE;
+
+  return strcmp (g_strstrip (contents), boot_id) == 0;
+}
+
+static void
+collection_free (Collection *self)
+{
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+  g_clear_object (&self->connection);
+  g_free (self->default_target);
+  g_clear_pointer (&self->units, g_ptr_array_unref);
+  g_clear_pointer (&self->object_paths, g_ptr_array_unref);
+  g_free (self);
+}
+
+static void
+finish_collection (void)
+{
+  g_autoptr(GError) error = NULL;
+  GVariant *payload;
+
+  payload = eins_boot_blame_compute (collection->units,
+                                     collection->default_target,
+                                     collection->userspace_start,
+                                     BOOT_BLAME_N_SLOWEST);
+  eins_recorder_record_event (BOOT_BLAME_EVENT, payload);
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+  collected = TRUE;
+
+  if (!g_file_set_contents (BOOT_BLAME_FILE_PATH, collection->boot_id, -1,
+                            &error))
+    g_warning ("Failed to write " BOOT_BLAME_FILE_PATH ": %s", error->message);
+
+  g_clear_pointer (&collection, collection_free);
+}
+
+static void
+abandon_collection (const gchar  *what,
+                    const GError *error)
+{
+  g_warning ("Failed to %s: %s", what, error->message);
+  g_clear_pointer (&collection, collection_free);
+}
+
+static void
+get_property (const gchar         *object_path,
+              const gchar         *interface,
+              const gchar         *name,
+              GAsyncReadyCallback  callback,
+              gpointer             user_data)
+{
+  g_dbus_connection_call (collection->connection,
+                          SYSTEMD_BUS_NAME,
+                          object_path,
+                          "org.freedesktop.DBus.Properties",
+                          "Get",
+                          g_variant_new ("(ss)", interface, name),
+                          G_VARIANT_TYPE ("(v)"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1 /* timeout */,
+                          collection->cancellable,
+                          callback,
+                          user_data);
+}
+
+/* Returns the value of the property, or NULL with @error set */
+static GVariant *
+get_property_finish (GObject       *source,
+                     GAsyncResult  *result,
+                     GError       **error)
+{
+  g_autoptr(GVariant) reply = NULL;
+  GVariant *value;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result,
+                                         error);
+  if (reply == NULL)
+    return NULL;
+
+  g_variant_get (reply, "(v)", &value);
+  return value;
+}
+
+static void get_next_unit_properties (void);
+
+static void
+got_unit_properties_cb (GObject      *source,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+  EinsBootUnit *unit = user_data;
+  g_autoptr(GVariant) reply = NULL;
+  g_autoptr(GVariant) properties = NULL;
+  g_autoptr(GError) error = NULL;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result,
+                                         &error);
+
+  /* The collection, and @unit with it, has already been abandoned */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  if (reply == NULL)
+    {
+      g_autofree gchar *what = g_strdup_printf ("get the properties of %s",
+                                                unit->name);
+
+      abandon_collection (what, error);
+      return;
+    }
+
+  g_variant_get (reply, "(@a{sv})", &properties);
+  g_variant_lookup (properties, "InactiveExitTimestampMonotonic", "t",
+                    &unit->activating);
+  g_variant_lookup (properties, "ActiveEnterTimestampMonotonic", "t",
+                    &unit->activated);
+  g_variant_lookup (properties, "After", "^as", &unit->after);
+
+  collection->n_pending--;
+  get_next_unit_properties ();
+}
+
+/* Sends Properties.GetAll calls for the next units, up to
+ * BOOT_BLAME_MAX_PENDING_CALLS awaiting a reply, and finishes the
+ * collection once every reply has arrived. */
+static void
+get_next_unit_properties (void)
+{
+  while (collection->n_pending < BOOT_BLAME_MAX_PENDING_CALLS &&
+         collection->next_unit < collection->units->len)
+    {
+      guint i = collection->next_unit++;
+
+      g_dbus_connection_call (collection->connection,
+                              SYSTEMD_BUS_NAME,
+                              g_ptr_array_index (collection->object_paths, i),
+                              "org.freedesktop.DBus.Properties",
+                              "GetAll",
+                              g_variant_new ("(s)", SYSTEMD_UNIT_INTERFACE),
+                              G_VARIANT_TYPE ("(a{sv})"),
+                              G_DBUS_CALL_FLAGS_NONE,
+                              -1 /* timeout */,
+                              collection->cancellable,
+                              got_unit_properties_cb,
+                              g_ptr_array_index (collection->units, i));
+      collection->n_pending++;
+    }
+
+  if (collection->n_pending == 0)
+    finish_collection ();
+}
+
+static void
+got_units_cb (GObject      *source,
+              GAsyncResult *result,
+              gpointer      user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GVariant) reply = NULL;
+  g_autoptr(GVariantIter) iter = NULL;
+  g_autoptr(GError) error = NULL;
+  const gchar *name, *load_state, *object_path;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result,
+                                         &error);
+  if (reply == NULL)
+    {
+      abandon_collection ("list units", error);
+      return;
+    }
+
+  g_variant_get (reply, "(a(ssssssouso))", &iter);
+  while (g_variant_iter_loop (iter, "(&s&s&s&s&s&s&ou&s&o)",
+                              &name, NULL, &load_state, NULL, NULL, NULL,
+                              &object_path, NULL, NULL, NULL))
+    {
+      EinsBootUnit *unit;
+
+      if (strcmp (load_state, "loaded") != 0)
+        continue;
+
+      unit = g_new0 (EinsBootUnit, 1);
+      unit->name = g_strdup (name);
+      g_ptr_array_add (collection->units, unit);
+      g_ptr_array_add (collection->object_paths, g_strdup (object_path));
+    }
+
+  get_next_unit_properties ();
+}
+
+static void
+got_default_target_cb (GObject      *source,
+                       GAsyncResult *result,
+                       gpointer      user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GVariant) reply = NULL;
+  g_autoptr(GError) error = NULL;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result,
+                                         &error);
+  if (reply == NULL)
+    {
+      abandon_collection ("get the default target", error);
+      return;
+    }
+
+  g_variant_get (reply, "(s)", &collection->default_target);
+
+  g_dbus_connection_call (collection->connection,
+                          SYSTEMD_BUS_NAME,
+                          SYSTEMD_OBJECT_PATH,
+                          SYSTEMD_MANAGER_INTERFACE,
+                          "ListUnits",
+                          NULL /* parameters */,
+                          G_VARIANT_TYPE ("(a(ssssssouso))"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1 /* timeout */,
+                          collection->cancellable,
+                          got_units_cb,
+                          NULL);
+}
+
+static void
+got_userspace_timestamp_cb (GObject      *source,
+                            GAsyncResult *result,
+                            gpointer      user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GVariant) value = NULL;
+  g_autoptr(GError) error = NULL;
+
+  value = get_property_finish (source, result, &error);
+  if (value == NULL)
+    {
+      abandon_collection ("get the start time of userspace", error);
+      return;
+    }
+
+  if (g_variant_is_of_type (value, G_VARIANT_TYPE_UINT64))
+    collection->userspace_start = g_variant_get_uint64 (value);
+
+  g_dbus_connection_call (collection->connection,
+                          SYSTEMD_BUS_NAME,
+                          SYSTEMD_OBJECT_PATH,
+                          SYSTEMD_MANAGER_INTERFACE,
+                          "GetDefaultTarget",
+                          NULL /* parameters */,
+                          G_VARIANT_TYPE ("(s)"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1 /* timeout */,
+                          collection->cancellable,
+                          got_default_target_cb,
+                          NULL);
+}
+
+static void
+got_finish_timestamp_cb (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GVariant) value = NULL;
+  g_autoptr(GError) error = NULL;
+
+  value = get_property_finish (source, result, &error);
+  if (value == NULL)
+    {
+      abandon_collection ("get the time startup finished", error);
+      return;
+    }
+
+  /* We will be called again when startup finishes. */
+  if (!g_variant_is_of_type (value, G_VARIANT_TYPE_UINT64) ||
+      g_variant_get_uint64 (value) == 0)
+    {
+      g_debug ("Startup has not finished yet");
+      g_clear_pointer (&collection, collection_free);
+      return;
+    }
+
+  get_property (SYSTEMD_OBJECT_PATH, SYSTEMD_MANAGER_INTERFACE,
+                "UserspaceTimestampMonotonic", got_userspace_timestamp_cb,
+                NULL);
+}
+
+/**
+ * eins_boot_blame_collect:
+ *
+ * Records the boot blame event for this boot, unless it has already been
+ * recorded or startup has not finished yet. Call this once when the daemon
+ * starts and again when startup finishes.
+ */
+void
+eins_boot_blame_collect (void)
+{
+  g_autoptr(GDBusConnection) connection = NULL;
+  g_autoptr(GError) error = NULL;
+  gchar boot_id[EINS_BOOT_ID_LENGTH + 1];
+
+  if (collected || collection != NULL)
+    return;
+
+  if (!eins_read_boot_id (boot_id, &error))
+    {
+      g_warning ("Failed to read boot ID: %s", error->message);
+      return;
+    }
+
+  if (already_collected (boot_id))
+    {
+      collected = TRUE;
+      return;
+    }
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+  if (connection == NULL)
+    {
+      g_warning ("Failed to connect to the system bus: %s", error->message);
+      return;
+    }
+
+  collection = g_new0 (Collection, 1);
+  collection->connection = g_steal_pointer (&connection);
+  memcpy (collection->boot_id, boot_id, sizeof (boot_id));
+  collection->cancellable = g_cancellable_new ();
+  collection->units =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) eins_boot_unit_free);
+  collection->object_paths = g_ptr_array_new_with_free_func (g_free);
+
+  get_property (SYSTEMD_OBJECT_PATH, SYSTEMD_MANAGER_INTERFACE,
+                "FinishTimestampMonotonic", got_finish_timestamp_cb, NULL);
+}
@@ -0,0 +1,42 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_boot_blame_collect (void);
+
+/* For tests */
+typedef struct {
+  gchar *name;
+  /* CLOCK_MONOTONIC times at which the unit started and finished activating,
+   * in microseconds; 0 if unknown. */
+  guint64 activating;
+  guint64 activated;
+  /* Units this one is ordered after */
+  GStrv after;
+} EinsBootUnit;
+
+void eins_boot_unit_free (EinsBootUnit *unit);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (EinsBootUnit, eins_boot_unit_free)
+
+GVariant *eins_boot_blame_compute (GPtrArray   *units,
+                                   const gchar *default_target,
+                                   guint64      userspace_start,
+                                   guint        n_slowest);
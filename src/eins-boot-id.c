@@ -0,0 +1,59 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-boot-id.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+#define BOOT_ID_PATH "/proc/sys/kernel/random/boot_id"
+
+/**
+ * eins_read_boot_id:
+ * @boot_id: (out caller-allocates): return location for the boot ID
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads the kernel's random ID for the current boot, which can be stored
+ * alongside state that is only valid until the next reboot.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+eins_read_boot_id (gchar    boot_id[EINS_BOOT_ID_LENGTH + 1],
+                   GError **error)
+{
+  g_autofree gchar *contents = NULL;
+
+  g_return_val_if_fail (boot_id != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (!g_file_get_contents (BOOT_ID_PATH, &contents, NULL, error))
+    return FALSE;
+
+  g_strstrip (contents);
+  if (strlen (contents) != EINS_BOOT_ID_LENGTH)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Unexpected contents of %s: %s", BOOT_ID_PATH, contents);
+      return FALSE;
+    }
+
+  memcpy (boot_id, contents, EINS_BOOT_ID_LENGTH + 1);
+  return TRUE;
+}
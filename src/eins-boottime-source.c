@@ -18,6 +18,9 @@
  */
 
 #include "eins-boottime-source.h"
+#include "eins-clock.h"
+#include "eins-stats.h"
+#include "eins-trace.h"
 
 #include <errno.h>
 #include <inttypes.h>
@@ -50,6 +53,7 @@ eins_boottime_source_dispatch (GSource    *source,
 {
   EinsBoottimeSource *self = (EinsBoottimeSource *) source;
   uint64_t n_expirations = 0;
+  gboolean ret;
 
   if (callback == NULL)
     {
@@ -66,7 +70,13 @@ eins_boottime_source_dispatch (GSource    *source,
       return G_SOURCE_REMOVE;
     }
 
-  return callback (user_data);
+  eins_stats_counter_inc (EINS_STATS_COUNTER_BOOTTIME_DISPATCHES);
+
+  EINS_TRACE_BEGIN (boottime_dispatch);
+  ret = callback (user_data);
+  EINS_TRACE_END (boottime_dispatch);
+
+  return ret;
 }
 
 static void
@@ -162,6 +172,9 @@ eins_boottime_source_new_useconds (guint64   interval_us,
  * If @interval_us is set to zero, the #GSource will be ready the next time it's
  * checked.
  *
+ * While eins_clock_use_virtual() is in effect, the timeout runs on the virtual
+ * boottime clock instead; see eins-clock.c.
+ *
  * Returns: the ID (greater than 0) of the event source.
  */
 guint
@@ -171,7 +184,12 @@ eins_boottimeout_add_useconds (guint64     interval_us,
 {
   guint id;
   g_autoptr(GError) error = NULL;
-  GSource *source = eins_boottime_source_new_useconds (interval_us, &error);
+  GSource *source;
+
+  if (eins_clock_is_virtual ())
+    source = eins_clock_virtual_timeout_source_new (interval_us);
+  else
+    source = eins_boottime_source_new_useconds (interval_us, &error);
 
   if (!source)
     {
@@ -0,0 +1,254 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-clock.h"
+
+#include <time.h>
+
+/*
+ * The clocks which scheduling depends on: wall-clock time, and CLOCK_BOOTTIME,
+ * which keeps counting while the system is suspended.
+ *
+ * Tests can replace both with virtual clocks, which only move when told to.
+ * eins_boottimeout_add_useconds() then returns virtual timeouts, which fire
+ * when eins_clock_advance() moves virtual boottime past their deadline, so a
+ * week of scheduling runs in milliseconds. Advancing stands equally for time
+ * awake and time suspended, since both count on CLOCK_BOOTTIME; wall-clock
+ * time moves with it, unless set with eins_clock_set_real_time() as when the
+ * clock is adjusted.
+ */
+
+typedef struct {
+  GSource parent;
+
+  guint64 interval_us;
+  /* On the virtual boottime clock */
+  gint64 deadline;
+} VirtualTimeout;
+
+static gboolean use_virtual;
+static gint64 virtual_real_time;
+static gint64 virtual_boottime;
+/* Element type: VirtualTimeout, not owned */
+static GList *virtual_timeouts;
+
+gint64
+eins_clock_get_real_time (void)
+{
+  if (use_virtual)
+    return virtual_real_time;
+
+  return g_get_real_time ();
+}
+
+gint64
+eins_clock_get_boottime (void)
+{
+  struct timespec ts;
+
+  if (use_virtual)
+    return virtual_boottime;
+
+  if (clock_gettime (CLOCK_BOOTTIME, &ts) < 0)
+    g_error ("clock_gettime (CLOCK_BOOTTIME) failed");
+
+  return ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+gboolean
+eins_clock_is_virtual (void)
+{
+  return use_virtual;
+}
+
+/* As with a timerfd, an interval of 0 disarms the timeout. */
+static gint64
+get_deadline (guint64 interval_us)
+{
+  return interval_us > 0 ? virtual_boottime + (gint64) interval_us : G_MAXINT64;
+}
+
+static gboolean
+virtual_timeout_prepare (GSource *source,
+                         gint    *timeout)
+{
+  VirtualTimeout *self = (VirtualTimeout *) source;
+
+  /* Only eins_clock_advance() can make it ready */
+  *timeout = -1;
+
+  return self->deadline <= virtual_boottime;
+}
+
+static gboolean
+virtual_timeout_check (GSource *source)
+{
+  VirtualTimeout *self = (VirtualTimeout *) source;
+
+  return self->deadline <= virtual_boottime;
+}
+
+static gboolean
+virtual_timeout_dispatch (GSource     *source,
+                          GSourceFunc  callback,
+                          gpointer     user_data)
+{
+  VirtualTimeout *self = (VirtualTimeout *) source;
+
+  if (callback == NULL)
+    {
+      g_warning ("Virtual timeout dispatched without callback. "
+                 "You must call g_source_set_callback().");
+      return G_SOURCE_REMOVE;
+    }
+
+  /* Like a timerfd, fire once however many intervals were missed */
+  self->deadline = get_deadline (self->interval_us);
+
+  return callback (user_data);
+}
+
+static void
+virtual_timeout_finalize (GSource *source)
+{
+  virtual_timeouts = g_list_remove (virtual_timeouts, source);
+}
+
+static const GSourceFuncs virtual_timeout_funcs = {
+  .prepare = virtual_timeout_prepare,
+  .check = virtual_timeout_check,
+  .dispatch = virtual_timeout_dispatch,
+  .finalize = virtual_timeout_finalize,
+};
+
+/**
+ * eins_clock_virtual_timeout_source_new:
+ * @interval_us: the timeout interval, in microseconds
+ *
+ * Returns: (transfer full): a source which fires every @interval_us of
+ *   virtual boottime
+ */
+GSource *
+eins_clock_virtual_timeout_source_new (guint64 interval_us)
+{
+  GSource *source;
+  VirtualTimeout *self;
+
+  g_return_val_if_fail (use_virtual, NULL);
+
+  source = g_source_new ((GSourceFuncs *) &virtual_timeout_funcs,
+                         sizeof (VirtualTimeout));
+  self = (VirtualTimeout *) source;
+  self->interval_us = interval_us;
+  self->deadline = get_deadline (interval_us);
+  virtual_timeouts = g_list_prepend (virtual_timeouts, self);
+
+  return source;
+}
+
+/**
+ * eins_clock_use_virtual:
+ * @real_time_us: the initial wall-clock time, in microseconds since the
+ *   epoch
+ *
+ * Replaces both clocks with virtual ones for the rest of the process's
+ * lifetime. Virtual boottime starts at 0.
+ */
+void
+eins_clock_use_virtual (gint64 real_time_us)
+{
+  use_virtual = TRUE;
+  virtual_real_time = real_time_us;
+  virtual_boottime = 0;
+}
+
+/* Dispatches everything which is ready, including sources added by those
+ * dispatched. */
+static void
+dispatch_ready (void)
+{
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+}
+
+static VirtualTimeout *
+get_next_timeout (void)
+{
+  VirtualTimeout *next = NULL;
+
+  for (GList *l = virtual_timeouts; l != NULL; l = l->next)
+    {
+      VirtualTimeout *timeout = l->data;
+
+      if (g_source_is_destroyed ((GSource *) timeout))
+        continue;
+
+      if (next == NULL || timeout->deadline < next->deadline)
+        next = timeout;
+    }
+
+  return next;
+}
+
+/**
+ * eins_clock_advance:
+ * @elapsed_us: how far to move both clocks
+ *
+ * Moves virtual boottime and wall-clock time forward by @elapsed_us. Each
+ * virtual timeout which falls due on the way is dispatched at its deadline,
+ * in order, along with any other source which is ready then, such as idles.
+ */
+void
+eins_clock_advance (guint64 elapsed_us)
+{
+  gint64 target;
+  VirtualTimeout *next;
+
+  g_return_if_fail (use_virtual);
+
+  target = virtual_boottime + (gint64) elapsed_us;
+
+  dispatch_ready ();
+
+  while ((next = get_next_timeout ()) != NULL && next->deadline <= target)
+    {
+      virtual_real_time += next->deadline - virtual_boottime;
+      virtual_boottime = next->deadline;
+      dispatch_ready ();
+    }
+
+  virtual_real_time += target - virtual_boottime;
+  virtual_boottime = target;
+  dispatch_ready ();
+}
+
+/**
+ * eins_clock_set_real_time:
+ * @real_time_us: the new wall-clock time, in microseconds since the epoch
+ *
+ * Sets the virtual wall-clock time without moving virtual boottime, as when
+ * the system clock is adjusted.
+ */
+void
+eins_clock_set_real_time (gint64 real_time_us)
+{
+  g_return_if_fail (use_virtual);
+
+  virtual_real_time = real_time_us;
+}
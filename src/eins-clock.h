@@ -0,0 +1,32 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+gint64 eins_clock_get_real_time (void);
+gint64 eins_clock_get_boottime (void);
+
+gboolean eins_clock_is_virtual (void);
+GSource *eins_clock_virtual_timeout_source_new (guint64 interval_us);
+
+/* For tests */
+void eins_clock_use_virtual (gint64 real_time_us);
+void eins_clock_advance (guint64 elapsed_us);
+void eins_clock_set_real_time (gint64 real_time_us);
@@ -0,0 +1,266 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-config.h"
+
+/*
+ * The daemon's configuration is a key file, read at startup and again when
+ * the daemon receives SIGHUP. Every key is optional. Each collector has a
+ * group named after its task in eins-schedule.c:
+ *
+ *   [psi]
+ *   # Whether to collect and record at all
+ *   enabled=true
+ *   # How often to record the event, in seconds
+ *   interval=86400
+ *   # Up to how long to delay each recording by, at random, in seconds
+ *   jitter=3600
+ *
+ * Some collectors also read thresholds from their group, as documented where
+ * they are used; and the daemon itself reads the [daemon] group. Values which
+ * are missing or can't be parsed fall back to the built-in defaults, which
+ * are also used when the file doesn't exist.
+ *
+ * Values are parsed and checked once, when the file is read, and any which
+ * are invalid are warned about then. Callers look them up each time they are
+ * used, which is cheap, so they see a reload without having to be told about
+ * it, except for the scheduling keys which eins_schedule_reload() applies.
+ */
+
+typedef enum {
+  KEY_TYPE_BOOLEAN,
+  KEY_TYPE_UINT64,
+} KeyType;
+
+typedef struct {
+  const gchar *name;
+  KeyType type;
+  /* Largest valid value, for KEY_TYPE_UINT64 */
+  guint64 max;
+} KnownKey;
+
+/* Every key read from any group */
+static const KnownKey known_keys[] = {
+  { "enabled", KEY_TYPE_BOOLEAN, 0 },
+  { "interval", KEY_TYPE_UINT64, G_MAXUINT64 },
+  { "jitter", KEY_TYPE_UINT64, G_MAXUINT64 },
+  { "min-samples", KEY_TYPE_UINT64, G_MAXUINT64 },
+  { "idle-percent", KEY_TYPE_UINT64, 100 },
+  { "timeout", KEY_TYPE_UINT64, G_MAXUINT64 },
+  { "idle-exit-timeout", KEY_TYPE_UINT64, G_MAXUINT64 },
+  { "checkpoint-interval", KEY_TYPE_UINT64, G_MAXUINT64 },
+};
+
+static gchar *config_path;
+/* Map from group (owned) to a map from key (owned) to its value as a
+ * guint64 (owned); booleans are stored as 0 or 1 */
+static GHashTable *config;
+
+static const KnownKey *
+lookup_known_key (const gchar *name)
+{
+  for (gsize i = 0; i < G_N_ELEMENTS (known_keys); i++)
+    {
+      if (g_str_equal (known_keys[i].name, name))
+        return &known_keys[i];
+    }
+
+  return NULL;
+}
+
+/* Returns whether the value of the key is valid, warning if it isn't. */
+static gboolean
+parse_value (GKeyFile       *key_file,
+             const gchar    *group,
+             const KnownKey *known_key,
+             guint64        *value)
+{
+  g_autoptr(GError) error = NULL;
+
+  switch (known_key->type)
+    {
+    case KEY_TYPE_BOOLEAN:
+      *value = g_key_file_get_boolean (key_file, group, known_key->name,
+                                       &error);
+      break;
+
+    case KEY_TYPE_UINT64:
+      *value = g_key_file_get_uint64 (key_file, group, known_key->name,
+                                      &error);
+      if (error == NULL && *value > known_key->max)
+        {
+          g_warning ("Ignoring [%s] %s in %s: %" G_GUINT64_FORMAT " is more "
+                     "than %" G_GUINT64_FORMAT, group, known_key->name,
+                     config_path, *value, known_key->max);
+          return FALSE;
+        }
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  if (error != NULL)
+    {
+      g_warning ("Ignoring [%s] %s in %s: %s", group, known_key->name,
+                 config_path, error->message);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GHashTable *
+parse_config (GKeyFile *key_file)
+{
+  g_autoptr(GHashTable) parsed = NULL;
+  g_auto(GStrv) groups = NULL;
+
+  parsed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                  (GDestroyNotify) g_hash_table_unref);
+  groups = g_key_file_get_groups (key_file, NULL);
+
+  for (gsize i = 0; groups[i] != NULL; i++)
+    {
+      g_auto(GStrv) keys = g_key_file_get_keys (key_file, groups[i], NULL,
+                                                NULL);
+      GHashTable *group_values;
+
+      group_values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                            g_free);
+      g_hash_table_insert (parsed, g_strdup (groups[i]), group_values);
+
+      for (gsize j = 0; keys != NULL && keys[j] != NULL; j++)
+        {
+          const KnownKey *known_key = lookup_known_key (keys[j]);
+          guint64 value;
+          guint64 *stored;
+
+          if (known_key == NULL)
+            {
+              g_warning ("Ignoring unknown key [%s] %s in %s", groups[i],
+                         keys[j], config_path);
+              continue;
+            }
+
+          if (!parse_value (key_file, groups[i], known_key, &value))
+            continue;
+
+          stored = g_new (guint64, 1);
+          *stored = value;
+          g_hash_table_insert (group_values, g_strdup (keys[j]), stored);
+        }
+    }
+
+  return g_steal_pointer (&parsed);
+}
+
+/**
+ * eins_config_load:
+ * @path: path of the configuration file
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads the configuration from @path, replacing any read before. A missing
+ * file is not an error: all values take their defaults.
+ *
+ * Returns: %TRUE on success; on failure, the previous configuration is kept
+ */
+gboolean
+eins_config_load (const gchar  *path,
+                  GError      **error)
+{
+  g_autoptr(GKeyFile) key_file = g_key_file_new ();
+  g_autoptr(GError) local_error = NULL;
+
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (path != config_path)
+    {
+      g_free (config_path);
+      config_path = g_strdup (path);
+    }
+
+  if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE,
+                                  &local_error) &&
+      !g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+    {
+      g_propagate_error (error, g_steal_pointer (&local_error));
+      return FALSE;
+    }
+
+  g_clear_pointer (&config, g_hash_table_unref);
+  config = parse_config (key_file);
+
+  return TRUE;
+}
+
+/**
+ * eins_config_reload:
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads the file last passed to eins_config_load() again.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+eins_config_reload (GError **error)
+{
+  g_return_val_if_fail (config_path != NULL, FALSE);
+
+  return eins_config_load (config_path, error);
+}
+
+/* Returns the parsed value of the key, or NULL if it is missing or
+ * invalid. */
+static const guint64 *
+lookup_value (const gchar *group,
+              const gchar *key)
+{
+  GHashTable *group_values;
+
+  if (config == NULL)
+    return NULL;
+
+  group_values = g_hash_table_lookup (config, group);
+  if (group_values == NULL)
+    return NULL;
+
+  return g_hash_table_lookup (group_values, key);
+}
+
+gboolean
+eins_config_get_boolean (const gchar *group,
+                         const gchar *key,
+                         gboolean     default_value)
+{
+  const guint64 *value = lookup_value (group, key);
+
+  return value != NULL ? (gboolean) *value : default_value;
+}
+
+guint64
+eins_config_get_uint64 (const gchar *group,
+                        const gchar *key,
+                        guint64      default_value)
+{
+  const guint64 *value = lookup_value (group, key);
+
+  return value != NULL ? *value : default_value;
+}
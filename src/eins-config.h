@@ -0,0 +1,38 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/*
+ * If this environment variable is set, the daemon reads its configuration
+ * from the file it names rather than from the installed one.
+ */
+#define EINS_CONFIG_FILE_ENV "EINS_CONFIG_FILE"
+
+gboolean eins_config_load (const gchar  *path,
+                           GError      **error);
+gboolean eins_config_reload (GError **error);
+
+gboolean eins_config_get_boolean (const gchar *group,
+                                  const gchar *key,
+                                  gboolean     default_value);
+guint64 eins_config_get_uint64 (const gchar *group,
+                                const gchar *key,
+                                guint64      default_value);
@@ -0,0 +1,225 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-cpu-flags.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+/*
+ * The dictionary. Never remove or reorder entries: the index of each flag is
+ * its bit in the bitmap, and decoding old events depends on it. To add flags,
+ * append them, bump EINS_CPU_FLAGS_VERSION, and append the new length to
+ * FLAGS_PER_VERSION. Names listed by several architectures appear once.
+ */
+static const gchar * const FLAGS[] = {
+  /* x86, in the order of the kernel's arch/x86/include/asm/cpufeatures.h */
+  "fpu", "vme", "de", "pse", "tsc", "msr", "pae", "mce", "cx8", "apic", "sep",
+  "mtrr", "pge", "mca", "cmov", "pat", "pse36", "pn", "clflush", "dts",
+  "acpi", "mmx", "fxsr", "sse", "sse2", "ss", "ht", "tm", "ia64", "pbe",
+  "syscall", "mp", "nx", "mmxext", "fxsr_opt", "pdpe1gb", "rdtscp", "lm",
+  "3dnowext", "3dnow", "recovery", "longrun", "lrti", "cxmmx", "k6_mtrr",
+  "cyrix_arr", "centaur_mcr", "constant_tsc", "up", "art", "arch_perfmon",
+  "pebs", "bts", "rep_good", "acc_power", "nopl", "xtopology", "tsc_reliable",
+  "nonstop_tsc", "cpuid", "extd_apicid", "amd_dcm", "aperfmperf", "rapl",
+  "nonstop_tsc_s3", "tsc_known_freq", "pni", "pclmulqdq", "dtes64", "monitor",
+  "ds_cpl", "vmx", "smx", "est", "tm2", "ssse3", "cid", "sdbg", "fma", "cx16",
+  "xtpr", "pdcm", "pcid", "dca", "sse4_1", "sse4_2", "x2apic", "movbe",
+  "popcnt", "tsc_deadline_timer", "aes", "xsave", "avx", "f16c", "rdrand",
+  "hypervisor", "rng", "rng_en", "ace", "ace_en", "ace2", "ace2_en", "phe",
+  "phe_en", "pmm", "pmm_en", "lahf_lm", "cmp_legacy", "svm", "extapic",
+  "cr8_legacy", "abm", "sse4a", "misalignsse", "3dnowprefetch", "osvw", "ibs",
+  "xop", "skinit", "wdt", "lwp", "fma4", "tce", "nodeid_msr", "tbm",
+  "topoext", "perfctr_core", "perfctr_nb", "bpext", "ptsc", "perfctr_llc",
+  "mwaitx", "ring3mwait", "cpuid_fault", "cpb", "epb", "cat_l3", "cat_l2",
+  "cdp_l3", "invpcid_single", "hw_pstate", "proc_feedback", "sme", "pti",
+  "intel_ppin", "cdp_l2", "ssbd", "mba", "sev", "ibrs", "ibpb", "stibp",
+  "ibrs_enhanced", "tpr_shadow", "vnmi", "flexpriority", "ept", "vpid",
+  "vmmcall", "ept_ad", "fsgsbase", "tsc_adjust", "sgx", "bmi1", "hle", "avx2",
+  "fdp_excptn_only", "smep", "bmi2", "erms", "invpcid", "rtm", "cqm", "mpx",
+  "rdt_a", "avx512f", "avx512dq", "rdseed", "adx", "smap", "avx512ifma",
+  "clflushopt", "clwb", "intel_pt", "avx512pf", "avx512er", "avx512cd",
+  "sha_ni", "avx512bw", "avx512vl", "xsaveopt", "xsavec", "xgetbv1", "xsaves",
+  "xfd", "cqm_llc", "cqm_occup_llc", "cqm_mbm_total", "cqm_mbm_local",
+  "split_lock_detect", "user_shstk", "avx_vnni", "avx512_bf16", "clzero",
+  "irperf", "xsaveerptr", "rdpru", "wbnoinvd", "amd_ibpb", "amd_ibrs",
+  "amd_stibp", "amd_stibp_always_on", "amd_ppin", "amd_ssbd", "virt_ssbd",
+  "amd_ssb_no", "cppc", "amd_psfd", "btc_no", "dtherm", "ida", "arat", "pln",
+  "pts", "hwp", "hwp_notify", "hwp_act_window", "hwp_epp", "hwp_pkg_req",
+  "hfi", "npt", "lbrv", "svm_lock", "nrip_save", "tsc_scale", "vmcb_clean",
+  "flushbyasid", "decodeassists", "pausefilter", "pfthreshold", "avic",
+  "v_vmsave_vmload", "vgif", "x2avic", "v_spec_ctrl", "avx512vbmi", "umip",
+  "pku", "ospke", "waitpkg", "avx512_vbmi2", "shstk", "gfni", "vaes",
+  "vpclmulqdq", "avx512_vnni", "avx512_bitalg", "tme", "avx512_vpopcntdq",
+  "la57", "rdpid", "bus_lock_detect", "cldemote", "movdiri", "movdir64b",
+  "enqcmd", "sgx_lc", "overflow_recov", "succor", "smca", "avx512_4vnniw",
+  "avx512_4fmaps", "fsrm", "avx512_vp2intersect", "srbds_ctrl", "md_clear",
+  "rtm_always_abort", "tsx_force_abort", "serialize", "hybrid_cpu",
+  "tsxldtrk", "pconfig", "arch_lbr", "ibt", "amx_bf16", "avx512_fp16",
+  "amx_tile", "amx_int8", "flush_l1d", "arch_capabilities",
+  "core_capabilities", "spec_ctrl_ssbd", "sev_es",
+  /* 64-bit ARM, in the order of the kernel's hwcaps */
+  "fp", "asimd", "evtstrm", "pmull", "sha1", "sha2", "crc32", "atomics",
+  "fphp", "asimdhp", "asimdrdm", "jscvt", "fcma", "lrcpc", "dcpop", "sha3",
+  "sm3", "sm4", "asimddp", "sha512", "sve", "asimdfhm", "dit", "uscat",
+  "ilrcpc", "flagm", "ssbs", "sb", "paca", "pacg", "dcpodp", "sve2", "sveaes",
+  "svepmull", "svebitperm", "svesha3", "svesm4", "flagm2", "frint", "svei8mm",
+  "svef32mm", "svef64mm", "svebf16", "i8mm", "bf16", "dgh", "bti", "mte",
+  /* 32-bit ARM */
+  "swp", "half", "thumb", "26bit", "fastmult", "fpa", "vfp", "edsp", "java",
+  "iwmmxt", "crunch", "thumbee", "neon", "vfpv3", "vfpv3d16", "tls", "vfpv4",
+  "idiva", "idivt", "vfpd32", "lpae",
+};
+
+/* Number of entries of FLAGS in each version, indexed by version */
+static const gsize FLAGS_PER_VERSION[] = {
+  0,
+  G_N_ELEMENTS (FLAGS),
+};
+
+G_STATIC_ASSERT (G_N_ELEMENTS (FLAGS_PER_VERSION) ==
+                 EINS_CPU_FLAGS_VERSION + 1);
+
+#define BITMAP_SIZE(n_flags) (((n_flags) + 7) / 8)
+
+static gssize
+lookup_flag (const gchar *flag)
+{
+  for (gsize i = 0; i < G_N_ELEMENTS (FLAGS); i++)
+    {
+      if (strcmp (FLAGS[i], flag) == 0)
+        return i;
+    }
+
+  return -1;
+}
+
+static void
+append_word (GString     *string,
+             const gchar *word)
+{
+  if (string->len > 0)
+    g_string_append_c (string, ' ');
+  g_string_append (string, word);
+}
+
+/**
+ * eins_cpu_flags_encode:
+ * @flags: whitespace-separated CPU flags, such as lscpu's "Flags:" field
+ *
+ * Encodes @flags against the current version of the dictionary. Flags which
+ * are not in the dictionary, and repeats of flags already seen, are kept
+ * verbatim in the overflow string, so nothing is lost.
+ *
+ * Returns: (transfer floating): a %EINS_CPU_FLAGS_TYPE_STRING variant
+ */
+GVariant *
+eins_cpu_flags_encode (const gchar *flags)
+{
+  guint8 bitmap[BITMAP_SIZE (G_N_ELEMENTS (FLAGS))] = { 0 };
+  g_autoptr(GString) overflow = NULL;
+  g_auto(GStrv) words = NULL;
+
+  g_return_val_if_fail (flags != NULL, NULL);
+
+  overflow = g_string_new ("");
+  words = g_strsplit_set (flags, " \t\n", -1);
+
+  for (gchar **word = words; *word != NULL; word++)
+    {
+      gssize i;
+
+      if (**word == '\0')
+        continue;
+
+      i = lookup_flag (*word);
+      if (i >= 0 && (bitmap[i / 8] & (1 << (i % 8))) == 0)
+        bitmap[i / 8] |= 1 << (i % 8);
+      else
+        append_word (overflow, *word);
+    }
+
+  return g_variant_new ("(q@ays)", EINS_CPU_FLAGS_VERSION,
+                        g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                                   bitmap, sizeof bitmap, 1),
+                        overflow->str);
+}
+
+/**
+ * eins_cpu_flags_decode:
+ * @encoded: a %EINS_CPU_FLAGS_TYPE_STRING variant from
+ *   eins_cpu_flags_encode(), possibly by an older version of this code
+ * @error: return location for a #GError
+ *
+ * Reverses eins_cpu_flags_encode(). The flags come back in dictionary order,
+ * followed by the overflow string; for x86 this is the order in which the
+ * kernel lists them.
+ *
+ * Returns: (transfer full): space-separated CPU flags, or %NULL if @encoded
+ *   uses an unknown dictionary or its bitmap has the wrong size
+ */
+gchar *
+eins_cpu_flags_decode (GVariant  *encoded,
+                       GError   **error)
+{
+  g_autoptr(GVariant) bitmap_variant = NULL;
+  g_autoptr(GString) flags = NULL;
+  const guint8 *bitmap;
+  const gchar *overflow;
+  guint16 version;
+  gsize n_flags;
+  gsize size;
+
+  g_return_val_if_fail (g_variant_is_of_type (encoded,
+                                              G_VARIANT_TYPE (EINS_CPU_FLAGS_TYPE_STRING)),
+                        NULL);
+
+  g_variant_get (encoded, "(q@ay&s)", &version, &bitmap_variant, &overflow);
+
+  if (version == 0 || version > EINS_CPU_FLAGS_VERSION)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Unknown CPU flag dictionary version %u", version);
+      return NULL;
+    }
+
+  n_flags = FLAGS_PER_VERSION[version];
+  bitmap = g_variant_get_fixed_array (bitmap_variant, &size, 1);
+  if (size != BITMAP_SIZE (n_flags))
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "CPU flag bitmap has %" G_GSIZE_FORMAT " bytes, not %"
+                   G_GSIZE_FORMAT, size, BITMAP_SIZE (n_flags));
+      return NULL;
+    }
+
+  flags = g_string_new ("");
+
+  for (gsize i = 0; i < n_flags; i++)
+    {
+      if ((bitmap[i / 8] & (1 << (i % 8))) != 0)
+        append_word (flags, FLAGS[i]);
+    }
+
+  if (*overflow != '\0')
+    append_word (flags, overflow);
+
+  return g_string_free (g_steal_pointer (&flags), FALSE);
+}
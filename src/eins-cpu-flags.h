@@ -0,0 +1,43 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/*
+ * CPU flags, as listed by lscpu, encoded against a dictionary compiled into
+ * eins-cpu-flags.c. The payload is a triple, (qays):
+ *
+ * Field | Type   | Description
+ * ------+--------+-------------------------------------------------------
+ *     0 | uint16 | Version of the dictionary
+ *     1 | bytes  | Bitmap: bit i of byte i / 8 is set if flag i is present
+ *     2 | string | Space-separated flags which are not in the dictionary
+ *
+ * The bitmap always has room for every flag in that version of the
+ * dictionary, so it is (n_flags + 7) / 8 bytes long. Flags are only ever
+ * appended to the dictionary, and each addition bumps the version.
+ */
+#define EINS_CPU_FLAGS_TYPE_STRING "(qays)"
+
+#define EINS_CPU_FLAGS_VERSION 1
+
+GVariant *eins_cpu_flags_encode (const gchar *flags);
+gchar    *eins_cpu_flags_decode (GVariant     *encoded,
+                                 GError      **error);
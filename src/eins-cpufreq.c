@@ -0,0 +1,366 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-cpufreq.h"
+#include "eins-boot-id.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+/*
+ * cpufreq's counters start from zero at boot. So that each event covers the
+ * time since the last one, the counters read for it are kept in the cache
+ * with the boot ID, and subtracted from those read for the next event of the
+ * same boot.
+ */
+
+#define CPUFREQ_SNAPSHOT_FILE_PATH INSTRUMENTATION_CACHE_DIR "/cpufreq"
+
+#define SYSFS_ROOT "/sys"
+
+/* time_in_state is in units of 10 ms */
+#define TIME_IN_STATE_UNIT_MS 10
+
+static gboolean
+read_uint64 (const gchar *path,
+             guint64     *value)
+{
+  g_autofree gchar *contents = NULL;
+  gchar *end;
+
+  if (!g_file_get_contents (path, &contents, NULL, NULL))
+    return FALSE;
+
+  *value = g_ascii_strtoull (contents, &end, 10);
+
+  return end != contents;
+}
+
+static gboolean
+add_policy (GVariantBuilder *builder,
+            const gchar     *policy_path,
+            guint16          policy)
+{
+  g_autofree gchar *max_freq_path = NULL;
+  g_autofree gchar *time_in_state_path = NULL;
+  g_autofree gchar *total_trans_path = NULL;
+  g_autofree gchar *time_in_state = NULL;
+  g_auto(GStrv) lines = NULL;
+  GVariantBuilder states;
+  guint64 max_freq, total_trans;
+
+  max_freq_path = g_build_filename (policy_path, "cpuinfo_max_freq", NULL);
+  time_in_state_path = g_build_filename (policy_path, "stats",
+                                         "time_in_state", NULL);
+  total_trans_path = g_build_filename (policy_path, "stats", "total_trans",
+                                       NULL);
+
+  /* The kernel was built without CONFIG_CPU_FREQ_STAT */
+  if (!read_uint64 (max_freq_path, &max_freq) || max_freq == 0 ||
+      !g_file_get_contents (time_in_state_path, &time_in_state, NULL, NULL) ||
+      !read_uint64 (total_trans_path, &total_trans))
+    return FALSE;
+
+  g_variant_builder_init (&states, G_VARIANT_TYPE ("a(ut)"));
+
+  lines = g_strsplit (time_in_state, "\n", -1);
+  for (gsize i = 0; lines[i] != NULL; i++)
+    {
+      guint64 freq, time;
+      gchar *end;
+
+      freq = g_ascii_strtoull (lines[i], &end, 10);
+      if (end == lines[i] || *end != ' ')
+        continue;
+
+      time = g_ascii_strtoull (end + 1, NULL, 10);
+      g_variant_builder_add (&states, "(ut)", (guint32) freq, time);
+    }
+
+  g_variant_builder_add (builder, "(qua(ut)t)", policy, (guint32) max_freq,
+                         &states, total_trans);
+  return TRUE;
+}
+
+static gint
+compare_policy_names (gconstpointer a,
+                      gconstpointer b)
+{
+  const gchar *name_a = *(const gchar * const *) a;
+  const gchar *name_b = *(const gchar * const *) b;
+  guint64 policy_a = g_ascii_strtoull (name_a + strlen ("policy"), NULL, 10);
+  guint64 policy_b = g_ascii_strtoull (name_b + strlen ("policy"), NULL, 10);
+
+  return policy_a < policy_b ? -1 : policy_a > policy_b;
+}
+
+/**
+ * eins_cpufreq_read_snapshot:
+ * @sysfs_root: where sysfs is mounted, normally /sys
+ * @boot_id: the ID of the current boot
+ *
+ * Returns: (transfer floating): the cpufreq statistics of each policy, in a
+ *   variant of type %EINS_CPUFREQ_SNAPSHOT_TYPE_STRING
+ */
+GVariant *
+eins_cpufreq_read_snapshot (const gchar *sysfs_root,
+                            const gchar *boot_id)
+{
+  g_autofree gchar *cpufreq_path = NULL;
+  g_autoptr(GDir) dir = NULL;
+  g_autoptr(GPtrArray) names = g_ptr_array_new_with_free_func (g_free);
+  GVariantBuilder builder;
+  const gchar *name;
+
+  g_return_val_if_fail (sysfs_root != NULL, NULL);
+  g_return_val_if_fail (boot_id != NULL, NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(qua(ut)t)"));
+
+  cpufreq_path = g_build_filename (sysfs_root, "devices", "system", "cpu",
+                                   "cpufreq", NULL);
+  dir = g_dir_open (cpufreq_path, 0, NULL);
+
+  while (dir != NULL && (name = g_dir_read_name (dir)) != NULL)
+    {
+      if (g_str_has_prefix (name, "policy") &&
+          g_ascii_isdigit (name[strlen ("policy")]))
+        g_ptr_array_add (names, g_strdup (name));
+    }
+
+  g_ptr_array_sort (names, compare_policy_names);
+
+  for (guint i = 0; i < names->len; i++)
+    {
+      const gchar *policy_name = g_ptr_array_index (names, i);
+      g_autofree gchar *policy_path = g_build_filename (cpufreq_path,
+                                                        policy_name, NULL);
+      guint64 policy = g_ascii_strtoull (policy_name + strlen ("policy"),
+                                         NULL, 10);
+
+      add_policy (&builder, policy_path, (guint16) policy);
+    }
+
+  return g_variant_new ("(s@a(qua(ut)t))", boot_id,
+                        g_variant_builder_end (&builder));
+}
+
+static guint64
+counter_delta (guint64 previous,
+               guint64 current)
+{
+  return current >= previous ? current - previous : current;
+}
+
+static GVariant *
+lookup_policy (GVariant *snapshot,
+               guint16   policy)
+{
+  g_autoptr(GVariant) policies = NULL;
+
+  if (snapshot == NULL)
+    return NULL;
+
+  policies = g_variant_get_child_value (snapshot, 1);
+
+  for (gsize i = 0; i < g_variant_n_children (policies); i++)
+    {
+      GVariant *entry = g_variant_get_child_value (policies, i);
+      guint16 entry_policy;
+
+      g_variant_get_child (entry, 0, "q", &entry_policy);
+      if (entry_policy == policy)
+        return entry;
+
+      g_variant_unref (entry);
+    }
+
+  return NULL;
+}
+
+static guint64
+lookup_time (GVariant *policy_entry,
+             guint32   freq)
+{
+  g_autoptr(GVariant) states = NULL;
+
+  if (policy_entry == NULL)
+    return 0;
+
+  states = g_variant_get_child_value (policy_entry, 2);
+
+  for (gsize i = 0; i < g_variant_n_children (states); i++)
+    {
+      guint32 state_freq;
+      guint64 time;
+
+      g_variant_get_child (states, i, "(ut)", &state_freq, &time);
+      if (state_freq == freq)
+        return time;
+    }
+
+  return 0;
+}
+
+/**
+ * eins_cpufreq_compute_residency:
+ * @previous: (nullable): the snapshot taken for the last event, if any
+ * @current: a snapshot taken now
+ *
+ * Returns: (transfer floating): the payload of %CPU_FREQUENCY_EVENT for the
+ *   time between @previous and @current, or since boot if @previous is
+ *   %NULL or was taken during another boot
+ */
+GVariant *
+eins_cpufreq_compute_residency (GVariant *previous,
+                                GVariant *current)
+{
+  g_autoptr(GVariant) policies = NULL;
+  const gchar *previous_boot_id, *current_boot_id;
+  GVariantBuilder builder;
+
+  g_return_val_if_fail (current != NULL, NULL);
+
+  g_variant_get_child (current, 0, "&s", &current_boot_id);
+
+  if (previous != NULL)
+    {
+      g_variant_get_child (previous, 0, "&s", &previous_boot_id);
+      if (strcmp (previous_boot_id, current_boot_id) != 0)
+        previous = NULL;
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (EINS_CPUFREQ_TYPE_STRING));
+
+  policies = g_variant_get_child_value (current, 1);
+
+  for (gsize i = 0; i < g_variant_n_children (policies); i++)
+    {
+      g_autoptr(GVariant) entry = g_variant_get_child_value (policies, i);
+      g_autoptr(GVariant) previous_entry = NULL;
+      g_autoptr(GVariant) states = NULL;
+      guint64 bands[EINS_CPUFREQ_N_BANDS] = { 0 };
+      guint64 total_trans, previous_total_trans = 0;
+      guint32 max_freq;
+      guint16 policy;
+
+      g_variant_get (entry, "(qu@a(ut)t)", &policy, &max_freq, &states,
+                     &total_trans);
+      previous_entry = lookup_policy (previous, policy);
+      if (previous_entry != NULL)
+        g_variant_get_child (previous_entry, 3, "t", &previous_total_trans);
+
+      for (gsize j = 0; j < g_variant_n_children (states); j++)
+        {
+          guint32 freq;
+          guint64 time, band;
+
+          g_variant_get_child (states, j, "(ut)", &freq, &time);
+
+          band = freq == 0 ? 0 :
+            ((guint64) freq * EINS_CPUFREQ_N_BANDS - 1) / max_freq;
+          band = MIN (band, EINS_CPUFREQ_N_BANDS - 1);
+
+          bands[band] += counter_delta (lookup_time (previous_entry, freq),
+                                        time) * TIME_IN_STATE_UNIT_MS;
+        }
+
+      g_variant_builder_add (&builder, "(qq@att)", policy,
+                             (guint16) MIN (max_freq / 1000, G_MAXUINT16),
+                             g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+                                                        bands,
+                                                        EINS_CPUFREQ_N_BANDS,
+                                                        sizeof (guint64)),
+                             counter_delta (previous_total_trans,
+                                            total_trans));
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+load_snapshot (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GVariant) snapshot = NULL;
+  gchar *contents;
+  gsize length;
+
+  if (!g_file_get_contents (CPUFREQ_SNAPSHOT_FILE_PATH, &contents, &length,
+                            &error))
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning ("Failed to read " CPUFREQ_SNAPSHOT_FILE_PATH ": %s",
+                   error->message);
+      return NULL;
+    }
+
+  snapshot = g_variant_ref_sink (
+    g_variant_new_from_data (G_VARIANT_TYPE (EINS_CPUFREQ_SNAPSHOT_TYPE_STRING),
+                             contents, length, FALSE, g_free, contents));
+
+  /* Anything else is not trusted */
+  if (!g_variant_is_normal_form (snapshot))
+    return NULL;
+
+  return g_steal_pointer (&snapshot);
+}
+
+static void
+save_snapshot (GVariant *snapshot)
+{
+  g_autoptr(GVariant) normal = g_variant_get_normal_form (snapshot);
+  g_autoptr(GError) error = NULL;
+
+  if (!g_file_set_contents (CPUFREQ_SNAPSHOT_FILE_PATH,
+                            g_variant_get_data (normal),
+                            g_variant_get_size (normal), &error))
+    g_warning ("Failed to write " CPUFREQ_SNAPSHOT_FILE_PATH ": %s",
+               error->message);
+}
+
+/**
+ * eins_cpufreq_collect:
+ *
+ * Returns: (transfer floating) (nullable): the payload of
+ *   %CPU_FREQUENCY_EVENT for the time since the last call, or %NULL on error
+ */
+GVariant *
+eins_cpufreq_collect (void)
+{
+  g_autoptr(GVariant) previous = NULL;
+  g_autoptr(GVariant) current = NULL;
+  g_autoptr(GError) error = NULL;
+  gchar boot_id[EINS_BOOT_ID_LENGTH + 1];
+  GVariant *residency;
+
+  if (!eins_read_boot_id (boot_id, &error))
+    {
+      g_warning ("Failed to read boot ID: %s", error->message);
+      return NULL;
+    }
+
+  previous = load_snapshot ();
+  current = g_variant_ref_sink (eins_cpufreq_read_snapshot (SYSFS_ROOT,
+                                                            boot_id));
+  residency = eins_cpufreq_compute_residency (previous, current);
+  save_snapshot (current);
+
+  return residency;
+}
@@ -0,0 +1,62 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/*
+ * CPU frequency residency event, recorded alongside COMPUTER_HWINFO_EVENT,
+ * with payload "a(qqatt)".
+ *
+ * Field | Description
+ * ------+--------------------------------------------------------------
+ *     q | The cpufreq policy, which is usually the number of the first
+ *       | CPU it covers
+ *     q | The policy's maximum frequency, in MHz
+ *    at | Time spent in each of EINS_CPUFREQ_N_BANDS bands since the
+ *       | last event, in milliseconds. Band i is the frequencies above
+ *       | i/EINS_CPUFREQ_N_BANDS of the maximum, up to and including
+ *       | (i + 1)/EINS_CPUFREQ_N_BANDS of it.
+ *     t | Number of frequency changes since the last event
+ *
+ * Policies without cpufreq statistics are not reported. The first event of
+ * each boot covers the time since the boot, and the time between the last
+ * event of a boot and shutdown is not reported.
+ */
+
+#define CPU_FREQUENCY_EVENT "53f446d0-dbb1-4b16-ac77-d1c7694c8c71"
+
+#define EINS_CPUFREQ_TYPE_STRING "a(qqatt)"
+
+#define EINS_CPUFREQ_N_BANDS 8
+
+/* Collection, linked into eos-metrics-collect */
+GVariant *eins_cpufreq_collect (void);
+
+/* For tests */
+
+/* Boot ID, then for each policy its number, maximum frequency in kHz, the
+ * raw time_in_state as (frequency in kHz, time in 10 ms units) and
+ * total_trans */
+#define EINS_CPUFREQ_SNAPSHOT_TYPE_STRING "(sa(qua(ut)t))"
+
+GVariant *eins_cpufreq_read_snapshot (const gchar *sysfs_root,
+                                      const gchar *boot_id);
+GVariant *eins_cpufreq_compute_residency (GVariant *previous,
+                                          GVariant *current);
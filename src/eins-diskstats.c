@@ -0,0 +1,521 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-diskstats.h"
+#include "eins-boottime-source.h"
+#include "eins-recorder.h"
+#include "eins-ring-store.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+/*
+ * Block device I/O event, recorded once a day, with payload
+ * "(ua(sttqqquuu))".
+ *
+ * Field        | Description
+ * -------------+--------------------------------------------------------
+ *            u | Number of samples taken during the day
+ * a(sttqqquuu) | One entry per disk:
+ *              |   s: the kernel's name for it, such as 'mmcblk0' or 'sda'
+ *              |   t: bytes read
+ *              |   t: bytes written
+ *              |   q: median utilization, in ‰ of the time awake
+ *              |   q: 90th percentile of the same
+ *              |   q: 99th percentile of the same
+ *              |   u: median of the average request latency, in µs
+ *              |   u: 90th percentile of the same
+ *              |   u: 99th percentile of the same
+ *
+ * /proc/diskstats is sampled once a minute. Utilization is the share of the
+ * interval during which the disk had requests in flight. Latency is the
+ * average time taken by the requests which completed during the interval;
+ * intervals in which none did are left out of its percentiles.
+ *
+ * As for batteries, each interval's utilization, latency and bytes
+ * transferred are kept in a ring store in the cache until the event is
+ * recorded, so restarting the daemon or rebooting doesn't lose the day's
+ * samples so far.
+ *
+ * Intervals are measured with the monotonic clock, which stops while the
+ * system is suspended, as do the kernel's counters; so time spent asleep
+ * doesn't dilute utilization. The samples themselves are taken on boottime,
+ * so one is due as soon as the system resumes.
+ *
+ * Only disks backed by a device are listed, not loop, RAM or device-mapper
+ * block devices, nor partitions.
+ */
+
+#define DISKSTATS_EVENT "c6888b5a-7cf7-4e8a-b86d-073aaa6e3076"
+
+#define DISKSTATS_SAMPLE_INTERVAL_USECONDS (60 * G_USEC_PER_SEC)
+
+/* 24 hours */
+#define DISKSTATS_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+/* Intervals during which the system was awake for less than this are
+ * skipped: the counters barely move, so the ratios would be noise. */
+#define MIN_ELAPSED_USECONDS G_USEC_PER_SEC
+
+#define DISKSTATS_PATH "/proc/diskstats"
+#define SYS_BLOCK_DIR "/sys/block"
+
+#define SECTOR_SIZE 512
+
+#define DISKSTATS_STORE_FILE_PATH INSTRUMENTATION_CACHE_DIR "/diskstats-samples"
+/* Four for each disk */
+#define DISKSTATS_STORE_N_SERIES 16
+/* A day and a half of samples, in case the event is late */
+#define DISKSTATS_STORE_CAPACITY 2160
+
+typedef struct {
+  EinsDiskstatsLine last;
+  gboolean have_last;
+  gint64 last_time;
+  /* Indices of its series in the store, or -1 */
+  gint util_series;
+  gint latency_series;
+  gint read_series;
+  gint written_series;
+} Disk;
+
+static int diskstats_fd = -1;
+/* Map from name (borrowed from the Disk's last.name, which is only ever
+ * overwritten with the same name) to Disk (owned) */
+static GHashTable *disks;
+static EinsRingStore *store;
+static guint sample_source_id;
+
+/**
+ * eins_diskstats_parse_line:
+ * @line: a line of /proc/diskstats
+ * @out: (out): return location for the fields used
+ *
+ * Returns: %TRUE if @line could be parsed
+ */
+gboolean
+eins_diskstats_parse_line (const gchar       *line,
+                           EinsDiskstatsLine *out)
+{
+  g_return_val_if_fail (line != NULL, FALSE);
+  g_return_val_if_fail (out != NULL, FALSE);
+
+  /* major minor name, then the fields described in the kernel's
+   * Documentation/admin-guide/iostats.rst */
+  return sscanf (line,
+                 " %*u %*u %31s"
+                 " %" G_GUINT64_FORMAT " %*u %" G_GUINT64_FORMAT
+                 " %" G_GUINT64_FORMAT
+                 " %" G_GUINT64_FORMAT " %*u %" G_GUINT64_FORMAT
+                 " %" G_GUINT64_FORMAT
+                 " %*u %" G_GUINT64_FORMAT,
+                 out->name,
+                 &out->reads, &out->sectors_read, &out->read_ms,
+                 &out->writes, &out->sectors_written, &out->write_ms,
+                 &out->io_ticks_ms) == 8;
+}
+
+/**
+ * eins_diskstats_interval:
+ * @previous: the disk's counters at the start of the interval
+ * @current: the disk's counters at its end
+ * @elapsed_us: length of the interval on the monotonic clock, in
+ *   microseconds
+ * @out: (out): return location for the sample for the interval
+ *
+ * Returns: %FALSE if the interval was too short, or if the counters went
+ *   backwards because the disk was replaced; there is no sample then
+ */
+gboolean
+eins_diskstats_interval (const EinsDiskstatsLine *previous,
+                         const EinsDiskstatsLine *current,
+                         gint64                   elapsed_us,
+                         EinsDiskstatsInterval   *out)
+{
+  guint64 ios, busy_ms, io_ticks_ms;
+  guint32 latency_us = EINS_DISKSTATS_NO_LATENCY;
+
+  if (elapsed_us < MIN_ELAPSED_USECONDS ||
+      current->reads < previous->reads ||
+      current->sectors_read < previous->sectors_read ||
+      current->writes < previous->writes ||
+      current->sectors_written < previous->sectors_written ||
+      current->read_ms < previous->read_ms ||
+      current->write_ms < previous->write_ms ||
+      current->io_ticks_ms < previous->io_ticks_ms)
+    return FALSE;
+
+  ios = (current->reads - previous->reads) +
+        (current->writes - previous->writes);
+  busy_ms = (current->read_ms - previous->read_ms) +
+            (current->write_ms - previous->write_ms);
+  io_ticks_ms = current->io_ticks_ms - previous->io_ticks_ms;
+
+  if (ios > 0)
+    latency_us = MIN (busy_ms * 1000 / ios, EINS_DISKSTATS_NO_LATENCY - 1);
+
+  out->util_permille = MIN (io_ticks_ms * 1000 * 1000 / elapsed_us, 1000);
+  out->latency_us = latency_us;
+  out->bytes_read = (current->sectors_read - previous->sectors_read) *
+                    SECTOR_SIZE;
+  out->bytes_written = (current->sectors_written -
+                        previous->sectors_written) * SECTOR_SIZE;
+
+  return TRUE;
+}
+
+static gint
+compare_guint32 (gconstpointer a,
+                 gconstpointer b)
+{
+  guint32 value_a = *(const guint32 *) a;
+  guint32 value_b = *(const guint32 *) b;
+
+  return value_a < value_b ? -1 : value_a > value_b ? 1 : 0;
+}
+
+/**
+ * eins_diskstats_percentile:
+ * @values: (array length=n): the values, which are sorted in place
+ * @n: the number of values
+ * @percentile: between 0 and 100
+ *
+ * Returns: the given percentile of @values; or 0 if there are none
+ */
+guint32
+eins_diskstats_percentile (guint32 *values,
+                           guint    n,
+                           guint    percentile)
+{
+  g_return_val_if_fail (percentile <= 100, 0);
+
+  if (n == 0)
+    return 0;
+
+  qsort (values, n, sizeof (guint32), compare_guint32);
+
+  return values[eins_percentile_rank (n, percentile) - 1];
+}
+
+static void
+add_sample (gint    series,
+            gint64  time,
+            guint64 value)
+{
+  if (series >= 0)
+    eins_ring_store_append (store, series, time, value);
+}
+
+static gboolean
+sample_diskstats (gpointer user_data G_GNUC_UNUSED)
+{
+  static gchar buffer[16384];
+  gint64 now = g_get_monotonic_time ();
+  gint64 wall_now = g_get_real_time ();
+  gchar *line, *next;
+
+  if (eins_read_fd (diskstats_fd, buffer, sizeof (buffer)) < 0)
+    {
+      g_debug ("Failed to read " DISKSTATS_PATH ": %s", g_strerror (errno));
+      return G_SOURCE_CONTINUE;
+    }
+
+  for (line = buffer; *line != '\0'; line = next)
+    {
+      EinsDiskstatsLine current;
+      EinsDiskstatsInterval interval;
+      Disk *disk;
+
+      next = strchr (line, '\n');
+      if (next == NULL)
+        next = line + strlen (line);
+      else
+        *next++ = '\0';
+
+      if (!eins_diskstats_parse_line (line, &current) ||
+          (disk = g_hash_table_lookup (disks, current.name)) == NULL)
+        continue;
+
+      if (disk->have_last &&
+          eins_diskstats_interval (&disk->last, &current,
+                                   now - disk->last_time, &interval))
+        {
+          add_sample (disk->util_series, wall_now, interval.util_permille);
+          add_sample (disk->latency_series, wall_now, interval.latency_us);
+          add_sample (disk->read_series, wall_now, interval.bytes_read);
+          add_sample (disk->written_series, wall_now, interval.bytes_written);
+        }
+
+      disk->last = current;
+      disk->last_time = now;
+      disk->have_last = TRUE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Fewer samples than this, as there may be on the first day the daemon
+ * runs, are carried over to the next day. */
+#define DISKSTATS_MIN_SAMPLES 60
+
+static guint64
+take_sum (gint series)
+{
+  g_autoptr(GArray) samples = NULL;
+  guint64 sum = 0;
+
+  if (series < 0)
+    return 0;
+
+  samples = eins_ring_store_take (store, series);
+  for (guint i = 0; i < samples->len; i++)
+    sum += g_array_index (samples, EinsRingSample, i).value;
+
+  return sum;
+}
+
+/* Takes the samples of a series other than EINS_DISKSTATS_NO_LATENCY, as
+ * an array of guint32 */
+static GArray *
+take_values (gint series)
+{
+  g_autoptr(GArray) samples = NULL;
+  GArray *values = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  if (series < 0)
+    return values;
+
+  samples = eins_ring_store_take (store, series);
+  for (guint i = 0; i < samples->len; i++)
+    {
+      guint64 value = g_array_index (samples, EinsRingSample, i).value;
+
+      if (value < EINS_DISKSTATS_NO_LATENCY)
+        {
+          guint32 value32 = value;
+
+          g_array_append_val (values, value32);
+        }
+    }
+
+  return values;
+}
+
+static void
+record_diskstats (gpointer user_data G_GNUC_UNUSED)
+{
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  Disk *disk;
+  guint32 n_samples = 0;
+
+  g_hash_table_iter_init (&iter, disks);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &disk))
+    {
+      if (disk->util_series >= 0)
+        n_samples = MAX (n_samples,
+                         eins_ring_store_get_n_pending (store,
+                                                        disk->util_series));
+    }
+
+  if (n_samples < DISKSTATS_MIN_SAMPLES)
+    return;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sttqqquuu)"));
+
+  g_hash_table_iter_init (&iter, disks);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &disk))
+    {
+      g_autoptr(GArray) util = take_values (disk->util_series);
+      g_autoptr(GArray) latency = take_values (disk->latency_series);
+      guint32 *util_values = (guint32 *) util->data;
+      guint32 *latency_values = (guint32 *) latency->data;
+      guint64 bytes_read = take_sum (disk->read_series);
+      guint64 bytes_written = take_sum (disk->written_series);
+
+      if (util->len == 0)
+        continue;
+
+      g_variant_builder_add (&builder, "(sttqqquuu)",
+                             disk->last.name,
+                             bytes_read,
+                             bytes_written,
+                             eins_diskstats_percentile (util_values,
+                                                        util->len, 50),
+                             eins_diskstats_percentile (util_values,
+                                                        util->len, 90),
+                             eins_diskstats_percentile (util_values,
+                                                        util->len, 99),
+                             eins_diskstats_percentile (latency_values,
+                                                        latency->len, 50),
+                             eins_diskstats_percentile (latency_values,
+                                                        latency->len, 90),
+                             eins_diskstats_percentile (latency_values,
+                                                        latency->len, 99));
+    }
+
+  eins_recorder_record_event (DISKSTATS_EVENT,
+                              g_variant_new ("(ua(sttqqquuu))", n_samples,
+                                             &builder));
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+/* Lists the disks backed by a device, as opposed to virtual block devices. */
+static void
+find_disks (void)
+{
+  g_autoptr(GDir) dir = NULL;
+  g_autoptr(GError) error = NULL;
+  const gchar *name;
+
+  dir = g_dir_open (SYS_BLOCK_DIR, 0, &error);
+  if (dir == NULL)
+    {
+      g_debug ("Failed to list " SYS_BLOCK_DIR ": %s", error->message);
+      return;
+    }
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *device = g_build_filename (SYS_BLOCK_DIR, name,
+                                                   "device", NULL);
+      Disk *disk;
+
+      if (strlen (name) >= sizeof (disk->last.name) ||
+          !g_file_test (device, G_FILE_TEST_EXISTS))
+        continue;
+
+      disk = g_new0 (Disk, 1);
+      g_strlcpy (disk->last.name, name, sizeof (disk->last.name));
+      disk->util_series = -1;
+      disk->latency_series = -1;
+      disk->read_series = -1;
+      disk->written_series = -1;
+      g_hash_table_insert (disks, disk->last.name, disk);
+    }
+}
+
+static gchar *
+series_name (Disk        *disk,
+             const gchar *suffix)
+{
+  return g_strconcat (disk->last.name, suffix, NULL);
+}
+
+static gint
+get_series (Disk        *disk,
+            const gchar *suffix)
+{
+  g_autofree gchar *name = series_name (disk, suffix);
+
+  if (strlen (name) > EINS_RING_STORE_MAX_NAME_LENGTH)
+    return -1;
+
+  return eins_ring_store_get_series (store, name);
+}
+
+static void
+open_store (const gchar *store_path)
+{
+  static const gchar * const suffixes[] = {
+    "-util", "-latency", "-read", "-written"
+  };
+  g_autoptr(GHashTable) names = g_hash_table_new_full (g_str_hash,
+                                                       g_str_equal,
+                                                       g_free, NULL);
+  g_autoptr(GError) error = NULL;
+  GHashTableIter iter;
+  Disk *disk;
+
+  store = eins_ring_store_open (store_path, DISKSTATS_STORE_N_SERIES,
+                                DISKSTATS_STORE_CAPACITY, &error);
+  if (store == NULL)
+    {
+      g_warning ("Failed to open disk sample store: %s", error->message);
+      return;
+    }
+
+  g_hash_table_iter_init (&iter, disks);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &disk))
+    {
+      for (gsize i = 0; i < G_N_ELEMENTS (suffixes); i++)
+        g_hash_table_add (names, series_name (disk, suffixes[i]));
+    }
+
+  /* Samples of disks which are gone would never be taken */
+  eins_ring_store_prune (store, names);
+
+  g_hash_table_iter_init (&iter, disks);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &disk))
+    {
+      disk->util_series = get_series (disk, suffixes[0]);
+      disk->latency_series = get_series (disk, suffixes[1]);
+      disk->read_series = get_series (disk, suffixes[2]);
+      disk->written_series = get_series (disk, suffixes[3]);
+    }
+}
+
+void
+eins_diskstats_start (void)
+{
+  diskstats_fd = g_open (DISKSTATS_PATH, O_RDONLY | O_CLOEXEC, 0);
+  if (diskstats_fd < 0)
+    {
+      g_warning ("Failed to open " DISKSTATS_PATH ": %s", g_strerror (errno));
+      return;
+    }
+
+  disks = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+  find_disks ();
+
+  if (g_hash_table_size (disks) == 0)
+    {
+      g_debug ("No disks found");
+      return;
+    }
+
+  open_store (DISKSTATS_STORE_FILE_PATH);
+
+  sample_diskstats (NULL);
+  sample_source_id = eins_boottimeout_add_useconds (DISKSTATS_SAMPLE_INTERVAL_USECONDS,
+                                                    sample_diskstats, NULL);
+  eins_schedule_add ("diskstats", DISKSTATS_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_diskstats, NULL);
+}
+
+/* Samples already in the store are recorded once it is started again. */
+void
+eins_diskstats_stop (void)
+{
+  eins_schedule_remove ("diskstats");
+  g_clear_handle_id (&sample_source_id, g_source_remove);
+  g_clear_pointer (&store, eins_ring_store_free);
+  g_clear_pointer (&disks, g_hash_table_unref);
+
+  if (diskstats_fd >= 0)
+    g_close (diskstats_fd, NULL);
+  diskstats_fd = -1;
+}
@@ -0,0 +1,62 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_diskstats_start (void);
+void eins_diskstats_stop (void);
+
+/* For tests */
+
+/* The fields of a /proc/diskstats line which are used */
+typedef struct {
+  gchar name[32];
+  guint64 reads;
+  guint64 sectors_read;
+  guint64 read_ms;
+  guint64 writes;
+  guint64 sectors_written;
+  guint64 write_ms;
+  /* Time during which the device had requests in flight */
+  guint64 io_ticks_ms;
+} EinsDiskstatsLine;
+
+gboolean eins_diskstats_parse_line (const gchar       *line,
+                                    EinsDiskstatsLine *out);
+
+#define EINS_DISKSTATS_NO_LATENCY G_MAXUINT32
+
+typedef struct {
+  /* Share of the interval during which the device was busy, in ‰ */
+  guint16 util_permille;
+  /* Average time taken by the requests completed, in microseconds; or
+   * EINS_DISKSTATS_NO_LATENCY if none were */
+  guint32 latency_us;
+  guint64 bytes_read;
+  guint64 bytes_written;
+} EinsDiskstatsInterval;
+
+gboolean eins_diskstats_interval (const EinsDiskstatsLine *previous,
+                                  const EinsDiskstatsLine *current,
+                                  gint64                   elapsed_us,
+                                  EinsDiskstatsInterval   *out);
+guint32 eins_diskstats_percentile (guint32 *values,
+                                   guint    n,
+                                   guint    percentile);
@@ -0,0 +1,115 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-flatpak.h"
+
+/**
+ * eins_flatpak_format_ref:
+ * @ref: a ref
+ *
+ * Formats @ref the way it is reported in events, so that the same app or
+ * runtime can be matched up across them.
+ *
+ * Returns: (transfer full): @ref as kind/name/arch/branch, such as
+ *   "app/org.gnome.Calculator/x86_64/stable"
+ */
+gchar *
+eins_flatpak_format_ref (FlatpakRef *ref)
+{
+  g_return_val_if_fail (FLATPAK_IS_REF (ref), NULL);
+
+  return flatpak_ref_format_ref (ref);
+}
+
+/**
+ * eins_flatpak_get_app_ref:
+ * @installation: an installation
+ * @app_id: the ID of an app
+ * @error: return location for a #GError
+ *
+ * Returns: (transfer full): the formatted ref of the current version of
+ *   @app_id in @installation; or %NULL with @error set if it is not
+ *   installed there
+ */
+gchar *
+eins_flatpak_get_app_ref (FlatpakInstallation *installation,
+                          const gchar         *app_id,
+                          GError             **error)
+{
+  g_autoptr(FlatpakInstalledRef) app = NULL;
+
+  g_return_val_if_fail (FLATPAK_IS_INSTALLATION (installation), NULL);
+  g_return_val_if_fail (app_id != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  app = flatpak_installation_get_current_installed_app (installation, app_id,
+                                                        NULL, error);
+  if (app == NULL)
+    return NULL;
+
+  return eins_flatpak_format_ref (FLATPAK_REF (app));
+}
+
+/**
+ * eins_flatpak_get_app_refs:
+ * @app_ids: (array zero-terminated=1): IDs of apps
+ *
+ * Looks up the current version of each of @app_ids in the system
+ * installation, for the app usage event. Apps which are not installed there,
+ * which most likely means they are installed per-user, are left out.
+ *
+ * Returns: (transfer floating) (nullable): a map of type "a{ss}" from app ID
+ *   to formatted ref, or %NULL if the system installation can't be opened
+ */
+GVariant *
+eins_flatpak_get_app_refs (const gchar * const *app_ids)
+{
+  g_autoptr(FlatpakInstallation) installation = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantBuilder builder;
+
+  g_return_val_if_fail (app_ids != NULL, NULL);
+
+  installation = flatpak_installation_new_system (NULL, &error);
+  if (installation == NULL)
+    {
+      g_warning ("Failed to open the system flatpak installation: %s",
+                 error->message);
+      return NULL;
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+
+  for (gsize i = 0; app_ids[i] != NULL; i++)
+    {
+      g_autofree gchar *ref = NULL;
+
+      ref = eins_flatpak_get_app_ref (installation, app_ids[i], &error);
+      if (ref == NULL)
+        {
+          g_debug ("Failed to look up %s: %s", app_ids[i], error->message);
+          g_clear_error (&error);
+          continue;
+        }
+
+      g_variant_builder_add (&builder, "{ss}", app_ids[i], ref);
+    }
+
+  return g_variant_builder_end (&builder);
+}
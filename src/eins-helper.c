@@ -0,0 +1,178 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-helper.h"
+
+/*
+ * Collectors that need large libraries, or that only run occasionally, live
+ * in eos-metrics-collect rather than in the daemon. The daemon runs it with
+ * the name of a collector as its first argument, followed by "--" and any
+ * arguments the collector takes; it writes the collected payload to stdout
+ * as a serialized GVariant of type "v", in normal form, and exits.
+ */
+
+/* Set in meson.build */
+#ifndef EINS_HELPER_PATH
+#error "EINS_HELPER_PATH must be defined"
+#endif
+
+#define HELPER_TIMEOUT_SECONDS 60
+
+typedef struct {
+  gchar *collector;
+  GSubprocess *subprocess;
+  guint timeout_id;
+} HelperData;
+
+static void
+helper_data_free (HelperData *data)
+{
+  g_clear_handle_id (&data->timeout_id, g_source_remove);
+  g_clear_object (&data->subprocess);
+  g_free (data->collector);
+  g_free (data);
+}
+
+static gboolean
+helper_timeout_cb (gpointer user_data)
+{
+  HelperData *data = user_data;
+
+  g_warning ("%s %s took longer than %u seconds; killing it",
+             EINS_HELPER_PATH, data->collector, HELPER_TIMEOUT_SECONDS);
+  data->timeout_id = 0;
+  g_subprocess_force_exit (data->subprocess);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+communicate_cb (GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  GSubprocess *subprocess = G_SUBPROCESS (source);
+  HelperData *data = g_task_get_task_data (task);
+  g_autoptr(GBytes) stdout_bytes = NULL;
+  g_autoptr(GVariant) boxed = NULL;
+  GError *error = NULL;
+
+  g_clear_handle_id (&data->timeout_id, g_source_remove);
+
+  if (!g_subprocess_communicate_finish (subprocess, result, &stdout_bytes,
+                                        NULL, &error))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  if (!g_subprocess_get_successful (subprocess))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "%s %s failed", EINS_HELPER_PATH,
+                               data->collector);
+      return;
+    }
+
+  boxed = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE_VARIANT,
+                                                        stdout_bytes, FALSE));
+  if (g_bytes_get_size (stdout_bytes) == 0 || !g_variant_is_normal_form (boxed))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                               "%s %s produced malformed output",
+                               EINS_HELPER_PATH, data->collector);
+      return;
+    }
+
+  g_task_return_pointer (task, g_variant_get_variant (boxed),
+                         (GDestroyNotify) g_variant_unref);
+}
+
+/**
+ * eins_helper_collect_async:
+ * @collector: name of the collector to run, such as "hwinfo"
+ * @args: (nullable) (array zero-terminated=1): arguments for the collector
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the collector has finished
+ * @user_data: data to pass to @callback
+ *
+ * Runs a collector in eos-metrics-collect. The helper is killed if it takes
+ * longer than HELPER_TIMEOUT_SECONDS.
+ */
+void
+eins_helper_collect_async (const gchar         *collector,
+                           const gchar * const *args,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GPtrArray) argv = NULL;
+  HelperData *data;
+  GError *error = NULL;
+
+  g_return_if_fail (collector != NULL);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, eins_helper_collect_async);
+
+  data = g_new0 (HelperData, 1);
+  data->collector = g_strdup (collector);
+  g_task_set_task_data (task, data, (GDestroyNotify) helper_data_free);
+
+  argv = g_ptr_array_new ();
+  g_ptr_array_add (argv, (gpointer) EINS_HELPER_PATH);
+  g_ptr_array_add (argv, (gpointer) collector);
+  /* So that no argument is taken for an option of the helper's */
+  g_ptr_array_add (argv, (gpointer) "--");
+  for (gsize i = 0; args != NULL && args[i] != NULL; i++)
+    g_ptr_array_add (argv, (gpointer) args[i]);
+  g_ptr_array_add (argv, NULL);
+
+  data->subprocess = g_subprocess_newv ((const gchar * const *) argv->pdata,
+                                        G_SUBPROCESS_FLAGS_STDOUT_PIPE,
+                                        &error);
+  if (data->subprocess == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  data->timeout_id = g_timeout_add_seconds (HELPER_TIMEOUT_SECONDS,
+                                            helper_timeout_cb, data);
+  g_subprocess_communicate_async (data->subprocess, NULL, cancellable,
+                                  communicate_cb, g_steal_pointer (&task));
+}
+
+/**
+ * eins_helper_collect_finish:
+ * @result: the result passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Returns: (transfer full): the collected payload, or %NULL with @error set
+ */
+GVariant *
+eins_helper_collect_finish (GAsyncResult  *result,
+                            GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
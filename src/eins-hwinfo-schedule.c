@@ -0,0 +1,221 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-hwinfo.h"
+#include "eins-cpufreq.h"
+#include "eins-helper.h"
+#include "eins-recorder.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <gio/gio.h>
+
+/* 24 hours */
+#define RECORD_COMPUTER_HWINFO_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+static gint64 collect_start_time;
+/* Cancelled when the collector is stopped */
+static GCancellable *cancellable;
+static guint start_source_id;
+/* Watches for BOOTED_FLAG_FILE_PATH, on the first boot */
+static GFileMonitor *booted_monitor;
+
+static void
+got_computer_hwinfo_cb (GObject      *source G_GNUC_UNUSED,
+                        GAsyncResult *result,
+                        gpointer      user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GVariant) payload = NULL;
+  g_autoptr(GError) error = NULL;
+
+  eins_stats_histogram_add_elapsed (EINS_STATS_HISTOGRAM_HWINFO_COLLECT_US,
+                                    collect_start_time);
+
+  payload = eins_helper_collect_finish (result, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  if (payload == NULL)
+    {
+      g_warning ("Failed to collect hardware information: %s",
+                 error->message);
+      return;
+    }
+
+  if (!eins_hwinfo_is_computer_hwinfo (payload))
+    {
+      g_warning ("Hardware information has unexpected type %s",
+                 g_variant_get_type_string (payload));
+      return;
+    }
+
+  eins_recorder_record_event (COMPUTER_HWINFO_EVENT, payload);
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+static void
+got_cpu_frequency_cb (GObject      *source G_GNUC_UNUSED,
+                      GAsyncResult *result,
+                      gpointer      user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GVariant) payload = NULL;
+  g_autoptr(GError) error = NULL;
+
+  payload = eins_helper_collect_finish (result, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  if (payload == NULL)
+    {
+      g_warning ("Failed to collect CPU frequency residency: %s",
+                 error->message);
+      return;
+    }
+
+  if (!g_variant_is_of_type (payload,
+                             G_VARIANT_TYPE (EINS_CPUFREQ_TYPE_STRING)))
+    {
+      g_warning ("CPU frequency residency has unexpected type %s",
+                 g_variant_get_type_string (payload));
+      return;
+    }
+
+  /* No cpufreq policy has statistics */
+  if (g_variant_n_children (payload) == 0)
+    return;
+
+  eins_recorder_record_event (CPU_FREQUENCY_EVENT, payload);
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+static void
+record_computer_hwinfo (gpointer user_data G_GNUC_UNUSED)
+{
+  collect_start_time = g_get_monotonic_time ();
+  eins_helper_collect_async ("hwinfo", NULL, cancellable,
+                             got_computer_hwinfo_cb, NULL);
+
+  /* Reported with the hardware, so that the residency can be related to the
+   * CPU model */
+  eins_helper_collect_async ("cpufreq", NULL, cancellable,
+                             got_cpu_frequency_cb, NULL);
+}
+
+static void
+start_recording_record_computer_hwinfo (void)
+{
+  eins_schedule_add ("hwinfo", RECORD_COMPUTER_HWINFO_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT |
+                     EINS_SCHEDULE_FLAGS_RUN_IMMEDIATELY,
+                     record_computer_hwinfo, NULL);
+}
+
+/* The presence of this file indicates that the first-boot resize of the root
+ * filesystem is complete.
+ *
+ * https://github.com/endlessm/eos-boot-helper/blob/master/eos-firstboot
+ */
+
+#define BOOTED_FLAG_FILE_PATH "/var/eos-booted"
+
+static void
+stop_watching_booted (void)
+{
+  if (booted_monitor == NULL)
+    return;
+
+  g_signal_handlers_disconnect_by_data (booted_monitor, NULL);
+  g_file_monitor_cancel (booted_monitor);
+  g_clear_object (&booted_monitor);
+}
+
+static void
+boot_finished_cb (GFileMonitor     *monitor G_GNUC_UNUSED,
+                  GFile            *booted,
+                  GFile            *other_file G_GNUC_UNUSED,
+                  GFileMonitorEvent event_type,
+                  gpointer          user_data G_GNUC_UNUSED)
+{
+  /* Any event will do */
+  g_debug ("got (GFileMonitorEvent) %d for %s", event_type, g_file_peek_path (booted));
+  start_recording_record_computer_hwinfo ();
+  stop_watching_booted ();
+}
+
+/* On the first boot, the root partition is extended to fill the disk, in the
+ * background. We may be running before this process has completed; in that
+ * case, we need to wait. Rather than monitoring eos-firstboot.service via
+ * systemd's D-Bus API, we look for a flag file in /var.
+ */
+
+static gboolean
+start_recording_computer_info_when_booted (gpointer data G_GNUC_UNUSED)
+{
+  g_autoptr(GFile) booted = g_file_new_for_path (BOOTED_FLAG_FILE_PATH);
+  g_autoptr(GFileMonitor) monitor = NULL;
+  g_autoptr(GError) error = NULL;
+
+  start_source_id = 0;
+
+  if (g_file_query_exists (booted, NULL))
+    {
+      g_debug ("%s already exists", BOOTED_FLAG_FILE_PATH);
+      start_recording_record_computer_hwinfo ();
+    }
+  else if (!(monitor = g_file_monitor_file (booted, G_FILE_MONITOR_NONE,
+                                            NULL, &error)))
+    {
+      g_warning ("Couldn't watch %s: %s",
+                 BOOTED_FLAG_FILE_PATH, error->message);
+      start_recording_record_computer_hwinfo ();
+    }
+  else
+    {
+      g_debug ("Waiting for %s to appear before reporting disk space",
+               BOOTED_FLAG_FILE_PATH);
+
+      booted_monitor = g_steal_pointer (&monitor);
+      g_signal_connect (booted_monitor, "changed",
+                        (GCallback) boot_finished_cb,
+                        NULL);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+void
+eins_hwinfo_start (void)
+{
+  cancellable = g_cancellable_new ();
+  start_source_id = g_idle_add (start_recording_computer_info_when_booted,
+                                NULL);
+}
+
+/* Hardware information being collected is dropped. The task is persistent,
+ * so a collection which was due meanwhile runs once it is started again. */
+void
+eins_hwinfo_stop (void)
+{
+  eins_schedule_remove ("hwinfo");
+  g_clear_handle_id (&start_source_id, g_source_remove);
+  stop_watching_booted ();
+
+  g_cancellable_cancel (cancellable);
+  g_clear_object (&cancellable);
+}
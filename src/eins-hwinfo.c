@@ -17,142 +17,12 @@
  * <http://www.gnu.org/licenses/>.
  */
 #include "eins-hwinfo.h"
-#include "eins-boottime-source.h"
+#include "eins-trace.h"
 
-#include <eosmetrics/eosmetrics.h>
 #include <gio/gio.h>
 #include <glibtop/mem.h>
 #include <json-glib/json-glib.h>
 
-/*
- * Computer hardware information event with payload "(uuuua(sqd))".
- *
- * Field  | Description
- * -------+----------------------------------
- *      u | Please see RAM section
- *    uuu | Please see Root partition section
- * a(sqd) | Please see CPU section
- */
-
-#define COMPUTER_HWINFO_EVENT "81f303aa-448d-443d-97f9-8d8a9169321c"
-
-/*
- * RAM:
- * The amount of physical memory accessible to Endless OS, in mebibytes (2^20
- * bytes). The payload is a uint32 (u).
- */
-
-#define ONE_MIB_IN_BYTES (G_GUINT64_CONSTANT (1024 * 1024))
-
-#define RAMINFO_TYPE_STRING "u"
-
-/*
- * Root partition:
- * The payload is a triple of uint32, (uuu), representing the the total size,
- * space used, and space available on the root filesystem, measured in gibibytes
- * (2^30 bytes). We round to the nearest gibibyte: we have no need of a precise
- * figure in the reported data.
- *
- * On dual-boot installations, this refers to the Endless OS image file, not
- * the Windows partition it is hosted on.
- *
- * Space on other user-accessible partitions on the disk, including Windows
- * partitions on dual-boot systems, is not reported.
- *
- * You might think that given any two of these values for a filesystem, you
- * could derive the third. That's not the case: typically, 5% of space is
- * reserved (so used + available = 0.95 * total) but this is a tunable
- * parameter of the filesystem.
- */
-
-#define ONE_GIB_IN_BYTES (G_GUINT64_CONSTANT (1024 * 1024 * 1024))
-
-#define ROOTFS_SPACE_TYPE_STRING "uuu"
-
-/*
- * CPU:
- * CPUs in the system. The payload is an array of triples -- a(sqd) --
- * containing the following information for each group of similar cores/threads:
- *
- * Field | Type   | Description              | Default if unknown
- * ------+--------+--------------------------+-------------------
- *     0 | string | Human-readable CPU model | ''
- *     1 | uint16 | Number of cores/threads  | 0
- *     2 | double | Maximum¹ speed in MHz    | 0.
- *     3 | string | CPU instruction extensions flags | ''
- *
- * ¹ If the maximum speed can't be determined, we report the current speed
- *   instead, if known.
- *
- * For example, a laptop fitted with an i7-5500U (which has 2 physical cores,
- * each with 2 threads) will be reported as:
- *
- *  [
- *    ('Intel(R) Core(TM) i7-5500U CPU @ 2.40GHz', 4, 3000.)
- *  ]
- *
- * In principle, an ARM big.LITTLE system would have two elements in this
- * array, containing details of the big and LITTLE cores. In practice, the
- * current implementation only reports the currently-active cores.
- */
-
-#define CPUINFO_TYPE_STRING "(sqds)"
-#define CPUINFO_ARRAY_TYPE_STRING "a" CPUINFO_TYPE_STRING
-
-#define COMPUTER_HWINFO_TYPE_STRING "(" RAMINFO_TYPE_STRING \
-  ROOTFS_SPACE_TYPE_STRING "@" CPUINFO_ARRAY_TYPE_STRING ")"
-
-/* 24 hours */
-#define RECORD_COMPUTER_HWINFO_INTERVAL_USECONDS G_TIME_SPAN_DAY
-
-/* The path of a file to hold next record time. */
-#define RECORD_TIME_FILE_PATH INSTRUMENTATION_CACHE_DIR "/record_time"
-
-static gint64
-get_next_record_time (void)
-{
-  g_autoptr(GKeyFile) kf = g_key_file_new ();
-
-  if (g_key_file_load_from_file (kf,
-                                 RECORD_TIME_FILE_PATH,
-                                 G_KEY_FILE_NONE,
-                                 NULL))
-    return g_key_file_get_int64 (kf, "hwinfo", "next-record-time", NULL);
-
-  return 0;
-}
-
-/* Get wait time in microseconds */
-static guint64
-get_wait_time_for_next_record (void)
-{
-  gint64 now, record;
-
-  record = get_next_record_time ();
-  now = g_get_real_time ();
-
-  if (now < record)
-    return record - now;
-  else
-    return 0;
-}
-
-static void
-set_next_record_time (void)
-{
-  g_autoptr(GKeyFile) kf = g_key_file_new ();
-  guint64 now, next;
-  g_autoptr(GError) error = NULL;
-
-  now = g_get_real_time ();
-  next = now + RECORD_COMPUTER_HWINFO_INTERVAL_USECONDS;
-
-  g_key_file_set_uint64 (kf, "hwinfo", "next-record-time", next);
-
-  if (!g_key_file_save_to_file (kf, RECORD_TIME_FILE_PATH, &error))
-    g_warning ("Failed to write " RECORD_TIME_FILE_PATH ": %s", error->message);
-}
-
 static guint32
 round_to_nearest (guint64 size,
                   guint64 divisor)
@@ -436,12 +306,44 @@ eins_hwinfo_get_cpu_info (void)
   return eins_hwinfo_parse_lscpu_json (json_data, (gssize) json_size);
 }
 
+/* Converts an a(sqds) from eins_hwinfo_get_cpu_info() to a(sqd(qays)),
+ * encoding the flags with eins_cpu_flags_encode(). Sinks @cpu_info if it is
+ * floating.
+ */
+GVariant *
+eins_hwinfo_encode_cpu_info (GVariant *cpu_info)
+{
+  g_autoptr(GVariant) owned = g_variant_ref_sink (cpu_info);
+  g_autoptr(GVariantBuilder) builder = NULL;
+  GVariantIter iter;
+  const gchar *model;
+  guint16 n_cpus;
+  gdouble max_mhz;
+  const gchar *flags;
+
+  builder =
+    g_variant_builder_new (G_VARIANT_TYPE (ENCODED_CPUINFO_ARRAY_TYPE_STRING));
+
+  g_variant_iter_init (&iter, owned);
+  while (g_variant_iter_next (&iter, "(&sqd&s)", &model, &n_cpus, &max_mhz,
+                              &flags))
+    g_variant_builder_add (builder, "(sqd@" EINS_CPU_FLAGS_TYPE_STRING ")",
+                           model, n_cpus, max_mhz,
+                           eins_cpu_flags_encode (flags));
+
+  return g_variant_builder_end (builder);
+}
+
 GVariant *
 eins_hwinfo_get_computer_hwinfo (void)
 {
   guint32 ramsize = eins_hwinfo_get_ram_size ();
   DiskSpaceType diskspace = {};
-  GVariant *cpuinfo = eins_hwinfo_get_cpu_info();
+  GVariant *cpuinfo;
+
+  EINS_TRACE_BEGIN (get_cpu_info);
+  cpuinfo = eins_hwinfo_encode_cpu_info (eins_hwinfo_get_cpu_info ());
+  EINS_TRACE_END (get_cpu_info);
 
   eins_hwinfo_get_space_for_rootfs (&diskspace);
 
@@ -449,110 +351,3 @@ eins_hwinfo_get_computer_hwinfo (void)
                         diskspace.total, diskspace.used, diskspace.free,
                         cpuinfo);
 }
-
-static gboolean
-record_computer_hwinfo (gpointer is_first_call)
-{
-  GVariant *payload = eins_hwinfo_get_computer_hwinfo ();
-
-  if (payload != NULL)
-    emtr_event_recorder_record_event (emtr_event_recorder_get_default (),
-                                      COMPUTER_HWINFO_EVENT,
-                                      g_steal_pointer (&payload));
-  set_next_record_time ();
-
-  /* The interval of first record after each boot usually is not 24 hours. */
-  if (is_first_call)
-    {
-      eins_boottimeout_add_useconds (RECORD_COMPUTER_HWINFO_INTERVAL_USECONDS,
-                                     record_computer_hwinfo,
-                                     GUINT_TO_POINTER (FALSE));
-      return G_SOURCE_REMOVE;
-    }
-
-  return G_SOURCE_CONTINUE;
-}
-
-static void
-start_recording_record_computer_hwinfo (void)
-{
-  guint64 wait = get_wait_time_for_next_record ();
-
-  if (wait > 0)
-    {
-      eins_boottimeout_add_useconds (wait,
-                                     record_computer_hwinfo,
-                                     GUINT_TO_POINTER (TRUE));
-      return;
-    }
-
-  record_computer_hwinfo (GUINT_TO_POINTER (TRUE));
-}
-
-/* The presence of this file indicates that the first-boot resize of the root
- * filesystem is complete.
- *
- * https://github.com/endlessm/eos-boot-helper/blob/master/eos-firstboot
- */
-
-#define BOOTED_FLAG_FILE_PATH "/var/eos-booted"
-
-static void
-boot_finished_cb (GFileMonitor     *monitor,
-                  GFile            *booted,
-                  GFile            *other_file G_GNUC_UNUSED,
-                  GFileMonitorEvent event_type,
-                  gpointer          user_data)
-{
-  /* Any event will do */
-  g_debug ("got (GFileMonitorEvent) %d for %s", event_type, g_file_peek_path (booted));
-  start_recording_record_computer_hwinfo ();
-
-  g_signal_handlers_disconnect_by_func (monitor, boot_finished_cb, user_data);
-  g_object_unref (monitor);
-}
-
-/* On the first boot, the root partition is extended to fill the disk, in the
- * background. We may be running before this process has completed; in that
- * case, we need to wait. Rather than monitoring eos-firstboot.service via
- * systemd's D-Bus API, we look for a flag file in /var.
- */
-
-static gboolean
-start_recording_computer_info_when_booted (gpointer data G_GNUC_UNUSED)
-{
-  g_autoptr(GFile) booted = g_file_new_for_path (BOOTED_FLAG_FILE_PATH);
-  g_autoptr(GFileMonitor) monitor = NULL;
-  g_autoptr(GError) error = NULL;
-
-  if (g_file_query_exists (booted, NULL))
-    {
-      g_debug ("%s already exists", BOOTED_FLAG_FILE_PATH);
-      start_recording_record_computer_hwinfo ();
-    }
-  else if (!(monitor = g_file_monitor_file (booted, G_FILE_MONITOR_NONE,
-                                            NULL, &error)))
-    {
-      g_warning ("Couldn't watch %s: %s",
-                 BOOTED_FLAG_FILE_PATH, error->message);
-      start_recording_record_computer_hwinfo ();
-    }
-  else
-    {
-      g_debug ("Waiting for %s to appear before reporting disk space",
-               BOOTED_FLAG_FILE_PATH);
-
-      /* Ownership is transferred to boot_finished_cb() */
-      g_signal_connect (g_steal_pointer (&monitor), "changed",
-                        (GCallback) boot_finished_cb,
-                        NULL);
-    }
-
-  return G_SOURCE_REMOVE;
-}
-
-void
-eins_hwinfo_start (void)
-{
-  g_idle_add (start_recording_computer_info_when_booted, NULL);
-}
@@ -21,7 +21,124 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include "eins-cpu-flags.h"
+
+/*
+ * Computer hardware information event with payload "(uuuua(sqd(qays)))".
+ *
+ * Field        | Description
+ * -------------+----------------------------------
+ *            u | Please see RAM section
+ *          uuu | Please see Root partition section
+ * a(sqd(qays)) | Please see CPU section
+ *
+ * This replaces 81f303aa-448d-443d-97f9-8d8a9169321c, whose payload had the
+ * CPU flags as a plain string.
+ */
+
+#define COMPUTER_HWINFO_EVENT "d280e2f2-acd4-4c3f-aa8b-d50babedc2bb"
+
+/*
+ * RAM:
+ * The amount of physical memory accessible to Endless OS, in mebibytes (2^20
+ * bytes). The payload is a uint32 (u).
+ */
+
+#define ONE_MIB_IN_BYTES (G_GUINT64_CONSTANT (1024 * 1024))
+
+#define RAMINFO_TYPE_STRING "u"
+
+/*
+ * Root partition:
+ * The payload is a triple of uint32, (uuu), representing the the total size,
+ * space used, and space available on the root filesystem, measured in gibibytes
+ * (2^30 bytes). We round to the nearest gibibyte: we have no need of a precise
+ * figure in the reported data.
+ *
+ * On dual-boot installations, this refers to the Endless OS image file, not
+ * the Windows partition it is hosted on.
+ *
+ * Space on other user-accessible partitions on the disk, including Windows
+ * partitions on dual-boot systems, is not reported.
+ *
+ * You might think that given any two of these values for a filesystem, you
+ * could derive the third. That's not the case: typically, 5% of space is
+ * reserved (so used + available = 0.95 * total) but this is a tunable
+ * parameter of the filesystem.
+ */
+
+#define ONE_GIB_IN_BYTES (G_GUINT64_CONSTANT (1024 * 1024 * 1024))
+
+#define ROOTFS_SPACE_TYPE_STRING "uuu"
+
+/*
+ * CPU:
+ * CPUs in the system. The payload is an array of tuples -- a(sqd(qays)) --
+ * containing the following information for each group of similar cores/threads:
+ *
+ * Field | Type   | Description              | Default if unknown
+ * ------+--------+--------------------------+-------------------
+ *     0 | string | Human-readable CPU model | ''
+ *     1 | uint16 | Number of cores/threads  | 0
+ *     2 | double | Maximum¹ speed in MHz    | 0.
+ *     3 | (qays) | CPU instruction extensions flags, encoded as described in
+ *       |        | eins-cpu-flags.h         | (1, [0, …], '')
+ *
+ * ¹ If the maximum speed can't be determined, we report the current speed
+ *   instead, if known.
+ *
+ * For example, a laptop fitted with an i7-5500U (which has 2 physical cores,
+ * each with 2 threads) will be reported as follows, with the bitmap cut
+ * short:
+ *
+ *  [
+ *    ('Intel(R) Core(TM) i7-5500U CPU @ 2.40GHz', 4, 3000.,
+ *     (1, [0xff, 0xff, 0xfd, …], ''))
+ *  ]
+ *
+ * In principle, an ARM big.LITTLE system would have two elements in this
+ * array, containing details of the big and LITTLE cores. In practice, the
+ * current implementation only reports the currently-active cores.
+ */
+
+#define ENCODED_CPUINFO_TYPE_STRING "(sqd" EINS_CPU_FLAGS_TYPE_STRING ")"
+#define ENCODED_CPUINFO_ARRAY_TYPE_STRING "a" ENCODED_CPUINFO_TYPE_STRING
+
+/* A g_variant_new() format string, so not a valid type string */
+#define COMPUTER_HWINFO_TYPE_STRING "(" RAMINFO_TYPE_STRING \
+  ROOTFS_SPACE_TYPE_STRING "@" ENCODED_CPUINFO_ARRAY_TYPE_STRING ")"
+
+/* The type of the payload built with COMPUTER_HWINFO_TYPE_STRING */
+#define COMPUTER_HWINFO_VARIANT_TYPE_STRING "(" RAMINFO_TYPE_STRING \
+  ROOTFS_SPACE_TYPE_STRING ENCODED_CPUINFO_ARRAY_TYPE_STRING ")"
+
+/*
+ * CPU information as parsed from lscpu, with the flags still as a plain
+ * string.
+ */
+#define CPUINFO_TYPE_STRING "(sqds)"
+#define CPUINFO_ARRAY_TYPE_STRING "a" CPUINFO_TYPE_STRING
+
+/* Schedule and unschedule the event. Implemented in
+ * eins-hwinfo-schedule.c. */
 void eins_hwinfo_start (void);
+void eins_hwinfo_stop (void);
+
+/* Whether @payload, as received from eos-metrics-collect, can be recorded
+ * as the computer hardware information event. */
+static inline gboolean
+eins_hwinfo_is_computer_hwinfo (GVariant *payload)
+{
+  return g_variant_is_of_type (payload,
+                               G_VARIANT_TYPE (COMPUTER_HWINFO_VARIANT_TYPE_STRING));
+}
+
+/*
+ * Collection, implemented in eins-hwinfo.c. This is linked into
+ * eos-metrics-collect rather than into the daemon, so that json-glib and
+ * libgtop are only loaded while collecting.
+ */
+GVariant *eins_hwinfo_get_computer_hwinfo (void);
 
 /* For tests */
 typedef struct _DiskSpaceType {
@@ -39,5 +156,4 @@ guint32 eins_hwinfo_get_ram_size (void);
 GVariant *eins_hwinfo_get_cpu_info (void);
 GVariant *eins_hwinfo_parse_lscpu_json (const gchar *json_data,
                                         gssize       json_size);
-
-GVariant *eins_hwinfo_get_computer_hwinfo (void);
+GVariant *eins_hwinfo_encode_cpu_info (GVariant *cpu_info);
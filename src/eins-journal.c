@@ -0,0 +1,427 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-journal.h"
+#include "eins-recorder.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+#include "eins-unit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-unix.h>
+#include <systemd/sd-journal.h>
+
+/*
+ * Journal error event, recorded once a day if any error was logged, with
+ * payload "(ta(st))".
+ *
+ * Field | Description
+ * ------+--------------------------------------------------------------
+ *     t | Number of messages logged at priority err or above
+ * a(st) | The JOURNAL_TOP_UNITS units which logged the most of them, most
+ *       | first:
+ *       |   s: the unit, named as for the OOM event; "kernel" for kernel
+ *       |      messages; or "" for messages from no unit, and from units
+ *       |      beyond the first EINS_JOURNAL_MAX_UNITS seen that day
+ *       |   t: the number of messages it logged
+ *
+ * The journal is opened once, with a match on PRIORITY, and read from the
+ * position reached last time: woken by its fd, the daemon only reads the
+ * entries added since, so work is proportional to the number of errors
+ * logged rather than the size of the journal. Entries are read in batches
+ * of JOURNAL_BATCH_SIZE, continuing from an idle callback, so that a burst
+ * of errors doesn't hold up the main loop.
+ *
+ * The position is saved in JOURNAL_CURSOR_FILE_PATH whenever the event is
+ * recorded, and nowhere else. If the daemon restarts, it reads the entries
+ * logged since the last event again, and so recovers the counts which it
+ * lost. Without a saved position, as on first start, it starts from the
+ * end of the journal.
+ *
+ * Reading other users' and system services' entries needs membership of
+ * the systemd-journal group, which the service file grants.
+ */
+
+#define JOURNAL_EVENT "eacb9c0d-e0cf-4215-9b60-4d8a45a954c3"
+
+/* 24 hours */
+#define JOURNAL_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+#define JOURNAL_CURSOR_FILE_PATH INSTRUMENTATION_CACHE_DIR "/journal-cursor"
+
+/* LOG_ERR */
+#define JOURNAL_MAX_PRIORITY 3
+
+#define JOURNAL_TOP_UNITS 10
+
+#define JOURNAL_BATCH_SIZE 1000
+
+/* Only the start of each field is needed */
+#define JOURNAL_DATA_THRESHOLD 256
+
+static sd_journal *journal;
+static guint read_more_id;
+static guint journal_source_id;
+
+/* Map from unit (owned) to its count (owned guint64 *) */
+static GHashTable *counts;
+static guint64 total;
+
+/**
+ * eins_journal_unit_name:
+ * @unit: (nullable): the entry's _SYSTEMD_UNIT
+ * @user_unit: (nullable): the entry's _SYSTEMD_USER_UNIT
+ * @transport: (nullable): the entry's _TRANSPORT
+ *
+ * Returns: (transfer full): the name under which a message is counted
+ */
+gchar *
+eins_journal_unit_name (const gchar *unit,
+                        const gchar *user_unit,
+                        const gchar *transport)
+{
+  /* Messages from a user's units also have _SYSTEMD_UNIT=user@<uid>.service */
+  if (user_unit != NULL)
+    return eins_unit_canonicalize (user_unit);
+
+  if (unit != NULL)
+    return eins_unit_canonicalize (unit);
+
+  if (g_strcmp0 (transport, "kernel") == 0)
+    return g_strdup ("kernel");
+
+  return g_strdup ("");
+}
+
+/**
+ * eins_journal_add:
+ * @unit: the name under which a message is counted
+ *
+ * Counts a message. Memory use is bounded by counting units beyond the
+ * first %EINS_JOURNAL_MAX_UNITS together.
+ */
+void
+eins_journal_add (const gchar *unit)
+{
+  guint64 *count;
+
+  g_return_if_fail (unit != NULL);
+
+  if (counts == NULL)
+    counts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  count = g_hash_table_lookup (counts, unit);
+
+  if (count == NULL && g_hash_table_size (counts) >= EINS_JOURNAL_MAX_UNITS)
+    {
+      unit = "";
+      count = g_hash_table_lookup (counts, unit);
+    }
+
+  if (count == NULL)
+    {
+      count = g_new0 (guint64, 1);
+      g_hash_table_insert (counts, g_strdup (unit), count);
+    }
+
+  (*count)++;
+  total++;
+}
+
+typedef struct {
+  const gchar *unit;
+  guint64 count;
+} UnitCount;
+
+static gint
+compare_unit_counts (gconstpointer a,
+                     gconstpointer b)
+{
+  const UnitCount *count_a = a;
+  const UnitCount *count_b = b;
+
+  if (count_a->count != count_b->count)
+    return count_a->count > count_b->count ? -1 : 1;
+
+  return strcmp (count_a->unit, count_b->unit);
+}
+
+/**
+ * eins_journal_take_summary:
+ * @n_top: number of units to list
+ *
+ * Returns: (transfer floating) (nullable): the payload of the event for the
+ *   messages counted since the last call, or %NULL if there were none
+ */
+GVariant *
+eins_journal_take_summary (guint n_top)
+{
+  g_autoptr(GArray) sorted = NULL;
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  UnitCount unit_count;
+  guint64 *count;
+  GVariant *summary;
+
+  if (total == 0)
+    return NULL;
+
+  sorted = g_array_sized_new (FALSE, FALSE, sizeof (UnitCount),
+                              g_hash_table_size (counts));
+
+  g_hash_table_iter_init (&iter, counts);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &unit_count.unit,
+                                 (gpointer *) &count))
+    {
+      unit_count.count = *count;
+      g_array_append_val (sorted, unit_count);
+    }
+
+  g_array_sort (sorted, compare_unit_counts);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(st)"));
+
+  for (guint i = 0; i < MIN (n_top, sorted->len); i++)
+    {
+      const UnitCount *top = &g_array_index (sorted, UnitCount, i);
+
+      g_variant_builder_add (&builder, "(st)", top->unit, top->count);
+    }
+
+  summary = g_variant_new ("(ta(st))", total, &builder);
+
+  g_hash_table_remove_all (counts);
+  total = 0;
+
+  return summary;
+}
+
+/* Returns the value of the field in the current entry, or NULL. */
+static gchar *
+get_field (const gchar *field)
+{
+  gsize field_length = strlen (field);
+  const void *data;
+  size_t length;
+
+  if (sd_journal_get_data (journal, field, &data, &length) < 0 ||
+      length <= field_length + 1)
+    return NULL;
+
+  return g_strndup ((const gchar *) data + field_length + 1,
+                    length - field_length - 1);
+}
+
+/* Returns TRUE if there may be more entries to read. */
+static gboolean
+read_entries (void)
+{
+  for (guint i = 0; i < JOURNAL_BATCH_SIZE; i++)
+    {
+      g_autofree gchar *unit = NULL;
+      g_autofree gchar *user_unit = NULL;
+      g_autofree gchar *transport = NULL;
+      g_autofree gchar *name = NULL;
+      int r = sd_journal_next (journal);
+
+      if (r < 0)
+        {
+          g_warning ("Failed to read the journal: %s", g_strerror (-r));
+          return FALSE;
+        }
+
+      if (r == 0)
+        return FALSE;
+
+      unit = get_field ("_SYSTEMD_UNIT");
+      user_unit = get_field ("_SYSTEMD_USER_UNIT");
+      transport = get_field ("_TRANSPORT");
+      name = eins_journal_unit_name (unit, user_unit, transport);
+      eins_journal_add (name);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+read_more_cb (gpointer user_data G_GNUC_UNUSED)
+{
+  if (read_entries ())
+    return G_SOURCE_CONTINUE;
+
+  read_more_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+read_new_entries (void)
+{
+  if (read_more_id == 0 && read_entries ())
+    read_more_id = g_idle_add (read_more_cb, NULL);
+}
+
+static gboolean
+journal_readable_cb (gint         fd G_GNUC_UNUSED,
+                     GIOCondition condition G_GNUC_UNUSED,
+                     gpointer     user_data G_GNUC_UNUSED)
+{
+  int r = sd_journal_process (journal);
+
+  if (r < 0)
+    g_warning ("Failed to process journal changes: %s", g_strerror (-r));
+  else if (r != SD_JOURNAL_NOP)
+    read_new_entries ();
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+save_cursor (void)
+{
+  g_autoptr(GError) error = NULL;
+  char *cursor = NULL;
+  int r;
+
+  r = sd_journal_get_cursor (journal, &cursor);
+  if (r < 0)
+    {
+      /* Nothing read yet, from an empty journal */
+      g_debug ("Failed to get the journal cursor: %s", g_strerror (-r));
+      return;
+    }
+
+  if (!g_file_set_contents (JOURNAL_CURSOR_FILE_PATH, cursor, -1, &error))
+    g_warning ("Failed to write " JOURNAL_CURSOR_FILE_PATH ": %s",
+               error->message);
+
+  free (cursor);
+}
+
+static void
+record_journal (gpointer user_data G_GNUC_UNUSED)
+{
+  GVariant *summary = eins_journal_take_summary (JOURNAL_TOP_UNITS);
+
+  if (summary != NULL)
+    {
+      eins_recorder_record_event (JOURNAL_EVENT, summary);
+      eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+    }
+
+  save_cursor ();
+}
+
+/* Positions the journal just before the first entry not yet counted. */
+static void
+seek_to_saved_cursor (void)
+{
+  g_autofree gchar *cursor = NULL;
+
+  if (g_file_get_contents (JOURNAL_CURSOR_FILE_PATH, &cursor, NULL, NULL) &&
+      sd_journal_seek_cursor (journal, g_strstrip (cursor)) >= 0)
+    {
+      /* Seeking lands on the saved entry, which was already counted; or,
+       * if it has been vacuumed, on the next one, which wasn't. */
+      if (sd_journal_next (journal) > 0 &&
+          sd_journal_test_cursor (journal, cursor) <= 0)
+        sd_journal_previous (journal);
+
+      return;
+    }
+
+  sd_journal_seek_tail (journal);
+  sd_journal_previous (journal);
+}
+
+/* Files the daemon may not read are skipped silently, so without the
+ * systemd-journal group it would only see its own user's journal. */
+static gboolean
+can_read_system_journal (void)
+{
+  sd_journal *system_journal = NULL;
+  gboolean found;
+
+  if (sd_journal_open (&system_journal,
+                       SD_JOURNAL_LOCAL_ONLY | SD_JOURNAL_SYSTEM) < 0)
+    return FALSE;
+
+  found = sd_journal_has_runtime_files (system_journal) > 0 ||
+          sd_journal_has_persistent_files (system_journal) > 0;
+  sd_journal_close (system_journal);
+
+  return found;
+}
+
+void
+eins_journal_start (void)
+{
+  int r, fd;
+
+  r = sd_journal_open (&journal, SD_JOURNAL_LOCAL_ONLY);
+  if (r < 0)
+    {
+      g_warning ("Failed to open the journal: %s", g_strerror (-r));
+      return;
+    }
+
+  if (!can_read_system_journal ())
+    g_warning ("No system journal files are readable; journal errors will "
+               "not be counted. Is the daemon in the systemd-journal group?");
+
+  /* Matches on the same field are ORed */
+  for (guint priority = 0; priority <= JOURNAL_MAX_PRIORITY; priority++)
+    {
+      g_autofree gchar *match = g_strdup_printf ("PRIORITY=%u", priority);
+
+      sd_journal_add_match (journal, match, 0);
+    }
+
+  sd_journal_set_data_threshold (journal, JOURNAL_DATA_THRESHOLD);
+
+  fd = sd_journal_get_fd (journal);
+  if (fd < 0)
+    {
+      g_warning ("Failed to watch the journal: %s", g_strerror (-fd));
+      g_clear_pointer (&journal, sd_journal_close);
+      return;
+    }
+
+  seek_to_saved_cursor ();
+  read_new_entries ();
+
+  journal_source_id = g_unix_fd_add (fd, G_IO_IN, journal_readable_cb, NULL);
+  eins_schedule_add ("journal", JOURNAL_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_journal, NULL);
+}
+
+/* Counts not yet recorded are dropped, but the cursor is only saved when
+ * they are recorded, so the entries are read again once it is started
+ * again. */
+void
+eins_journal_stop (void)
+{
+  eins_schedule_remove ("journal");
+  g_clear_handle_id (&journal_source_id, g_source_remove);
+  g_clear_handle_id (&read_more_id, g_source_remove);
+  g_clear_pointer (&journal, sd_journal_close);
+  g_clear_pointer (&counts, g_hash_table_unref);
+  total = 0;
+}
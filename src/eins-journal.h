@@ -0,0 +1,35 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_journal_start (void);
+void eins_journal_stop (void);
+
+/* For tests */
+
+/* Messages from any further units are counted together, under "" */
+#define EINS_JOURNAL_MAX_UNITS 256
+
+gchar *eins_journal_unit_name (const gchar *unit,
+                               const gchar *user_unit,
+                               const gchar *transport);
+void eins_journal_add (const gchar *unit);
+GVariant *eins_journal_take_summary (guint n_top);
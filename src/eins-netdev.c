@@ -0,0 +1,640 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-netdev.h"
+#include "eins-boottime-source.h"
+#include "eins-config.h"
+#include "eins-recorder.h"
+#include "eins-ring-store.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+/*
+ * Network interface throughput event, recorded once a day, with payload
+ * "(ua(stttttttt))".
+ *
+ * Field        | Description
+ * -------------+------------------------------------------------------
+ *            u | Number of samples taken during the day
+ * a(stttttttt) | One entry per interface which transferred anything:
+ *              |   s: the kernel's name for it, such as 'wlp2s0'
+ *              |   t: bytes received
+ *              |   t: bytes sent
+ *              |   t: packets received
+ *              |   t: packets sent
+ *              |   t: bytes received in the busiest hour
+ *              |   t: bytes sent in the busiest hour
+ *              |   t: highest rate received over a minute, in bytes/s
+ *              |   t: highest rate sent over a minute, in bytes/s
+ *
+ * /proc/net/dev is sampled once a minute. Some drivers still keep 32-bit
+ * counters, so a counter going backwards from below 2³² is taken to have
+ * wrapped; one going backwards from above that was reset, and is counted
+ * from zero. An interface which appears after the first sample, such as a
+ * USB modem being plugged in, is counted from zero too, as is one replaced
+ * by another of the same name between two samples, as when the modem is
+ * unplugged and plugged in again; their counters restart, which could
+ * otherwise pass for a wrap. The two are told apart by their ifindex. One
+ * which disappears keeps what it transferred until the event is recorded,
+ * unless the daemon is restarted before then.
+ *
+ * As for batteries, what each interface transferred during each interval,
+ * and the length of the interval, are kept in a ring store in the cache
+ * until the event is recorded, so restarting the daemon or rebooting doesn't
+ * lose the day's samples so far. The intervals are replayed when the event
+ * is recorded, matching up the series by the time of their samples.
+ *
+ * Hours and rates are measured with the monotonic clock, which stops while
+ * the system is suspended, so time asleep doesn't dilute them; the busiest
+ * hour is the one with the most traffic among consecutive hours awake. The
+ * samples themselves are taken on boottime, so one is due as soon as the
+ * system resumes.
+ *
+ * Only interfaces backed by a device are listed, not the loopback, bridges,
+ * tunnels or other virtual interfaces.
+ */
+
+#define NETDEV_EVENT "29b7e0bb-01bc-46e4-9c76-e519d90116ba"
+
+#define NETDEV_SAMPLE_INTERVAL_USECONDS (60 * G_USEC_PER_SEC)
+
+/* 24 hours */
+#define NETDEV_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+/* Intervals during which the system was awake for less than this still add
+ * to the totals, but not to the peak rates, which would be noise. */
+#define MIN_ELAPSED_USECONDS G_USEC_PER_SEC
+
+#define NETDEV_PATH "/proc/net/dev"
+#define SYS_CLASS_NET_DIR "/sys/class/net"
+
+#define NETDEV_STORE_FILE_PATH INSTRUMENTATION_CACHE_DIR "/netdev-samples"
+/* Four for each interface, and the length of the intervals */
+#define NETDEV_STORE_N_SERIES 21
+/* A day and a half of samples, in case the event is late */
+#define NETDEV_STORE_CAPACITY 2160
+#define ELAPSED_SERIES_NAME "elapsed"
+
+typedef struct {
+  EinsNetdevLine last;
+  /* Number of the last sample the interface was listed in */
+  guint64 last_seen;
+  /* As of that sample, or 0 if unknown */
+  guint ifindex;
+  gboolean physical;
+  /* Indices of its series in the store, or -1: what it transferred during
+   * each interval */
+  gint rx_bytes_series;
+  gint tx_bytes_series;
+  gint rx_packets_series;
+  gint tx_packets_series;
+} Interface;
+
+static int netdev_fd = -1;
+/* Map from name (borrowed from the Interface's last.name, which is only ever
+ * overwritten with the same name) to Interface (owned) */
+static GHashTable *interfaces;
+/* Number of the last sample taken, counting from 1 */
+static guint64 sample_number;
+static gint64 last_sample_time;
+static EinsRingStore *store;
+/* Length of each interval on the monotonic clock, in microseconds */
+static gint elapsed_series = -1;
+static guint sample_source_id;
+
+/**
+ * eins_netdev_parse_line:
+ * @line: a line of /proc/net/dev
+ * @out: (out): return location for the fields used
+ *
+ * Returns: %TRUE if @line could be parsed; %FALSE for the header lines
+ */
+gboolean
+eins_netdev_parse_line (const gchar    *line,
+                        EinsNetdevLine *out)
+{
+  const gchar *colon;
+  gsize name_length;
+
+  g_return_val_if_fail (line != NULL, FALSE);
+  g_return_val_if_fail (out != NULL, FALSE);
+
+  line += strspn (line, " ");
+  colon = strchr (line, ':');
+  if (colon == NULL)
+    return FALSE;
+
+  name_length = colon - line;
+  if (name_length == 0 || name_length >= sizeof (out->name))
+    return FALSE;
+
+  memcpy (out->name, line, name_length);
+  out->name[name_length] = '\0';
+
+  /* Receive bytes, packets, errs, drop, fifo, frame, compressed, multicast,
+   * then transmit bytes, packets and more. Old kernels don't put a space
+   * after the colon. */
+  return sscanf (colon + 1,
+                 " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+                 " %*u %*u %*u %*u %*u %*u"
+                 " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT,
+                 &out->rx_bytes, &out->rx_packets,
+                 &out->tx_bytes, &out->tx_packets) == 4;
+}
+
+/**
+ * eins_netdev_counter_delta:
+ * @previous: a counter at the start of an interval
+ * @current: the same counter at its end
+ *
+ * Returns: how much the counter increased during the interval, allowing for
+ *   32-bit counters wrapping and counters being reset
+ */
+guint64
+eins_netdev_counter_delta (guint64 previous,
+                           guint64 current)
+{
+  if (current >= previous)
+    return current - previous;
+
+  if (previous <= G_MAXUINT32)
+    return current + ((guint64) G_MAXUINT32 + 1) - previous;
+
+  return current;
+}
+
+/**
+ * eins_netdev_totals_add:
+ * @totals: an interface's totals
+ * @previous: the interface's counters at the start of the interval
+ * @current: the interface's counters at its end
+ * @elapsed_us: length of the interval on the monotonic clock, in
+ *   microseconds
+ *
+ * Adds what the interface transferred during the interval to @totals. Once
+ * it has been awake for an hour since the last one, the hour is finished.
+ */
+void
+eins_netdev_totals_add (EinsNetdevTotals     *totals,
+                        const EinsNetdevLine *previous,
+                        const EinsNetdevLine *current,
+                        gint64                elapsed_us)
+{
+  guint64 rx_bytes = eins_netdev_counter_delta (previous->rx_bytes,
+                                                current->rx_bytes);
+  guint64 tx_bytes = eins_netdev_counter_delta (previous->tx_bytes,
+                                                current->tx_bytes);
+
+  totals->rx_bytes += rx_bytes;
+  totals->tx_bytes += tx_bytes;
+  totals->rx_packets += eins_netdev_counter_delta (previous->rx_packets,
+                                                   current->rx_packets);
+  totals->tx_packets += eins_netdev_counter_delta (previous->tx_packets,
+                                                   current->tx_packets);
+
+  if (elapsed_us >= MIN_ELAPSED_USECONDS)
+    {
+      totals->peak_rx_rate = MAX (totals->peak_rx_rate,
+                                  rx_bytes * G_USEC_PER_SEC / elapsed_us);
+      totals->peak_tx_rate = MAX (totals->peak_tx_rate,
+                                  tx_bytes * G_USEC_PER_SEC / elapsed_us);
+    }
+
+  totals->hour_rx_bytes += rx_bytes;
+  totals->hour_tx_bytes += tx_bytes;
+  totals->hour_elapsed_us += MAX (elapsed_us, 0);
+
+  if (totals->hour_elapsed_us >= G_TIME_SPAN_HOUR)
+    eins_netdev_totals_finish_hour (totals);
+}
+
+/**
+ * eins_netdev_totals_finish_hour:
+ * @totals: an interface's totals
+ *
+ * Counts the hour in progress, even if it is incomplete, towards the busiest
+ * hour, and starts another.
+ */
+void
+eins_netdev_totals_finish_hour (EinsNetdevTotals *totals)
+{
+  totals->peak_hour_rx_bytes = MAX (totals->peak_hour_rx_bytes,
+                                    totals->hour_rx_bytes);
+  totals->peak_hour_tx_bytes = MAX (totals->peak_hour_tx_bytes,
+                                    totals->hour_tx_bytes);
+  totals->hour_rx_bytes = 0;
+  totals->hour_tx_bytes = 0;
+  totals->hour_elapsed_us = 0;
+}
+
+void
+eins_netdev_totals_reset (EinsNetdevTotals *totals)
+{
+  memset (totals, 0, sizeof (*totals));
+}
+
+/**
+ * eins_netdev_read_ifindex:
+ * @class_net_dir: where sysfs lists network interfaces, normally
+ *   /sys/class/net
+ * @name: the kernel's name for an interface
+ *
+ * The kernel gives each interface it creates a new index, so an interface
+ * which is removed and created again under the same name has another one.
+ *
+ * Returns: the interface's index, or 0 if it could not be read
+ */
+guint
+eins_netdev_read_ifindex (const gchar *class_net_dir,
+                          const gchar *name)
+{
+  g_autofree gchar *path = g_build_filename (class_net_dir, name, "ifindex",
+                                             NULL);
+  g_autofree gchar *contents = NULL;
+  guint64 ifindex;
+
+  if (!g_file_get_contents (path, &contents, NULL, NULL) ||
+      !g_ascii_string_to_unsigned (g_strstrip (contents), 10, 1, G_MAXUINT,
+                                   &ifindex, NULL))
+    return 0;
+
+  return ifindex;
+}
+
+static gboolean
+is_physical (const gchar *name)
+{
+  g_autofree gchar *device = g_build_filename (SYS_CLASS_NET_DIR, name,
+                                               "device", NULL);
+
+  return g_file_test (device, G_FILE_TEST_EXISTS);
+}
+
+static gint
+get_series (const gchar *name,
+            const gchar *suffix)
+{
+  g_autofree gchar *series_name = g_strconcat (name, suffix, NULL);
+
+  if (store == NULL || strlen (series_name) > EINS_RING_STORE_MAX_NAME_LENGTH)
+    return -1;
+
+  return eins_ring_store_get_series (store, series_name);
+}
+
+static Interface *
+interface_new (const gchar *name)
+{
+  Interface *interface = g_new0 (Interface, 1);
+
+  g_strlcpy (interface->last.name, name, sizeof (interface->last.name));
+  interface->physical = is_physical (name);
+  interface->rx_bytes_series = -1;
+  interface->tx_bytes_series = -1;
+  interface->rx_packets_series = -1;
+  interface->tx_packets_series = -1;
+
+  if (interface->physical)
+    {
+      interface->rx_bytes_series = get_series (name, "-rx-bytes");
+      interface->tx_bytes_series = get_series (name, "-tx-bytes");
+      interface->rx_packets_series = get_series (name, "-rx-packets");
+      interface->tx_packets_series = get_series (name, "-tx-packets");
+    }
+
+  return interface;
+}
+
+static void
+add_sample (gint    series,
+            gint64  time,
+            guint64 value)
+{
+  if (series >= 0)
+    eins_ring_store_append (store, series, time, value);
+}
+
+static void
+add_interval (Interface            *interface,
+              const EinsNetdevLine *previous,
+              const EinsNetdevLine *current,
+              gint64                time)
+{
+  add_sample (interface->rx_bytes_series, time,
+              eins_netdev_counter_delta (previous->rx_bytes,
+                                         current->rx_bytes));
+  add_sample (interface->tx_bytes_series, time,
+              eins_netdev_counter_delta (previous->tx_bytes,
+                                         current->tx_bytes));
+  add_sample (interface->rx_packets_series, time,
+              eins_netdev_counter_delta (previous->rx_packets,
+                                         current->rx_packets));
+  add_sample (interface->tx_packets_series, time,
+              eins_netdev_counter_delta (previous->tx_packets,
+                                         current->tx_packets));
+}
+
+static gboolean
+sample_netdev (gpointer user_data G_GNUC_UNUSED)
+{
+  static gchar buffer[16384];
+  static const EinsNetdevLine zero = { 0 };
+  gint64 now = g_get_monotonic_time ();
+  gint64 wall_now = g_get_real_time ();
+  gchar *line, *next;
+
+  if (eins_read_fd (netdev_fd, buffer, sizeof (buffer)) < 0)
+    {
+      g_debug ("Failed to read " NETDEV_PATH ": %s", g_strerror (errno));
+      return G_SOURCE_CONTINUE;
+    }
+
+  sample_number++;
+
+  for (line = buffer; *line != '\0'; line = next)
+    {
+      EinsNetdevLine current;
+      Interface *interface;
+
+      next = strchr (line, '\n');
+      if (next == NULL)
+        next = line + strlen (line);
+      else
+        *next++ = '\0';
+
+      if (!eins_netdev_parse_line (line, &current))
+        continue;
+
+      interface = g_hash_table_lookup (interfaces, current.name);
+      if (interface == NULL)
+        {
+          interface = interface_new (current.name);
+          g_hash_table_insert (interfaces, interface->last.name, interface);
+        }
+
+      if (interface->physical)
+        {
+          guint ifindex = eins_netdev_read_ifindex (SYS_CLASS_NET_DIR,
+                                                    current.name);
+
+          /* Listed in the previous sample: count the difference. Appeared,
+           * or replaced, since then: its counters started from zero. First
+           * sample: only take a baseline. */
+          if (interface->last_seen == sample_number - 1 &&
+              interface->last_seen != 0 && ifindex == interface->ifindex)
+            add_interval (interface, &interface->last, &current, wall_now);
+          else if (sample_number > 1)
+            add_interval (interface, &zero, &current, wall_now);
+
+          interface->ifindex = ifindex;
+        }
+
+      interface->last = current;
+      interface->last_seen = sample_number;
+    }
+
+  if (sample_number > 1)
+    add_sample (elapsed_series, wall_now, MAX (now - last_sample_time, 0));
+
+  last_sample_time = now;
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Takes the samples of a series, as a set of EinsRingSample (owned) keyed
+ * by their time, so that the samples of different series added at once can
+ * be matched up. */
+static GHashTable *
+take_by_time (gint series)
+{
+  g_autoptr(GArray) samples = NULL;
+  GHashTable *by_time = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                               g_free, NULL);
+
+  if (series < 0)
+    return by_time;
+
+  samples = eins_ring_store_take (store, series);
+  for (guint i = 0; i < samples->len; i++)
+    {
+      EinsRingSample *sample = g_new (EinsRingSample, 1);
+
+      *sample = g_array_index (samples, EinsRingSample, i);
+      g_hash_table_add (by_time, sample);
+    }
+
+  return by_time;
+}
+
+/* Returns 0 for a sample which is missing, such as one lost with the
+ * power. */
+static guint64
+value_at (GHashTable *by_time,
+          gint64      time)
+{
+  EinsRingSample *sample = g_hash_table_lookup (by_time, &time);
+
+  return sample != NULL ? sample->value : 0;
+}
+
+/* Replays the intervals stored for the interface since the event was last
+ * recorded. */
+static void
+take_totals (Interface        *interface,
+             GArray           *intervals,
+             EinsNetdevTotals *totals)
+{
+  static const EinsNetdevLine zero = { 0 };
+  g_autoptr(GHashTable) rx_bytes = NULL;
+  g_autoptr(GHashTable) tx_bytes = NULL;
+  g_autoptr(GHashTable) rx_packets = NULL;
+  g_autoptr(GHashTable) tx_packets = NULL;
+
+  rx_bytes = take_by_time (interface->rx_bytes_series);
+  tx_bytes = take_by_time (interface->tx_bytes_series);
+  rx_packets = take_by_time (interface->rx_packets_series);
+  tx_packets = take_by_time (interface->tx_packets_series);
+
+  for (guint i = 0; i < intervals->len; i++)
+    {
+      const EinsRingSample *interval = &g_array_index (intervals,
+                                                       EinsRingSample, i);
+      EinsNetdevLine delta = { 0 };
+
+      delta.rx_bytes = value_at (rx_bytes, interval->time);
+      delta.tx_bytes = value_at (tx_bytes, interval->time);
+      delta.rx_packets = value_at (rx_packets, interval->time);
+      delta.tx_packets = value_at (tx_packets, interval->time);
+
+      eins_netdev_totals_add (totals, &zero, &delta, interval->value);
+    }
+}
+
+/* Frees the series of interfaces which are gone, and of any which were gone
+ * before the daemon was started. */
+static void
+prune_store (void)
+{
+  g_autoptr(GHashTable) names = NULL;
+  static const gchar * const suffixes[] = {
+    "-rx-bytes", "-tx-bytes", "-rx-packets", "-tx-packets"
+  };
+  GHashTableIter iter;
+  Interface *interface;
+
+  if (store == NULL)
+    return;
+
+  names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  g_hash_table_add (names, g_strdup (ELAPSED_SERIES_NAME));
+
+  g_hash_table_iter_init (&iter, interfaces);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &interface))
+    {
+      if (!interface->physical)
+        continue;
+
+      for (gsize i = 0; i < G_N_ELEMENTS (suffixes); i++)
+        g_hash_table_add (names, g_strconcat (interface->last.name,
+                                              suffixes[i], NULL));
+    }
+
+  eins_ring_store_prune (store, names);
+}
+
+/* Fewer samples than this, as there may be on the first day the daemon
+ * runs, are carried over to the next day. Can be changed with min-samples in
+ * the [netdev] group of the configuration. */
+#define NETDEV_MIN_SAMPLES 60
+
+static void
+record_netdev (gpointer user_data G_GNUC_UNUSED)
+{
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  Interface *interface;
+  g_autoptr(GArray) intervals = NULL;
+
+  if (elapsed_series < 0 ||
+      eins_ring_store_get_n_pending (store, elapsed_series) <
+      eins_config_get_uint64 ("netdev", "min-samples", NETDEV_MIN_SAMPLES))
+    return;
+
+  intervals = eins_ring_store_take (store, elapsed_series);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(stttttttt)"));
+
+  g_hash_table_iter_init (&iter, interfaces);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &interface))
+    {
+      EinsNetdevTotals totals = { 0 };
+
+      if (interface->physical)
+        take_totals (interface, intervals, &totals);
+
+      if (totals.rx_bytes != 0 || totals.tx_bytes != 0)
+        {
+          eins_netdev_totals_finish_hour (&totals);
+          g_variant_builder_add (&builder, "(stttttttt)",
+                                 interface->last.name,
+                                 totals.rx_bytes,
+                                 totals.tx_bytes,
+                                 totals.rx_packets,
+                                 totals.tx_packets,
+                                 totals.peak_hour_rx_bytes,
+                                 totals.peak_hour_tx_bytes,
+                                 totals.peak_rx_rate,
+                                 totals.peak_tx_rate);
+        }
+
+      /* Forget interfaces which have gone away, now that what they
+       * transferred has been recorded. */
+      if (interface->last_seen != sample_number)
+        g_hash_table_iter_remove (&iter);
+    }
+
+  prune_store ();
+
+  eins_recorder_record_event (NETDEV_EVENT,
+                              g_variant_new ("(ua(stttttttt))",
+                                             intervals->len, &builder));
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+static void
+open_store (const gchar *store_path)
+{
+  g_autoptr(GError) error = NULL;
+
+  store = eins_ring_store_open (store_path, NETDEV_STORE_N_SERIES,
+                                NETDEV_STORE_CAPACITY, &error);
+  if (store == NULL)
+    {
+      g_warning ("Failed to open network sample store: %s", error->message);
+      return;
+    }
+
+  elapsed_series = eins_ring_store_get_series (store, ELAPSED_SERIES_NAME);
+}
+
+void
+eins_netdev_start (void)
+{
+  netdev_fd = g_open (NETDEV_PATH, O_RDONLY | O_CLOEXEC, 0);
+  if (netdev_fd < 0)
+    {
+      g_warning ("Failed to open " NETDEV_PATH ": %s", g_strerror (errno));
+      return;
+    }
+
+  interfaces = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+  open_store (NETDEV_STORE_FILE_PATH);
+
+  /* Only takes a baseline, but lists the interfaces, so that the series of
+   * those which are gone can be freed */
+  sample_netdev (NULL);
+  prune_store ();
+  sample_source_id = eins_boottimeout_add_useconds (NETDEV_SAMPLE_INTERVAL_USECONDS,
+                                                    sample_netdev, NULL);
+  eins_schedule_add ("netdev", NETDEV_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_netdev, NULL);
+}
+
+/* Intervals already in the store are recorded once it is started again. */
+void
+eins_netdev_stop (void)
+{
+  eins_schedule_remove ("netdev");
+  g_clear_handle_id (&sample_source_id, g_source_remove);
+  g_clear_pointer (&store, eins_ring_store_free);
+  g_clear_pointer (&interfaces, g_hash_table_unref);
+  elapsed_series = -1;
+  sample_number = 0;
+
+  if (netdev_fd >= 0)
+    g_close (netdev_fd, NULL);
+  netdev_fd = -1;
+}
@@ -0,0 +1,71 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_netdev_start (void);
+void eins_netdev_stop (void);
+
+/* For tests */
+
+/* The fields of a /proc/net/dev line which are used */
+typedef struct {
+  gchar name[16];
+  guint64 rx_bytes;
+  guint64 rx_packets;
+  guint64 tx_bytes;
+  guint64 tx_packets;
+} EinsNetdevLine;
+
+gboolean eins_netdev_parse_line (const gchar    *line,
+                                 EinsNetdevLine *out);
+
+guint64 eins_netdev_counter_delta (guint64 previous,
+                                   guint64 current);
+guint eins_netdev_read_ifindex (const gchar *class_net_dir,
+                                const gchar *name);
+
+/* What an interface transferred since the last event */
+typedef struct {
+  guint64 rx_bytes;
+  guint64 rx_packets;
+  guint64 tx_bytes;
+  guint64 tx_packets;
+
+  /* The hour being counted, in time awake */
+  gint64 hour_elapsed_us;
+  guint64 hour_rx_bytes;
+  guint64 hour_tx_bytes;
+
+  /* Bytes transferred in the busiest hour */
+  guint64 peak_hour_rx_bytes;
+  guint64 peak_hour_tx_bytes;
+
+  /* Highest rate over a sampling interval, in bytes per second */
+  guint64 peak_rx_rate;
+  guint64 peak_tx_rate;
+} EinsNetdevTotals;
+
+void eins_netdev_totals_add (EinsNetdevTotals     *totals,
+                             const EinsNetdevLine *previous,
+                             const EinsNetdevLine *current,
+                             gint64                elapsed_us);
+void eins_netdev_totals_finish_hour (EinsNetdevTotals *totals);
+void eins_netdev_totals_reset (EinsNetdevTotals *totals);
@@ -0,0 +1,493 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-oom.h"
+#include "eins-recorder.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+#include "eins-unit.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <glib-unix.h>
+
+/*
+ * Out-of-memory event, recorded once a day if any cgroup ran out of memory,
+ * with payload "a(stt)".
+ *
+ * Field | Description
+ * ------+--------------------------------------------------------------
+ *     s | Unit, with any instance name removed ("user@.service") and
+ *       | session numbers too ("session.scope"); for apps, the app ID.
+ *       | "" counts every unit beyond the first EINS_OOM_MAX_UNITS seen
+ *       | that day.
+ *     t | Number of times the unit reached its memory limit and
+ *       | reclaim failed, from the "oom" counter of memory.events
+ *     t | Number of its processes killed by the OOM killer, whether
+ *       | because of its own limit or because the whole system ran out
+ *       | of memory, from the "oom_kill" counter
+ *
+ * The kernel raises an inotify modify event whenever a memory.events file
+ * changes, so one watch on each top-level slice's file, whose counters
+ * include those of every cgroup below it, sees every OOM without polling.
+ * That covers the app scopes, which are below user.slice. Only when the
+ * "oom" or "oom_kill" counter of a slice has changed is the slice walked to
+ * find the units responsible, from the memory.events.local of each cgroup.
+ * Whatever cannot be attributed, for example on kernels without
+ * memory.events.local, is counted against the slice.
+ */
+
+#define OOM_EVENT "fcdbc6b5-3aeb-4d0d-b0af-c0c987ece405"
+
+/* 24 hours */
+#define OOM_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+
+/* Deep enough for user.slice/user-<uid>.slice/user@<uid>.service/app.slice/
+ * app-….scope/<sub-cgroup> */
+#define MAX_WALK_DEPTH 8
+
+static const gchar * const top_level_names[] = {
+  "system.slice",
+  "user.slice",
+  "machine.slice",
+};
+
+typedef struct {
+  guint64 oom;
+  guint64 oom_kill;
+} Counters;
+
+typedef struct {
+  gchar *path;
+  /* From memory.events */
+  Counters total;
+  /* Map from cgroup path to Counters from its memory.events.local (owned) */
+  GHashTable *local;
+} TopLevel;
+
+static int inotify_fd = -1;
+static guint inotify_source_id;
+
+/* Map from path to TopLevel (owned) */
+static GHashTable *top_levels;
+
+/* Map from watch descriptor to TopLevel (owned by top_levels) */
+static GHashTable *top_level_by_wd;
+
+/* Map from unit name (owned) to Counters (owned) */
+static GHashTable *summary;
+
+/**
+ * eins_oom_parse_events:
+ * @contents: contents of a memory.events or memory.events.local file
+ * @oom: (out): return location for the "oom" counter
+ * @oom_kill: (out): return location for the "oom_kill" counter
+ *
+ * Returns: %TRUE if both counters were found
+ */
+gboolean
+eins_oom_parse_events (const gchar *contents,
+                       guint64     *oom,
+                       guint64     *oom_kill)
+{
+  g_auto(GStrv) lines = NULL;
+  gboolean found_oom = FALSE, found_oom_kill = FALSE;
+
+  g_return_val_if_fail (contents != NULL, FALSE);
+
+  lines = g_strsplit (contents, "\n", -1);
+
+  for (gsize i = 0; lines[i] != NULL; i++)
+    {
+      if (sscanf (lines[i], "oom %" G_GUINT64_FORMAT, oom) == 1)
+        found_oom = TRUE;
+      else if (sscanf (lines[i], "oom_kill %" G_GUINT64_FORMAT, oom_kill) == 1)
+        found_oom_kill = TRUE;
+    }
+
+  return found_oom && found_oom_kill;
+}
+
+/**
+ * eins_oom_unit_name:
+ * @cgroup_path: path of a cgroup
+ *
+ * Returns: (transfer full): the name under which OOMs in the cgroup are
+ *   counted: that of the unit which contains it
+ */
+gchar *
+eins_oom_unit_name (const gchar *cgroup_path)
+{
+  g_autofree gchar *path = g_strdup (cgroup_path);
+
+  g_return_val_if_fail (cgroup_path != NULL, NULL);
+
+  while (TRUE)
+    {
+      g_autofree gchar *name = g_path_get_basename (path);
+      g_autofree gchar *parent = NULL;
+
+      if (g_str_has_suffix (name, ".service") ||
+          g_str_has_suffix (name, ".scope") ||
+          g_str_has_suffix (name, ".slice"))
+        return eins_unit_canonicalize (name);
+
+      /* A cgroup which the unit's processes created below it */
+      parent = g_path_get_dirname (path);
+      if (strcmp (parent, path) == 0)
+        return g_steal_pointer (&name);
+
+      g_free (path);
+      path = g_steal_pointer (&parent);
+    }
+}
+
+static gboolean
+read_counters (const gchar *path,
+               Counters    *counters)
+{
+  g_autofree gchar *contents = NULL;
+
+  if (!g_file_get_contents (path, &contents, NULL, NULL))
+    return FALSE;
+
+  return eins_oom_parse_events (contents, &counters->oom, &counters->oom_kill);
+}
+
+/* Counters are reset if the cgroup is removed and created again. */
+static guint64
+counter_delta (guint64 previous,
+               guint64 current)
+{
+  return current >= previous ? current - previous : current;
+}
+
+static void
+summary_add (const gchar *unit,
+             guint64      oom,
+             guint64      oom_kill)
+{
+  Counters *counters;
+
+  if (oom == 0 && oom_kill == 0)
+    return;
+
+  if (summary == NULL)
+    summary = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  counters = g_hash_table_lookup (summary, unit);
+
+  if (counters == NULL && g_hash_table_size (summary) >= EINS_OOM_MAX_UNITS)
+    {
+      unit = "";
+      counters = g_hash_table_lookup (summary, unit);
+    }
+
+  if (counters == NULL)
+    {
+      counters = g_new0 (Counters, 1);
+      g_hash_table_insert (summary, g_strdup (unit), counters);
+    }
+
+  counters->oom += oom;
+  counters->oom_kill += oom_kill;
+}
+
+/*
+ * Reads the local counters of @path and every cgroup below it into @local,
+ * adding any increase since @previous to the summary unless @baseline is set.
+ * Adds what was attributed to @attributed.
+ */
+static void
+walk_cgroup (const gchar *path,
+             guint        depth,
+             GHashTable  *previous,
+             GHashTable  *local,
+             gboolean     baseline,
+             Counters    *attributed)
+{
+  g_autofree gchar *events_path = NULL;
+  g_autoptr(GDir) dir = NULL;
+  Counters current;
+  const gchar *name;
+
+  events_path = g_build_filename (path, "memory.events.local", NULL);
+  if (read_counters (events_path, &current))
+    {
+      Counters *counters = g_new (Counters, 1);
+      Counters *last = g_hash_table_lookup (previous, path);
+      Counters zero = { 0 };
+
+      *counters = current;
+      g_hash_table_insert (local, g_strdup (path), counters);
+
+      if (last == NULL)
+        last = &zero;
+
+      if (!baseline)
+        {
+          guint64 oom = counter_delta (last->oom, current.oom);
+          guint64 oom_kill = counter_delta (last->oom_kill, current.oom_kill);
+
+          if (oom > 0 || oom_kill > 0)
+            {
+              g_autofree gchar *unit = eins_oom_unit_name (path);
+
+              summary_add (unit, oom, oom_kill);
+              attributed->oom += oom;
+              attributed->oom_kill += oom_kill;
+            }
+        }
+    }
+
+  if (depth >= MAX_WALK_DEPTH)
+    return;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *child = g_build_filename (path, name, NULL);
+
+      if (g_file_test (child, G_FILE_TEST_IS_DIR))
+        walk_cgroup (child, depth + 1, previous, local, baseline, attributed);
+    }
+}
+
+static void
+top_level_free (TopLevel *top_level)
+{
+  g_free (top_level->path);
+  g_hash_table_unref (top_level->local);
+  g_free (top_level);
+}
+
+/**
+ * eins_oom_scan:
+ * @top_level_path: path of a cgroup whose memory.events may have changed
+ * @baseline: if %TRUE, only read the counters of the cgroup and those below
+ *   it, so that later scans count what happens after this one
+ *
+ * Adds any OOMs in the cgroup since the last scan to the summary.
+ */
+void
+eins_oom_scan (const gchar *top_level_path,
+               gboolean     baseline)
+{
+  g_autofree gchar *events_path = NULL;
+  g_autoptr(GHashTable) local = NULL;
+  g_autofree gchar *unit = NULL;
+  TopLevel *top_level;
+  Counters total, attributed = { 0 };
+  guint64 oom, oom_kill;
+
+  g_return_if_fail (top_level_path != NULL);
+
+  if (top_levels == NULL)
+    top_levels = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                        (GDestroyNotify) top_level_free);
+
+  top_level = g_hash_table_lookup (top_levels, top_level_path);
+  if (top_level == NULL)
+    {
+      top_level = g_new0 (TopLevel, 1);
+      top_level->path = g_strdup (top_level_path);
+      top_level->local = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, g_free);
+      g_hash_table_insert (top_levels, top_level->path, top_level);
+    }
+
+  events_path = g_build_filename (top_level_path, "memory.events", NULL);
+  if (!read_counters (events_path, &total))
+    return;
+
+  oom = counter_delta (top_level->total.oom, total.oom);
+  oom_kill = counter_delta (top_level->total.oom_kill, total.oom_kill);
+  top_level->total = total;
+
+  /* Only the other counters changed, for example because a cgroup reached
+   * its memory.high */
+  if (!baseline && oom == 0 && oom_kill == 0)
+    return;
+
+  local = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  walk_cgroup (top_level_path, 0, top_level->local, local, baseline,
+               &attributed);
+
+  /* Replacing the table forgets cgroups which have since been removed */
+  g_hash_table_unref (top_level->local);
+  top_level->local = g_steal_pointer (&local);
+
+  if (baseline)
+    return;
+
+  unit = eins_oom_unit_name (top_level_path);
+  summary_add (unit,
+               oom > attributed.oom ? oom - attributed.oom : 0,
+               oom_kill > attributed.oom_kill ? oom_kill - attributed.oom_kill : 0);
+}
+
+/**
+ * eins_oom_take_summary:
+ *
+ * Returns: (transfer floating) (nullable): the payload of the event for the
+ *   OOMs found since the last call, or %NULL if there were none
+ */
+GVariant *
+eins_oom_take_summary (void)
+{
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  const gchar *unit;
+  const Counters *counters;
+
+  if (summary == NULL || g_hash_table_size (summary) == 0)
+    return NULL;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(stt)"));
+
+  g_hash_table_iter_init (&iter, summary);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &unit,
+                                 (gpointer *) &counters))
+    g_variant_builder_add (&builder, "(stt)", unit, counters->oom,
+                           counters->oom_kill);
+
+  g_hash_table_remove_all (summary);
+
+  return g_variant_builder_end (&builder);
+}
+
+static gboolean
+inotify_readable_cb (gint         fd,
+                     GIOCondition condition G_GNUC_UNUSED,
+                     gpointer     user_data G_GNUC_UNUSED)
+{
+  gchar buf[1024] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+
+  while (TRUE)
+    {
+      ssize_t len = read (fd, buf, sizeof buf);
+
+      if (len < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          if (errno != EAGAIN)
+            g_warning ("Failed to read inotify events: %s", g_strerror (errno));
+
+          return G_SOURCE_CONTINUE;
+        }
+
+      for (gchar *p = buf; p < buf + len; )
+        {
+          const struct inotify_event *event = (const struct inotify_event *) p;
+          TopLevel *top_level = g_hash_table_lookup (top_level_by_wd,
+                                                     GINT_TO_POINTER (event->wd));
+
+          if (top_level != NULL && (event->mask & IN_MODIFY))
+            eins_oom_scan (top_level->path, FALSE);
+
+          p += sizeof (struct inotify_event) + event->len;
+        }
+    }
+}
+
+static void
+record_oom (gpointer user_data G_GNUC_UNUSED)
+{
+  GVariant *oom_summary = eins_oom_take_summary ();
+
+  if (oom_summary != NULL)
+    {
+      eins_recorder_record_event (OOM_EVENT, oom_summary);
+      eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+    }
+}
+
+void
+eins_oom_start (void)
+{
+  inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0)
+    {
+      g_warning ("Failed to initialize inotify: %s", g_strerror (errno));
+      return;
+    }
+
+  top_level_by_wd = g_hash_table_new (NULL, NULL);
+
+  for (gsize i = 0; i < G_N_ELEMENTS (top_level_names); i++)
+    {
+      g_autofree gchar *path = g_build_filename (CGROUP_ROOT,
+                                                 top_level_names[i], NULL);
+      g_autofree gchar *events_path = g_build_filename (path, "memory.events",
+                                                        NULL);
+      int wd;
+
+      /* The memory controller is not enabled for this slice, or it doesn't
+       * exist, as machine.slice usually doesn't */
+      wd = inotify_add_watch (inotify_fd, events_path, IN_MODIFY);
+      if (wd < 0)
+        {
+          g_debug ("Failed to watch %s: %s", events_path, g_strerror (errno));
+          continue;
+        }
+
+      eins_oom_scan (path, TRUE);
+      g_hash_table_insert (top_level_by_wd, GINT_TO_POINTER (wd),
+                           g_hash_table_lookup (top_levels, path));
+    }
+
+  if (g_hash_table_size (top_level_by_wd) == 0)
+    {
+      close (inotify_fd);
+      inotify_fd = -1;
+      return;
+    }
+
+  inotify_source_id = g_unix_fd_add (inotify_fd, G_IO_IN, inotify_readable_cb,
+                                     NULL);
+  eins_schedule_add ("oom", OOM_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_oom, NULL);
+}
+
+/* OOMs not yet recorded are dropped. Once it is started again, they are
+ * counted from then, as when the daemon starts. */
+void
+eins_oom_stop (void)
+{
+  eins_schedule_remove ("oom");
+  g_clear_handle_id (&inotify_source_id, g_source_remove);
+  g_clear_pointer (&top_level_by_wd, g_hash_table_unref);
+  g_clear_pointer (&top_levels, g_hash_table_unref);
+  g_clear_pointer (&summary, g_hash_table_unref);
+
+  if (inotify_fd >= 0)
+    g_close (inotify_fd, NULL);
+  inotify_fd = -1;
+}
@@ -0,0 +1,37 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_oom_start (void);
+void eins_oom_stop (void);
+
+/* For tests */
+
+/* Kills of any further units are counted together, under "" */
+#define EINS_OOM_MAX_UNITS 64
+
+gboolean eins_oom_parse_events (const gchar *contents,
+                                guint64     *oom,
+                                guint64     *oom_kill);
+gchar *eins_oom_unit_name (const gchar *cgroup_path);
+void eins_oom_scan (const gchar *top_level_path,
+                    gboolean     baseline);
+GVariant *eins_oom_take_summary (void);
@@ -0,0 +1,447 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-peripherals.h"
+#include "eins-recorder.h"
+#include "eins-stats.h"
+#include "eins-uevent-monitor.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gio/gio.h>
+
+/*
+ * Peripheral inventory event, with payload "a(sqqu)", recorded whenever the
+ * set of devices differs from the one last recorded.
+ *
+ * Field | Description
+ * ------+--------------------------------------------------------------
+ *     s | Bus: 'pci' or 'usb'
+ *     q | Vendor ID
+ *     q | Product ID
+ *     u | Class: for PCI, the 24-bit class code; for USB, the device
+ *       | class, subclass and protocol as (class << 16 | sub << 8 | proto)
+ *
+ * Only PCI storage, network and display controllers are listed, which
+ * covers disk controllers, Wi-Fi and GPUs; and every USB device but hubs.
+ * Entries are sorted, and each of several identical devices has its own.
+ *
+ * sysfs is walked once when the daemon starts. After that, the inventory is
+ * kept up to date from kernel uevents, and compared with the last recorded
+ * one (cached in INSTRUMENTATION_CACHE_DIR) once the devices have been still
+ * for REPORT_DELAY_SECONDS, so plugging in a dock records one event.
+ */
+
+#define PERIPHERALS_EVENT "ec499cb8-1e92-4085-8d8a-c45422a429fc"
+
+#define PERIPHERALS_CACHE_FILE_PATH INSTRUMENTATION_CACHE_DIR "/peripherals"
+
+#define SYSFS_ROOT "/sys"
+
+#define REPORT_DELAY_SECONDS 10
+
+#define PCI_BASE_CLASS_STORAGE 0x01
+#define PCI_BASE_CLASS_NETWORK 0x02
+#define PCI_BASE_CLASS_DISPLAY 0x03
+
+#define USB_CLASS_HUB 0x09
+
+/* Map from devpath (owned gchar *) to entry (owned GVariant *) */
+static GHashTable *devices;
+static guint report_source_id;
+static guint pci_watch_id;
+static guint usb_watch_id;
+
+static GHashTable *
+devices_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                (GDestroyNotify) g_variant_unref);
+}
+
+static GVariant *
+new_entry (const gchar *bus,
+           guint16      vendor,
+           guint16      product,
+           guint32      class)
+{
+  if (strcmp (bus, "pci") == 0)
+    {
+      guint8 base_class = class >> 16;
+
+      if (base_class != PCI_BASE_CLASS_STORAGE &&
+          base_class != PCI_BASE_CLASS_NETWORK &&
+          base_class != PCI_BASE_CLASS_DISPLAY)
+        return NULL;
+    }
+  else if ((class >> 16) == USB_CLASS_HUB)
+    {
+      return NULL;
+    }
+
+  return g_variant_ref_sink (g_variant_new ("(sqqu)", bus, vendor, product,
+                                            class));
+}
+
+static gboolean
+read_hex_file (const gchar *dir,
+               const gchar *name,
+               guint64     *value)
+{
+  g_autofree gchar *path = g_build_filename (dir, name, NULL);
+  g_autofree gchar *contents = NULL;
+  gchar *end;
+
+  if (!g_file_get_contents (path, &contents, NULL, NULL))
+    return FALSE;
+
+  *value = g_ascii_strtoull (contents, &end, 16);
+  return end != contents;
+}
+
+static GVariant *
+read_pci_device (const gchar *path)
+{
+  guint64 vendor, device, class;
+
+  if (!read_hex_file (path, "vendor", &vendor) ||
+      !read_hex_file (path, "device", &device) ||
+      !read_hex_file (path, "class", &class))
+    return NULL;
+
+  return new_entry ("pci", vendor, device, class);
+}
+
+static GVariant *
+read_usb_device (const gchar *path)
+{
+  guint64 vendor, product, class, subclass, protocol;
+
+  if (!read_hex_file (path, "idVendor", &vendor) ||
+      !read_hex_file (path, "idProduct", &product) ||
+      !read_hex_file (path, "bDeviceClass", &class) ||
+      !read_hex_file (path, "bDeviceSubClass", &subclass) ||
+      !read_hex_file (path, "bDeviceProtocol", &protocol))
+    return NULL;
+
+  return new_entry ("usb", vendor, product,
+                    class << 16 | subclass << 8 | protocol);
+}
+
+/*
+ * Returns the devpath of a /sys/bus/…/devices entry, as it would appear in a
+ * uevent: the target of the symlink, relative to the root of sysfs.
+ */
+static gchar *
+get_devpath (const gchar *sysfs_root,
+             const gchar *dir,
+             const gchar *name)
+{
+  g_autofree gchar *path = g_build_filename (dir, name, NULL);
+  g_autofree gchar *target = g_file_read_link (path, NULL);
+  g_autofree gchar *resolved = NULL;
+  gsize root_len = strlen (sysfs_root);
+
+  if (target == NULL)
+    return g_steal_pointer (&path);
+
+  resolved = g_canonicalize_filename (target, dir);
+  if (g_str_has_prefix (resolved, sysfs_root) && resolved[root_len] == '/')
+    return g_strdup (resolved + root_len);
+
+  return g_steal_pointer (&resolved);
+}
+
+static void
+scan_bus (const gchar *sysfs_root,
+          const gchar *bus,
+          GHashTable  *result)
+{
+  g_autofree gchar *dir_path = g_build_filename (sysfs_root, "bus", bus,
+                                                 "devices", NULL);
+  g_autoptr(GDir) dir = NULL;
+  g_autoptr(GError) error = NULL;
+  const gchar *name;
+
+  dir = g_dir_open (dir_path, 0, &error);
+  if (dir == NULL)
+    {
+      g_debug ("Failed to list %s: %s", dir_path, error->message);
+      return;
+    }
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *path = g_build_filename (dir_path, name, NULL);
+      GVariant *entry;
+
+      if (strcmp (bus, "pci") == 0)
+        {
+          entry = read_pci_device (path);
+        }
+      else
+        {
+          /* USB interfaces, as opposed to devices, are named like 1-1:1.0 */
+          if (strchr (name, ':') != NULL)
+            continue;
+
+          entry = read_usb_device (path);
+        }
+
+      if (entry != NULL)
+        g_hash_table_replace (result, get_devpath (sysfs_root, dir_path, name),
+                              entry);
+    }
+}
+
+/**
+ * eins_peripherals_scan:
+ * @sysfs_root: where sysfs is mounted, normally /sys
+ *
+ * Lists the PCI and USB devices of interest.
+ *
+ * Returns: (transfer full): a map from each device's devpath to its
+ *   "(sqqu)" inventory entry
+ */
+GHashTable *
+eins_peripherals_scan (const gchar *sysfs_root)
+{
+  g_autofree gchar *root = g_canonicalize_filename (sysfs_root, NULL);
+  GHashTable *result = devices_new ();
+
+  scan_bus (root, "pci", result);
+  scan_bus (root, "usb", result);
+
+  return result;
+}
+
+/**
+ * eins_peripherals_entry_from_uevent:
+ * @properties: an "add" uevent, from eins_uevent_parse()
+ *
+ * Builds the inventory entry of a newly-added device from the uevent alone,
+ * without reading sysfs.
+ *
+ * Returns: (transfer full) (nullable): the device's "(sqqu)" inventory entry,
+ *   or %NULL if it is not of interest
+ */
+GVariant *
+eins_peripherals_entry_from_uevent (GHashTable *properties)
+{
+  const gchar *subsystem = g_hash_table_lookup (properties, "SUBSYSTEM");
+
+  if (g_strcmp0 (subsystem, "pci") == 0)
+    {
+      const gchar *id = g_hash_table_lookup (properties, "PCI_ID");
+      const gchar *class = g_hash_table_lookup (properties, "PCI_CLASS");
+      guint vendor, device;
+
+      if (id == NULL || class == NULL ||
+          sscanf (id, "%x:%x", &vendor, &device) != 2)
+        return NULL;
+
+      return new_entry ("pci", vendor, device,
+                        g_ascii_strtoull (class, NULL, 16));
+    }
+
+  if (g_strcmp0 (subsystem, "usb") == 0)
+    {
+      const gchar *devtype = g_hash_table_lookup (properties, "DEVTYPE");
+      const gchar *product_prop = g_hash_table_lookup (properties, "PRODUCT");
+      const gchar *type = g_hash_table_lookup (properties, "TYPE");
+      guint vendor, product, class, subclass, protocol;
+
+      /* The same keys are sent for each of the device's interfaces */
+      if (g_strcmp0 (devtype, "usb_device") != 0 ||
+          product_prop == NULL || type == NULL ||
+          sscanf (product_prop, "%x/%x", &vendor, &product) != 2 ||
+          sscanf (type, "%u/%u/%u", &class, &subclass, &protocol) != 3)
+        return NULL;
+
+      return new_entry ("usb", vendor, product,
+                        class << 16 | subclass << 8 | protocol);
+    }
+
+  return NULL;
+}
+
+static gint
+compare_entries (gconstpointer a,
+                 gconstpointer b)
+{
+  GVariant *entry_a = *(GVariant * const *) a;
+  GVariant *entry_b = *(GVariant * const *) b;
+  const gchar *bus_a, *bus_b;
+  guint16 vendor_a, vendor_b, product_a, product_b;
+  guint32 class_a, class_b;
+  gint cmp;
+
+  g_variant_get (entry_a, "(&sqqu)", &bus_a, &vendor_a, &product_a, &class_a);
+  g_variant_get (entry_b, "(&sqqu)", &bus_b, &vendor_b, &product_b, &class_b);
+
+  cmp = strcmp (bus_a, bus_b);
+  if (cmp != 0)
+    return cmp;
+  if (vendor_a != vendor_b)
+    return vendor_a < vendor_b ? -1 : 1;
+  if (product_a != product_b)
+    return product_a < product_b ? -1 : 1;
+  if (class_a != class_b)
+    return class_a < class_b ? -1 : 1;
+
+  return 0;
+}
+
+/**
+ * eins_peripherals_build_inventory:
+ * @devices: a map from devpath to inventory entry
+ *
+ * Returns: (transfer floating): the "a(sqqu)" payload for @devices, sorted so
+ *   that the same devices always give the same payload
+ */
+GVariant *
+eins_peripherals_build_inventory (GHashTable *devices)
+{
+  g_autoptr(GPtrArray) entries = NULL;
+  GHashTableIter iter;
+  GVariant *entry;
+
+  entries = g_ptr_array_sized_new (g_hash_table_size (devices));
+
+  g_hash_table_iter_init (&iter, devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    g_ptr_array_add (entries, entry);
+
+  g_ptr_array_sort (entries, compare_entries);
+
+  return g_variant_new_array (G_VARIANT_TYPE ("(sqqu)"),
+                              (GVariant **) entries->pdata, entries->len);
+}
+
+static gboolean
+report_inventory (gpointer user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GVariant) inventory = NULL;
+  g_autoptr(GVariant) normal = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *cached = NULL;
+  gsize cached_size;
+  gsize size;
+
+  report_source_id = 0;
+
+  inventory = g_variant_ref_sink (eins_peripherals_build_inventory (devices));
+  normal = g_variant_get_normal_form (inventory);
+  size = g_variant_get_size (normal);
+
+  if (g_file_get_contents (PERIPHERALS_CACHE_FILE_PATH, &cached, &cached_size,
+                           NULL) &&
+      cached_size == size &&
+      memcmp (cached, g_variant_get_data (normal), size) == 0)
+    {
+      g_debug ("Peripherals unchanged");
+      return G_SOURCE_REMOVE;
+    }
+
+  eins_recorder_record_event (PERIPHERALS_EVENT, normal);
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+
+  if (!g_file_set_contents (PERIPHERALS_CACHE_FILE_PATH,
+                            g_variant_get_data (normal), size, &error))
+    g_warning ("Failed to write " PERIPHERALS_CACHE_FILE_PATH ": %s",
+               error->message);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_report (void)
+{
+  if (report_source_id != 0)
+    g_source_remove (report_source_id);
+
+  report_source_id = g_timeout_add_seconds (REPORT_DELAY_SECONDS,
+                                            report_inventory, NULL);
+}
+
+static void
+device_changed_cb (GHashTable *properties,
+                   gpointer    user_data G_GNUC_UNUSED)
+{
+  const gchar *action, *devpath;
+
+  if (properties == NULL)
+    {
+      /* Some events were lost */
+      g_hash_table_unref (devices);
+      devices = eins_peripherals_scan (SYSFS_ROOT);
+      schedule_report ();
+      return;
+    }
+
+  action = g_hash_table_lookup (properties, "ACTION");
+  devpath = g_hash_table_lookup (properties, "DEVPATH");
+
+  if (strcmp (action, "add") == 0)
+    {
+      GVariant *entry = eins_peripherals_entry_from_uevent (properties);
+
+      if (entry == NULL)
+        return;
+
+      g_hash_table_replace (devices, g_strdup (devpath), entry);
+    }
+  else if (strcmp (action, "remove") == 0)
+    {
+      if (!g_hash_table_remove (devices, devpath))
+        return;
+    }
+  else
+    {
+      return;
+    }
+
+  schedule_report ();
+}
+
+void
+eins_peripherals_start (void)
+{
+  /*
+   * Subscribe first, so that nothing plugged in during the walk is missed.
+   * Those events wait in the socket until the main loop runs.
+   */
+  pci_watch_id = eins_uevent_monitor_add ("pci", device_changed_cb, NULL);
+  usb_watch_id = eins_uevent_monitor_add ("usb", device_changed_cb, NULL);
+
+  devices = eins_peripherals_scan (SYSFS_ROOT);
+  schedule_report ();
+}
+
+/* Devices changed meanwhile are reported once it is started again, since
+ * the inventory is compared with the cached one. */
+void
+eins_peripherals_stop (void)
+{
+  g_clear_handle_id (&pci_watch_id, eins_uevent_monitor_remove);
+  g_clear_handle_id (&usb_watch_id, eins_uevent_monitor_remove);
+  g_clear_handle_id (&report_source_id, g_source_remove);
+  g_clear_pointer (&devices, g_hash_table_unref);
+}
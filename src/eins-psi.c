@@ -0,0 +1,423 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-psi.h"
+#include "eins-boottime-source.h"
+#include "eins-config.h"
+#include "eins-recorder.h"
+#include "eins-ring-store.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+/*
+ * Pressure stall information event, recorded once a day, with payload
+ * "(ua(syyyytt))".
+ *
+ * Field      | Description
+ * -----------+--------------------------------------------------------
+ *          u | Number of samples taken during the day
+ * a(syyyytt) | One entry per resource:
+ *            |   s: the resource: 'cpu', 'memory' or 'io'
+ *            |   y: median of the "some" avg10 value, in percent
+ *            |   y: 90th percentile of the same
+ *            |   y: 99th percentile of the same
+ *            |   y: maximum of the same
+ *            |   t: time during which some tasks were stalled on the
+ *            |      resource, in microseconds
+ *            |   t: time during which all non-idle tasks were stalled on
+ *            |      the resource, in microseconds; 0 for 'cpu' on older
+ *            |      kernels
+ *
+ * avg10 values are rounded to the nearest percent. See
+ * https://docs.kernel.org/accounting/psi.html for the meaning of "some" and
+ * "full".
+ *
+ * The pressure files are sampled once a minute: reading one is a single
+ * pread() on a descriptor kept open for the daemon's lifetime, and storing
+ * it is a few fixed-size writes, so the cost doesn't depend on how loaded the
+ * system is. PSI triggers would only report stalls above a threshold, which
+ * is not enough to build the distribution.
+ *
+ * As for batteries, each avg10 value, and the stall time since the previous
+ * sample, are kept in a ring store in the cache until the event is recorded,
+ * so restarting the daemon or rebooting doesn't lose the day's samples so
+ * far. Only the stall time between the last sample before the restart and
+ * the first one after it is lost, since the totals restart from zero on
+ * boot.
+ */
+
+#define PSI_EVENT "287819f6-8be0-4281-84a6-a3515a98b996"
+
+#define PSI_SAMPLE_INTERVAL_USECONDS (60 * G_USEC_PER_SEC)
+
+/* 24 hours */
+#define PSI_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+#define PRESSURE_DIR "/proc/pressure"
+
+#define PSI_STORE_FILE_PATH INSTRUMENTATION_CACHE_DIR "/psi-samples"
+/* Three for each resource */
+#define PSI_STORE_N_SERIES 9
+/* A day and a half of samples, in case the event is late */
+#define PSI_STORE_CAPACITY 2160
+
+typedef struct {
+  const gchar *name;
+  int fd;
+  /* The totals as of the last sample, if any */
+  gboolean have_last;
+  guint64 last_some_total;
+  guint64 last_full_total;
+  /* Indices of its series in the store, or -1: avg10 in hundredths of a
+   * percent, and the "some" and "full" stall time since the previous
+   * sample, in microseconds */
+  gint avg10_series;
+  gint some_series;
+  gint full_series;
+} Resource;
+
+static Resource resources[] = {
+  { "cpu", -1, FALSE, 0, 0, -1, -1, -1 },
+  { "memory", -1, FALSE, 0, 0, -1, -1, -1 },
+  { "io", -1, FALSE, 0, 0, -1, -1, -1 },
+};
+
+static EinsRingStore *store;
+static guint sample_source_id;
+
+static gboolean
+parse_line (const gchar *line,
+            const gchar *kind,
+            EinsPsiLine *out)
+{
+  gsize kind_len = strlen (kind);
+  gdouble avg10, avg60, avg300;
+  guint64 total;
+
+  if (strncmp (line, kind, kind_len) != 0 || line[kind_len] != ' ')
+    return FALSE;
+
+  /* The daemon never calls setlocale(), so %lf expects a '.' */
+  if (sscanf (line + kind_len,
+              " avg10=%lf avg60=%lf avg300=%lf total=%" G_GUINT64_FORMAT,
+              &avg10, &avg60, &avg300, &total) != 4)
+    return FALSE;
+
+  out->avg10 = avg10;
+  out->total = total;
+  return TRUE;
+}
+
+/**
+ * eins_psi_parse:
+ * @contents: contents of a file in /proc/pressure
+ * @some: (out): return location for the "some" line
+ * @full: (out): return location for the "full" line, which is all zeroes if
+ *   missing, as it is for CPU pressure on older kernels
+ *
+ * Returns: %TRUE if at least the "some" line could be parsed
+ */
+gboolean
+eins_psi_parse (const gchar *contents,
+                EinsPsiLine *some,
+                EinsPsiLine *full)
+{
+  const gchar *newline;
+
+  g_return_val_if_fail (contents != NULL, FALSE);
+  g_return_val_if_fail (some != NULL, FALSE);
+  g_return_val_if_fail (full != NULL, FALSE);
+
+  memset (full, 0, sizeof (*full));
+
+  if (!parse_line (contents, "some", some))
+    return FALSE;
+
+  newline = strchr (contents, '\n');
+  if (newline != NULL)
+    parse_line (newline + 1, "full", full);
+
+  return TRUE;
+}
+
+/**
+ * eins_psi_summary_add:
+ * @summary: a summary
+ * @avg10: a "some" avg10 value, in percent
+ */
+void
+eins_psi_summary_add (EinsPsiSummary *summary,
+                      gdouble         avg10)
+{
+  avg10 = CLAMP (avg10, 0., 100.);
+
+  summary->avg10_buckets[(guint) (avg10 + 0.5)]++;
+  summary->n_samples++;
+}
+
+/**
+ * eins_psi_summary_percentile:
+ * @summary: a summary
+ * @percentile: between 0 and 100
+ *
+ * Returns: the given percentile of the "some" avg10 values added to @summary,
+ *   rounded to the nearest percent; or 0 if none have been added
+ */
+guint8
+eins_psi_summary_percentile (const EinsPsiSummary *summary,
+                             guint                 percentile)
+{
+  g_return_val_if_fail (percentile <= 100, 0);
+
+  return eins_buckets_percentile (summary->avg10_buckets, EINS_PSI_N_BUCKETS,
+                                  percentile);
+}
+
+static guint64
+total_delta (guint64 start,
+             guint64 end)
+{
+  return end > start ? end - start : 0;
+}
+
+static void
+add_sample (gint    series,
+            gint64  time,
+            guint64 value)
+{
+  if (series >= 0)
+    eins_ring_store_append (store, series, time, value);
+}
+
+static gboolean
+sample_pressure (gpointer user_data G_GNUC_UNUSED)
+{
+  gint64 now = g_get_real_time ();
+
+  for (gsize i = 0; i < G_N_ELEMENTS (resources); i++)
+    {
+      Resource *resource = &resources[i];
+      gchar buffer[256];
+      EinsPsiLine some, full;
+
+      if (resource->fd < 0)
+        continue;
+
+      if (eins_read_fd (resource->fd, buffer, sizeof (buffer)) < 0)
+        {
+          g_debug ("Failed to read %s pressure: %s", resource->name,
+                   g_strerror (errno));
+          continue;
+        }
+
+      if (!eins_psi_parse (buffer, &some, &full))
+        {
+          g_debug ("Failed to parse %s pressure: %s", resource->name, buffer);
+          continue;
+        }
+
+      add_sample (resource->avg10_series, now,
+                  (guint64) (CLAMP (some.avg10, 0., 100.) * 100 + 0.5));
+
+      if (resource->have_last)
+        {
+          add_sample (resource->some_series, now,
+                      total_delta (resource->last_some_total, some.total));
+          add_sample (resource->full_series, now,
+                      total_delta (resource->last_full_total, full.total));
+        }
+
+      resource->last_some_total = some.total;
+      resource->last_full_total = full.total;
+      resource->have_last = TRUE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Fewer samples than this, as there may be on the first day the daemon
+ * runs, are carried over to the next day. Can be changed with min-samples in
+ * the [psi] group of the configuration. */
+#define PSI_MIN_SAMPLES 60
+
+static guint32
+count_pending (gint series)
+{
+  return series >= 0 ? eins_ring_store_get_n_pending (store, series) : 0;
+}
+
+static guint64
+take_sum (gint series)
+{
+  g_autoptr(GArray) samples = NULL;
+  guint64 sum = 0;
+
+  if (series < 0)
+    return 0;
+
+  samples = eins_ring_store_take (store, series);
+  for (guint i = 0; i < samples->len; i++)
+    sum += g_array_index (samples, EinsRingSample, i).value;
+
+  return sum;
+}
+
+static void
+record_pressure (gpointer user_data G_GNUC_UNUSED)
+{
+  GVariantBuilder builder;
+  guint32 n_samples = 0;
+
+  for (gsize i = 0; i < G_N_ELEMENTS (resources); i++)
+    n_samples = MAX (n_samples, count_pending (resources[i].avg10_series));
+
+  if (n_samples < eins_config_get_uint64 ("psi", "min-samples",
+                                          PSI_MIN_SAMPLES))
+    return;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(syyyytt)"));
+
+  for (gsize i = 0; i < G_N_ELEMENTS (resources); i++)
+    {
+      Resource *resource = &resources[i];
+      EinsPsiSummary summary = { 0 };
+      g_autoptr(GArray) samples = NULL;
+      guint64 some_stall_us, full_stall_us;
+
+      if (resource->avg10_series < 0)
+        continue;
+
+      samples = eins_ring_store_take (store, resource->avg10_series);
+      for (guint j = 0; j < samples->len; j++)
+        eins_psi_summary_add (&summary,
+                              g_array_index (samples, EinsRingSample,
+                                             j).value / 100.);
+
+      some_stall_us = take_sum (resource->some_series);
+      full_stall_us = take_sum (resource->full_series);
+
+      if (summary.n_samples == 0)
+        continue;
+
+      g_variant_builder_add (&builder, "(syyyytt)",
+                             resource->name,
+                             eins_psi_summary_percentile (&summary, 50),
+                             eins_psi_summary_percentile (&summary, 90),
+                             eins_psi_summary_percentile (&summary, 99),
+                             eins_psi_summary_percentile (&summary, 100),
+                             some_stall_us, full_stall_us);
+    }
+
+  eins_recorder_record_event (PSI_EVENT,
+                              g_variant_new ("(ua(syyyytt))", n_samples,
+                                             &builder));
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+static gint
+get_series (const gchar *resource,
+            const gchar *suffix)
+{
+  g_autofree gchar *name = g_strconcat (resource, suffix, NULL);
+
+  return eins_ring_store_get_series (store, name);
+}
+
+static void
+open_store (const gchar *store_path)
+{
+  g_autoptr(GError) error = NULL;
+
+  store = eins_ring_store_open (store_path, PSI_STORE_N_SERIES,
+                                PSI_STORE_CAPACITY, &error);
+  if (store == NULL)
+    {
+      g_warning ("Failed to open PSI sample store: %s", error->message);
+      return;
+    }
+
+  for (gsize i = 0; i < G_N_ELEMENTS (resources); i++)
+    {
+      Resource *resource = &resources[i];
+
+      resource->avg10_series = get_series (resource->name, "-avg10");
+      resource->some_series = get_series (resource->name, "-some");
+      resource->full_series = get_series (resource->name, "-full");
+    }
+}
+
+void
+eins_psi_start (void)
+{
+  gboolean any_open = FALSE;
+
+  for (gsize i = 0; i < G_N_ELEMENTS (resources); i++)
+    {
+      g_autofree gchar *path = g_build_filename (PRESSURE_DIR,
+                                                 resources[i].name, NULL);
+
+      resources[i].fd = g_open (path, O_RDONLY | O_CLOEXEC, 0);
+      if (resources[i].fd < 0)
+        g_debug ("Failed to open %s: %s", path, g_strerror (errno));
+      else
+        any_open = TRUE;
+    }
+
+  /* The kernel was built without PSI, or booted with psi=0. */
+  if (!any_open)
+    return;
+
+  open_store (PSI_STORE_FILE_PATH);
+
+  sample_pressure (NULL);
+  sample_source_id = eins_boottimeout_add_useconds (PSI_SAMPLE_INTERVAL_USECONDS,
+                                                    sample_pressure, NULL);
+  eins_schedule_add ("psi", PSI_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_pressure, NULL);
+}
+
+/* Samples already in the store are recorded once it is started again. */
+void
+eins_psi_stop (void)
+{
+  eins_schedule_remove ("psi");
+  g_clear_handle_id (&sample_source_id, g_source_remove);
+  g_clear_pointer (&store, eins_ring_store_free);
+
+  for (gsize i = 0; i < G_N_ELEMENTS (resources); i++)
+    {
+      Resource *resource = &resources[i];
+
+      if (resource->fd >= 0)
+        g_close (resource->fd, NULL);
+
+      resource->fd = -1;
+      resource->have_last = FALSE;
+      resource->avg10_series = -1;
+      resource->some_series = -1;
+      resource->full_series = -1;
+    }
+}
@@ -0,0 +1,49 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_psi_start (void);
+void eins_psi_stop (void);
+
+/* For tests */
+typedef struct {
+  /* Share of the last 10 seconds spent stalled, as a percentage */
+  gdouble avg10;
+  /* Total time spent stalled since boot, in microseconds */
+  guint64 total;
+} EinsPsiLine;
+
+gboolean eins_psi_parse (const gchar *contents,
+                         EinsPsiLine *some,
+                         EinsPsiLine *full);
+
+/* One bucket per whole percentage point, from 0 to 100 */
+#define EINS_PSI_N_BUCKETS 101
+
+typedef struct {
+  guint32 n_samples;
+  guint32 avg10_buckets[EINS_PSI_N_BUCKETS];
+} EinsPsiSummary;
+
+void eins_psi_summary_add (EinsPsiSummary *summary,
+                           gdouble         avg10);
+guint8 eins_psi_summary_percentile (const EinsPsiSummary *summary,
+                                    guint                 percentile);
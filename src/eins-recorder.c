@@ -0,0 +1,385 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <eosmetrics/eosmetrics.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+/*
+ * Everything in this package records metrics through these functions rather
+ * than calling eosmetrics directly, so that tests and benchmarks can run
+ * without an event recorder on the system bus by capturing events to a file
+ * instead. The backend is chosen on first use.
+ */
+
+typedef enum {
+  BACKEND_UNSET,
+  BACKEND_EOSMETRICS,
+  BACKEND_FILE,
+} Backend;
+
+static Backend backend = BACKEND_UNSET;
+static int record_fd = -1;
+static gchar *record_path;
+static guint32 last_timer_serial;
+
+struct _EinsAggregateTimer {
+  /* NULL unless using the eosmetrics backend */
+  EmtrAggregateTimer *timer;
+  guint32 user_id;
+  guint32 serial;
+  gchar *event_id;
+  GVariant *payload;
+};
+
+static void
+ensure_backend (void)
+{
+  const gchar *path;
+  g_autoptr(GError) error = NULL;
+
+  if (backend != BACKEND_UNSET)
+    return;
+
+  path = g_getenv (EINS_RECORDER_FILE_ENV);
+  if (path != NULL && *path != '\0')
+    {
+      if (eins_recorder_use_file (path, &error))
+        return;
+
+      g_warning ("Failed to open %s; using the event recorder instead: %s",
+                 path, error->message);
+    }
+
+  backend = BACKEND_EOSMETRICS;
+}
+
+/**
+ * eins_recorder_use_file:
+ * @path: path of the file to append records to
+ * @error: return location for a #GError, or %NULL
+ *
+ * Appends all subsequent events to @path, in the format described by
+ * %EINS_RECORD_TYPE_STRING, instead of sending them to the event recorder.
+ * This is done implicitly if %EINS_RECORDER_FILE_ENV is set.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+eins_recorder_use_file (const gchar  *path,
+                        GError      **error)
+{
+  int fd;
+
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  fd = g_open (path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to open %s: %s", path, g_strerror (saved_errno));
+      return FALSE;
+    }
+
+  if (record_fd >= 0)
+    g_close (record_fd, NULL);
+
+  record_fd = fd;
+  g_free (record_path);
+  record_path = g_strdup (path);
+  backend = BACKEND_FILE;
+
+  return TRUE;
+}
+
+static void
+append_record (gchar        kind,
+               guint32      user_id,
+               guint32      serial,
+               const gchar *event_id,
+               GVariant    *payload)
+{
+  g_autoptr(GVariant) record = NULL;
+  g_autoptr(GVariant) normal = NULL;
+  g_autoptr(GByteArray) buffer = NULL;
+  guint32 size_le;
+  gsize size;
+  off_t end;
+  gssize n;
+
+  record = g_variant_ref_sink (g_variant_new (EINS_RECORD_TYPE_STRING,
+                                              kind, g_get_real_time (),
+                                              user_id, serial, event_id,
+                                              payload));
+  normal = g_variant_get_normal_form (record);
+  size = g_variant_get_size (normal);
+  g_return_if_fail (size <= G_MAXUINT32);
+
+  size_le = GUINT32_TO_LE ((guint32) size);
+  buffer = g_byte_array_sized_new (sizeof (size_le) + size);
+  g_byte_array_append (buffer, (const guint8 *) &size_le, sizeof (size_le));
+  g_byte_array_append (buffer, g_variant_get_data (normal), size);
+
+  end = lseek (record_fd, 0, SEEK_END);
+  if (end < 0)
+    {
+      g_warning ("Failed to seek in %s: %s", record_path, g_strerror (errno));
+      return;
+    }
+
+  /* Each record is appended with a single write() to the O_APPEND file, so
+   * that it is never interleaved with another process's. It is not retried
+   * after a short write: the rest would land after anything appended
+   * meanwhile. */
+  do
+    n = write (record_fd, buffer->data, buffer->len);
+  while (n < 0 && errno == EINTR);
+
+  if (n == (gssize) buffer->len)
+    return;
+
+  if (n < 0)
+    g_warning ("Failed to write to %s: %s", record_path, g_strerror (errno));
+  else
+    g_warning ("Short write to %s: %" G_GSSIZE_FORMAT " of %u bytes",
+               record_path, n, buffer->len);
+
+  /* A truncated record would make every record after it unreadable, since
+   * each is found from the length of the one before. */
+  if (n > 0 && ftruncate (record_fd, end) < 0)
+    g_warning ("Failed to truncate %s: %s", record_path, g_strerror (errno));
+}
+
+/**
+ * eins_recorder_record_event:
+ * @event_id: the event's UUID
+ * @payload: (nullable): the event's auxiliary payload; floating references
+ *   are consumed
+ *
+ * Records a singular event, without waiting for it to be delivered.
+ */
+void
+eins_recorder_record_event (const gchar *event_id,
+                            GVariant    *payload)
+{
+  g_return_if_fail (event_id != NULL);
+
+  ensure_backend ();
+
+  if (backend == BACKEND_FILE)
+    append_record (EINS_RECORD_KIND_EVENT, 0, 0, event_id, payload);
+  else
+    emtr_event_recorder_record_event (emtr_event_recorder_get_default (),
+                                      event_id, payload);
+}
+
+/**
+ * eins_recorder_record_event_sync:
+ * @event_id: the event's UUID
+ * @payload: (nullable): the event's auxiliary payload; floating references
+ *   are consumed
+ *
+ * Like eins_recorder_record_event(), but waits until the event has been
+ * delivered. Use this in short-lived processes.
+ */
+void
+eins_recorder_record_event_sync (const gchar *event_id,
+                                 GVariant    *payload)
+{
+  g_return_if_fail (event_id != NULL);
+
+  ensure_backend ();
+
+  if (backend == BACKEND_FILE)
+    append_record (EINS_RECORD_KIND_EVENT, 0, 0, event_id, payload);
+  else
+    emtr_event_recorder_record_event_sync (emtr_event_recorder_get_default (),
+                                           event_id, payload);
+}
+
+/**
+ * eins_recorder_flush_sync:
+ *
+ * Waits until everything recorded so far has been handed over. With the
+ * eosmetrics backend, this means every pending message on the system bus
+ * connection has been written. This should be called before exiting.
+ */
+void
+eins_recorder_flush_sync (void)
+{
+  g_autoptr(GDBusConnection) connection = NULL;
+  g_autoptr(GError) error = NULL;
+
+  ensure_backend ();
+
+  if (backend == BACKEND_FILE)
+    return;
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+  if (connection == NULL ||
+      !g_dbus_connection_flush_sync (connection, NULL, &error))
+    g_warning ("Failed to flush events to the event recorder: %s",
+               error->message);
+}
+
+/**
+ * eins_recorder_start_aggregate_timer:
+ * @user_id: the user the time is attributed to
+ * @event_id: the aggregate event's UUID
+ * @payload: (nullable): the event's auxiliary payload; floating references
+ *   are consumed
+ *
+ * Starts timing an aggregate event. The recorder adds the time until
+ * eins_aggregate_timer_stop() is called to the event's daily total.
+ *
+ * Returns: (transfer full) (nullable): a new timer, or %NULL if it could not
+ *   be started
+ */
+EinsAggregateTimer *
+eins_recorder_start_aggregate_timer (guint32      user_id,
+                                     const gchar *event_id,
+                                     GVariant    *payload)
+{
+  EinsAggregateTimer *timer;
+
+  g_return_val_if_fail (event_id != NULL, NULL);
+
+  ensure_backend ();
+
+  timer = g_new0 (EinsAggregateTimer, 1);
+  timer->user_id = user_id;
+  timer->serial = ++last_timer_serial;
+  timer->event_id = g_strdup (event_id);
+  timer->payload = payload != NULL ? g_variant_ref_sink (payload) : NULL;
+
+  if (backend == BACKEND_FILE)
+    {
+      append_record (EINS_RECORD_KIND_TIMER_START, timer->user_id,
+                     timer->serial, timer->event_id, timer->payload);
+      return timer;
+    }
+
+  timer->timer =
+    emtr_event_recorder_start_aggregate_timer_with_uid (emtr_event_recorder_get_default (),
+                                                        user_id,
+                                                        event_id,
+                                                        timer->payload);
+  if (timer->timer == NULL)
+    {
+      eins_aggregate_timer_stop (timer);
+      return NULL;
+    }
+
+  return timer;
+}
+
+/**
+ * eins_aggregate_timer_stop:
+ * @timer: (transfer full): a timer returned by
+ *   eins_recorder_start_aggregate_timer()
+ *
+ * Stops @timer and frees it.
+ */
+void
+eins_aggregate_timer_stop (EinsAggregateTimer *timer)
+{
+  g_return_if_fail (timer != NULL);
+
+  if (backend == BACKEND_FILE)
+    append_record (EINS_RECORD_KIND_TIMER_STOP, timer->user_id,
+                   timer->serial, timer->event_id, timer->payload);
+
+  /* The timer will stop itself when its reference count falls to 0. */
+  g_clear_object (&timer->timer);
+  g_clear_pointer (&timer->payload, g_variant_unref);
+  g_free (timer->event_id);
+  g_free (timer);
+}
+
+/**
+ * eins_recorder_load_file:
+ * @path: path of a file written by the file backend
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads back the records in @path. A truncated final record, as left by a
+ * process killed while writing it, is ignored.
+ *
+ * Returns: (transfer full) (element-type GVariant): the records, each of type
+ *   %EINS_RECORD_TYPE_STRING, or %NULL with @error set
+ */
+GPtrArray *
+eins_recorder_load_file (const gchar  *path,
+                         GError      **error)
+{
+  g_autoptr(GPtrArray) records = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  gchar *contents = NULL;
+  gsize length, offset = 0;
+
+  g_return_val_if_fail (path != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!g_file_get_contents (path, &contents, &length, error))
+    return NULL;
+
+  bytes = g_bytes_new_take (contents, length);
+  records = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+
+  while (length - offset >= sizeof (guint32))
+    {
+      g_autoptr(GBytes) record_bytes = NULL;
+      g_autoptr(GVariant) record = NULL;
+      guint32 size_le, size;
+
+      memcpy (&size_le, contents + offset, sizeof (size_le));
+      size = GUINT32_FROM_LE (size_le);
+      offset += sizeof (size_le);
+
+      if (size > length - offset)
+        {
+          g_debug ("Ignoring truncated record at end of %s", path);
+          break;
+        }
+
+      record_bytes = g_bytes_new_from_bytes (bytes, offset, size);
+      record = g_variant_new_from_bytes (G_VARIANT_TYPE (EINS_RECORD_TYPE_STRING),
+                                         record_bytes, FALSE);
+      offset += size;
+
+      if (!g_variant_is_normal_form (record))
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                       "Malformed record in %s", path);
+          return NULL;
+        }
+
+      g_ptr_array_add (records, g_variant_ref_sink (g_steal_pointer (&record)));
+    }
+
+  return g_steal_pointer (&records);
+}
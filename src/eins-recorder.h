@@ -0,0 +1,65 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/*
+ * If this environment variable is set, events are appended to the file it
+ * names rather than being sent to the eos-metrics event recorder.
+ */
+#define EINS_RECORDER_FILE_ENV "EINS_RECORDER_FILE"
+
+/*
+ * Each record in such a file is a little-endian uint32 length followed by a
+ * serialized GVariant of this type, in normal form:
+ *
+ * Field | Type   | Description
+ * ------+--------+--------------------------------------------------------
+ *     0 | byte   | Kind of record: one of the EINS_RECORD_KIND_* values
+ *     1 | int64  | Wall-clock time the record was written, in microseconds
+ *     2 | uint32 | User ID, for aggregate timers; 0 otherwise
+ *     3 | uint32 | Serial number, for aggregate timers; 0 otherwise
+ *     4 | string | Event ID
+ *     5 | mv     | Auxiliary payload, if any
+ */
+#define EINS_RECORD_TYPE_STRING "(yxuusmv)"
+
+#define EINS_RECORD_KIND_EVENT 'e'
+#define EINS_RECORD_KIND_TIMER_START 'b'
+#define EINS_RECORD_KIND_TIMER_STOP 'f'
+
+typedef struct _EinsAggregateTimer EinsAggregateTimer;
+
+gboolean eins_recorder_use_file (const gchar  *path,
+                                 GError      **error);
+
+void eins_recorder_record_event (const gchar *event_id,
+                                 GVariant    *payload);
+void eins_recorder_record_event_sync (const gchar *event_id,
+                                      GVariant    *payload);
+void eins_recorder_flush_sync (void);
+
+EinsAggregateTimer *eins_recorder_start_aggregate_timer (guint32      user_id,
+                                                         const gchar *event_id,
+                                                         GVariant    *payload);
+void eins_aggregate_timer_stop (EinsAggregateTimer *timer);
+
+GPtrArray *eins_recorder_load_file (const gchar  *path,
+                                    GError      **error);
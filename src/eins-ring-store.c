@@ -0,0 +1,463 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-ring-store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/*
+ * A ring store keeps the recent samples of a few named series, for
+ * collectors which sample more often than they record an event. The file
+ * holds a header, then one fixed-size header per series, then one ring of
+ * samples per series. Its size only depends on the number of series and the
+ * capacity of each ring, so it never grows however long the system is up:
+ * once a ring is full, each sample overwrites the oldest one.
+ *
+ * As for the session checkpoint, the file is mapped shared, so appending a
+ * sample is a couple of stores into the page cache and survives the daemon
+ * being killed or restarted. Samples are written before the head which
+ * publishes them is advanced, with a single aligned store, so a series
+ * header is never seen half-updated. The file is allocated in full when it
+ * is opened, so that storing into the mapping can't fail with SIGBUS once
+ * the disk is full.
+ *
+ * Nothing is synced to disk: if the system loses power, the head may have
+ * reached the disk while a slot it covers didn't. Each slot therefore holds
+ * the sequence number of its sample, which is the head once it has been
+ * appended, and a slot whose number doesn't match, whether zeroed or left
+ * over from a previous lap of the ring, is skipped. Slots are aligned to
+ * their size, so that none straddles two pages.
+ *
+ * A series header with an empty name is free.
+ */
+
+#define RING_STORE_MAGIC "EINSRING"
+#define RING_STORE_VERSION 2
+#define RING_STORE_MAX_SERIES 256
+#define RING_STORE_MAX_CAPACITY (1 << 20)
+
+typedef struct {
+  gchar magic[8];
+  guint32 version;
+  guint32 n_series;
+  guint32 capacity;
+  guint32 reserved;
+} RingStoreHeader;
+
+typedef struct {
+  gchar name[EINS_RING_STORE_MAX_NAME_LENGTH + 1];
+  /* Number of samples ever appended; the next one goes in slot
+   * head % capacity. */
+  guint64 head;
+  /* Number of samples ever taken. */
+  guint64 tail;
+} SeriesHeader;
+
+typedef struct {
+  /* 1 for the first sample of a series, and so on; 0 if never written */
+  guint64 sequence;
+  EinsRingSample sample;
+  guint64 reserved;
+} RingSlot;
+
+G_STATIC_ASSERT (sizeof (RingStoreHeader) == 24);
+G_STATIC_ASSERT (sizeof (SeriesHeader) == 48);
+G_STATIC_ASSERT (sizeof (EinsRingSample) == 16);
+G_STATIC_ASSERT (sizeof (RingSlot) == 32);
+
+struct _EinsRingStore {
+  gchar *path;
+  int fd;
+  void *map;
+  gsize size;
+  guint n_series;
+  guint capacity;
+  RingStoreHeader *header;
+  SeriesHeader *series;
+  RingSlot *slots;
+};
+
+static gsize
+get_slots_offset (guint n_series)
+{
+  gsize headers_size = sizeof (RingStoreHeader) +
+                       n_series * sizeof (SeriesHeader);
+
+  return (headers_size + sizeof (RingSlot) - 1) / sizeof (RingSlot) *
+         sizeof (RingSlot);
+}
+
+static gsize
+get_file_size (guint n_series,
+               guint capacity)
+{
+  return get_slots_offset (n_series) +
+         (gsize) n_series * capacity * sizeof (RingSlot);
+}
+
+static gboolean
+header_is_valid (const RingStoreHeader *header,
+                 guint                  n_series,
+                 guint                  capacity)
+{
+  return memcmp (header->magic, RING_STORE_MAGIC, sizeof (header->magic)) == 0
+    && header->version == RING_STORE_VERSION
+    && header->n_series == n_series
+    && header->capacity == capacity;
+}
+
+static gboolean
+series_is_valid (const SeriesHeader *series)
+{
+  return series->name[EINS_RING_STORE_MAX_NAME_LENGTH] == '\0'
+    && series->tail <= series->head;
+}
+
+static void
+reset_file (EinsRingStore *self)
+{
+  memset (self->map, 0, self->size);
+  memcpy (self->header->magic, RING_STORE_MAGIC, sizeof (self->header->magic));
+  self->header->version = RING_STORE_VERSION;
+  self->header->n_series = self->n_series;
+  self->header->capacity = self->capacity;
+}
+
+/**
+ * eins_ring_store_open:
+ * @path: path of the store, which is created if needed
+ * @n_series: the number of series it can hold
+ * @capacity: the number of samples kept per series
+ * @error: return location for a #GError, or %NULL
+ *
+ * Maps the ring store at @path. If it is not a valid store with the given
+ * geometry, it is emptied; a series whose header is corrupt is freed.
+ *
+ * Returns: (transfer full): a new #EinsRingStore, or %NULL with @error set
+ */
+EinsRingStore *
+eins_ring_store_open (const gchar  *path,
+                      guint         n_series,
+                      guint         capacity,
+                      GError      **error)
+{
+  g_autoptr(EinsRingStore) self = NULL;
+  struct stat st;
+  void *map;
+  int r;
+
+  g_return_val_if_fail (path != NULL, NULL);
+  g_return_val_if_fail (n_series > 0 && n_series <= RING_STORE_MAX_SERIES, NULL);
+  g_return_val_if_fail (capacity > 0 && capacity <= RING_STORE_MAX_CAPACITY, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  self = g_new0 (EinsRingStore, 1);
+  self->path = g_strdup (path);
+  self->n_series = n_series;
+  self->capacity = capacity;
+  self->size = get_file_size (n_series, capacity);
+  self->fd = g_open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (self->fd < 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to open %s: %s", path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  if (fstat (self->fd, &st) < 0
+      || ((gsize) st.st_size != self->size
+          && ftruncate (self->fd, self->size) < 0))
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to size %s: %s", path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  /* Also allocates the holes of a file which was sized but never written */
+  r = posix_fallocate (self->fd, 0, self->size);
+  if (r != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (r),
+                   "Failed to allocate %s: %s", path, g_strerror (r));
+      return NULL;
+    }
+
+  map = mmap (NULL, self->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+              self->fd, 0);
+  if (map == MAP_FAILED)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to map %s: %s", path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  self->map = map;
+  self->header = map;
+  self->series = (SeriesHeader *) (self->header + 1);
+  self->slots = (RingSlot *) ((guint8 *) map + get_slots_offset (n_series));
+
+  if (!header_is_valid (self->header, n_series, capacity))
+    {
+      g_debug ("Initializing ring store %s", path);
+      reset_file (self);
+    }
+
+  for (guint i = 0; i < n_series; i++)
+    {
+      SeriesHeader *series = &self->series[i];
+
+      if (!series_is_valid (series))
+        {
+          g_debug ("Discarding corrupt series %u of %s", i, path);
+          memset (series, 0, sizeof (SeriesHeader));
+        }
+    }
+
+  return g_steal_pointer (&self);
+}
+
+/**
+ * eins_ring_store_free:
+ * @self: an #EinsRingStore
+ *
+ * Unmaps and closes the store. Its contents are left on disk.
+ */
+void
+eins_ring_store_free (EinsRingStore *self)
+{
+  g_return_if_fail (self != NULL);
+
+  if (self->map != NULL)
+    munmap (self->map, self->size);
+
+  if (self->fd >= 0)
+    {
+      g_autoptr(GError) local_error = NULL;
+
+      if (!g_close (self->fd, &local_error))
+        g_warning ("Failed to close %s: %s", self->path, local_error->message);
+    }
+
+  g_free (self->path);
+  g_free (self);
+}
+
+static gint
+find_series (EinsRingStore *self,
+             const gchar   *name)
+{
+  for (guint i = 0; i < self->n_series; i++)
+    {
+      if (strcmp (self->series[i].name, name) == 0)
+        return i;
+    }
+
+  return -1;
+}
+
+/**
+ * eins_ring_store_get_series:
+ * @self: an #EinsRingStore
+ * @name: a non-empty name of at most %EINS_RING_STORE_MAX_NAME_LENGTH bytes
+ *
+ * Looks up the series called @name, claiming a free one if needed. Its
+ * samples carry over from when the store was last open.
+ *
+ * Returns: the index of the series; or -1 if all are in use
+ */
+gint
+eins_ring_store_get_series (EinsRingStore *self,
+                            const gchar   *name)
+{
+  SeriesHeader *series;
+  gint index;
+
+  g_return_val_if_fail (self != NULL, -1);
+  g_return_val_if_fail (name != NULL && *name != '\0', -1);
+  g_return_val_if_fail (strlen (name) <= EINS_RING_STORE_MAX_NAME_LENGTH, -1);
+
+  index = find_series (self, name);
+  if (index >= 0)
+    return index;
+
+  index = find_series (self, "");
+  if (index < 0)
+    return -1;
+
+  /* Free series are all zeros, so the name is always terminated. */
+  series = &self->series[index];
+  strcpy (series->name, name);
+
+  return index;
+}
+
+/**
+ * eins_ring_store_append:
+ * @self: an #EinsRingStore
+ * @series: the index of a series
+ * @time: wall-clock time of the sample, in microseconds
+ * @value: the sample
+ *
+ * Adds a sample to @series, overwriting its oldest one if it is full.
+ */
+void
+eins_ring_store_append (EinsRingStore *self,
+                        gint           series,
+                        gint64         time,
+                        guint64        value)
+{
+  SeriesHeader *header;
+  RingSlot *slot;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (series >= 0 && (guint) series < self->n_series);
+
+  header = &self->series[series];
+  slot = &self->slots[(gsize) series * self->capacity +
+                      header->head % self->capacity];
+  slot->sample.time = time;
+  slot->sample.value = value;
+  slot->sequence = header->head + 1;
+
+  /* Publish the sample only once it is complete. */
+  __atomic_store_n (&header->head, header->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * eins_ring_store_get_n_pending:
+ * @self: an #EinsRingStore
+ * @series: the index of a series
+ *
+ * Counts the samples appended to @series since they were last taken, up to
+ * its capacity, without taking them. eins_ring_store_take() may return fewer
+ * if some were lost with the power.
+ *
+ * Returns: the number of samples pending
+ */
+guint
+eins_ring_store_get_n_pending (EinsRingStore *self,
+                               gint           series)
+{
+  SeriesHeader *header;
+
+  g_return_val_if_fail (self != NULL, 0);
+  g_return_val_if_fail (series >= 0 && (guint) series < self->n_series, 0);
+
+  header = &self->series[series];
+
+  return MIN (header->head - header->tail, self->capacity);
+}
+
+/**
+ * eins_ring_store_take:
+ * @self: an #EinsRingStore
+ * @series: the index of a series
+ *
+ * Returns the samples appended to @series since the last call, up to its
+ * capacity, and marks them as taken. Callers recording an event from them
+ * should do so straight away.
+ *
+ * Returns: (transfer full) (element-type EinsRingSample): the samples,
+ *   oldest first
+ */
+GArray *
+eins_ring_store_take (EinsRingStore *self,
+                      gint           series)
+{
+  SeriesHeader *header;
+  const RingSlot *ring;
+  GArray *samples;
+  guint64 start;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (series >= 0 && (guint) series < self->n_series, NULL);
+
+  header = &self->series[series];
+  ring = &self->slots[(gsize) series * self->capacity];
+
+  /* Samples older than the capacity have been overwritten. */
+  start = header->tail;
+  if (header->head - start > self->capacity)
+    start = header->head - self->capacity;
+
+  samples = g_array_sized_new (FALSE, FALSE, sizeof (EinsRingSample),
+                               header->head - start);
+
+  for (guint64 i = start; i < header->head; i++)
+    {
+      const RingSlot *slot = &ring[i % self->capacity];
+
+      /* Lost with the power, so holding an older sample, or none */
+      if (slot->sequence == i + 1)
+        g_array_append_vals (samples, &slot->sample, 1);
+    }
+
+  header->tail = header->head;
+
+  return samples;
+}
+
+/**
+ * eins_ring_store_prune:
+ * @self: an #EinsRingStore
+ * @live_names: hash table whose keys are the names of the series still in
+ *   use
+ *
+ * Frees the series which are not in @live_names, such as those of a device
+ * which was removed, along with any samples not yet taken.
+ *
+ * Returns: the number of series which were freed
+ */
+guint
+eins_ring_store_prune (EinsRingStore *self,
+                       GHashTable    *live_names)
+{
+  guint n_pruned = 0;
+
+  g_return_val_if_fail (self != NULL, 0);
+  g_return_val_if_fail (live_names != NULL, 0);
+
+  for (guint i = 0; i < self->n_series; i++)
+    {
+      SeriesHeader *series = &self->series[i];
+
+      if (series->name[0] == '\0' ||
+          g_hash_table_contains (live_names, series->name))
+        continue;
+
+      g_debug ("Discarding series %s of %s", series->name, self->path);
+      memset (series, 0, sizeof (SeriesHeader));
+      n_pruned++;
+    }
+
+  return n_pruned;
+}
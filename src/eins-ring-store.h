@@ -0,0 +1,53 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+typedef struct _EinsRingStore EinsRingStore;
+
+typedef struct {
+  /* Wall-clock time, in microseconds */
+  gint64 time;
+  guint64 value;
+} EinsRingSample;
+
+/* Longest series name, not counting the terminating nul */
+#define EINS_RING_STORE_MAX_NAME_LENGTH 31
+
+EinsRingStore *eins_ring_store_open (const gchar  *path,
+                                     guint         n_series,
+                                     guint         capacity,
+                                     GError      **error);
+void eins_ring_store_free (EinsRingStore *self);
+
+gint eins_ring_store_get_series (EinsRingStore *self,
+                                 const gchar   *name);
+void eins_ring_store_append (EinsRingStore *self,
+                             gint           series,
+                             gint64         time,
+                             guint64        value);
+guint eins_ring_store_get_n_pending (EinsRingStore *self,
+                                     gint           series);
+GArray *eins_ring_store_take (EinsRingStore *self,
+                              gint           series);
+guint eins_ring_store_prune (EinsRingStore *self,
+                             GHashTable    *live_names);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (EinsRingStore, eins_ring_store_free)
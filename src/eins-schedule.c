@@ -0,0 +1,338 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-schedule.h"
+#include "eins-boottime-source.h"
+#include "eins-clock.h"
+#include "eins-config.h"
+
+/*
+ * Runs tasks at long intervals, such as once a day. Intervals are measured on
+ * CLOCK_BOOTTIME, so that time spent suspended counts towards them. For
+ * persistent tasks, the wall-clock time at which each is next due is stored
+ * in RECORD_TIME_FILE_PATH, in a group named after the task.
+ *
+ * The group of the same name in the configuration can disable a task, change
+ * its interval, and add a random delay of up to "jitter" seconds to each run
+ * so that machines which booted together don't all report at once. See
+ * eins-config.c.
+ *
+ * Both clocks come from eins-clock.c, so tests can run days of scheduling on
+ * virtual ones.
+ */
+
+/* The path of a file to hold next record time. */
+#define RECORD_TIME_FILE_PATH INSTRUMENTATION_CACHE_DIR "/record_time"
+
+typedef struct {
+  gchar *name;
+  guint64 default_interval_us;
+  EinsScheduleFlags flags;
+  EinsScheduleFunc func;
+  gpointer user_data;
+
+  /* From the configuration */
+  gboolean enabled;
+  guint64 interval_us;
+  guint64 jitter_us;
+
+  /* Wall-clock time at which the task is next due, ignoring jitter */
+  gint64 due_time;
+  /* 0 while the task is disabled */
+  guint source_id;
+} Task;
+
+static GPtrArray *tasks;
+/* Overrides RECORD_TIME_FILE_PATH, for tests */
+static gchar *record_time_path;
+
+static const gchar *
+get_record_time_path (void)
+{
+  return record_time_path != NULL ? record_time_path : RECORD_TIME_FILE_PATH;
+}
+
+static gint64
+get_next_record_time (const gchar *name)
+{
+  g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+  if (g_key_file_load_from_file (kf,
+                                 get_record_time_path (),
+                                 G_KEY_FILE_NONE,
+                                 NULL))
+    return g_key_file_get_int64 (kf, name, "next-record-time", NULL);
+
+  return 0;
+}
+
+static void
+set_next_record_time (const gchar *name,
+                      gint64       next)
+{
+  g_autoptr(GKeyFile) kf = g_key_file_new ();
+  g_autoptr(GError) error = NULL;
+
+  /* Keep other tasks' times. */
+  g_key_file_load_from_file (kf, get_record_time_path (),
+                             G_KEY_FILE_KEEP_COMMENTS, NULL);
+  g_key_file_set_int64 (kf, name, "next-record-time", next);
+
+  if (!g_key_file_save_to_file (kf, get_record_time_path (), &error))
+    g_warning ("Failed to write %s: %s", get_record_time_path (),
+               error->message);
+}
+
+static void
+task_read_config (Task *task)
+{
+  guint64 interval_s;
+
+  task->enabled = eins_config_get_boolean (task->name, "enabled", TRUE);
+
+  interval_s = eins_config_get_uint64 (task->name, "interval", 0);
+  if (interval_s > 0 && interval_s <= G_MAXUINT64 / G_USEC_PER_SEC)
+    task->interval_us = interval_s * G_USEC_PER_SEC;
+  else
+    task->interval_us = task->default_interval_us;
+
+  task->jitter_us = MIN (eins_config_get_uint64 (task->name, "jitter", 0),
+                         G_MAXUINT64 / G_USEC_PER_SEC) * G_USEC_PER_SEC;
+}
+
+static void
+task_free (Task *task)
+{
+  g_clear_handle_id (&task->source_id, g_source_remove);
+  g_free (task->name);
+  g_free (task);
+}
+
+static gboolean task_dispatch (gpointer data);
+
+/* Runs the task after @wait_us, plus jitter, replacing any pending run. */
+static void
+task_start_timer (Task    *task,
+                  guint64  wait_us)
+{
+  if (task->source_id != 0)
+    g_source_remove (task->source_id);
+
+  if (task->jitter_us > 0)
+    wait_us += (guint64) (g_random_double () * task->jitter_us);
+
+  if (wait_us == 0)
+    task->source_id = g_idle_add (task_dispatch, task);
+  else
+    task->source_id = eins_boottimeout_add_useconds (wait_us, task_dispatch,
+                                                     task);
+}
+
+static gboolean
+task_dispatch (gpointer data)
+{
+  Task *task = data;
+
+  /* This source is removed when it returns */
+  task->source_id = 0;
+
+  task->func (task->user_data);
+
+  task->due_time = eins_clock_get_real_time () + task->interval_us;
+  if (task->flags & EINS_SCHEDULE_FLAGS_PERSISTENT)
+    set_next_record_time (task->name, task->due_time);
+
+  /* The first wait is usually shorter than the interval, so always start a
+   * new source rather than reusing this one. */
+  task_start_timer (task, task->interval_us);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * eins_schedule_add:
+ * @name: a name for the task, unique within the daemon
+ * @interval_us: how often to run the task, in microseconds, unless the
+ *   configuration says otherwise
+ * @flags: flags
+ * @func: function to call
+ * @user_data: data to pass to @func
+ *
+ * Runs @func every @interval_us for the rest of the daemon's lifetime, while
+ * the task is enabled in the configuration.
+ */
+void
+eins_schedule_add (const gchar       *name,
+                   guint64            interval_us,
+                   EinsScheduleFlags  flags,
+                   EinsScheduleFunc   func,
+                   gpointer           user_data)
+{
+  Task *task;
+  guint64 wait;
+  gint64 now = eins_clock_get_real_time ();
+
+  g_return_if_fail (name != NULL);
+  g_return_if_fail (interval_us > 0);
+  g_return_if_fail (func != NULL);
+
+  task = g_new0 (Task, 1);
+  task->name = g_strdup (name);
+  task->default_interval_us = interval_us;
+  task->flags = flags;
+  task->func = func;
+  task->user_data = user_data;
+  task_read_config (task);
+
+  if (tasks == NULL)
+    tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) task_free);
+  g_ptr_array_add (tasks, task);
+
+  interval_us = task->interval_us;
+  wait = interval_us;
+
+  if (flags & EINS_SCHEDULE_FLAGS_RUN_IMMEDIATELY)
+    wait = 0;
+
+  if (flags & EINS_SCHEDULE_FLAGS_PERSISTENT)
+    {
+      gint64 next = get_next_record_time (name);
+
+      /* If the clock has gone backwards, don't wait more than one interval. */
+      if (next > now)
+        wait = MIN ((guint64) (next - now), interval_us);
+      else if (next != 0)
+        wait = 0;
+      else if (wait > 0)
+        /* First run ever: remember when it is due, so that restarting the
+         * daemon doesn't postpone it. */
+        set_next_record_time (name, now + wait);
+    }
+
+  task->due_time = now + wait;
+
+  if (task->enabled)
+    task_start_timer (task, wait);
+}
+
+/**
+ * eins_schedule_remove:
+ * @name: the name of a task added with eins_schedule_add()
+ *
+ * Stops and forgets the task. If it is persistent, the time at which it is
+ * next due is kept, so adding it again carries on from there.
+ */
+void
+eins_schedule_remove (const gchar *name)
+{
+  g_return_if_fail (name != NULL);
+
+  if (tasks == NULL)
+    return;
+
+  for (guint i = 0; i < tasks->len; i++)
+    {
+      Task *task = g_ptr_array_index (tasks, i);
+
+      if (g_str_equal (task->name, name))
+        {
+          g_ptr_array_remove_index (tasks, i);
+          return;
+        }
+    }
+}
+
+/**
+ * eins_schedule_reload:
+ *
+ * Applies the current configuration to every task. A task whose interval
+ * changed is next due one new interval after it last ran, or at once if that
+ * has passed; one which was disabled and is enabled again carries on as if
+ * it had never been disabled.
+ */
+void
+eins_schedule_reload (void)
+{
+  gint64 now = eins_clock_get_real_time ();
+
+  if (tasks == NULL)
+    return;
+
+  for (guint i = 0; i < tasks->len; i++)
+    {
+      Task *task = g_ptr_array_index (tasks, i);
+      guint64 old_interval_us = task->interval_us;
+      guint64 old_jitter_us = task->jitter_us;
+      gint64 due_time;
+
+      task_read_config (task);
+
+      if (!task->enabled)
+        {
+          if (task->source_id != 0)
+            g_debug ("Disabling scheduled task %s", task->name);
+
+          g_clear_handle_id (&task->source_id, g_source_remove);
+          continue;
+        }
+
+      if (task->source_id != 0 && task->interval_us == old_interval_us &&
+          task->jitter_us == old_jitter_us)
+        continue;
+
+      due_time = task->due_time - (gint64) old_interval_us +
+        (gint64) task->interval_us;
+      task->due_time = due_time;
+
+      if (task->flags & EINS_SCHEDULE_FLAGS_PERSISTENT)
+        set_next_record_time (task->name, due_time);
+
+      g_debug ("Rescheduling task %s every %" G_GUINT64_FORMAT " s",
+               task->name, task->interval_us / G_USEC_PER_SEC);
+
+      /* As at startup, don't wait more than one interval if the clock has
+       * gone backwards. */
+      task_start_timer (task, due_time > now ?
+                              MIN ((guint64) (due_time - now), task->interval_us) :
+                              0);
+    }
+}
+
+/**
+ * eins_schedule_set_record_time_path:
+ * @path: (nullable): where to keep the times at which persistent tasks are
+ *   next due, or %NULL for RECORD_TIME_FILE_PATH
+ */
+void
+eins_schedule_set_record_time_path (const gchar *path)
+{
+  g_free (record_time_path);
+  record_time_path = g_strdup (path);
+}
+
+/**
+ * eins_schedule_remove_all:
+ *
+ * Stops and forgets every task, as if the daemon had exited.
+ */
+void
+eins_schedule_remove_all (void)
+{
+  g_clear_pointer (&tasks, g_ptr_array_unref);
+}
@@ -0,0 +1,52 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+typedef void (*EinsScheduleFunc) (gpointer user_data);
+
+/**
+ * EinsScheduleFlags:
+ * @EINS_SCHEDULE_FLAGS_NONE: the task first runs one interval after it is
+ *   added
+ * @EINS_SCHEDULE_FLAGS_PERSISTENT: the time at which the task is next due is
+ *   kept in the cache, so that the interval carries over when the daemon is
+ *   restarted or the system reboots; if it has already passed, the task runs
+ *   as soon as it is added
+ * @EINS_SCHEDULE_FLAGS_RUN_IMMEDIATELY: the task first runs as soon as it is
+ *   added, unless it is persistent and not yet due
+ */
+typedef enum {
+  EINS_SCHEDULE_FLAGS_NONE = 0,
+  EINS_SCHEDULE_FLAGS_PERSISTENT = 1 << 0,
+  EINS_SCHEDULE_FLAGS_RUN_IMMEDIATELY = 1 << 1,
+} EinsScheduleFlags;
+
+void eins_schedule_add (const gchar       *name,
+                        guint64            interval_us,
+                        EinsScheduleFlags  flags,
+                        EinsScheduleFunc   func,
+                        gpointer           user_data);
+void eins_schedule_remove (const gchar *name);
+void eins_schedule_reload (void);
+
+/* For tests */
+void eins_schedule_set_record_time_path (const gchar *path);
+void eins_schedule_remove_all (void);
@@ -0,0 +1,358 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-session-checkpoint.h"
+#include "eins-boot-id.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/*
+ * The checkpoint file is a single page holding a fixed-size header followed by
+ * a fixed number of slots, one per tracked session. It is mapped shared, so
+ * updating a slot is just a handful of stores into the page cache: the kernel
+ * writes it back on its own schedule, and the contents survive the daemon
+ * being killed at any point.
+ *
+ * A slot with user_id == 0 is free; root is never tracked, because only human
+ * users' sessions are recorded.
+ */
+
+#define CHECKPOINT_MAGIC "EINSSESS"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_N_SLOTS 64
+
+typedef struct {
+  gchar magic[8];
+  guint32 version;
+  guint32 n_slots;
+  gchar boot_id[EINS_BOOT_ID_LENGTH + 1];
+  guint8 padding[3];
+} CheckpointHeader;
+
+typedef struct {
+  guint32 user_id;
+  guint32 reserved;
+  /* Wall-clock time the session started, in microseconds. */
+  gint64 start_time;
+  /* Wall-clock time of the last checkpoint, in microseconds. */
+  gint64 checkpoint_time;
+  /* Session time already handed to the event recorder, in microseconds. */
+  gint64 accumulated;
+} CheckpointSlot;
+
+typedef struct {
+  CheckpointHeader header;
+  CheckpointSlot slots[CHECKPOINT_N_SLOTS];
+} CheckpointFile;
+
+G_STATIC_ASSERT (sizeof (CheckpointHeader) == 56);
+G_STATIC_ASSERT (sizeof (CheckpointSlot) == 32);
+
+struct _EinsSessionCheckpoint {
+  gchar *path;
+  int fd;
+  CheckpointFile *file;
+};
+
+static void
+reset_file (CheckpointFile *file,
+            const gchar    *boot_id)
+{
+  memset (file, 0, sizeof (CheckpointFile));
+  memcpy (file->header.magic, CHECKPOINT_MAGIC, sizeof (file->header.magic));
+  file->header.version = CHECKPOINT_VERSION;
+  file->header.n_slots = CHECKPOINT_N_SLOTS;
+  memcpy (file->header.boot_id, boot_id, EINS_BOOT_ID_LENGTH + 1);
+}
+
+static gboolean
+header_is_valid (const CheckpointHeader *header)
+{
+  return memcmp (header->magic, CHECKPOINT_MAGIC, sizeof (header->magic)) == 0
+    && header->version == CHECKPOINT_VERSION
+    && header->n_slots == CHECKPOINT_N_SLOTS
+    && header->boot_id[EINS_BOOT_ID_LENGTH] == '\0';
+}
+
+/**
+ * eins_session_checkpoint_open:
+ * @path: path of the checkpoint file, which is created if needed
+ * @error: return location for a #GError, or %NULL
+ *
+ * Maps the session checkpoint file at @path. If the file was written during a
+ * previous boot, or is not a valid checkpoint file, all of its slots are
+ * discarded: any session it described ended when the machine went down.
+ *
+ * Returns: (transfer full): a new #EinsSessionCheckpoint, or %NULL with @error
+ *   set
+ */
+EinsSessionCheckpoint *
+eins_session_checkpoint_open (const gchar  *path,
+                              GError      **error)
+{
+  g_autoptr(EinsSessionCheckpoint) self = NULL;
+  gchar boot_id[EINS_BOOT_ID_LENGTH + 1];
+  struct stat st;
+  void *map;
+  int r;
+
+  g_return_val_if_fail (path != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!eins_read_boot_id (boot_id, error))
+    return NULL;
+
+  self = g_new0 (EinsSessionCheckpoint, 1);
+  self->path = g_strdup (path);
+  self->fd = g_open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (self->fd < 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to open %s: %s", path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  if (fstat (self->fd, &st) < 0
+      || (st.st_size != sizeof (CheckpointFile)
+          && ftruncate (self->fd, sizeof (CheckpointFile)) < 0))
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to size %s: %s", path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  /* Storing into a hole of a shared mapping raises SIGBUS if the disk is
+   * full, so allocate the whole file now. */
+  r = posix_fallocate (self->fd, 0, sizeof (CheckpointFile));
+  if (r != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (r),
+                   "Failed to allocate %s: %s", path, g_strerror (r));
+      return NULL;
+    }
+
+  map = mmap (NULL, sizeof (CheckpointFile), PROT_READ | PROT_WRITE,
+              MAP_SHARED, self->fd, 0);
+  if (map == MAP_FAILED)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to map %s: %s", path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  self->file = map;
+
+  if (!header_is_valid (&self->file->header))
+    {
+      g_debug ("Initializing session checkpoint file %s", path);
+      reset_file (self->file, boot_id);
+    }
+  else if (strcmp (self->file->header.boot_id, boot_id) != 0)
+    {
+      g_debug ("Discarding session checkpoints from boot %s",
+               self->file->header.boot_id);
+      reset_file (self->file, boot_id);
+    }
+
+  return g_steal_pointer (&self);
+}
+
+/**
+ * eins_session_checkpoint_free:
+ * @self: an #EinsSessionCheckpoint
+ *
+ * Unmaps and closes the checkpoint file. Its contents are left on disk.
+ */
+void
+eins_session_checkpoint_free (EinsSessionCheckpoint *self)
+{
+  g_return_if_fail (self != NULL);
+
+  if (self->file != NULL)
+    munmap (self->file, sizeof (CheckpointFile));
+
+  if (self->fd >= 0)
+    {
+      g_autoptr(GError) local_error = NULL;
+
+      if (!g_close (self->fd, &local_error))
+        g_warning ("Failed to close %s: %s", self->path, local_error->message);
+    }
+
+  g_free (self->path);
+  g_free (self);
+}
+
+static CheckpointSlot *
+find_slot (EinsSessionCheckpoint *self,
+           guint32                user_id)
+{
+  for (gsize i = 0; i < CHECKPOINT_N_SLOTS; i++)
+    {
+      if (self->file->slots[i].user_id == user_id)
+        return &self->file->slots[i];
+    }
+
+  return NULL;
+}
+
+/**
+ * eins_session_checkpoint_lookup:
+ * @self: an #EinsSessionCheckpoint
+ * @user_id: a non-zero user ID
+ * @start_time: (out) (optional): return location for the wall-clock time at
+ *   which the session started, in microseconds
+ * @accumulated: (out) (optional): return location for the session time that
+ *   has already been handed to the event recorder, in microseconds
+ *
+ * Returns: %TRUE if a checkpoint exists for @user_id during the current boot
+ */
+gboolean
+eins_session_checkpoint_lookup (EinsSessionCheckpoint *self,
+                                guint32                user_id,
+                                gint64                *start_time,
+                                gint64                *accumulated)
+{
+  const CheckpointSlot *slot;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (user_id != 0, FALSE);
+
+  slot = find_slot (self, user_id);
+  if (slot == NULL)
+    return FALSE;
+
+  if (start_time != NULL)
+    *start_time = slot->start_time;
+  if (accumulated != NULL)
+    *accumulated = slot->accumulated;
+
+  return TRUE;
+}
+
+/**
+ * eins_session_checkpoint_update:
+ * @self: an #EinsSessionCheckpoint
+ * @user_id: a non-zero user ID
+ * @start_time: wall-clock time at which the session started, in microseconds
+ * @accumulated: session time already handed to the event recorder, in
+ *   microseconds
+ *
+ * Records the state of @user_id's session, claiming a free slot if needed.
+ *
+ * Returns: %TRUE on success; %FALSE if all slots are in use
+ */
+gboolean
+eins_session_checkpoint_update (EinsSessionCheckpoint *self,
+                                guint32                user_id,
+                                gint64                 start_time,
+                                gint64                 accumulated)
+{
+  CheckpointSlot *slot;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (user_id != 0, FALSE);
+
+  slot = find_slot (self, user_id);
+  if (slot == NULL)
+    slot = find_slot (self, 0);
+  if (slot == NULL)
+    return FALSE;
+
+  slot->start_time = start_time;
+  slot->checkpoint_time = g_get_real_time ();
+  slot->accumulated = accumulated;
+  slot->user_id = user_id;
+
+  return TRUE;
+}
+
+/**
+ * eins_session_checkpoint_remove:
+ * @self: an #EinsSessionCheckpoint
+ * @user_id: a non-zero user ID
+ *
+ * Frees the slot used by @user_id's session, if any. This should be called
+ * once the session's time has been handed to the event recorder in full.
+ */
+void
+eins_session_checkpoint_remove (EinsSessionCheckpoint *self,
+                                guint32                user_id)
+{
+  CheckpointSlot *slot;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (user_id != 0);
+
+  slot = find_slot (self, user_id);
+  if (slot != NULL)
+    memset (slot, 0, sizeof (CheckpointSlot));
+}
+
+/**
+ * eins_session_checkpoint_prune:
+ * @self: an #EinsSessionCheckpoint
+ * @live_user_ids: hash table whose keys are the user IDs, stored with
+ *   GUINT_TO_POINTER(), which currently have a session
+ *
+ * Frees the slots of sessions which are not in @live_user_ids. These sessions
+ * ended while nobody was tracking them, so their time since the last
+ * checkpoint cannot be recovered.
+ *
+ * Returns: the number of slots which were freed
+ */
+guint
+eins_session_checkpoint_prune (EinsSessionCheckpoint *self,
+                               GHashTable            *live_user_ids)
+{
+  guint n_pruned = 0;
+
+  g_return_val_if_fail (self != NULL, 0);
+  g_return_val_if_fail (live_user_ids != NULL, 0);
+
+  for (gsize i = 0; i < CHECKPOINT_N_SLOTS; i++)
+    {
+      CheckpointSlot *slot = &self->file->slots[i];
+
+      if (slot->user_id == 0 ||
+          g_hash_table_contains (live_user_ids, GUINT_TO_POINTER (slot->user_id)))
+        continue;
+
+      g_debug ("Session for user %" G_GUINT32_FORMAT " ended untracked; "
+               "last checkpoint was %" G_GINT64_FORMAT " µs ago",
+               slot->user_id, g_get_real_time () - slot->checkpoint_time);
+      memset (slot, 0, sizeof (CheckpointSlot));
+      n_pruned++;
+    }
+
+  return n_pruned;
+}
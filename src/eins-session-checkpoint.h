@@ -0,0 +1,42 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+typedef struct _EinsSessionCheckpoint EinsSessionCheckpoint;
+
+EinsSessionCheckpoint *eins_session_checkpoint_open (const gchar  *path,
+                                                     GError      **error);
+void eins_session_checkpoint_free (EinsSessionCheckpoint *self);
+
+gboolean eins_session_checkpoint_lookup (EinsSessionCheckpoint *self,
+                                         guint32                user_id,
+                                         gint64                *start_time,
+                                         gint64                *accumulated);
+gboolean eins_session_checkpoint_update (EinsSessionCheckpoint *self,
+                                         guint32                user_id,
+                                         gint64                 start_time,
+                                         gint64                 accumulated);
+void eins_session_checkpoint_remove (EinsSessionCheckpoint *self,
+                                     guint32                user_id);
+guint eins_session_checkpoint_prune (EinsSessionCheckpoint *self,
+                                     GHashTable            *live_user_ids);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (EinsSessionCheckpoint, eins_session_checkpoint_free)
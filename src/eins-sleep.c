@@ -0,0 +1,185 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-sleep.h"
+#include "eins-recorder.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <string.h>
+#include <time.h>
+
+/*
+ * Suspend and resume event, recorded once a day if the system slept, with
+ * payload "((tttau)(tttau))".
+ *
+ * Field   | Description
+ * --------+------------------------------------------------------------
+ * (tttau) | Time the system was awake between logind's PrepareForSleep
+ *         | (true) and PrepareForSleep (false), in milliseconds: that is,
+ *         | the time taken to suspend plus the time taken to resume
+ * (tttau) | Time the system was actually asleep, in seconds
+ *
+ * Each histogram is the number of suspends, the sum and maximum of the
+ * values, then counts in power-of-two buckets; see eins-stats.h.
+ *
+ * Both signals are timestamped against CLOCK_MONOTONIC, which stops while the
+ * system is asleep, and CLOCK_BOOTTIME, which doesn't. The difference between
+ * the two intervals is the time spent asleep.
+ */
+
+#define SLEEP_EVENT "ee014a00-4aab-4501-a6a9-7de28970271e"
+
+/* 24 hours */
+#define SLEEP_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+static EinsSleepTimestamp sleep_start;
+static gboolean sleeping = FALSE;
+static EinsHistogram transition_ms;
+static EinsHistogram asleep_s;
+
+/* For PrepareForSleep */
+static GDBusProxy *watched_proxy;
+static gulong signal_id;
+
+static void
+get_timestamp (EinsSleepTimestamp *timestamp)
+{
+  struct timespec ts;
+
+  timestamp->monotonic_us = g_get_monotonic_time ();
+
+  clock_gettime (CLOCK_BOOTTIME, &ts);
+  timestamp->boottime_us = ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+/**
+ * eins_sleep_prepare_for_sleep:
+ * @start: the argument of PrepareForSleep: %TRUE before suspending, %FALSE
+ *   after resuming
+ * @now: when the signal was received
+ *
+ * Adds a suspend to the summary once the system has resumed from it.
+ */
+void
+eins_sleep_prepare_for_sleep (gboolean                  start,
+                              const EinsSleepTimestamp *now)
+{
+  gint64 awake_us, total_us;
+
+  if (start)
+    {
+      sleep_start = *now;
+      sleeping = TRUE;
+      return;
+    }
+
+  /* The daemon was started while the system was going to sleep */
+  if (!sleeping)
+    return;
+
+  sleeping = FALSE;
+
+  awake_us = MAX (now->monotonic_us - sleep_start.monotonic_us, 0);
+  total_us = MAX (now->boottime_us - sleep_start.boottime_us, awake_us);
+
+  eins_histogram_add (&transition_ms, awake_us / 1000);
+  eins_histogram_add (&asleep_s, (total_us - awake_us) / G_USEC_PER_SEC);
+}
+
+/**
+ * eins_sleep_take_summary:
+ *
+ * Returns: (transfer floating) (nullable): the payload of the event for the
+ *   suspends added since the last call, or %NULL if there were none
+ */
+GVariant *
+eins_sleep_take_summary (void)
+{
+  GVariant *summary;
+
+  if (transition_ms.count == 0)
+    return NULL;
+
+  summary = g_variant_new ("(@" EINS_HISTOGRAM_TYPE_STRING
+                           "@" EINS_HISTOGRAM_TYPE_STRING ")",
+                           eins_histogram_to_variant (&transition_ms),
+                           eins_histogram_to_variant (&asleep_s));
+
+  memset (&transition_ms, 0, sizeof (transition_ms));
+  memset (&asleep_s, 0, sizeof (asleep_s));
+
+  return summary;
+}
+
+static void
+record_sleep (gpointer user_data G_GNUC_UNUSED)
+{
+  GVariant *summary = eins_sleep_take_summary ();
+
+  if (summary != NULL)
+    {
+      eins_recorder_record_event (SLEEP_EVENT, summary);
+      eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+    }
+}
+
+static void
+login_signal_cb (GDBusProxy *proxy       G_GNUC_UNUSED,
+                 gchar      *sender_name G_GNUC_UNUSED,
+                 gchar      *signal_name,
+                 GVariant   *parameters,
+                 gpointer    user_data   G_GNUC_UNUSED)
+{
+  EinsSleepTimestamp now;
+  gboolean start;
+
+  if (strcmp (signal_name, "PrepareForSleep") != 0 ||
+      !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")))
+    return;
+
+  get_timestamp (&now);
+  g_variant_get (parameters, "(b)", &start);
+  eins_sleep_prepare_for_sleep (start, &now);
+}
+
+void
+eins_sleep_start (GDBusProxy *login_proxy)
+{
+  watched_proxy = g_object_ref (login_proxy);
+  signal_id = g_signal_connect (watched_proxy, "g-signal",
+                                G_CALLBACK (login_signal_cb), NULL);
+  eins_schedule_add ("sleep", SLEEP_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_sleep, NULL);
+}
+
+/* Suspends not yet recorded are dropped. */
+void
+eins_sleep_stop (void)
+{
+  eins_schedule_remove ("sleep");
+
+  if (watched_proxy != NULL)
+    g_clear_signal_handler (&signal_id, watched_proxy);
+  g_clear_object (&watched_proxy);
+
+  sleeping = FALSE;
+  memset (&transition_ms, 0, sizeof (transition_ms));
+  memset (&asleep_s, 0, sizeof (asleep_s));
+}
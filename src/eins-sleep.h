@@ -0,0 +1,34 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <gio/gio.h>
+
+void eins_sleep_start (GDBusProxy *login_proxy);
+void eins_sleep_stop (void);
+
+/* For tests */
+typedef struct {
+  gint64 monotonic_us;
+  gint64 boottime_us;
+} EinsSleepTimestamp;
+
+void eins_sleep_prepare_for_sleep (gboolean                  start,
+                                   const EinsSleepTimestamp *now);
+GVariant *eins_sleep_take_summary (void);
@@ -0,0 +1,480 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+/* How often to check how late the main loop dispatches a timeout. */
+#define MAIN_LOOP_LAG_PROBE_INTERVAL_MS (60 * 1000)
+
+guint64 eins_stats_counters[EINS_STATS_N_COUNTERS];
+gint64 eins_stats_gauges[EINS_STATS_N_GAUGES];
+static EinsHistogram histograms[EINS_STATS_N_HISTOGRAMS];
+
+static const gchar * const counter_names[] = {
+  [EINS_STATS_COUNTER_SYSTEMD_SIGNALS] = "systemd-signals",
+  [EINS_STATS_COUNTER_LOGIN_SIGNALS] = "login-signals",
+  [EINS_STATS_COUNTER_SESSIONS_STARTED] = "sessions-started",
+  [EINS_STATS_COUNTER_SESSIONS_STOPPED] = "sessions-stopped",
+  [EINS_STATS_COUNTER_EVENTS_RECORDED] = "events-recorded",
+  [EINS_STATS_COUNTER_BOOTTIME_DISPATCHES] = "boottime-dispatches",
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (counter_names) == EINS_STATS_N_COUNTERS);
+
+static const gchar * const gauge_names[] = {
+  [EINS_STATS_GAUGE_ACTIVE_SESSIONS] = "active-sessions",
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (gauge_names) == EINS_STATS_N_GAUGES);
+
+static const gchar * const histogram_names[] = {
+  [EINS_STATS_HISTOGRAM_LOGIN_SIGNAL_US] = "login-signal-us",
+  [EINS_STATS_HISTOGRAM_DBUS_CALL_US] = "dbus-call-us",
+  [EINS_STATS_HISTOGRAM_HWINFO_COLLECT_US] = "hwinfo-collect-us",
+  [EINS_STATS_HISTOGRAM_MAIN_LOOP_LAG_US] = "main-loop-lag-us",
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (histogram_names) == EINS_STATS_N_HISTOGRAMS);
+
+static const gchar introspection_xml[] =
+  "<node>"
+  "  <interface name='" EINS_STATS_INTERFACE "'>"
+  "    <method name='GetStats'>"
+  "      <arg type='a{sv}' name='stats' direction='out'/>"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
+static guint
+histogram_bucket (guint64 value)
+{
+  guint bucket;
+
+  if (value == 0)
+    return 0;
+
+  bucket = g_bit_storage (value);
+  return MIN (bucket, EINS_HISTOGRAM_N_BUCKETS - 1);
+}
+
+void
+eins_histogram_add (EinsHistogram *histogram,
+                    guint64        value)
+{
+  guint32 *bucket = &histogram->buckets[histogram_bucket (value)];
+
+  histogram->count++;
+  histogram->sum += value;
+  histogram->max = MAX (histogram->max, value);
+
+  if (*bucket < G_MAXUINT32)
+    (*bucket)++;
+}
+
+/*
+ * Returns an upper bound for the given percentile (between 0 and 100) of the
+ * values added to the histogram: the top of the bucket it falls in, clamped
+ * to the largest value seen. Returns 0 for an empty histogram.
+ */
+guint64
+eins_histogram_percentile (const EinsHistogram *histogram,
+                           guint                percentile)
+{
+  guint i;
+  guint64 upper;
+
+  g_return_val_if_fail (percentile <= 100, 0);
+
+  i = eins_buckets_percentile (histogram->buckets, EINS_HISTOGRAM_N_BUCKETS,
+                               percentile);
+  upper = i == 0 ? 0 : (G_GUINT64_CONSTANT (1) << i) - 1;
+
+  if (i == EINS_HISTOGRAM_N_BUCKETS - 1)
+    upper = G_MAXUINT64;
+
+  return MIN (upper, histogram->max);
+}
+
+/**
+ * eins_percentile_rank:
+ * @n_values: how many values there are
+ * @percentile: between 0 and 100
+ *
+ * Returns: the rank of the given percentile among @n_values sorted values,
+ *   counting from 1; or 0 if there are none
+ */
+guint64
+eins_percentile_rank (guint64 n_values,
+                      guint   percentile)
+{
+  g_return_val_if_fail (percentile <= 100, 0);
+
+  if (n_values == 0)
+    return 0;
+
+  return MAX ((n_values * percentile + 99) / 100, 1);
+}
+
+/**
+ * eins_buckets_percentile:
+ * @buckets: (array length=n_buckets): how many values fell in each bucket
+ * @n_buckets: the number of buckets
+ * @percentile: between 0 and 100
+ *
+ * Returns: the index of the bucket which the given percentile of the values
+ *   falls in; or 0 if there are none
+ */
+guint
+eins_buckets_percentile (const guint32 *buckets,
+                         guint          n_buckets,
+                         guint          percentile)
+{
+  guint64 total = 0, rank, seen = 0;
+
+  g_return_val_if_fail (n_buckets > 0, 0);
+  g_return_val_if_fail (percentile <= 100, 0);
+
+  for (guint i = 0; i < n_buckets; i++)
+    total += buckets[i];
+
+  rank = eins_percentile_rank (total, percentile);
+  if (rank == 0)
+    return 0;
+
+  for (guint i = 0; i < n_buckets; i++)
+    {
+      seen += buckets[i];
+      if (seen >= rank)
+        return i;
+    }
+
+  return n_buckets - 1;
+}
+
+/**
+ * eins_read_fd:
+ * @fd: a descriptor for a sysfs or procfs file
+ * @buffer: (out): return location for the file's contents, nul-terminated
+ * @size: the size of @buffer
+ *
+ * Reads the file from the start with a single pread(), which makes the
+ * kernel generate its contents afresh, so the descriptor can be kept open
+ * and read again for each sample rather than the file being reopened.
+ * Anything beyond @size - 1 bytes is left out.
+ *
+ * Returns: the number of bytes read, or -1 with errno set
+ */
+gssize
+eins_read_fd (int    fd,
+              gchar *buffer,
+              gsize  size)
+{
+  gssize n;
+
+  g_return_val_if_fail (buffer != NULL, -1);
+  g_return_val_if_fail (size > 0, -1);
+
+  do
+    n = pread (fd, buffer, size - 1, 0);
+  while (n < 0 && errno == EINTR);
+
+  if (n >= 0)
+    buffer[n] = '\0';
+
+  return n;
+}
+
+/**
+ * eins_read_fd_int64:
+ * @fd: a descriptor for a sysfs or procfs file holding a decimal number,
+ *   or -1
+ * @value: (out): return location for the number
+ *
+ * Reads the number as eins_read_fd() does.
+ *
+ * Returns: %TRUE if a number was read
+ */
+gboolean
+eins_read_fd_int64 (int     fd,
+                    gint64 *value)
+{
+  gchar buffer[32];
+  gchar *end;
+
+  if (eins_read_fd (fd, buffer, sizeof (buffer)) <= 0)
+    return FALSE;
+
+  *value = g_ascii_strtoll (buffer, &end, 10);
+
+  return end != buffer;
+}
+
+/*
+ * Trailing empty buckets are left out, which makes histograms of small values
+ * much shorter; eins_histogram_from_variant() treats missing buckets as empty.
+ */
+GVariant *
+eins_histogram_to_variant (const EinsHistogram *histogram)
+{
+  gsize n_buckets = EINS_HISTOGRAM_N_BUCKETS;
+
+  while (n_buckets > 0 && histogram->buckets[n_buckets - 1] == 0)
+    n_buckets--;
+
+  return g_variant_new ("(ttt@au)",
+                        histogram->count, histogram->sum, histogram->max,
+                        g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+                                                   histogram->buckets,
+                                                   n_buckets,
+                                                   sizeof (guint32)));
+}
+
+gboolean
+eins_histogram_from_variant (GVariant      *variant,
+                             EinsHistogram *histogram)
+{
+  g_autoptr(GVariant) buckets = NULL;
+  const guint32 *data;
+  gsize n_buckets;
+
+  if (!g_variant_is_of_type (variant, G_VARIANT_TYPE (EINS_HISTOGRAM_TYPE_STRING)))
+    return FALSE;
+
+  memset (histogram, 0, sizeof (EinsHistogram));
+  g_variant_get (variant, "(ttt@au)",
+                 &histogram->count, &histogram->sum, &histogram->max,
+                 &buckets);
+
+  data = g_variant_get_fixed_array (buckets, &n_buckets, sizeof (guint32));
+  memcpy (histogram->buckets, data,
+          MIN (n_buckets, EINS_HISTOGRAM_N_BUCKETS) * sizeof (guint32));
+
+  return TRUE;
+}
+
+void
+eins_stats_histogram_add (EinsStatsHistogram histogram,
+                          guint64            value)
+{
+  eins_histogram_add (&histograms[histogram], value);
+}
+
+/*
+ * Adds the time elapsed since @start_time, as returned by
+ * g_get_monotonic_time(), to @histogram.
+ */
+void
+eins_stats_histogram_add_elapsed (EinsStatsHistogram histogram,
+                                  gint64             start_time)
+{
+  gint64 elapsed = g_get_monotonic_time () - start_time;
+
+  eins_histogram_add (&histograms[histogram], MAX (elapsed, 0));
+}
+
+static guint64
+get_resident_set_size (void)
+{
+  /* Kept open, since the benchmarks poll the statistics */
+  static int statm_fd = -1;
+  gchar buffer[128];
+  guint64 size_pages, resident_pages;
+
+  if (statm_fd < 0)
+    statm_fd = g_open ("/proc/self/statm", O_RDONLY | O_CLOEXEC, 0);
+
+  if (eins_read_fd (statm_fd, buffer, sizeof (buffer)) <= 0 ||
+      sscanf (buffer, "%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT,
+              &size_pages, &resident_pages) != 2)
+    return 0;
+
+  return resident_pages * sysconf (_SC_PAGESIZE);
+}
+
+/*
+ * Returns a floating a{sv} holding every counter and gauge, keyed by name, as
+ * uint64 and int64 respectively; every histogram, in the format returned by
+ * eins_histogram_to_variant(); and the resident set size in bytes.
+ */
+GVariant *
+eins_stats_snapshot (void)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  for (gsize i = 0; i < EINS_STATS_N_COUNTERS; i++)
+    g_variant_builder_add (&builder, "{sv}", counter_names[i],
+                           g_variant_new_uint64 (eins_stats_counters[i]));
+
+  for (gsize i = 0; i < EINS_STATS_N_GAUGES; i++)
+    g_variant_builder_add (&builder, "{sv}", gauge_names[i],
+                           g_variant_new_int64 (eins_stats_gauges[i]));
+
+  for (gsize i = 0; i < EINS_STATS_N_HISTOGRAMS; i++)
+    g_variant_builder_add (&builder, "{sv}", histogram_names[i],
+                           eins_histogram_to_variant (&histograms[i]));
+
+  g_variant_builder_add (&builder, "{sv}", "rss-bytes",
+                         g_variant_new_uint64 (get_resident_set_size ()));
+
+  return g_variant_builder_end (&builder);
+}
+
+/*
+ * Formats the result of eins_stats_snapshot() for humans, one statistic per
+ * line. Histograms are summarized by their count, mean and percentiles.
+ */
+gchar *
+eins_stats_format (GVariant *stats)
+{
+  g_autoptr(GString) out = g_string_new (NULL);
+  GVariantIter iter;
+  const gchar *name;
+  GVariant *value;
+
+  g_return_val_if_fail (g_variant_is_of_type (stats, G_VARIANT_TYPE_VARDICT), NULL);
+
+  g_variant_iter_init (&iter, stats);
+  while (g_variant_iter_loop (&iter, "{&sv}", &name, &value))
+    {
+      EinsHistogram histogram;
+
+      if (eins_histogram_from_variant (value, &histogram))
+        {
+          g_string_append_printf (out,
+                                  "%s: count=%" G_GUINT64_FORMAT
+                                  " mean=%" G_GUINT64_FORMAT
+                                  " p50=%" G_GUINT64_FORMAT
+                                  " p90=%" G_GUINT64_FORMAT
+                                  " p99=%" G_GUINT64_FORMAT
+                                  " max=%" G_GUINT64_FORMAT "\n",
+                                  name, histogram.count,
+                                  histogram.count > 0 ? histogram.sum / histogram.count : 0,
+                                  eins_histogram_percentile (&histogram, 50),
+                                  eins_histogram_percentile (&histogram, 90),
+                                  eins_histogram_percentile (&histogram, 99),
+                                  histogram.max);
+        }
+      else
+        {
+          g_autofree gchar *printed = g_variant_print (value, FALSE);
+
+          g_string_append_printf (out, "%s: %s\n", name, printed);
+        }
+    }
+
+  return g_string_free (g_steal_pointer (&out), FALSE);
+}
+
+static void
+handle_method_call (GDBusConnection       *connection G_GNUC_UNUSED,
+                    const gchar           *sender G_GNUC_UNUSED,
+                    const gchar           *object_path G_GNUC_UNUSED,
+                    const gchar           *interface_name G_GNUC_UNUSED,
+                    const gchar           *method_name,
+                    GVariant              *parameters G_GNUC_UNUSED,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               user_data G_GNUC_UNUSED)
+{
+  if (g_strcmp0 (method_name, "GetStats") == 0)
+    g_dbus_method_invocation_return_value (invocation,
+                                           g_variant_new ("(@a{sv})",
+                                                          eins_stats_snapshot ()));
+  else
+    g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                           G_DBUS_ERROR_UNKNOWN_METHOD,
+                                           "Unknown method %s", method_name);
+}
+
+static const GDBusInterfaceVTable interface_vtable = {
+  .method_call = handle_method_call,
+};
+
+static void
+bus_acquired_cb (GDBusConnection *connection,
+                 const gchar     *name G_GNUC_UNUSED,
+                 gpointer         user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GDBusNodeInfo) node_info = NULL;
+  g_autoptr(GError) error = NULL;
+
+  node_info = g_dbus_node_info_new_for_xml (introspection_xml, &error);
+  g_assert_no_error (error);
+
+  if (g_dbus_connection_register_object (connection, EINS_STATS_OBJECT_PATH,
+                                         node_info->interfaces[0],
+                                         &interface_vtable,
+                                         NULL /* user_data */,
+                                         NULL /* user_data_free_func */,
+                                         &error) == 0)
+    g_warning ("Failed to export " EINS_STATS_INTERFACE ": %s",
+               error->message);
+}
+
+static void
+name_lost_cb (GDBusConnection *connection G_GNUC_UNUSED,
+              const gchar     *name,
+              gpointer         user_data G_GNUC_UNUSED)
+{
+  g_debug ("Don't own %s; statistics are not available over D-Bus", name);
+}
+
+static gboolean
+probe_main_loop_lag (gpointer user_data)
+{
+  gint64 *expected_time = user_data;
+  gint64 now = g_get_monotonic_time ();
+
+  eins_stats_histogram_add (EINS_STATS_HISTOGRAM_MAIN_LOOP_LAG_US,
+                            MAX (now - *expected_time, 0));
+  *expected_time = now + MAIN_LOOP_LAG_PROBE_INTERVAL_MS * G_TIME_SPAN_MILLISECOND;
+
+  return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Exports the statistics on the system bus, and starts measuring how late the
+ * main loop runs a timeout compared to when it was due. The latter uses
+ * CLOCK_MONOTONIC, which does not advance while the system is suspended, so
+ * suspending does not count as lag.
+ */
+void
+eins_stats_start (void)
+{
+  static gint64 expected_time;
+
+  g_bus_own_name (G_BUS_TYPE_SYSTEM, EINS_STATS_BUS_NAME,
+                  G_BUS_NAME_OWNER_FLAGS_NONE,
+                  bus_acquired_cb,
+                  NULL /* name_acquired_handler */,
+                  name_lost_cb,
+                  NULL /* user_data */,
+                  NULL /* user_data_free_func */);
+
+  expected_time = g_get_monotonic_time () +
+    MAIN_LOOP_LAG_PROBE_INTERVAL_MS * G_TIME_SPAN_MILLISECOND;
+  g_timeout_add (MAIN_LOOP_LAG_PROBE_INTERVAL_MS, probe_main_loop_lag,
+                 &expected_time);
+}
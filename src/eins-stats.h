@@ -0,0 +1,118 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Statistics about the daemon itself. Counters, gauges and histograms live in
+ * static arrays and are updated without locking, because everything runs on
+ * the main thread; updating one costs a handful of instructions.
+ */
+
+#define EINS_STATS_BUS_NAME "com.endlessm.MetricsInstrumentation"
+#define EINS_STATS_OBJECT_PATH "/com/endlessm/MetricsInstrumentation"
+#define EINS_STATS_INTERFACE "com.endlessm.MetricsInstrumentation.Stats"
+
+typedef enum {
+  EINS_STATS_COUNTER_SYSTEMD_SIGNALS,
+  EINS_STATS_COUNTER_LOGIN_SIGNALS,
+  EINS_STATS_COUNTER_SESSIONS_STARTED,
+  EINS_STATS_COUNTER_SESSIONS_STOPPED,
+  EINS_STATS_COUNTER_EVENTS_RECORDED,
+  EINS_STATS_COUNTER_BOOTTIME_DISPATCHES,
+  EINS_STATS_N_COUNTERS
+} EinsStatsCounter;
+
+typedef enum {
+  EINS_STATS_GAUGE_ACTIVE_SESSIONS,
+  EINS_STATS_N_GAUGES
+} EinsStatsGauge;
+
+typedef enum {
+  EINS_STATS_HISTOGRAM_LOGIN_SIGNAL_US,
+  EINS_STATS_HISTOGRAM_DBUS_CALL_US,
+  EINS_STATS_HISTOGRAM_HWINFO_COLLECT_US,
+  EINS_STATS_HISTOGRAM_MAIN_LOOP_LAG_US,
+  EINS_STATS_N_HISTOGRAMS
+} EinsStatsHistogram;
+
+/*
+ * A histogram with power-of-two buckets: bucket 0 counts zeroes, and bucket i
+ * counts values in [2^(i-1), 2^i). The last bucket also counts anything
+ * larger.
+ */
+#define EINS_HISTOGRAM_N_BUCKETS 64
+
+typedef struct {
+  guint64 count;
+  guint64 sum;
+  guint64 max;
+  guint32 buckets[EINS_HISTOGRAM_N_BUCKETS];
+} EinsHistogram;
+
+#define EINS_HISTOGRAM_TYPE_STRING "(tttau)"
+
+void eins_histogram_add (EinsHistogram *histogram,
+                         guint64        value);
+guint64 eins_histogram_percentile (const EinsHistogram *histogram,
+                                   guint                percentile);
+GVariant *eins_histogram_to_variant (const EinsHistogram *histogram);
+gboolean eins_histogram_from_variant (GVariant      *variant,
+                                      EinsHistogram *histogram);
+
+/* Shared by the collectors' summaries */
+guint64 eins_percentile_rank (guint64 n_values,
+                              guint   percentile);
+guint eins_buckets_percentile (const guint32 *buckets,
+                               guint          n_buckets,
+                               guint          percentile);
+
+/* For sysfs and procfs files opened once and read again for each sample */
+gssize eins_read_fd (int    fd,
+                     gchar *buffer,
+                     gsize  size);
+gboolean eins_read_fd_int64 (int     fd,
+                             gint64 *value);
+
+extern guint64 eins_stats_counters[EINS_STATS_N_COUNTERS];
+extern gint64 eins_stats_gauges[EINS_STATS_N_GAUGES];
+
+static inline void
+eins_stats_counter_inc (EinsStatsCounter counter)
+{
+  eins_stats_counters[counter]++;
+}
+
+static inline void
+eins_stats_gauge_set (EinsStatsGauge gauge,
+                      gint64         value)
+{
+  eins_stats_gauges[gauge] = value;
+}
+
+void eins_stats_histogram_add (EinsStatsHistogram histogram,
+                               guint64            value);
+void eins_stats_histogram_add_elapsed (EinsStatsHistogram histogram,
+                                       gint64             start_time);
+
+GVariant *eins_stats_snapshot (void);
+gchar *eins_stats_format (GVariant *stats);
+
+void eins_stats_start (void);
@@ -0,0 +1,758 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-thermal.h"
+#include "eins-boottime-source.h"
+#include "eins-config.h"
+#include "eins-recorder.h"
+#include "eins-ring-store.h"
+#include "eins-schedule.h"
+#include "eins-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+/*
+ * Thermal event, recorded once a day, with payload "(ua(qtt)a(syyyy))".
+ *
+ * Field     | Description
+ * ----------+---------------------------------------------------------
+ *         u | Number of samples taken during the day
+ *   a(qtt)  | One entry per CPU package, on x86 only:
+ *           |   q: the package ID
+ *           |   t: times the package was throttled during the day
+ *           |   t: times any of its cores was throttled, summed over
+ *           |      the cores
+ * a(syyyy)  | One entry per thermal zone:
+ *           |   s: the zone's type, such as 'x86_pkg_temp' or 'acpitz'
+ *           |   y: median temperature, in degrees Celsius
+ *           |   y: 90th percentile of the same
+ *           |   y: 99th percentile of the same
+ *           |   y: maximum of the same
+ *
+ * Temperatures are rounded down to whole degrees and clamped to between 0
+ * and 127. Thermal zones are not reliably associated with packages, so they
+ * are reported separately.
+ *
+ * Like the pressure files, every counter and temperature is read with a
+ * single pread() on a descriptor opened once, so sampling needs no path
+ * lookups.
+ *
+ * The exception is when a CPU goes offline, as every CPU but the boot CPU
+ * does on each suspend: its thermal_throttle group is removed, so reads from
+ * the descriptors fail, and the group is added back when the CPU comes back
+ * online. A throttle count which fails to read is reopened by path, and once
+ * it can be read again counts on from the value it then has, which is taken
+ * to have restarted from zero if it is lower than before.
+ *
+ * As for batteries, the temperatures and the throttles counted since the
+ * previous sample are kept in a ring store in the cache until the event is
+ * recorded, so restarting the daemon or rebooting doesn't lose the day's
+ * samples so far.
+ */
+
+#define THERMAL_EVENT "b012be94-db42-4137-9ca4-d795a582118b"
+
+#define THERMAL_SAMPLE_INTERVAL_USECONDS (60 * G_USEC_PER_SEC)
+
+/* 24 hours */
+#define THERMAL_RECORD_INTERVAL_USECONDS G_TIME_SPAN_DAY
+
+/* Fewer samples than this are carried over to the next day, as for PSI.
+ * Can be changed with min-samples in the [thermal] group of the
+ * configuration. */
+#define THERMAL_MIN_SAMPLES 60
+
+#define SYSFS_ROOT "/sys"
+
+#define THERMAL_STORE_FILE_PATH INSTRUMENTATION_CACHE_DIR "/thermal-samples"
+/* Two for each package, and one for each zone */
+#define THERMAL_STORE_N_SERIES 24
+/* A day and a half of samples, in case the event is late */
+#define THERMAL_STORE_CAPACITY 2160
+
+typedef struct {
+  gchar *path;
+  /* -1 while the file can't be opened */
+  int fd;
+  /* The value last read */
+  guint64 last;
+  /* How much the value has gone up since it was first read, across
+   * reopenings */
+  guint64 total;
+  gboolean started;
+} ThrottleCount;
+
+typedef struct {
+  guint16 id;
+  /* path is NULL if the package has no count */
+  ThrottleCount package_count;
+  /* One for each core, rather than each CPU: hyperthreads share a count.
+   * Element type: ThrottleCount */
+  GArray *core_counts;
+  /* IDs of the cores in core_counts, within the package */
+  GArray *core_ids;
+  /* Totals of the counts as of the last sample, so that each sample
+   * stores the throttles since the previous one */
+  guint64 package_sampled;
+  guint64 core_sampled;
+  /* Indices of their series in the store, or -1 */
+  gint package_series;
+  gint core_series;
+} Package;
+
+typedef struct {
+  gchar *name;
+  gchar *type;
+  int fd;
+  /* Index of its series in the store, or -1 */
+  gint series;
+} Zone;
+
+static GPtrArray *packages;
+static GPtrArray *zones;
+static EinsRingStore *store;
+static guint sample_source_id;
+
+void
+eins_thermal_summary_add (EinsThermalSummary *summary,
+                          gint64              millidegrees)
+{
+  gint64 degrees = CLAMP (millidegrees / 1000, 0, EINS_THERMAL_N_BUCKETS - 1);
+
+  summary->buckets[degrees]++;
+  summary->n_samples++;
+}
+
+/**
+ * eins_thermal_summary_percentile:
+ * @summary: a summary
+ * @percentile: between 0 and 100
+ *
+ * Returns: the given percentile of the temperatures added to @summary, in
+ *   degrees Celsius; or 0 if none have been added
+ */
+guint8
+eins_thermal_summary_percentile (const EinsThermalSummary *summary,
+                                 guint                     percentile)
+{
+  g_return_val_if_fail (percentile <= 100, 0);
+
+  return eins_buckets_percentile (summary->buckets, EINS_THERMAL_N_BUCKETS,
+                                  percentile);
+}
+
+static gboolean
+read_file (const gchar *path,
+           gint64      *value)
+{
+  g_autofree gchar *contents = NULL;
+  gchar *end;
+
+  if (!g_file_get_contents (path, &contents, NULL, NULL))
+    return FALSE;
+
+  *value = g_ascii_strtoll (contents, &end, 10);
+
+  return end != contents;
+}
+
+static int
+open_file (const gchar *path)
+{
+  int fd = g_open (path, O_RDONLY | O_CLOEXEC, 0);
+
+  if (fd < 0 && errno != ENOENT)
+    g_debug ("Failed to open %s: %s", path, g_strerror (errno));
+
+  return fd;
+}
+
+static void
+throttle_count_clear (ThrottleCount *count)
+{
+  g_clear_pointer (&count->path, g_free);
+  if (count->fd >= 0)
+    close (count->fd);
+  count->fd = -1;
+}
+
+/* Reads the count, reopening it if it has been removed and added back.
+ * Returns FALSE, leaving the total as it was, if it can't be read. */
+static gboolean
+throttle_count_read (ThrottleCount *count)
+{
+  gint64 value;
+
+  if (count->fd < 0 || !eins_read_fd_int64 (count->fd, &value))
+    {
+      if (count->fd >= 0)
+        close (count->fd);
+
+      count->fd = open_file (count->path);
+      if (count->fd < 0 || !eins_read_fd_int64 (count->fd, &value))
+        return FALSE;
+    }
+
+  if (!count->started)
+    count->started = TRUE;
+  else if ((guint64) value >= count->last)
+    count->total += value - count->last;
+  else
+    count->total += value;
+
+  count->last = value;
+
+  return TRUE;
+}
+
+static void
+package_free (Package *package)
+{
+  throttle_count_clear (&package->package_count);
+  g_array_unref (package->core_counts);
+  g_array_unref (package->core_ids);
+  g_free (package);
+}
+
+static void
+zone_free (Zone *zone)
+{
+  g_free (zone->name);
+  g_free (zone->type);
+  close (zone->fd);
+  g_free (zone);
+}
+
+static Package *
+get_package (guint16 id)
+{
+  Package *package;
+
+  for (guint i = 0; i < packages->len; i++)
+    {
+      package = g_ptr_array_index (packages, i);
+      if (package->id == id)
+        return package;
+    }
+
+  package = g_new0 (Package, 1);
+  package->id = id;
+  package->package_count.fd = -1;
+  package->package_series = -1;
+  package->core_series = -1;
+  package->core_counts = g_array_new (FALSE, FALSE, sizeof (ThrottleCount));
+  g_array_set_clear_func (package->core_counts,
+                          (GDestroyNotify) throttle_count_clear);
+  package->core_ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+  g_ptr_array_add (packages, package);
+
+  return package;
+}
+
+static gboolean
+has_core (Package *package,
+          guint32  core_id)
+{
+  for (guint i = 0; i < package->core_ids->len; i++)
+    {
+      if (g_array_index (package->core_ids, guint32, i) == core_id)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+open_cpu (const gchar *cpu_path)
+{
+  g_autofree gchar *package_id_path = NULL;
+  g_autofree gchar *core_id_path = NULL;
+  g_autofree gchar *throttle_path = NULL;
+  gint64 package_id, core_id;
+  Package *package;
+
+  throttle_path = g_build_filename (cpu_path, "thermal_throttle", NULL);
+  package_id_path = g_build_filename (cpu_path, "topology",
+                                      "physical_package_id", NULL);
+  core_id_path = g_build_filename (cpu_path, "topology", "core_id", NULL);
+
+  /* Only x86 CPUs report throttling */
+  if (!g_file_test (throttle_path, G_FILE_TEST_IS_DIR) ||
+      !read_file (package_id_path, &package_id) ||
+      !read_file (core_id_path, &core_id))
+    return;
+
+  package = get_package ((guint16) package_id);
+
+  if (package->package_count.path == NULL)
+    {
+      g_autofree gchar *path = g_build_filename (throttle_path,
+                                                 "package_throttle_count",
+                                                 NULL);
+
+      package->package_count.fd = open_file (path);
+      if (package->package_count.fd >= 0)
+        package->package_count.path = g_steal_pointer (&path);
+    }
+
+  if (!has_core (package, (guint32) core_id))
+    {
+      ThrottleCount count = { NULL, -1, 0, 0, FALSE };
+      g_autofree gchar *path = g_build_filename (throttle_path,
+                                                 "core_throttle_count", NULL);
+
+      count.fd = open_file (path);
+      if (count.fd >= 0)
+        {
+          guint32 id = (guint32) core_id;
+
+          count.path = g_steal_pointer (&path);
+          g_array_append_val (package->core_counts, count);
+          g_array_append_val (package->core_ids, id);
+        }
+    }
+}
+
+static void
+open_cpus (const gchar *sysfs_root)
+{
+  g_autofree gchar *cpus_path = g_build_filename (sysfs_root, "devices",
+                                                  "system", "cpu", NULL);
+  g_autoptr(GDir) dir = g_dir_open (cpus_path, 0, NULL);
+  const gchar *name;
+
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *cpu_path = NULL;
+
+      /* Skip cpufreq, cpuidle and so on */
+      if (!g_str_has_prefix (name, "cpu") || !g_ascii_isdigit (name[3]))
+        continue;
+
+      cpu_path = g_build_filename (cpus_path, name, NULL);
+      open_cpu (cpu_path);
+    }
+}
+
+static void
+open_zones (const gchar *sysfs_root)
+{
+  g_autofree gchar *zones_path = g_build_filename (sysfs_root, "class",
+                                                   "thermal", NULL);
+  g_autoptr(GDir) dir = g_dir_open (zones_path, 0, NULL);
+  const gchar *name;
+
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *temp_path = NULL;
+      g_autofree gchar *type_path = NULL;
+      g_autofree gchar *type = NULL;
+      Zone *zone;
+      int fd;
+
+      /* Skip cooling devices */
+      if (!g_str_has_prefix (name, "thermal_zone"))
+        continue;
+
+      temp_path = g_build_filename (zones_path, name, "temp", NULL);
+      type_path = g_build_filename (zones_path, name, "type", NULL);
+
+      if (!g_file_get_contents (type_path, &type, NULL, NULL))
+        continue;
+
+      fd = open_file (temp_path);
+      if (fd < 0)
+        continue;
+
+      zone = g_new0 (Zone, 1);
+      zone->name = g_strdup (name);
+      zone->type = g_strdup (g_strstrip (type));
+      zone->fd = fd;
+      zone->series = -1;
+      g_ptr_array_add (zones, zone);
+    }
+}
+
+static gint
+compare_packages (gconstpointer a,
+                  gconstpointer b)
+{
+  const Package *package_a = *(Package * const *) a;
+  const Package *package_b = *(Package * const *) b;
+
+  return (gint) package_a->id - (gint) package_b->id;
+}
+
+static gint
+compare_zones (gconstpointer a,
+               gconstpointer b)
+{
+  const Zone *zone_a = *(Zone * const *) a;
+  const Zone *zone_b = *(Zone * const *) b;
+
+  gsize len_a = strlen (zone_a->name);
+  gsize len_b = strlen (zone_b->name);
+
+  /* So that thermal_zone10 comes after thermal_zone9 */
+  if (len_a != len_b)
+    return len_a < len_b ? -1 : 1;
+
+  return strcmp (zone_a->name, zone_b->name);
+}
+
+static gchar *
+package_series_name (Package     *package,
+                     const gchar *suffix)
+{
+  return g_strdup_printf ("package%u%s", package->id, suffix);
+}
+
+static gint
+get_series (const gchar *name)
+{
+  if (strlen (name) > EINS_RING_STORE_MAX_NAME_LENGTH)
+    return -1;
+
+  return eins_ring_store_get_series (store, name);
+}
+
+static void
+open_store (const gchar *store_path)
+{
+  g_autoptr(GHashTable) names = g_hash_table_new_full (g_str_hash,
+                                                       g_str_equal,
+                                                       g_free, NULL);
+  g_autoptr(GError) error = NULL;
+
+  store = eins_ring_store_open (store_path, THERMAL_STORE_N_SERIES,
+                                THERMAL_STORE_CAPACITY, &error);
+  if (store == NULL)
+    {
+      g_warning ("Failed to open thermal sample store: %s", error->message);
+      return;
+    }
+
+  for (guint i = 0; i < packages->len; i++)
+    {
+      Package *package = g_ptr_array_index (packages, i);
+
+      g_hash_table_add (names, package_series_name (package, ""));
+      g_hash_table_add (names, package_series_name (package, "-cores"));
+    }
+
+  for (guint i = 0; i < zones->len; i++)
+    {
+      Zone *zone = g_ptr_array_index (zones, i);
+
+      g_hash_table_add (names, g_strdup (zone->name));
+    }
+
+  /* Samples of packages and zones which are gone would never be taken */
+  eins_ring_store_prune (store, names);
+
+  for (guint i = 0; i < packages->len; i++)
+    {
+      Package *package = g_ptr_array_index (packages, i);
+      g_autofree gchar *package_name = package_series_name (package, "");
+      g_autofree gchar *core_name = package_series_name (package, "-cores");
+
+      package->package_series = get_series (package_name);
+      package->core_series = get_series (core_name);
+    }
+
+  for (guint i = 0; i < zones->len; i++)
+    {
+      Zone *zone = g_ptr_array_index (zones, i);
+
+      zone->series = get_series (zone->name);
+    }
+}
+
+/**
+ * eins_thermal_open:
+ * @sysfs_root: where sysfs is mounted, normally /sys
+ * @store_path: path of the store which keeps samples until they are
+ *   recorded
+ *
+ * Opens the throttle counters of each CPU package and core, and the
+ * temperature of each thermal zone.
+ *
+ * Returns: %TRUE if there is anything to sample
+ */
+gboolean
+eins_thermal_open (const gchar *sysfs_root,
+                   const gchar *store_path)
+{
+  g_return_val_if_fail (packages == NULL, FALSE);
+
+  packages = g_ptr_array_new_with_free_func ((GDestroyNotify) package_free);
+  zones = g_ptr_array_new_with_free_func ((GDestroyNotify) zone_free);
+
+  open_cpus (sysfs_root);
+  open_zones (sysfs_root);
+
+  g_ptr_array_sort (packages, compare_packages);
+  g_ptr_array_sort (zones, compare_zones);
+
+  if (packages->len == 0 && zones->len == 0)
+    return FALSE;
+
+  open_store (store_path);
+
+  return TRUE;
+}
+
+void
+eins_thermal_close (void)
+{
+  g_clear_pointer (&packages, g_ptr_array_unref);
+  g_clear_pointer (&zones, g_ptr_array_unref);
+  g_clear_pointer (&store, eins_ring_store_free);
+}
+
+static void
+add_sample (gint    series,
+            gint64  time,
+            guint64 value)
+{
+  if (series >= 0)
+    eins_ring_store_append (store, series, time, value);
+}
+
+/**
+ * eins_thermal_sample:
+ *
+ * Adds the temperature of each zone, and the throttles of each package
+ * since the previous call, to the store.
+ */
+void
+eins_thermal_sample (void)
+{
+  gint64 now = g_get_real_time ();
+
+  for (guint i = 0; i < packages->len; i++)
+    {
+      Package *package = g_ptr_array_index (packages, i);
+      guint64 core_throttles = 0;
+
+      if (package->package_count.path != NULL)
+        {
+          throttle_count_read (&package->package_count);
+          add_sample (package->package_series, now,
+                      package->package_count.total -
+                      package->package_sampled);
+          package->package_sampled = package->package_count.total;
+        }
+
+      /* A core which is offline contributes its total so far, so that the
+       * sum never goes backwards */
+      for (guint j = 0; j < package->core_counts->len; j++)
+        {
+          ThrottleCount *count = &g_array_index (package->core_counts,
+                                                 ThrottleCount, j);
+
+          throttle_count_read (count);
+          core_throttles += count->total;
+        }
+
+      add_sample (package->core_series, now,
+                  core_throttles - package->core_sampled);
+      package->core_sampled = core_throttles;
+    }
+
+  for (guint i = 0; i < zones->len; i++)
+    {
+      Zone *zone = g_ptr_array_index (zones, i);
+      gint64 millidegrees;
+
+      /* Some zones fail to read while their device is suspended */
+      if (eins_read_fd_int64 (zone->fd, &millidegrees))
+        add_sample (zone->series, now,
+                    CLAMP (millidegrees / 1000, 0,
+                           EINS_THERMAL_N_BUCKETS - 1));
+    }
+}
+
+/* Takes the samples of a series, counting them towards n_samples. */
+static GArray *
+take_samples (gint     series,
+              guint32 *n_samples)
+{
+  GArray *samples;
+
+  if (series < 0)
+    return g_array_new (FALSE, FALSE, sizeof (EinsRingSample));
+
+  samples = eins_ring_store_take (store, series);
+  *n_samples = MAX (*n_samples, samples->len);
+
+  return samples;
+}
+
+static guint64
+take_sum (gint     series,
+          guint32 *n_samples)
+{
+  g_autoptr(GArray) samples = take_samples (series, n_samples);
+  guint64 sum = 0;
+
+  for (guint i = 0; i < samples->len; i++)
+    sum += g_array_index (samples, EinsRingSample, i).value;
+
+  return sum;
+}
+
+static guint32
+count_pending (gint series)
+{
+  return series >= 0 ? eins_ring_store_get_n_pending (store, series) : 0;
+}
+
+/* Returns the number of samples which eins_thermal_take_summary() would
+ * report, without taking them. */
+static guint32
+count_pending_samples (void)
+{
+  guint32 n_samples = 0;
+
+  for (guint i = 0; i < packages->len; i++)
+    {
+      Package *package = g_ptr_array_index (packages, i);
+
+      n_samples = MAX (n_samples, count_pending (package->package_series));
+      n_samples = MAX (n_samples, count_pending (package->core_series));
+    }
+
+  for (guint i = 0; i < zones->len; i++)
+    {
+      Zone *zone = g_ptr_array_index (zones, i);
+
+      n_samples = MAX (n_samples, count_pending (zone->series));
+    }
+
+  return n_samples;
+}
+
+/**
+ * eins_thermal_take_summary:
+ *
+ * Returns: (transfer floating): the payload of the event, with the samples
+ *   taken since the last call, including those stored before the daemon
+ *   was restarted
+ */
+GVariant *
+eins_thermal_take_summary (void)
+{
+  GVariantBuilder package_builder, zone_builder;
+  guint32 n_samples = 0;
+
+  g_variant_builder_init (&package_builder, G_VARIANT_TYPE ("a(qtt)"));
+
+  for (guint i = 0; i < packages->len; i++)
+    {
+      Package *package = g_ptr_array_index (packages, i);
+      guint64 package_throttles = take_sum (package->package_series,
+                                            &n_samples);
+      guint64 core_throttles = take_sum (package->core_series, &n_samples);
+
+      g_variant_builder_add (&package_builder, "(qtt)", package->id,
+                             package_throttles, core_throttles);
+    }
+
+  g_variant_builder_init (&zone_builder, G_VARIANT_TYPE ("a(syyyy)"));
+
+  for (guint i = 0; i < zones->len; i++)
+    {
+      Zone *zone = g_ptr_array_index (zones, i);
+      g_autoptr(GArray) samples = take_samples (zone->series, &n_samples);
+      EinsThermalSummary summary = { 0 };
+
+      for (guint j = 0; j < samples->len; j++)
+        eins_thermal_summary_add (&summary,
+                                  g_array_index (samples, EinsRingSample,
+                                                 j).value * 1000);
+
+      if (summary.n_samples == 0)
+        continue;
+
+      g_variant_builder_add (&zone_builder, "(syyyy)", zone->type,
+                             eins_thermal_summary_percentile (&summary, 50),
+                             eins_thermal_summary_percentile (&summary, 90),
+                             eins_thermal_summary_percentile (&summary, 99),
+                             eins_thermal_summary_percentile (&summary, 100));
+    }
+
+  return g_variant_new ("(ua(qtt)a(syyyy))", n_samples,
+                        &package_builder, &zone_builder);
+}
+
+static gboolean
+sample_thermal (gpointer user_data G_GNUC_UNUSED)
+{
+  eins_thermal_sample ();
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+record_thermal (gpointer user_data G_GNUC_UNUSED)
+{
+  if (count_pending_samples () <
+      eins_config_get_uint64 ("thermal", "min-samples", THERMAL_MIN_SAMPLES))
+    return;
+
+  eins_recorder_record_event (THERMAL_EVENT, eins_thermal_take_summary ());
+  eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+}
+
+void
+eins_thermal_start (void)
+{
+  if (!eins_thermal_open (SYSFS_ROOT, THERMAL_STORE_FILE_PATH))
+    {
+      g_debug ("No throttle counters or thermal zones found");
+      eins_thermal_close ();
+      return;
+    }
+
+  eins_thermal_sample ();
+  sample_source_id = eins_boottimeout_add_useconds (THERMAL_SAMPLE_INTERVAL_USECONDS,
+                                                    sample_thermal, NULL);
+  eins_schedule_add ("thermal", THERMAL_RECORD_INTERVAL_USECONDS,
+                     EINS_SCHEDULE_FLAGS_PERSISTENT, record_thermal, NULL);
+}
+
+/* Samples already in the store are recorded once it is started again. */
+void
+eins_thermal_stop (void)
+{
+  eins_schedule_remove ("thermal");
+  g_clear_handle_id (&sample_source_id, g_source_remove);
+  eins_thermal_close ();
+}
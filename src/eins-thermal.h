@@ -0,0 +1,45 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+void eins_thermal_start (void);
+void eins_thermal_stop (void);
+
+/* For tests */
+
+/* One bucket per whole degree Celsius, from 0 to 127 */
+#define EINS_THERMAL_N_BUCKETS 128
+
+typedef struct {
+  guint32 n_samples;
+  guint32 buckets[EINS_THERMAL_N_BUCKETS];
+} EinsThermalSummary;
+
+void eins_thermal_summary_add (EinsThermalSummary *summary,
+                               gint64              millidegrees);
+guint8 eins_thermal_summary_percentile (const EinsThermalSummary *summary,
+                                        guint                     percentile);
+
+gboolean eins_thermal_open (const gchar *sysfs_root,
+                           const gchar *store_path);
+void eins_thermal_sample (void);
+GVariant *eins_thermal_take_summary (void);
+void eins_thermal_close (void);
@@ -0,0 +1,60 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/* Static tracepoints around the instrumentation hot paths.
+ *
+ * With -Dusdt=true, each EINS_TRACE_BEGIN/END pair emits a USDT probe named
+ * eos_metrics:<phase>__begin / eos_metrics:<phase>__end, which is a single
+ * nop until perf or bpftrace attaches to it. With -Dsysprof=enabled, the pair
+ * also emits a sysprof mark in the "eos-metrics" group covering the phase.
+ * With neither, both macros expand to nothing.
+ *
+ * A BEGIN and its END must be in the same scope.
+ */
+
+#ifdef HAVE_USDT
+#include <sys/sdt.h>
+#define EINS_TRACE_PROBE(phase, suffix) DTRACE_PROBE (eos_metrics, phase##__##suffix)
+#else
+#define EINS_TRACE_PROBE(phase, suffix)
+#endif
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+
+#define EINS_TRACE_BEGIN(phase) \
+  gint64 eins_trace_##phase##_begin = SYSPROF_CAPTURE_CURRENT_TIME; \
+  EINS_TRACE_PROBE (phase, begin)
+
+#define EINS_TRACE_END(phase) \
+  G_STMT_START { \
+    EINS_TRACE_PROBE (phase, end); \
+    sysprof_collector_mark (eins_trace_##phase##_begin, \
+                            SYSPROF_CAPTURE_CURRENT_TIME - eins_trace_##phase##_begin, \
+                            "eos-metrics", #phase, NULL); \
+  } G_STMT_END
+#else
+#define EINS_TRACE_BEGIN(phase) \
+  G_STMT_START { EINS_TRACE_PROBE (phase, begin); } G_STMT_END
+#define EINS_TRACE_END(phase) \
+  G_STMT_START { EINS_TRACE_PROBE (phase, end); } G_STMT_END
+#endif
@@ -0,0 +1,305 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-uevent-monitor.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+
+#include <glib-unix.h>
+
+/*
+ * One netlink socket, subscribed to the kernel's uevent multicast group, is
+ * shared by every watch. Listening needs no privileges. Events re-broadcast
+ * by udev are on another group and are not received, so there is no
+ * dependency on libudev or on udev having processed the device.
+ */
+
+/* The kernel's own uevent multicast group */
+#define KERNEL_UEVENT_GROUP 1
+
+/* Enough for any uevent: the kernel limits them to 2048 bytes of keys */
+#define UEVENT_BUFFER_SIZE 8192
+
+/* Queued events are dropped once this much is waiting */
+#define RECEIVE_BUFFER_SIZE (256 * 1024)
+
+typedef struct {
+  guint id;
+  gchar *subsystem;
+  EinsUeventFunc func;
+  gpointer user_data;
+} Watch;
+
+static int monitor_fd = -1;
+static guint monitor_source_id;
+static GPtrArray *watches;
+static guint next_watch_id = 1;
+
+static void
+watch_free (Watch *watch)
+{
+  g_free (watch->subsystem);
+  g_free (watch);
+}
+
+/**
+ * eins_uevent_parse:
+ * @buf: a message received from the uevent socket
+ * @len: its length
+ *
+ * Parses a kernel uevent, which is an "ACTION@DEVPATH" header followed by
+ * nul-separated KEY=VALUE pairs.
+ *
+ * Returns: (transfer full) (nullable): the event's properties, or %NULL if
+ *   @buf is not a complete kernel uevent
+ */
+GHashTable *
+eins_uevent_parse (const gchar *buf,
+                   gsize        len)
+{
+  g_autoptr(GHashTable) properties = NULL;
+  const gchar *end = buf + len;
+  const gchar *nul;
+  const gchar *p;
+
+  /* The header must be nul-terminated and contain '@' */
+  nul = memchr (buf, '\0', len);
+  if (nul == NULL || strchr (buf, '@') == NULL)
+    return NULL;
+
+  properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  for (p = nul + 1; p < end; p = nul + 1)
+    {
+      const gchar *equals;
+
+      nul = memchr (p, '\0', end - p);
+      if (nul == NULL)
+        return NULL;
+
+      equals = strchr (p, '=');
+      if (equals != NULL)
+        g_hash_table_replace (properties, g_strndup (p, equals - p),
+                              g_strdup (equals + 1));
+    }
+
+  if (!g_hash_table_contains (properties, "ACTION") ||
+      !g_hash_table_contains (properties, "DEVPATH") ||
+      !g_hash_table_contains (properties, "SUBSYSTEM"))
+    return NULL;
+
+  return g_steal_pointer (&properties);
+}
+
+static void
+dispatch (GHashTable *properties)
+{
+  const gchar *subsystem = g_hash_table_lookup (properties, "SUBSYSTEM");
+
+  /* Watches must not be added or removed from their callbacks. */
+  for (guint i = 0; i < watches->len; i++)
+    {
+      Watch *watch = g_ptr_array_index (watches, i);
+
+      if (strcmp (watch->subsystem, subsystem) == 0)
+        watch->func (properties, watch->user_data);
+    }
+}
+
+/* Each callback re-reads everything it tracks, so one which watches several
+ * subsystems is only told once. */
+static void
+dispatch_overflow (void)
+{
+  for (guint i = 0; i < watches->len; i++)
+    {
+      Watch *watch = g_ptr_array_index (watches, i);
+      gboolean told = FALSE;
+
+      for (guint j = 0; j < i && !told; j++)
+        {
+          Watch *other = g_ptr_array_index (watches, j);
+
+          told = other->func == watch->func &&
+                 other->user_data == watch->user_data;
+        }
+
+      if (!told)
+        watch->func (NULL, watch->user_data);
+    }
+}
+
+static gboolean
+monitor_readable_cb (gint         fd,
+                     GIOCondition condition G_GNUC_UNUSED,
+                     gpointer     user_data G_GNUC_UNUSED)
+{
+  gchar buf[UEVENT_BUFFER_SIZE];
+  gboolean overflowed = FALSE;
+
+  while (TRUE)
+    {
+      g_autoptr(GHashTable) properties = NULL;
+      struct sockaddr_nl sender = { 0 };
+      socklen_t sender_len = sizeof sender;
+      ssize_t len;
+
+      len = recvfrom (fd, buf, sizeof buf - 1, MSG_DONTWAIT,
+                      (struct sockaddr *) &sender, &sender_len);
+      if (len < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          /* Events queued after the overflow are still read, but whatever
+           * they changed is re-read anyway once the socket is drained, so
+           * that is only done once however often it overflows meanwhile. */
+          if (errno == ENOBUFS)
+            {
+              g_debug ("uevent socket overflowed");
+              overflowed = TRUE;
+              continue;
+            }
+
+          if (errno != EAGAIN)
+            g_warning ("Failed to read uevent: %s", g_strerror (errno));
+
+          if (overflowed)
+            dispatch_overflow ();
+
+          return G_SOURCE_CONTINUE;
+        }
+
+      /* Only trust the kernel */
+      if (sender.nl_pid != 0)
+        continue;
+
+      buf[len] = '\0';
+      properties = eins_uevent_parse (buf, len);
+      if (properties != NULL)
+        dispatch (properties);
+    }
+}
+
+static gboolean
+open_monitor (void)
+{
+  struct sockaddr_nl addr = {
+    .nl_family = AF_NETLINK,
+    .nl_groups = KERNEL_UEVENT_GROUP,
+  };
+  int size = RECEIVE_BUFFER_SIZE;
+  int fd;
+
+  fd = socket (AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+               NETLINK_KOBJECT_UEVENT);
+  if (fd < 0)
+    {
+      g_warning ("Failed to open uevent socket: %s", g_strerror (errno));
+      return FALSE;
+    }
+
+  if (setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof size) < 0)
+    g_debug ("Failed to resize uevent socket buffer: %s", g_strerror (errno));
+
+  if (bind (fd, (struct sockaddr *) &addr, sizeof addr) < 0)
+    {
+      g_warning ("Failed to bind uevent socket: %s", g_strerror (errno));
+      close (fd);
+      return FALSE;
+    }
+
+  monitor_fd = fd;
+  monitor_source_id = g_unix_fd_add (fd, G_IO_IN, monitor_readable_cb, NULL);
+
+  return TRUE;
+}
+
+/**
+ * eins_uevent_monitor_add:
+ * @subsystem: the subsystem to watch, such as "usb"
+ * @func: called for each uevent from @subsystem
+ * @user_data: passed to @func
+ *
+ * Starts calling @func for kernel uevents from @subsystem. The socket is
+ * opened by the first watch and closed with the last.
+ *
+ * Returns: an ID for eins_uevent_monitor_remove(), or 0 if the socket could
+ *   not be opened
+ */
+guint
+eins_uevent_monitor_add (const gchar    *subsystem,
+                         EinsUeventFunc  func,
+                         gpointer        user_data)
+{
+  Watch *watch;
+
+  g_return_val_if_fail (subsystem != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  if (monitor_fd < 0 && !open_monitor ())
+    return 0;
+
+  if (watches == NULL)
+    watches = g_ptr_array_new_with_free_func ((GDestroyNotify) watch_free);
+
+  watch = g_new0 (Watch, 1);
+  watch->id = next_watch_id++;
+  watch->subsystem = g_strdup (subsystem);
+  watch->func = func;
+  watch->user_data = user_data;
+  g_ptr_array_add (watches, watch);
+
+  return watch->id;
+}
+
+/**
+ * eins_uevent_monitor_remove:
+ * @watch_id: an ID from eins_uevent_monitor_add()
+ *
+ * Stops calling the watch's callback.
+ */
+void
+eins_uevent_monitor_remove (guint watch_id)
+{
+  g_return_if_fail (watches != NULL);
+
+  for (guint i = 0; i < watches->len; i++)
+    {
+      Watch *watch = g_ptr_array_index (watches, i);
+
+      if (watch->id == watch_id)
+        {
+          g_ptr_array_remove_index (watches, i);
+          break;
+        }
+    }
+
+  if (watches->len == 0)
+    {
+      g_source_remove (monitor_source_id);
+      monitor_source_id = 0;
+      close (monitor_fd);
+      monitor_fd = -1;
+    }
+}
@@ -0,0 +1,41 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Called for each kernel uevent in the watched subsystem. @properties maps
+ * each of the event's keys, including ACTION, DEVPATH and SUBSYSTEM, to its
+ * value. It is NULL if the socket overflowed and events were lost, in which
+ * case the watcher should re-read whatever state it tracks. That happens
+ * once the socket has been drained, and only once for each callback and
+ * user data, even if they watch several subsystems.
+ */
+typedef void (*EinsUeventFunc) (GHashTable *properties,
+                                gpointer    user_data);
+
+guint eins_uevent_monitor_add (const gchar    *subsystem,
+                               EinsUeventFunc  func,
+                               gpointer        user_data);
+void eins_uevent_monitor_remove (guint watch_id);
+
+/* For tests */
+GHashTable *eins_uevent_parse (const gchar *buf,
+                               gsize        len);
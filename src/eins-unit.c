@@ -0,0 +1,57 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-unit.h"
+#include "eins-app-launch.h"
+
+#include <string.h>
+
+/**
+ * eins_unit_canonicalize:
+ * @unit: the name of a systemd unit
+ *
+ * Maps the many units which are instances of the same thing to one name, so
+ * that they are counted together and tables keyed by unit stay small.
+ *
+ * Returns: (transfer full): for an app scope, the app ID; for a session
+ *   scope, "session.scope"; for an instance of a template, the template,
+ *   such as "getty@.service"; otherwise @unit itself
+ */
+gchar *
+eins_unit_canonicalize (const gchar *unit)
+{
+  g_autofree gchar *app_id = NULL;
+  const gchar *at, *dot;
+
+  g_return_val_if_fail (unit != NULL, NULL);
+
+  app_id = eins_app_launch_parse_scope (unit);
+  if (app_id != NULL)
+    return g_steal_pointer (&app_id);
+
+  if (g_str_has_prefix (unit, "session-") && g_str_has_suffix (unit, ".scope"))
+    return g_strdup ("session.scope");
+
+  at = strchr (unit, '@');
+  dot = strrchr (unit, '.');
+  if (at != NULL && dot != NULL && at < dot)
+    return g_strdup_printf ("%.*s%s", (int) (at - unit + 1), unit, dot);
+
+  return g_strdup (unit);
+}
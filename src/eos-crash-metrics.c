@@ -25,7 +25,9 @@
 #include <flatpak.h>
 #include <ostree.h>
 
-#include <eosmetrics/eosmetrics.h>
+#include "eins-flatpak.h"
+#include "eins-recorder.h"
+#include "eins-trace.h"
 
 #define PROGRAM_DUMPED_CORE_EVENT "ed57b607-4a56-47f1-b1e4-5dc3e74335ec"
 #define EXPECTED_NUMBER_ARGS 3
@@ -82,20 +84,19 @@ report_crash (const char *binary,
   if (info != NULL)
     {
       g_variant_dict_insert_value (&dict, "app_ref",
-                                   g_variant_new_take_string (flatpak_ref_format_ref (FLATPAK_REF (info->app))));
+                                   g_variant_new_take_string (eins_flatpak_format_ref (FLATPAK_REF (info->app))));
       g_variant_dict_insert_value (&dict, "app_commit",
                                    g_variant_new_string (flatpak_ref_get_commit (FLATPAK_REF (info->app))));
       g_variant_dict_insert_value (&dict, "app_url", g_variant_new_string (app_url));
       g_variant_dict_insert_value (&dict, "runtime_ref",
-                                   g_variant_new_take_string (flatpak_ref_format_ref (FLATPAK_REF (info->runtime))));
+                                   g_variant_new_take_string (eins_flatpak_format_ref (FLATPAK_REF (info->runtime))));
       g_variant_dict_insert_value (&dict, "runtime_commit",
                                    g_variant_new_string (flatpak_ref_get_commit (FLATPAK_REF (info->runtime))));
       g_variant_dict_insert_value (&dict, "runtime_url", g_variant_new_string (runtime_url));
     }
 
-  emtr_event_recorder_record_event_sync (emtr_event_recorder_get_default (),
-                                         PROGRAM_DUMPED_CORE_EVENT,
-                                         g_variant_dict_end (&dict));
+  eins_recorder_record_event_sync (PROGRAM_DUMPED_CORE_EVENT,
+                                   g_variant_dict_end (&dict));
 }
 
 static OstreeSysroot *
@@ -321,7 +322,9 @@ main (int argc, char **argv)
       return EXIT_SUCCESS;
     }
 
+  EINS_TRACE_BEGIN (load_ostree_sysroot);
   sysroot = load_ostree_sysroot (&error);
+  EINS_TRACE_END (load_ostree_sysroot);
   if (!sysroot)
     {
       g_warning ("Unable to get current OSTree sysroot: %s", error->message);
@@ -337,7 +340,9 @@ main (int argc, char **argv)
   if (g_str_has_prefix (path, "/app/bin"))
     {
       g_message ("%s is likely a Flatpak, get information", path);
+      EINS_TRACE_BEGIN (get_flatpak_info);
       flatpak_info = get_flatpak_info (path, &error);
+      EINS_TRACE_END (get_flatpak_info);
       if (!flatpak_info)
         {
           g_warning ("Unable to get flatpak information: %s", error->message);
@@ -366,7 +371,9 @@ main (int argc, char **argv)
       return EXIT_FAILURE;
     }
 
+  EINS_TRACE_BEGIN (report_crash);
   report_crash (path, signal, timestamp, name.machine, ostree_commit, ostree_url, ostree_version, flatpak_info, app_url, runtime_url);
+  EINS_TRACE_END (report_crash);
 
   return EXIT_SUCCESS;
 }
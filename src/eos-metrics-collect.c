@@ -0,0 +1,165 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Runs one collector and writes its payload to stdout, for the daemon to
+ * record; see eins-helper.c for the protocol. Keeping these collectors out of
+ * the daemon means the libraries they use are only mapped for the second or
+ * so that collection takes, rather than for the whole uptime.
+ *
+ * With --record, the payload is handed to the event recorder instead. This is
+ * how eos-metrics-collect.timer runs the periodic collectors when the daemon
+ * is built to exit while nobody is logged in.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "eins-cpufreq.h"
+#include "eins-flatpak.h"
+#include "eins-hwinfo.h"
+#include "eins-recorder.h"
+
+typedef GVariant *(*CollectFunc) (void);
+typedef GVariant *(*CollectArgsFunc) (const gchar * const *args);
+
+typedef struct {
+  const gchar *name;
+  /* Exactly one of these is set */
+  CollectFunc collect;
+  CollectArgsFunc collect_args;
+  /* The event recorded with --record, or NULL if the payload is only for
+   * the daemon to use */
+  const gchar *event_id;
+} Collector;
+
+static const Collector collectors[] = {
+  { "hwinfo", eins_hwinfo_get_computer_hwinfo, NULL, COMPUTER_HWINFO_EVENT },
+  { "cpufreq", eins_cpufreq_collect, NULL, CPU_FREQUENCY_EVENT },
+  /* Takes app IDs; see eins-app-usage.c */
+  { "flatpak-refs", NULL, eins_flatpak_get_app_refs, NULL },
+};
+
+static const Collector *
+lookup_collector (const gchar *name)
+{
+  for (gsize i = 0; i < G_N_ELEMENTS (collectors); i++)
+    {
+      if (strcmp (collectors[i].name, name) == 0)
+        return &collectors[i];
+    }
+
+  return NULL;
+}
+
+static gboolean
+write_payload (GVariant *payload)
+{
+  g_autoptr(GVariant) boxed = NULL;
+  g_autoptr(GVariant) normal = NULL;
+  gsize size;
+
+  boxed = g_variant_ref_sink (g_variant_new_variant (payload));
+  normal = g_variant_get_normal_form (boxed);
+  size = g_variant_get_size (normal);
+
+  if (fwrite (g_variant_get_data (normal), 1, size, stdout) != size ||
+      fflush (stdout) != 0)
+    {
+      g_printerr ("Failed to write payload: %s\n", g_strerror (errno));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+gint
+main (gint  argc,
+      char *argv[])
+{
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GVariant) payload = NULL;
+  const Collector *collector;
+  gboolean opt_record = FALSE;
+  const GOptionEntry entries[] = {
+    { "record", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &opt_record,
+      "Hand the payload to the event recorder rather than writing it out",
+      NULL },
+    { NULL }
+  };
+
+  context = g_option_context_new ("COLLECTOR - collect one set of metrics");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("option parsing failed: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (argc < 2 || (collector = lookup_collector (argv[1])) == NULL ||
+      (collector->collect != NULL && argc != 2) ||
+      (opt_record && collector->event_id == NULL))
+    {
+      g_printerr ("Usage: %s [--record] COLLECTOR [ARGUMENT...]\n\n"
+                  "Collectors:\n", argv[0]);
+      for (gsize i = 0; i < G_N_ELEMENTS (collectors); i++)
+        g_printerr ("  %s\n", collectors[i].name);
+
+      return EXIT_FAILURE;
+    }
+
+  if (collector->collect != NULL)
+    {
+      payload = collector->collect ();
+    }
+  else
+    {
+      g_auto(GStrv) args = g_new0 (gchar *, argc - 1);
+
+      for (gint i = 2; i < argc; i++)
+        args[i - 2] = g_strdup (argv[i]);
+
+      payload = collector->collect_args ((const gchar * const *) args);
+    }
+
+  if (payload == NULL)
+    return EXIT_FAILURE;
+
+  g_variant_ref_sink (payload);
+
+  if (opt_record)
+    {
+      /* For example, no cpufreq policy has statistics */
+      if (g_variant_is_of_type (payload, G_VARIANT_TYPE_ARRAY) &&
+          g_variant_n_children (payload) == 0)
+        return EXIT_SUCCESS;
+
+      eins_recorder_record_event_sync (collector->event_id, payload);
+      eins_recorder_flush_sync ();
+      return EXIT_SUCCESS;
+    }
+
+  return write_payload (payload) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -23,9 +23,25 @@
 #include <glib-unix.h>
 #include <string.h>
 
-#include <eosmetrics/eosmetrics.h>
-
+#include "eins-app-launch.h"
+#include "eins-app-usage.h"
+#include "eins-battery.h"
+#include "eins-boot-blame.h"
+#include "eins-boottime-source.h"
+#include "eins-config.h"
+#include "eins-diskstats.h"
 #include "eins-hwinfo.h"
+#include "eins-journal.h"
+#include "eins-netdev.h"
+#include "eins-oom.h"
+#include "eins-peripherals.h"
+#include "eins-psi.h"
+#include "eins-recorder.h"
+#include "eins-session-checkpoint.h"
+#include "eins-sleep.h"
+#include "eins-stats.h"
+#include "eins-thermal.h"
+#include "eins-trace.h"
 
 /*
  * Recorded when startup has finished as defined by the systemd manager DBus
@@ -46,11 +62,100 @@
 #define MIN_HUMAN_USER_ID 1000
 
 /*
- * Map from user ID of logged-in user (guint32) to EmtrAggregateTimer (owned
- * by hash table).
+ * How often each session's aggregate timer is stopped and restarted, handing
+ * the elapsed time to the event recorder, and its checkpoint updated. This
+ * bounds how much session time is lost if the daemon dies without stopping its
+ * timers, for example on a power cut or when it is OOM-killed. Can be changed
+ * with checkpoint-interval, in seconds, in the [daemon] group of the
+ * configuration; 0 turns checkpointing off.
+ */
+#define SESSION_CHECKPOINT_INTERVAL_SECONDS (10 * 60)
+
+/* The path of a file to hold the state of each session across restarts. */
+#define SESSION_CHECKPOINT_FILE_PATH INSTRUMENTATION_CACHE_DIR "/session-checkpoint"
+
+typedef struct {
+  guint32 user_id;
+  EinsAggregateTimer *timer;
+  /* Wall-clock time at which the session started, in microseconds. */
+  gint64 start_time;
+  /* Wall-clock time at which the current timer was started, in microseconds. */
+  gint64 timer_start_time;
+  /* Time handed to the event recorder by previous timers, in microseconds. */
+  gint64 accumulated;
+} Session;
+
+/*
+ * Map from user ID of logged-in user (guint32) to Session (owned by hash
+ * table).
  */
 static GHashTable *session_by_user_id;
 
+/* May be NULL if the checkpoint file could not be opened. */
+static EinsSessionCheckpoint *session_checkpoint;
+static guint checkpoint_source_id;
+static guint64 checkpoint_interval_s;
+
+/* The installed configuration file, unless overridden by EINS_CONFIG_FILE_ENV. */
+static const gchar *config_file_path = INSTRUMENTATION_CONFIG_FILE_PATH;
+
+/*
+ * With --idle-exit, the daemon exits once startup has finished and no human
+ * user has been logged in for this long. It is started again by
+ * user@.service when somebody logs in, and the periodic collectors are run by
+ * eos-metrics-collect.timer rather than by the daemon. Can be changed with
+ * idle-exit-timeout in the [daemon] group of the configuration.
+ */
+#define IDLE_EXIT_TIMEOUT_SECONDS 60
+
+static gboolean opt_idle_exit = FALSE;
+static gboolean startup_finished = FALSE;
+static guint idle_exit_source_id;
+static GMainLoop *main_loop;
+
+/* May be NULL if logind could not be reached. */
+static GDBusProxy *login_dbus_proxy;
+
+static gboolean
+idle_exit_cb (gpointer user_data G_GNUC_UNUSED)
+{
+  g_debug ("Nobody has logged in for a while; exiting");
+
+  idle_exit_source_id = 0;
+  g_main_loop_quit (main_loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Arm or disarm the idle exit timeout, depending on whether there is anything
+ * left to measure.
+ */
+static void
+update_idle_exit (void)
+{
+  gboolean idle;
+
+  if (!opt_idle_exit)
+    return;
+
+  idle = startup_finished && g_hash_table_size (session_by_user_id) == 0;
+
+  if (idle && idle_exit_source_id == 0)
+    {
+      guint64 timeout_s = eins_config_get_uint64 ("daemon", "idle-exit-timeout",
+                                                  IDLE_EXIT_TIMEOUT_SECONDS);
+
+      idle_exit_source_id =
+        g_timeout_add_seconds (MIN (timeout_s, G_MAXUINT), idle_exit_cb, NULL);
+    }
+  else if (!idle && idle_exit_source_id != 0)
+    {
+      g_source_remove (idle_exit_source_id);
+      idle_exit_source_id = 0;
+    }
+}
+
 /*
  * Handle a signal from the systemd manager by recording the StartupFinished
  * signal. Once the StartupFinished signal has been received, call the
@@ -64,17 +169,26 @@ record_startup (GDBusProxy *dbus_proxy,
                 GVariant   *parameters,
                 gpointer    user_data G_GNUC_UNUSED)
 {
+  eins_stats_counter_inc (EINS_STATS_COUNTER_SYSTEMD_SIGNALS);
+
   if (strcmp (signal_name, "StartupFinished") == 0)
     {
-      emtr_event_recorder_record_event (emtr_event_recorder_get_default (),
-                                        STARTUP_FINISHED, parameters);
+      eins_recorder_record_event (STARTUP_FINISHED, parameters);
+      eins_stats_counter_inc (EINS_STATS_COUNTER_EVENTS_RECORDED);
+      eins_boot_blame_collect ();
+
+      startup_finished = TRUE;
+      update_idle_exit ();
 
       GError *error = NULL;
+      gint64 start_time = g_get_monotonic_time ();
       GVariant *unsubscribe_result =
         g_dbus_proxy_call_sync (dbus_proxy, "Unsubscribe",
                                 NULL /* parameters */,
                                 G_DBUS_CALL_FLAGS_NONE, -1 /* timeout */,
                                 NULL /* GCancellable */, &error);
+      eins_stats_histogram_add_elapsed (EINS_STATS_HISTOGRAM_DBUS_CALL_US,
+                                        start_time);
       if (unsubscribe_result == NULL)
         {
           g_warning ("Error unsubscribing from systemd signals: %s.",
@@ -114,10 +228,21 @@ systemd_dbus_proxy_new (void)
   g_signal_connect (dbus_proxy, "g-signal", G_CALLBACK (record_startup),
                     NULL /* data */);
 
+  /* Startup may have finished before the daemon started. */
+  g_autoptr(GVariant) finish_timestamp =
+    g_dbus_proxy_get_cached_property (dbus_proxy, "FinishTimestampMonotonic");
+  if (finish_timestamp != NULL &&
+      g_variant_is_of_type (finish_timestamp, G_VARIANT_TYPE_UINT64) &&
+      g_variant_get_uint64 (finish_timestamp) != 0)
+    startup_finished = TRUE;
+
+  gint64 start_time = g_get_monotonic_time ();
   GVariant *subscribe_result =
     g_dbus_proxy_call_sync (dbus_proxy, "Subscribe", NULL /* parameters*/,
                             G_DBUS_CALL_FLAGS_NONE, -1 /* timeout */,
                             NULL /* GCancellable*/, &error);
+  eins_stats_histogram_add_elapsed (EINS_STATS_HISTOGRAM_DBUS_CALL_US,
+                                    start_time);
   if (subscribe_result == NULL)
     {
       g_warning ("Error subscribing to systemd signals: %s.", error->message);
@@ -141,30 +266,82 @@ userid_to_key (guint32 user_id)
   return GUINT_TO_POINTER (user_id);
 }
 
+static void
+session_free (Session *session)
+{
+  g_clear_pointer (&session->timer, eins_aggregate_timer_stop);
+
+  if (session_checkpoint != NULL)
+    eins_session_checkpoint_remove (session_checkpoint, session->user_id);
+
+  eins_stats_counter_inc (EINS_STATS_COUNTER_SESSIONS_STOPPED);
+
+  g_free (session);
+}
+
+static void
+checkpoint_session (Session *session)
+{
+  if (session_checkpoint == NULL)
+    return;
+
+  if (!eins_session_checkpoint_update (session_checkpoint, session->user_id,
+                                       session->start_time,
+                                       session->accumulated))
+    g_debug ("No free checkpoint slot for user %" G_GUINT32_FORMAT,
+             session->user_id);
+}
+
+static EinsAggregateTimer *
+start_session_timer (guint32 user_id)
+{
+  return eins_recorder_start_aggregate_timer (user_id, DAILY_SESSION_TIME,
+                                              NULL);
+}
+
 /*
  * Create a new session for the user, then start the corresponding aggregate
- * timer.
+ * timer. If the session was checkpointed by a previous instance of the daemon
+ * during this boot, it is resumed rather than treated as a new login.
  */
 static void
 add_session (guint32 user_id)
 {
-  EmtrAggregateTimer *timer = NULL;
+  EinsAggregateTimer *timer = NULL;
+  Session *session;
+  gint64 now = g_get_real_time ();
 
   /*  Only care about real humans */
   if (user_id < MIN_HUMAN_USER_ID)
     return;
 
-  timer = emtr_event_recorder_start_aggregate_timer_with_uid (emtr_event_recorder_get_default (),
-                                                              user_id,
-                                                              DAILY_SESSION_TIME,
-                                                              NULL);
+  timer = start_session_timer (user_id);
   if (timer == NULL)
     {
       g_warning ("Failed to start an aggregate timer for user %u", user_id);
+      return;
     }
-  else {
-    g_hash_table_insert (session_by_user_id, userid_to_key (user_id), timer);
-  }
+
+  session = g_new0 (Session, 1);
+  session->user_id = user_id;
+  session->timer = timer;
+  session->start_time = now;
+  session->timer_start_time = now;
+
+  if (session_checkpoint != NULL &&
+      eins_session_checkpoint_lookup (session_checkpoint, user_id,
+                                      &session->start_time,
+                                      &session->accumulated))
+    g_debug ("Resuming checkpointed session for user %" G_GUINT32_FORMAT,
+             user_id);
+
+  g_hash_table_insert (session_by_user_id, userid_to_key (user_id), session);
+  checkpoint_session (session);
+
+  eins_stats_counter_inc (EINS_STATS_COUNTER_SESSIONS_STARTED);
+  eins_stats_gauge_set (EINS_STATS_GAUGE_ACTIVE_SESSIONS,
+                        g_hash_table_size (session_by_user_id));
+  update_idle_exit ();
 }
 
 /*
@@ -177,11 +354,71 @@ remove_session (guint32 user_id)
   if (user_id < MIN_HUMAN_USER_ID)
     return;
 
-  /* The timer will stop itself when its reference count falls to 0. */
   gboolean removed = g_hash_table_remove (session_by_user_id, userid_to_key (user_id));
 
   if (!removed)
     g_warning ("No running timer for user ID %" G_GUINT32_FORMAT, user_id);
+
+  eins_stats_gauge_set (EINS_STATS_GAUGE_ACTIVE_SESSIONS,
+                        g_hash_table_size (session_by_user_id));
+  update_idle_exit ();
+}
+
+/*
+ * Hand the time elapsed so far in every session to the event recorder by
+ * replacing its aggregate timer with a fresh one, then checkpoint it. The
+ * recorder sums the durations of all timers for a user and day, so splitting a
+ * session across several timers does not change what is reported.
+ */
+static gboolean
+checkpoint_all_sessions (gpointer user_data G_GNUC_UNUSED)
+{
+  GHashTableIter iter;
+  Session *session;
+  gint64 now = g_get_real_time ();
+
+  g_hash_table_iter_init (&iter, session_by_user_id);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &session))
+    {
+      EinsAggregateTimer *timer = start_session_timer (session->user_id);
+
+      if (timer == NULL)
+        {
+          g_warning ("Failed to restart the aggregate timer for user %u",
+                     session->user_id);
+          continue;
+        }
+
+      eins_aggregate_timer_stop (session->timer);
+      session->timer = timer;
+      session->accumulated += now - session->timer_start_time;
+      session->timer_start_time = now;
+
+      checkpoint_session (session);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Arm, re-arm or disarm the checkpoint timer to match the configuration. */
+static void
+update_checkpoint_interval (void)
+{
+  guint64 interval_s = eins_config_get_uint64 ("daemon", "checkpoint-interval",
+                                               SESSION_CHECKPOINT_INTERVAL_SECONDS);
+
+  if (checkpoint_source_id != 0 && interval_s == checkpoint_interval_s)
+    return;
+
+  g_clear_handle_id (&checkpoint_source_id, g_source_remove);
+  checkpoint_interval_s = interval_s;
+
+  if (interval_s == 0 || interval_s > G_MAXUINT64 / G_USEC_PER_SEC)
+    return;
+
+  checkpoint_source_id =
+    eins_boottimeout_add_useconds (interval_s * G_USEC_PER_SEC,
+                                   checkpoint_all_sessions, NULL);
 }
 
 /*
@@ -205,6 +442,11 @@ record_login (GDBusProxy *dbus_proxy   G_GNUC_UNUSED,
               gpointer    user_data    G_GNUC_UNUSED)
 {
   guint32 user_id;
+  gint64 start_time = g_get_monotonic_time ();
+
+  eins_stats_counter_inc (EINS_STATS_COUNTER_LOGIN_SIGNALS);
+
+  EINS_TRACE_BEGIN (record_login);
 
   if (strcmp ("UserNew", signal_name) == 0)
     {
@@ -216,6 +458,11 @@ record_login (GDBusProxy *dbus_proxy   G_GNUC_UNUSED,
       g_variant_get (parameters, "(u&o)", &user_id, NULL);
       remove_session (user_id);
     }
+
+  EINS_TRACE_END (record_login);
+
+  eins_stats_histogram_add_elapsed (EINS_STATS_HISTOGRAM_LOGIN_SIGNAL_US,
+                                    start_time);
 }
 
 static GDBusProxy *
@@ -241,9 +488,12 @@ login_dbus_proxy_new (void)
   g_signal_connect (dbus_proxy, "g-signal", G_CALLBACK (record_login),
                     NULL /* data */);
 
+  gint64 start_time = g_get_monotonic_time ();
   GVariant *users =
     g_dbus_proxy_call_sync (dbus_proxy, "ListUsers", NULL,
                             G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+  eins_stats_histogram_add_elapsed (EINS_STATS_HISTOGRAM_DBUS_CALL_US,
+                                    start_time);
   if (error)
     {
       g_warning ("Error calling ListUsers: %s.", error->message);
@@ -260,45 +510,228 @@ login_dbus_proxy_new (void)
       add_session (user_id);
     }
 
+  /* Any other checkpointed session ended while the daemon was not running. */
+  if (session_checkpoint != NULL)
+    eins_session_checkpoint_prune (session_checkpoint, session_by_user_id);
+
   return dbus_proxy;
 }
 
+/*
+ * Print the statistics of the running daemon, as exported on the system bus.
+ */
+static gboolean
+dump_stats (GError **error)
+{
+  g_autoptr(GDBusConnection) connection = NULL;
+  g_autoptr(GVariant) reply = NULL;
+  g_autoptr(GVariant) stats = NULL;
+  g_autofree gchar *formatted = NULL;
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+  if (connection == NULL)
+    return FALSE;
+
+  reply = g_dbus_connection_call_sync (connection,
+                                       EINS_STATS_BUS_NAME,
+                                       EINS_STATS_OBJECT_PATH,
+                                       EINS_STATS_INTERFACE,
+                                       "GetStats",
+                                       NULL /* parameters */,
+                                       G_VARIANT_TYPE ("(a{sv})"),
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1 /* timeout */,
+                                       NULL /* GCancellable */,
+                                       error);
+  if (reply == NULL)
+    return FALSE;
+
+  g_variant_get (reply, "(@a{sv})", &stats);
+  formatted = eins_stats_format (stats);
+  g_print ("%s", formatted);
+
+  return TRUE;
+}
+
 static gboolean
-quit_main_loop (GMainLoop *main_loop)
+quit_main_loop (GMainLoop *loop)
 {
-  g_main_loop_quit (main_loop);
+  g_main_loop_quit (loop);
   return G_SOURCE_REMOVE;
 }
 
+static void
+start_sleep (void)
+{
+  if (login_dbus_proxy != NULL)
+    eins_sleep_start (login_dbus_proxy);
+}
+
+/*
+ * Each collector can be disabled with enabled=false in the group of the
+ * configuration named after it. When the configuration is reloaded, those
+ * which are newly disabled are stopped, which closes whatever they were
+ * watching and drops what they had gathered in memory, and those which are
+ * newly enabled are started.
+ *
+ * With --idle-exit, hardware information is collected by the timer instead.
+ * PSI, disk and network statistics, temperatures, battery discharge, suspends,
+ * app launches and usage, OOMs and journal errors have to be observed
+ * continuously, so they are only summarized when the daemon stays resident.
+ */
+typedef struct {
+  const gchar *name;
+  void (*start) (void);
+  void (*stop) (void);
+  gboolean resident_only;
+  gboolean started;
+} Collector;
+
+static Collector collectors[] = {
+  { "peripherals", eins_peripherals_start, eins_peripherals_stop, FALSE, FALSE },
+  { "hwinfo", eins_hwinfo_start, eins_hwinfo_stop, TRUE, FALSE },
+  { "psi", eins_psi_start, eins_psi_stop, TRUE, FALSE },
+  { "diskstats", eins_diskstats_start, eins_diskstats_stop, TRUE, FALSE },
+  { "netdev", eins_netdev_start, eins_netdev_stop, TRUE, FALSE },
+  { "thermal", eins_thermal_start, eins_thermal_stop, TRUE, FALSE },
+  { "battery", eins_battery_start, eins_battery_stop, TRUE, FALSE },
+  { "app-launch", eins_app_launch_start, eins_app_launch_stop, TRUE, FALSE },
+  { "app-usage", eins_app_usage_start, eins_app_usage_stop, TRUE, FALSE },
+  { "oom", eins_oom_start, eins_oom_stop, TRUE, FALSE },
+  { "journal", eins_journal_start, eins_journal_stop, TRUE, FALSE },
+  { "sleep", start_sleep, eins_sleep_stop, TRUE, FALSE },
+};
+
+/* Starts the collectors which are enabled, and stops those which aren't. */
+static void
+update_collectors (void)
+{
+  for (gsize i = 0; i < G_N_ELEMENTS (collectors); i++)
+    {
+      Collector *collector = &collectors[i];
+      gboolean enabled;
+
+      if (collector->resident_only && opt_idle_exit)
+        continue;
+
+      enabled = eins_config_get_boolean (collector->name, "enabled", TRUE);
+
+      if (enabled && !collector->started)
+        {
+          collector->start ();
+          collector->started = TRUE;
+        }
+      else if (!enabled && collector->started)
+        {
+          g_debug ("Stopping collector %s", collector->name);
+          collector->stop ();
+          collector->started = FALSE;
+        }
+    }
+}
+
+/*
+ * Applies a changed configuration without restarting, so that sessions being
+ * timed and the D-Bus subscriptions are kept.
+ */
+static gboolean
+reload_config (gpointer user_data G_GNUC_UNUSED)
+{
+  g_autoptr(GError) error = NULL;
+
+  g_debug ("Reloading configuration");
+
+  if (!eins_config_reload (&error))
+    {
+      g_warning ("Failed to reload %s: %s", config_file_path, error->message);
+      return G_SOURCE_CONTINUE;
+    }
+
+  eins_schedule_reload ();
+  update_checkpoint_interval ();
+  update_collectors ();
+
+  return G_SOURCE_CONTINUE;
+}
+
 gint
 main (gint  argc,
       char *argv[])
 {
   g_autoptr(GOptionContext) context = NULL;
   g_autoptr(GError) error = NULL;
+  gboolean opt_dump_stats = FALSE;
+  const GOptionEntry entries[] = {
+    { "dump-stats", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &opt_dump_stats,
+      "Print statistics about the running daemon and exit", NULL },
+    { "idle-exit", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &opt_idle_exit,
+      "Exit while nobody is logged in, and leave periodic collection to "
+      "eos-metrics-collect.timer", NULL },
+    { NULL }
+  };
 
   context = g_option_context_new ("- record metrics for systemwide events");
+  g_option_context_add_main_entries (context, entries, NULL);
   if (!g_option_context_parse (context, &argc, &argv, &error))
     {
       g_printerr ("option parsing failed: %s\n", error->message);
       exit (1);
     }
 
-  session_by_user_id = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+  if (opt_dump_stats)
+    {
+      if (!dump_stats (&error))
+        {
+          g_printerr ("Failed to get statistics: %s\n", error->message);
+          exit (1);
+        }
+
+      return EXIT_SUCCESS;
+    }
+
+  const gchar *config_file_env = g_getenv (EINS_CONFIG_FILE_ENV);
+  if (config_file_env != NULL && *config_file_env != '\0')
+    config_file_path = config_file_env;
+
+  if (!eins_config_load (config_file_path, &error))
+    {
+      g_warning ("Failed to read %s; using the defaults: %s",
+                 config_file_path, error->message);
+      g_clear_error (&error);
+    }
+
+  session_by_user_id = g_hash_table_new_full (NULL, NULL, NULL,
+                                              (GDestroyNotify) session_free);
+
+  session_checkpoint = eins_session_checkpoint_open (SESSION_CHECKPOINT_FILE_PATH,
+                                                     &error);
+  if (session_checkpoint == NULL)
+    {
+      g_warning ("Failed to open " SESSION_CHECKPOINT_FILE_PATH ": %s",
+                 error->message);
+      g_clear_error (&error);
+    }
 
   GDBusProxy *systemd_dbus_proxy = systemd_dbus_proxy_new ();
-  GDBusProxy *login_dbus_proxy = login_dbus_proxy_new ();
+  login_dbus_proxy = login_dbus_proxy_new ();
+
+  main_loop = g_main_loop_new (NULL, TRUE);
 
-  GMainLoop *main_loop = g_main_loop_new (NULL, TRUE);
+  eins_stats_start ();
+  update_collectors ();
 
-  eins_hwinfo_start ();
+  /* In case startup finished before the daemon started. */
+  eins_boot_blame_collect ();
 
-  g_unix_signal_add (SIGHUP, (GSourceFunc) quit_main_loop, main_loop);
+  update_checkpoint_interval ();
+
+  g_unix_signal_add (SIGHUP, reload_config, NULL);
   g_unix_signal_add (SIGINT, (GSourceFunc) quit_main_loop, main_loop);
   g_unix_signal_add (SIGTERM, (GSourceFunc) quit_main_loop, main_loop);
   g_unix_signal_add (SIGUSR1, (GSourceFunc) quit_main_loop, main_loop);
   g_unix_signal_add (SIGUSR2, (GSourceFunc) quit_main_loop, main_loop);
 
+  update_idle_exit ();
   g_main_loop_run (main_loop);
 
   /*
@@ -307,8 +740,14 @@ main (gint  argc,
    */
   g_hash_table_remove_all (session_by_user_id);
   g_hash_table_unref (session_by_user_id);
+  g_clear_pointer (&session_checkpoint, eins_session_checkpoint_free);
+
+  /* Wait for the timers' final messages to be written. */
+  eins_recorder_flush_sync ();
 
-  g_main_loop_unref (main_loop);
+  if (idle_exit_source_id != 0)
+    g_source_remove (idle_exit_source_id);
+  g_clear_pointer (&main_loop, g_main_loop_unref);
   g_clear_object (&systemd_dbus_proxy);
   g_clear_object (&login_dbus_proxy);
 
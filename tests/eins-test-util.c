@@ -0,0 +1,113 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-test-util.h"
+
+#include <stdio.h>
+#include <glib/gstdio.h>
+
+/**
+ * eins_test_write_file:
+ * @dir: directory of the file, which is created if needed
+ * @name: name of the file
+ * @contents: what to write to it
+ *
+ * Rewrites the file in place rather than replacing it, so that code under
+ * test which keeps it open, as for sysfs attributes, sees the new contents.
+ */
+void
+eins_test_write_file (const gchar *dir,
+                      const gchar *name,
+                      const gchar *contents)
+{
+  g_autofree gchar *path = g_build_filename (dir, name, NULL);
+  FILE *file;
+
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+
+  file = g_fopen (path, "w");
+  g_assert_nonnull (file);
+  g_assert_cmpint (fputs (contents, file), >=, 0);
+  g_assert_cmpint (fclose (file), ==, 0);
+}
+
+/**
+ * eins_test_rm_rf:
+ * @path: a file or directory
+ *
+ * Removes @path and everything below it. Symlinks are removed rather than
+ * followed, so that a fake tree linking to real directories is safe to
+ * remove.
+ */
+void
+eins_test_rm_rf (const gchar *path)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  if (!g_file_test (path, G_FILE_TEST_IS_SYMLINK) &&
+      (dir = g_dir_open (path, 0, NULL)) != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          g_autofree gchar *child = g_build_filename (path, name, NULL);
+
+          eins_test_rm_rf (child);
+        }
+
+      g_rmdir (path);
+    }
+  else
+    {
+      g_unlink (path);
+    }
+}
+
+/**
+ * eins_test_tmp_fixture_setup:
+ * @fixture: fixture to set up
+ * @name: name of the file
+ *
+ * Creates a temporary directory and sets @fixture->path to a file called
+ * @name in it, which is not created.
+ */
+void
+eins_test_tmp_fixture_setup (EinsTestTmpFixture *fixture,
+                             const gchar        *name)
+{
+  g_autoptr(GError) error = NULL;
+
+  fixture->tmpdir = g_dir_make_tmp ("eins-test-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->path = g_build_filename (fixture->tmpdir, name, NULL);
+}
+
+/**
+ * eins_test_tmp_fixture_teardown:
+ * @fixture: fixture to tear down
+ *
+ * Removes the temporary directory and everything the test left in it.
+ */
+void
+eins_test_tmp_fixture_teardown (EinsTestTmpFixture *fixture)
+{
+  eins_test_rm_rf (fixture->tmpdir);
+  g_clear_pointer (&fixture->path, g_free);
+  g_clear_pointer (&fixture->tmpdir, g_free);
+}
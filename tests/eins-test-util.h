@@ -0,0 +1,40 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+/* Helpers shared by the tests which build fake sysfs, procfs or cgroup
+ * trees in a temporary directory. */
+
+void eins_test_write_file (const gchar *dir,
+                           const gchar *name,
+                           const gchar *contents);
+void eins_test_rm_rf (const gchar *path);
+
+/* Fixture for the tests of modules which keep their state in a single
+ * file. */
+typedef struct {
+  gchar *tmpdir;
+  gchar *path;
+} EinsTestTmpFixture;
+
+void eins_test_tmp_fixture_setup (EinsTestTmpFixture *fixture,
+                                  const gchar        *name);
+void eins_test_tmp_fixture_teardown (EinsTestTmpFixture *fixture);
@@ -0,0 +1,181 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-app-launch.h"
+#include "eins-stats.h"
+
+static void
+test_parse_scope (void)
+{
+  const struct {
+    const gchar *scope_name;
+    const gchar *app_id;
+  } cases[] = {
+    { "app-gnome-org.gnome.Nautilus-4321.scope", "org.gnome.Nautilus" },
+    { "app-flatpak-com.endlessm.photos-1234.scope", "com.endlessm.photos" },
+    { "app-org.gnome.Terminal-99.scope", "org.gnome.Terminal" },
+    { "app-gnome-my\\x2dapp-12.scope", "my-app" },
+    { "app-gnome-firefox-1c9d8f.scope", "firefox" },
+    { "app--12.scope", NULL },
+    { "app-.scope", NULL },
+    { "app-org.gnome.Terminal@1.service", NULL },
+    { "session-2.scope", NULL },
+    { "dbus.service", NULL },
+  };
+
+  for (gsize i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      g_autofree gchar *app_id =
+        eins_app_launch_parse_scope (cases[i].scope_name);
+
+      g_assert_cmpstr (app_id, ==, cases[i].app_id);
+    }
+}
+
+static void
+test_summary (void)
+{
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) histogram = NULL;
+  const gchar *app_id;
+  guint64 count, sum, max;
+
+  g_assert_null (eins_app_launch_take_summary ());
+
+  eins_app_launch_add ("org.gnome.Nautilus", 1200 * 1000);
+  eins_app_launch_add ("org.gnome.Nautilus", 800 * 1000);
+
+  summary = g_variant_ref_sink (eins_app_launch_take_summary ());
+  g_assert_true (g_variant_is_of_type (summary,
+                                       G_VARIANT_TYPE ("a(s" EINS_HISTOGRAM_TYPE_STRING ")")));
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 1);
+
+  g_variant_get_child (summary, 0, "(&s@" EINS_HISTOGRAM_TYPE_STRING ")",
+                       &app_id, &histogram);
+  g_assert_cmpstr (app_id, ==, "org.gnome.Nautilus");
+  g_variant_get (histogram, "(ttt@au)", &count, &sum, &max, NULL);
+  g_assert_cmpuint (count, ==, 2);
+  g_assert_cmpuint (sum, ==, 2000);
+  g_assert_cmpuint (max, ==, 1200);
+
+  g_assert_null (eins_app_launch_take_summary ());
+}
+
+static void
+test_summary_bounded (void)
+{
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) other = NULL;
+  guint64 count;
+
+  for (guint i = 0; i < EINS_APP_LAUNCH_MAX_APPS + 10; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("com.example.App%u", i);
+
+      eins_app_launch_add (app_id, G_USEC_PER_SEC);
+    }
+
+  /* Apps which have been seen are still counted separately */
+  eins_app_launch_add ("com.example.App0", G_USEC_PER_SEC);
+
+  summary = g_variant_ref_sink (eins_app_launch_take_summary ());
+  g_assert_cmpuint (g_variant_n_children (summary), ==,
+                    EINS_APP_LAUNCH_MAX_APPS + 1);
+
+  for (gsize i = 0; i < g_variant_n_children (summary); i++)
+    {
+      g_autoptr(GVariant) histogram = NULL;
+      const gchar *app_id;
+
+      g_variant_get_child (summary, i, "(&s@" EINS_HISTOGRAM_TYPE_STRING ")",
+                           &app_id, &histogram);
+      g_variant_get (histogram, "(ttt@au)", &count, NULL, NULL, NULL);
+
+      if (*app_id == '\0')
+        other = g_steal_pointer (&histogram);
+      else if (g_strcmp0 (app_id, "com.example.App0") == 0)
+        g_assert_cmpuint (count, ==, 2);
+      else
+        g_assert_cmpuint (count, ==, 1);
+    }
+
+  g_assert_nonnull (other);
+  g_variant_get (other, "(ttt@au)", &count, NULL, NULL, NULL);
+  g_assert_cmpuint (count, ==, 10);
+}
+
+#define MS (G_USEC_PER_SEC / 1000)
+
+static void
+test_progress (void)
+{
+  EinsAppLaunchProgress progress;
+  gint64 duration_us = -1;
+
+  /* Busy for 500 ms, then idle */
+  eins_app_launch_progress_init (&progress, 1000 * MS);
+  g_assert_false (eins_app_launch_progress_update (&progress, 1250 * MS,
+                                                   200 * MS, 5, &duration_us));
+  g_assert_false (eins_app_launch_progress_update (&progress, 1500 * MS,
+                                                   400 * MS, 5, &duration_us));
+  g_assert_true (eins_app_launch_progress_update (&progress, 1750 * MS,
+                                                  405 * MS, 5, &duration_us));
+  g_assert_cmpint (duration_us, ==, 500 * MS);
+}
+
+static void
+test_progress_blocked_on_io (void)
+{
+  EinsAppLaunchProgress progress;
+  gint64 duration_us = -1;
+
+  /* Waiting for storage, using well under 5% of a CPU: not yet launched */
+  eins_app_launch_progress_init (&progress, 0);
+  g_assert_false (eins_app_launch_progress_update (&progress, 250 * MS,
+                                                   2 * MS, 5, &duration_us));
+  g_assert_false (eins_app_launch_progress_update (&progress, 500 * MS,
+                                                   4 * MS, 5, &duration_us));
+  g_assert_false (eins_app_launch_progress_update (&progress, 750 * MS,
+                                                   4 * MS, 5, &duration_us));
+
+  /* Then doing its work */
+  g_assert_false (eins_app_launch_progress_update (&progress, 1000 * MS,
+                                                   150 * MS, 5, &duration_us));
+  g_assert_cmpint (duration_us, ==, -1);
+
+  g_assert_true (eins_app_launch_progress_update (&progress, 1250 * MS,
+                                                  151 * MS, 5, &duration_us));
+  g_assert_cmpint (duration_us, ==, 1000 * MS);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/app-launch/parse-scope", test_parse_scope);
+  g_test_add_func ("/app-launch/summary", test_summary);
+  g_test_add_func ("/app-launch/summary/bounded", test_summary_bounded);
+  g_test_add_func ("/app-launch/progress", test_progress);
+  g_test_add_func ("/app-launch/progress/blocked-on-io",
+                   test_progress_blocked_on_io);
+
+  return g_test_run ();
+}
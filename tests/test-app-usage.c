@@ -0,0 +1,234 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-app-usage.h"
+#include "eins-test-util.h"
+
+#include <stdio.h>
+#include <glib/gstdio.h>
+
+/* Rewrites the file in place, as the daemon keeps it open */
+static void
+write_scope (const gchar *path,
+             guint64      usage_us,
+             guint64      memory_peak)
+{
+  g_autofree gchar *cpu_path = g_build_filename (path, "cpu.stat", NULL);
+  g_autofree gchar *memory_path = g_build_filename (path, "memory.peak", NULL);
+  FILE *file;
+
+  g_assert_cmpint (g_mkdir_with_parents (path, 0755), ==, 0);
+
+  file = g_fopen (cpu_path, "w");
+  g_assert_nonnull (file);
+  fprintf (file, "usage_usec %" G_GUINT64_FORMAT "\nuser_usec 0\n"
+           "system_usec 0\n", usage_us);
+  fclose (file);
+
+  file = g_fopen (memory_path, "w");
+  g_assert_nonnull (file);
+  fprintf (file, "%" G_GUINT64_FORMAT "\n", memory_peak);
+  fclose (file);
+}
+
+static void
+assert_summary_has (GVariant    *summary,
+                    const gchar *app,
+                    guint64      cpu_ms,
+                    guint64      memory_peak,
+                    guint32      n_instances)
+{
+  for (gsize i = 0; i < g_variant_n_children (summary); i++)
+    {
+      const gchar *actual_app;
+      guint64 actual_cpu_ms, actual_memory_peak;
+      guint32 actual_n_instances;
+
+      g_variant_get_child (summary, i, "(&sttu)", &actual_app, &actual_cpu_ms,
+                           &actual_memory_peak, &actual_n_instances);
+      if (g_strcmp0 (actual_app, app) == 0)
+        {
+          g_assert_cmpuint (actual_cpu_ms, ==, cpu_ms);
+          g_assert_cmpuint (actual_memory_peak, ==, memory_peak);
+          g_assert_cmpuint (actual_n_instances, ==, n_instances);
+          return;
+        }
+    }
+
+  g_assert_not_reached ();
+}
+
+static void
+test_sample (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *slice = NULL;
+  g_autofree gchar *app_slice = NULL;
+  g_autofree gchar *first = NULL;
+  g_autofree gchar *second = NULL;
+  g_autofree gchar *terminal = NULL;
+  g_autofree gchar *service = NULL;
+  g_autoptr(GVariant) summary = NULL;
+  g_auto(GStrv) flatpak_apps = NULL;
+
+  root = g_dir_make_tmp ("test-app-usage-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  slice = g_build_filename (root, "user.slice", NULL);
+  app_slice = g_build_filename (slice, "user-1000.slice", "user@1000.service",
+                                "app.slice", NULL);
+  first = g_build_filename (app_slice, "app-gnome-org.gnome.Calculator-12.scope",
+                            NULL);
+  second = g_build_filename (app_slice, "app-gnome-org.gnome.Calculator-34.scope",
+                             NULL);
+  terminal = g_build_filename (app_slice,
+                               "app-flatpak-org.gnome.Terminal-56.scope", NULL);
+  service = g_build_filename (app_slice, "dbus.service", NULL);
+
+  /* CPU time used before the first sample is not counted */
+  write_scope (first, 5 * G_USEC_PER_SEC, 1000);
+  write_scope (service, 5 * G_USEC_PER_SEC, 1000);
+  eins_app_usage_sample (slice);
+
+  summary = g_variant_ref_sink (eins_app_usage_take_summary (&flatpak_apps));
+  g_assert_true (g_variant_is_of_type (summary, G_VARIANT_TYPE ("a(sttu)")));
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 1);
+  assert_summary_has (summary, "org.gnome.Calculator", 0, 1000, 1);
+  g_assert_cmpuint (g_strv_length (flatpak_apps), ==, 0);
+
+  /* Instances of the same app are added together */
+  write_scope (first, 7500 * 1000, 3000);
+  write_scope (second, G_USEC_PER_SEC, 2000);
+  write_scope (terminal, 250 * 1000, 500);
+  eins_app_usage_sample (slice);
+
+  g_clear_pointer (&summary, g_variant_unref);
+  g_clear_pointer (&flatpak_apps, g_strfreev);
+  summary = g_variant_ref_sink (eins_app_usage_take_summary (&flatpak_apps));
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 2);
+  assert_summary_has (summary, "org.gnome.Calculator", 3500, 3000, 1);
+  assert_summary_has (summary, "org.gnome.Terminal", 250, 500, 1);
+  g_assert_cmpuint (g_strv_length (flatpak_apps), ==, 1);
+  g_assert_cmpstr (flatpak_apps[0], ==, "org.gnome.Terminal");
+
+  /* A scope which has gone away is forgotten */
+  eins_test_rm_rf (first);
+  write_scope (second, 2 * G_USEC_PER_SEC, 2000);
+  eins_app_usage_sample (slice);
+
+  g_clear_pointer (&summary, g_variant_unref);
+  g_clear_pointer (&flatpak_apps, g_strfreev);
+  summary = g_variant_ref_sink (eins_app_usage_take_summary (&flatpak_apps));
+  assert_summary_has (summary, "org.gnome.Calculator", 1000, 2000, 0);
+  assert_summary_has (summary, "org.gnome.Terminal", 0, 500, 0);
+
+  /* …and if it comes back, it counts from zero */
+  write_scope (first, 100 * 1000, 100);
+  eins_app_usage_sample (slice);
+
+  g_clear_pointer (&summary, g_variant_unref);
+  g_clear_pointer (&flatpak_apps, g_strfreev);
+  summary = g_variant_ref_sink (eins_app_usage_take_summary (&flatpak_apps));
+  assert_summary_has (summary, "org.gnome.Calculator", 100, 2000, 1);
+
+  eins_test_rm_rf (root);
+}
+
+static void
+test_summary_bounded (void)
+{
+  g_autoptr(GVariant) summary = NULL;
+  g_auto(GStrv) flatpak_apps = NULL;
+
+  g_assert_null (eins_app_usage_take_summary (&flatpak_apps));
+  g_assert_null (flatpak_apps);
+
+  for (guint i = 0; i < EINS_APP_USAGE_MAX_APPS + 10; i++)
+    {
+      g_autofree gchar *app = g_strdup_printf ("com.example.App%u", i);
+
+      eins_app_usage_add (app, TRUE, G_USEC_PER_SEC, i, TRUE);
+    }
+
+  /* Apps which have been seen are still counted separately */
+  eins_app_usage_add ("com.example.App0", TRUE, G_USEC_PER_SEC, 0, FALSE);
+
+  summary = g_variant_ref_sink (eins_app_usage_take_summary (&flatpak_apps));
+  g_assert_cmpuint (g_variant_n_children (summary), ==,
+                    EINS_APP_USAGE_MAX_APPS + 1);
+  assert_summary_has (summary, "com.example.App0", 2000, 0, 1);
+
+  assert_summary_has (summary, "", 10000, EINS_APP_USAGE_MAX_APPS + 9, 10);
+
+  /* There is no ref to look up for the rest */
+  g_assert_cmpuint (g_strv_length (flatpak_apps), ==, EINS_APP_USAGE_MAX_APPS);
+  g_assert_false (g_strv_contains ((const gchar * const *) flatpak_apps, ""));
+}
+
+static void
+test_apply_refs (void)
+{
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) refs = NULL;
+  g_autoptr(GVariant) with_refs = NULL;
+  g_auto(GStrv) flatpak_apps = NULL;
+
+  eins_app_usage_add ("org.gnome.Calculator", TRUE, G_USEC_PER_SEC, 1000,
+                      TRUE);
+  eins_app_usage_add ("org.example.User", TRUE, G_USEC_PER_SEC, 2000, TRUE);
+  eins_app_usage_add ("org.gnome.Terminal", FALSE, G_USEC_PER_SEC, 3000, TRUE);
+  /* From a scope named app-flatpak---help-1.scope, which any user can
+   * create; it must not reach the helper's command line */
+  eins_app_usage_add ("--help", TRUE, G_USEC_PER_SEC, 4000, TRUE);
+
+  summary = g_variant_ref_sink (eins_app_usage_take_summary (&flatpak_apps));
+  g_assert_cmpuint (g_strv_length (flatpak_apps), ==, 2);
+  g_assert_true (g_strv_contains ((const gchar * const *) flatpak_apps,
+                                  "org.gnome.Calculator"));
+  g_assert_true (g_strv_contains ((const gchar * const *) flatpak_apps,
+                                  "org.example.User"));
+
+  /* As eos-metrics-collect flatpak-refs reports them; org.example.User is
+   * installed per-user, so it has no ref in the system installation */
+  refs = g_variant_ref_sink (g_variant_new_parsed (
+    "{'org.gnome.Calculator': 'app/org.gnome.Calculator/x86_64/stable'}"));
+
+  with_refs = g_variant_ref_sink (eins_app_usage_apply_refs (summary, refs));
+  g_assert_true (g_variant_is_of_type (with_refs, G_VARIANT_TYPE ("a(sttu)")));
+  g_assert_cmpuint (g_variant_n_children (with_refs), ==, 4);
+  assert_summary_has (with_refs, "app/org.gnome.Calculator/x86_64/stable",
+                      1000, 1000, 1);
+  assert_summary_has (with_refs, "org.example.User", 1000, 2000, 1);
+  assert_summary_has (with_refs, "org.gnome.Terminal", 1000, 3000, 1);
+  assert_summary_has (with_refs, "--help", 1000, 4000, 1);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/app-usage/sample", test_sample);
+  g_test_add_func ("/app-usage/summary/bounded", test_summary_bounded);
+  g_test_add_func ("/app-usage/summary/refs", test_apply_refs);
+
+  return g_test_run ();
+}
@@ -0,0 +1,228 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-battery.h"
+#include "eins-test-util.h"
+
+static void
+test_percentile (void)
+{
+  EinsBatterySummary summary = { 0 };
+
+  g_assert_cmpuint (eins_battery_summary_percentile (&summary, 50), ==, 0);
+
+  for (guint i = 0; i < 90; i++)
+    eins_battery_summary_add (&summary, 6250);
+  for (guint i = 0; i < 9; i++)
+    eins_battery_summary_add (&summary, 15000);
+  eins_battery_summary_add (&summary, 250000);
+
+  g_assert_cmpuint (summary.n_samples, ==, 100);
+  g_assert_cmpuint (eins_battery_summary_percentile (&summary, 50), ==, 6200);
+  g_assert_cmpuint (eins_battery_summary_percentile (&summary, 90), ==, 6200);
+  g_assert_cmpuint (eins_battery_summary_percentile (&summary, 99), ==, 15000);
+  g_assert_cmpuint (eins_battery_summary_percentile (&summary, 100), ==, 99900);
+}
+
+static void
+assert_battery (GVariant    *summary,
+                gsize        index,
+                const gchar *name,
+                guint16      health_permille,
+                guint32      cycle_count,
+                guint32      n_samples,
+                guint32      p50)
+{
+  const gchar *actual_name;
+  guint16 actual_health_permille;
+  guint32 actual_cycle_count, actual_n_samples, actual_p50;
+
+  g_variant_get_child (summary, index, "(&squuuuu)", &actual_name,
+                       &actual_health_permille, &actual_cycle_count,
+                       &actual_n_samples, &actual_p50, NULL, NULL);
+  g_assert_cmpstr (actual_name, ==, name);
+  g_assert_cmpuint (actual_health_permille, ==, health_permille);
+  g_assert_cmpuint (actual_cycle_count, ==, cycle_count);
+  g_assert_cmpuint (actual_n_samples, ==, n_samples);
+  g_assert_cmpuint (actual_p50, ==, p50);
+}
+
+static void
+test_sample (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *supplies = NULL;
+  g_autofree gchar *bat0 = NULL;
+  g_autofree gchar *bat1 = NULL;
+  g_autofree gchar *ac = NULL;
+  g_autofree gchar *mouse = NULL;
+  g_autofree gchar *store = NULL;
+  g_autoptr(GVariant) summary = NULL;
+
+  root = g_dir_make_tmp ("test-battery-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  supplies = g_build_filename (root, "class", "power_supply", NULL);
+  bat0 = g_build_filename (supplies, "BAT0", NULL);
+  bat1 = g_build_filename (supplies, "BAT1", NULL);
+  ac = g_build_filename (supplies, "AC", NULL);
+  mouse = g_build_filename (supplies, "hidpp_battery_0", NULL);
+  store = g_build_filename (root, "battery-samples", NULL);
+
+  /* Reports energy and power */
+  eins_test_write_file (bat0, "type", "Battery\n");
+  eins_test_write_file (bat0, "status", "Discharging\n");
+  eins_test_write_file (bat0, "energy_full", "40000000\n");
+  eins_test_write_file (bat0, "energy_full_design", "50000000\n");
+  eins_test_write_file (bat0, "cycle_count", "321\n");
+  eins_test_write_file (bat0, "power_now", "8500000\n");
+
+  /* Reports charge and current, negative while discharging */
+  eins_test_write_file (bat1, "type", "Battery\n");
+  eins_test_write_file (bat1, "status", "Charging\n");
+  eins_test_write_file (bat1, "charge_full", "3000000\n");
+  eins_test_write_file (bat1, "charge_full_design", "4000000\n");
+  eins_test_write_file (bat1, "current_now", "-1000000\n");
+  eins_test_write_file (bat1, "voltage_now", "12000000\n");
+
+  eins_test_write_file (ac, "type", "Mains\n");
+  eins_test_write_file (ac, "online", "0\n");
+  eins_test_write_file (mouse, "type", "Battery\n");
+  eins_test_write_file (mouse, "scope", "Device\n");
+  eins_test_write_file (mouse, "status", "Discharging\n");
+
+  g_assert_true (eins_battery_open (root, store));
+  g_assert_true (eins_battery_sample ());
+
+  summary = g_variant_ref_sink (eins_battery_take_summary ());
+  g_assert_true (g_variant_is_of_type (summary,
+                                       G_VARIANT_TYPE ("a(squuuuu)")));
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 2);
+  assert_battery (summary, 0, "BAT0", 800, 321, 1, 8500);
+  assert_battery (summary, 1, "BAT1", 750, 0, 0, 0);
+
+  /* Unplugged */
+  eins_test_write_file (bat1, "status", "Discharging\n");
+  g_assert_true (eins_battery_sample ());
+  eins_test_write_file (bat0, "status", "Full\n");
+  eins_test_write_file (bat1, "status", "Full\n");
+  g_assert_false (eins_battery_sample ());
+
+  g_clear_pointer (&summary, g_variant_unref);
+  summary = g_variant_ref_sink (eins_battery_take_summary ());
+  assert_battery (summary, 0, "BAT0", 800, 321, 1, 8500);
+  assert_battery (summary, 1, "BAT1", 750, 0, 1, 12000);
+
+  eins_battery_close ();
+  eins_test_rm_rf (root);
+}
+
+static void
+test_restart (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *bat0 = NULL;
+  g_autofree gchar *bat1 = NULL;
+  g_autofree gchar *store = NULL;
+  g_autoptr(GVariant) summary = NULL;
+
+  root = g_dir_make_tmp ("test-battery-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  bat0 = g_build_filename (root, "class", "power_supply", "BAT0", NULL);
+  bat1 = g_build_filename (root, "class", "power_supply", "BAT1", NULL);
+  store = g_build_filename (root, "battery-samples", NULL);
+
+  eins_test_write_file (bat0, "type", "Battery\n");
+  eins_test_write_file (bat0, "status", "Discharging\n");
+  eins_test_write_file (bat0, "power_now", "8500000\n");
+
+  g_assert_true (eins_battery_open (root, store));
+  g_assert_true (eins_battery_sample ());
+  g_assert_true (eins_battery_sample ());
+  eins_battery_close ();
+
+  /* The samples taken before the restart are kept */
+  eins_test_write_file (bat0, "power_now", "4000000\n");
+  g_assert_true (eins_battery_open (root, store));
+  g_assert_true (eins_battery_sample ());
+
+  summary = g_variant_ref_sink (eins_battery_take_summary ());
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 1);
+  assert_battery (summary, 0, "BAT0", 0, 0, 3, 8500);
+  eins_battery_close ();
+
+  /* ...but not those of a battery which is gone */
+  eins_test_write_file (bat1, "type", "Battery\n");
+  eins_test_write_file (bat1, "status", "Discharging\n");
+  eins_test_write_file (bat1, "power_now", "6000000\n");
+  g_assert_true (eins_battery_open (root, store));
+  g_assert_true (eins_battery_sample ());
+  eins_battery_close ();
+
+  eins_test_rm_rf (bat1);
+  g_assert_true (eins_battery_open (root, store));
+  eins_battery_close ();
+
+  eins_test_write_file (bat1, "type", "Battery\n");
+  eins_test_write_file (bat1, "status", "Discharging\n");
+  g_assert_true (eins_battery_open (root, store));
+  g_clear_pointer (&summary, g_variant_unref);
+  summary = g_variant_ref_sink (eins_battery_take_summary ());
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 2);
+  assert_battery (summary, 0, "BAT0", 0, 0, 1, 4000);
+  assert_battery (summary, 1, "BAT1", 0, 0, 0, 0);
+  eins_battery_close ();
+
+  eins_test_rm_rf (root);
+}
+
+static void
+test_no_battery (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *ac = NULL;
+
+  root = g_dir_make_tmp ("test-battery-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  ac = g_build_filename (root, "class", "power_supply", "AC", NULL);
+  eins_test_write_file (ac, "type", "Mains\n");
+
+  g_assert_false (eins_battery_open (root, NULL));
+  eins_battery_close ();
+  eins_test_rm_rf (root);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/battery/percentile", test_percentile);
+  g_test_add_func ("/battery/sample", test_sample);
+  g_test_add_func ("/battery/restart", test_restart);
+  g_test_add_func ("/battery/no-battery", test_no_battery);
+
+  return g_test_run ();
+}
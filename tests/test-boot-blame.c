@@ -0,0 +1,129 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "eins-boot-blame.h"
+
+static void
+add_unit (GPtrArray   *units,
+          const gchar *name,
+          guint64      activating_ms,
+          guint64      activated_ms,
+          const gchar *after)
+{
+  EinsBootUnit *unit = g_new0 (EinsBootUnit, 1);
+
+  unit->name = g_strdup (name);
+  unit->activating = activating_ms * 1000;
+  unit->activated = activated_ms * 1000;
+  unit->after = after != NULL ? g_strsplit (after, " ", -1) : NULL;
+  g_ptr_array_add (units, unit);
+}
+
+static GPtrArray *
+make_units (void)
+{
+  GPtrArray *units =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) eins_boot_unit_free);
+
+  /* Userspace starts at 1000ms. */
+  add_unit (units, "sysinit.target", 1500, 1500, "systemd-udevd.service");
+  add_unit (units, "systemd-udevd.service", 1100, 1500, NULL);
+  add_unit (units, "basic.target", 1600, 1600, "sysinit.target");
+  add_unit (units, "slow.service", 1600, 4600,
+            "basic.target missing.service");
+  add_unit (units, "quick.service", 1600, 1700, "basic.target");
+  /* Became active after graphical.target started, so can't have blocked it */
+  add_unit (units, "late.service", 5000, 9000, "basic.target");
+  add_unit (units, "never-started.service", 0, 0, "basic.target");
+  add_unit (units, "graphical.target", 4600, 4600,
+            "slow.service quick.service late.service never-started.service");
+
+  return units;
+}
+
+static void
+test_compute (void)
+{
+  g_autoptr(GPtrArray) units = make_units ();
+  g_autoptr(GVariant) payload = NULL;
+  g_autofree gchar *printed = NULL;
+
+  payload = g_variant_ref_sink (eins_boot_blame_compute (units,
+                                                         "graphical.target",
+                                                         1000 * 1000, 3));
+  printed = g_variant_print (payload, FALSE);
+
+  g_assert_cmpstr (printed, ==,
+                   "(["
+                   "('late.service', 4000), "
+                   "('slow.service', 3000), "
+                   "('systemd-udevd.service', 400)"
+                   "], ["
+                   "('graphical.target', 3600, 0), "
+                   "('slow.service', 3600, 3000), "
+                   "('basic.target', 600, 0), "
+                   "('sysinit.target', 500, 0), "
+                   "('systemd-udevd.service', 500, 400)"
+                   "])");
+}
+
+static void
+test_cycle (void)
+{
+  g_autoptr(GPtrArray) units =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) eins_boot_unit_free);
+  g_autoptr(GVariant) payload = NULL;
+  g_autoptr(GVariant) chain = NULL;
+
+  add_unit (units, "a.target", 10, 10, "b.service");
+  add_unit (units, "b.service", 5, 10, "a.target");
+
+  payload = g_variant_ref_sink (eins_boot_blame_compute (units, "a.target",
+                                                         0, 10));
+  chain = g_variant_get_child_value (payload, 1);
+  g_assert_cmpuint (g_variant_n_children (chain), ==, 2);
+}
+
+static void
+test_missing_target (void)
+{
+  g_autoptr(GPtrArray) units = make_units ();
+  g_autoptr(GVariant) payload = NULL;
+  g_autoptr(GVariant) chain = NULL;
+
+  payload = g_variant_ref_sink (eins_boot_blame_compute (units,
+                                                         "multi-user.target",
+                                                         0, 10));
+  chain = g_variant_get_child_value (payload, 1);
+  g_assert_cmpuint (g_variant_n_children (chain), ==, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/boot-blame/compute", test_compute);
+  g_test_add_func ("/boot-blame/cycle", test_cycle);
+  g_test_add_func ("/boot-blame/missing-target", test_missing_target);
+
+  return g_test_run ();
+}
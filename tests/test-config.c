@@ -0,0 +1,152 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-config.h"
+
+#include <glib/gstdio.h>
+
+static gchar *
+write_config (const gchar *contents)
+{
+  g_autoptr(GError) error = NULL;
+  gchar *path = NULL;
+  int fd;
+
+  fd = g_file_open_tmp ("test-config-XXXXXX.conf", &path, &error);
+  g_assert_no_error (error);
+  g_close (fd, NULL);
+
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+
+  return path;
+}
+
+static void
+test_defaults (void)
+{
+  g_autoptr(GError) error = NULL;
+
+  /* Nothing loaded yet */
+  g_assert_true (eins_config_get_boolean ("psi", "enabled", TRUE));
+  g_assert_cmpuint (eins_config_get_uint64 ("psi", "interval", 86400), ==,
+                    86400);
+
+  g_assert_true (eins_config_load ("/nonexistent/instrumentation.conf",
+                                   &error));
+  g_assert_no_error (error);
+  g_assert_false (eins_config_get_boolean ("psi", "enabled", FALSE));
+  g_assert_cmpuint (eins_config_get_uint64 ("psi", "interval", 3600), ==,
+                    3600);
+}
+
+static void
+test_values (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+
+  path = write_config ("[psi]\n"
+                       "enabled=false\n"
+                       "interval=3600\n"
+                       "jitter=many\n"
+                       "[app-launch]\n"
+                       "idle-percent=150\n"
+                       "timeout=30\n"
+                       "colour=blue\n");
+
+  /* Invalid values are warned about once, when the file is read */
+  g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+                         "Ignoring [psi] jitter in *");
+  g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+                         "Ignoring [app-launch] idle-percent in *: 150 is "
+                         "more than 100");
+  g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+                         "Ignoring unknown key [app-launch] colour in *");
+  g_assert_true (eins_config_load (path, &error));
+  g_assert_no_error (error);
+  g_test_assert_expected_messages ();
+
+  g_assert_false (eins_config_get_boolean ("psi", "enabled", TRUE));
+  g_assert_cmpuint (eins_config_get_uint64 ("psi", "interval", 86400), ==,
+                    3600);
+  g_assert_true (eins_config_get_boolean ("thermal", "enabled", TRUE));
+  g_assert_cmpuint (eins_config_get_uint64 ("app-launch", "timeout", 10), ==,
+                    30);
+
+  /* …and fall back to the default, without warning again each time they
+   * are looked up */
+  for (guint i = 0; i < 2; i++)
+    {
+      g_assert_cmpuint (eins_config_get_uint64 ("psi", "jitter", 0), ==, 0);
+      g_assert_cmpuint (eins_config_get_uint64 ("app-launch", "idle-percent",
+                                                10), ==, 10);
+    }
+
+  g_unlink (path);
+}
+
+static void
+test_reload (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+
+  path = write_config ("[thermal]\nmin-samples=10\n");
+  g_assert_true (eins_config_load (path, &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (eins_config_get_uint64 ("thermal", "min-samples", 60), ==,
+                    10);
+
+  g_file_set_contents (path, "[thermal]\nmin-samples=20\n", -1, &error);
+  g_assert_no_error (error);
+  g_assert_true (eins_config_reload (&error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (eins_config_get_uint64 ("thermal", "min-samples", 60), ==,
+                    20);
+
+  /* A file which can't be parsed leaves the last configuration in place */
+  g_file_set_contents (path, "min-samples=30\n", -1, &error);
+  g_assert_no_error (error);
+  g_assert_false (eins_config_reload (&error));
+  g_assert_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND);
+  g_assert_cmpuint (eins_config_get_uint64 ("thermal", "min-samples", 60), ==,
+                    20);
+
+  /* A file which has been removed is as if it had never existed */
+  g_clear_error (&error);
+  g_unlink (path);
+  g_assert_true (eins_config_reload (&error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (eins_config_get_uint64 ("thermal", "min-samples", 60), ==,
+                    60);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/config/defaults", test_defaults);
+  g_test_add_func ("/config/values", test_values);
+  g_test_add_func ("/config/reload", test_reload);
+
+  return g_test_run ();
+}
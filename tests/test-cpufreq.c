@@ -0,0 +1,156 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-cpufreq.h"
+#include "eins-test-util.h"
+
+#define BOOT_ID "5c8a1d7e-2d3b-4b7e-9f0a-1b2c3d4e5f60"
+#define OTHER_BOOT_ID "0f6e5d4c-3b2a-4190-8f7e-6d5c4b3a2910"
+
+static void
+write_policy (const gchar *root,
+              const gchar *name,
+              const gchar *max_freq,
+              const gchar *time_in_state,
+              const gchar *total_trans)
+{
+  g_autofree gchar *policy = g_build_filename (root, "devices", "system",
+                                               "cpu", "cpufreq", name, NULL);
+  g_autofree gchar *stats = g_build_filename (policy, "stats", NULL);
+
+  eins_test_write_file (policy, "cpuinfo_max_freq", max_freq);
+
+  if (time_in_state != NULL)
+    {
+      eins_test_write_file (stats, "time_in_state", time_in_state);
+      eins_test_write_file (stats, "total_trans", total_trans);
+    }
+}
+
+static void
+assert_policy (GVariant      *residency,
+               gsize          index,
+               guint16        policy,
+               guint16        max_mhz,
+               const guint64  bands[EINS_CPUFREQ_N_BANDS],
+               guint64        transitions)
+{
+  g_autoptr(GVariant) actual_bands = NULL;
+  const guint64 *actual;
+  guint16 actual_policy, actual_max_mhz;
+  guint64 actual_transitions;
+  gsize n_bands;
+
+  g_variant_get_child (residency, index, "(qq@att)", &actual_policy,
+                       &actual_max_mhz, &actual_bands, &actual_transitions);
+  g_assert_cmpuint (actual_policy, ==, policy);
+  g_assert_cmpuint (actual_max_mhz, ==, max_mhz);
+  g_assert_cmpuint (actual_transitions, ==, transitions);
+
+  actual = g_variant_get_fixed_array (actual_bands, &n_bands,
+                                      sizeof (guint64));
+  g_assert_cmpmem (actual, n_bands * sizeof (guint64),
+                   bands, EINS_CPUFREQ_N_BANDS * sizeof (guint64));
+}
+
+static void
+test_residency (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autoptr(GVariant) boot = NULL;
+  g_autoptr(GVariant) day = NULL;
+  g_autoptr(GVariant) next_boot = NULL;
+  g_autoptr(GVariant) residency = NULL;
+  const guint64 boot_bands[EINS_CPUFREQ_N_BANDS] = {
+    1000, 0, 0, 200, 0, 0, 0, 50,
+  };
+  const guint64 little_bands[EINS_CPUFREQ_N_BANDS] = {
+    0, 0, 0, 0, 0, 0, 0, 300,
+  };
+  const guint64 day_bands[EINS_CPUFREQ_N_BANDS] = {
+    500, 0, 0, 0, 0, 0, 0, 100,
+  };
+
+  root = g_dir_make_tmp ("test-cpufreq-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  /* 2 GHz, with a boost frequency above the nominal maximum */
+  write_policy (root, "policy0", "2000000\n",
+                "200000 100\n800000 20\n2000000 3\n2400000 2\n", "40\n");
+  /* Sorted numerically, not alphabetically */
+  write_policy (root, "policy10", "1000000\n", "1000000 30\n", "0\n");
+  /* No statistics */
+  write_policy (root, "policy4", "1800000\n", NULL, NULL);
+
+  boot = g_variant_ref_sink (eins_cpufreq_read_snapshot (root, BOOT_ID));
+  g_assert_true (g_variant_is_of_type (boot,
+                                       G_VARIANT_TYPE (EINS_CPUFREQ_SNAPSHOT_TYPE_STRING)));
+
+  residency = g_variant_ref_sink (eins_cpufreq_compute_residency (NULL, boot));
+  g_assert_true (g_variant_is_of_type (residency,
+                                       G_VARIANT_TYPE (EINS_CPUFREQ_TYPE_STRING)));
+  g_assert_cmpuint (g_variant_n_children (residency), ==, 2);
+  assert_policy (residency, 0, 0, 2000, boot_bands, 40);
+  assert_policy (residency, 1, 10, 1000, little_bands, 0);
+
+  /* A day later, in the same boot */
+  write_policy (root, "policy0", "2000000\n",
+                "200000 150\n800000 20\n2000000 13\n2400000 2\n", "52\n");
+  day = g_variant_ref_sink (eins_cpufreq_read_snapshot (root, BOOT_ID));
+
+  g_clear_pointer (&residency, g_variant_unref);
+  residency = g_variant_ref_sink (eins_cpufreq_compute_residency (boot, day));
+  assert_policy (residency, 0, 0, 2000, day_bands, 12);
+
+  /* After a reboot, the counters start again */
+  next_boot = g_variant_ref_sink (eins_cpufreq_read_snapshot (root,
+                                                              OTHER_BOOT_ID));
+  g_clear_pointer (&residency, g_variant_unref);
+  residency = g_variant_ref_sink (eins_cpufreq_compute_residency (day,
+                                                                  next_boot));
+  assert_policy (residency, 1, 10, 1000, little_bands, 0);
+
+  eins_test_rm_rf (root);
+}
+
+static void
+test_no_cpufreq (void)
+{
+  g_autoptr(GVariant) snapshot = NULL;
+  g_autoptr(GVariant) residency = NULL;
+
+  snapshot = g_variant_ref_sink (eins_cpufreq_read_snapshot ("/nonexistent",
+                                                             BOOT_ID));
+  residency = g_variant_ref_sink (eins_cpufreq_compute_residency (NULL,
+                                                                  snapshot));
+  g_assert_cmpuint (g_variant_n_children (residency), ==, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/cpufreq/residency", test_residency);
+  g_test_add_func ("/cpufreq/no-cpufreq", test_no_cpufreq);
+
+  return g_test_run ();
+}
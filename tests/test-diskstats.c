@@ -0,0 +1,147 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-diskstats.h"
+
+static void
+test_parse (void)
+{
+  EinsDiskstatsLine line;
+
+  /* Linux 5.5 and later, with discard and flush fields */
+  g_assert_true (eins_diskstats_parse_line (" 179       0 mmcblk0 25345 5310 1842396 40172 "
+                                            "9843 11277 469440 80132 0 46348 130320 "
+                                            "0 0 0 0 1268 9996",
+                                            &line));
+  g_assert_cmpstr (line.name, ==, "mmcblk0");
+  g_assert_cmpuint (line.reads, ==, 25345);
+  g_assert_cmpuint (line.sectors_read, ==, 1842396);
+  g_assert_cmpuint (line.read_ms, ==, 40172);
+  g_assert_cmpuint (line.writes, ==, 9843);
+  g_assert_cmpuint (line.sectors_written, ==, 469440);
+  g_assert_cmpuint (line.write_ms, ==, 80132);
+  g_assert_cmpuint (line.io_ticks_ms, ==, 46348);
+
+  /* Older kernels only have the first 11 fields */
+  g_assert_true (eins_diskstats_parse_line ("   8       0 sda 1 2 3 4 5 6 7 8 9 10 11",
+                                            &line));
+  g_assert_cmpstr (line.name, ==, "sda");
+  g_assert_cmpuint (line.io_ticks_ms, ==, 10);
+
+  g_assert_false (eins_diskstats_parse_line ("", &line));
+  g_assert_false (eins_diskstats_parse_line ("   8       0 sda 1 2 3", &line));
+}
+
+static void
+test_interval (void)
+{
+  EinsDiskstatsInterval interval;
+  EinsDiskstatsLine previous = { "sda", 100, 800, 50, 10, 80, 20, 1000 };
+  EinsDiskstatsLine current = previous;
+
+  /* 30 requests taking 3 ms on average, busy for 6 s of a minute */
+  current.reads += 20;
+  current.sectors_read += 16;
+  current.read_ms += 40;
+  current.writes += 10;
+  current.sectors_written += 8;
+  current.write_ms += 50;
+  current.io_ticks_ms += 6000;
+
+  g_assert_true (eins_diskstats_interval (&previous, &current,
+                                          60 * G_USEC_PER_SEC, &interval));
+  g_assert_cmpuint (interval.util_permille, ==, 100);
+  g_assert_cmpuint (interval.latency_us, ==, 3000);
+  g_assert_cmpuint (interval.bytes_read, ==, 8192);
+  g_assert_cmpuint (interval.bytes_written, ==, 4096);
+
+  /* Nothing happened */
+  g_assert_true (eins_diskstats_interval (&current, &current,
+                                          60 * G_USEC_PER_SEC, &interval));
+  g_assert_cmpuint (interval.util_permille, ==, 0);
+  g_assert_cmpuint (interval.latency_us, ==, EINS_DISKSTATS_NO_LATENCY);
+  g_assert_cmpuint (interval.bytes_read, ==, 0);
+
+  /* Awake for only a fraction of the interval */
+  g_assert_false (eins_diskstats_interval (&previous, &current,
+                                           G_USEC_PER_SEC / 2, &interval));
+
+  /* The disk was replaced */
+  g_assert_false (eins_diskstats_interval (&current, &previous,
+                                           60 * G_USEC_PER_SEC, &interval));
+}
+
+static void
+test_interval_awake_time (void)
+{
+  EinsDiskstatsInterval interval;
+  EinsDiskstatsLine previous = { .name = "sda" };
+  EinsDiskstatsLine current = previous;
+
+  /*
+   * Busy for the whole 10 seconds the system was awake, in an interval which
+   * was 10 minutes long on boottime. The monotonic clock gives 10 s.
+   */
+  current.io_ticks_ms = 10000;
+  g_assert_true (eins_diskstats_interval (&previous, &current,
+                                          10 * G_USEC_PER_SEC, &interval));
+  g_assert_cmpuint (interval.util_permille, ==, 1000);
+
+  /* Rounding of io_ticks can take it slightly over */
+  current.io_ticks_ms = 10010;
+  g_assert_true (eins_diskstats_interval (&previous, &current,
+                                          10 * G_USEC_PER_SEC, &interval));
+  g_assert_cmpuint (interval.util_permille, ==, 1000);
+}
+
+static void
+test_percentile (void)
+{
+  guint32 values[1000];
+
+  g_assert_cmpuint (eins_diskstats_percentile (values, 0, 50), ==, 0);
+
+  /* One sample in ten is 50% busy; the others are idle */
+  for (guint i = 0; i < G_N_ELEMENTS (values); i++)
+    values[i] = (i % 10) == 0 ? 500 : 0;
+
+  g_assert_cmpuint (eins_diskstats_percentile (values, G_N_ELEMENTS (values),
+                                               50), ==, 0);
+  g_assert_cmpuint (eins_diskstats_percentile (values, G_N_ELEMENTS (values),
+                                               90), ==, 0);
+  g_assert_cmpuint (eins_diskstats_percentile (values, G_N_ELEMENTS (values),
+                                               99), ==, 500);
+  g_assert_cmpuint (eins_diskstats_percentile (values, G_N_ELEMENTS (values),
+                                               100), ==, 500);
+  g_assert_cmpuint (eins_diskstats_percentile (values, 1, 50), ==, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/diskstats/parse", test_parse);
+  g_test_add_func ("/diskstats/interval", test_interval);
+  g_test_add_func ("/diskstats/interval/awake-time", test_interval_awake_time);
+  g_test_add_func ("/diskstats/percentile", test_percentile);
+
+  return g_test_run ();
+}
@@ -17,6 +17,9 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
+#include "eins-cpu-flags.h"
 #include "eins-hwinfo.h"
 
 static void assert_root_disk_space (DiskSpaceType *dspace)
@@ -174,6 +177,35 @@ test_get_cpu_info_for_current_system (void)
   assert_cpu_info_for_current_system (payload);
 }
 
+/* Decodes the flags of each entry of an a(sqd(qays)) CPU payload, giving
+ * the a(sqds) which lscpu parsing produces. */
+static GVariant *
+decode_cpu_info (GVariant *encoded)
+{
+  GVariantBuilder builder;
+  GVariantIter iter;
+  const gchar *model;
+  guint16 n_cpus;
+  gdouble max_mhz;
+  GVariant *flags;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (CPUINFO_ARRAY_TYPE_STRING));
+
+  g_variant_iter_init (&iter, encoded);
+  while (g_variant_iter_loop (&iter, "(&sqd@" EINS_CPU_FLAGS_TYPE_STRING ")",
+                              &model, &n_cpus, &max_mhz, &flags))
+    {
+      g_autoptr(GError) error = NULL;
+      g_autofree gchar *decoded = eins_cpu_flags_decode (flags, &error);
+
+      g_assert_no_error (error);
+      g_variant_builder_add (&builder, CPUINFO_TYPE_STRING, model, n_cpus,
+                             max_mhz, decoded);
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
 static void
 test_get_computer_hwinfo (void)
 {
@@ -181,16 +213,131 @@ test_get_computer_hwinfo (void)
   guint32 ram_size;
   DiskSpaceType dspace;
   g_autoptr(GVariant) cpu_payload;
+  g_autoptr(GVariant) decoded_cpu_payload = NULL;
 
   g_assert_nonnull (payload);
-  g_assert_cmpstr (g_variant_get_type_string (payload), ==, "(uuuua(sqds))");
+  g_assert_cmpstr (g_variant_get_type_string (payload), ==,
+                   "(uuuua(sqd(qays)))");
 
-  g_variant_get (payload, "(uuuu@a(sqds))", &ram_size,
+  g_variant_get (payload, "(uuuu@a(sqd(qays)))", &ram_size,
                  &dspace.total, &dspace.used, &dspace.free, &cpu_payload);
 
   assert_ram_size (ram_size);
   assert_root_disk_space (&dspace);
-  assert_cpu_info_for_current_system (cpu_payload);
+
+  decoded_cpu_payload = decode_cpu_info (cpu_payload);
+  assert_cpu_info_for_current_system (decoded_cpu_payload);
+}
+
+/* Passes the payload through the same serialization as eos-metrics-collect
+ * and eins-helper.c, then through the daemon's check before recording it. */
+static void
+test_computer_hwinfo_from_helper (void)
+{
+  g_autoptr(GVariant) payload = eins_hwinfo_get_computer_hwinfo ();
+  g_autoptr(GVariant) boxed = NULL;
+  g_autoptr(GVariant) normal = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GVariant) received_boxed = NULL;
+  g_autoptr(GVariant) received = NULL;
+
+  g_assert_nonnull (payload);
+  boxed = g_variant_ref_sink (g_variant_new_variant (payload));
+  normal = g_variant_get_normal_form (boxed);
+  bytes = g_variant_get_data_as_bytes (normal);
+
+  received_boxed = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE_VARIANT,
+                                                                 bytes, FALSE));
+  g_assert_true (g_variant_is_normal_form (received_boxed));
+  received = g_variant_get_variant (received_boxed);
+
+  g_assert_true (eins_hwinfo_is_computer_hwinfo (received));
+  g_assert_true (g_variant_equal (received, payload));
+
+  /* The format string is not a type string */
+  g_assert_false (g_variant_type_string_is_valid (COMPUTER_HWINFO_TYPE_STRING));
+}
+
+/* The XPS 13's flags, from XPS_13_9343_VARIANT */
+static const gchar *XPS_13_9343_FLAGS =
+    "fpu vme de pse tsc msr pae mce cx8 apic sep mtrr pge mca cmov pat pse36 clflush dts acpi mmx fxsr sse sse2 ss ht tm pbe syscall nx pdpe1gb rdtscp lm constant_tsc arch_perfmon pebs bts rep_good nopl xtopology nonstop_tsc cpuid aperfmperf pni pclmulqdq dtes64 monitor ds_cpl vmx est tm2 ssse3 sdbg fma cx16 xtpr pdcm pcid sse4_1 sse4_2 x2apic movbe popcnt tsc_deadline_timer aes xsave avx f16c rdrand lahf_lm abm 3dnowprefetch cpuid_fault epb invpcid_single pti tpr_shadow vnmi flexpriority ept vpid fsgsbase tsc_adjust bmi1 avx2 smep bmi2 erms invpcid rdseed adx smap intel_pt xsaveopt ibpb ibrs stibp dtherm ida arat pln pts";
+
+static void
+test_cpu_flags_round_trip (void)
+{
+  g_autoptr(GVariant) encoded = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *decoded = NULL;
+  g_auto(GStrv) expected_words = NULL;
+  g_auto(GStrv) decoded_words = NULL;
+  const gchar *overflow;
+
+  encoded = g_variant_ref_sink (eins_cpu_flags_encode (XPS_13_9343_FLAGS));
+  g_assert_cmpstr (g_variant_get_type_string (encoded), ==,
+                   EINS_CPU_FLAGS_TYPE_STRING);
+
+  /* Every flag is in the dictionary */
+  g_variant_get_child (encoded, 2, "&s", &overflow);
+  g_assert_cmpstr (overflow, ==, "");
+  g_assert_cmpuint (g_variant_get_size (encoded) * 10, <,
+                    strlen (XPS_13_9343_FLAGS));
+
+  decoded = eins_cpu_flags_decode (encoded, &error);
+  g_assert_no_error (error);
+
+  /* The order may differ, but nothing may be lost or added */
+  expected_words = g_strsplit (XPS_13_9343_FLAGS, " ", -1);
+  decoded_words = g_strsplit (decoded, " ", -1);
+  g_assert_cmpuint (g_strv_length (decoded_words), ==,
+                    g_strv_length (expected_words));
+  for (gchar **word = expected_words; *word != NULL; word++)
+    g_assert_true (g_strv_contains ((const gchar * const *) decoded_words,
+                                    *word));
+}
+
+static void
+test_cpu_flags_overflow (void)
+{
+  g_autoptr(GVariant) encoded = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *decoded = NULL;
+  const gchar *overflow;
+
+  encoded = g_variant_ref_sink (eins_cpu_flags_encode (" fpu  made_up\tfpu "));
+  g_variant_get_child (encoded, 2, "&s", &overflow);
+  g_assert_cmpstr (overflow, ==, "made_up fpu");
+
+  decoded = eins_cpu_flags_decode (encoded, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (decoded, ==, "fpu made_up fpu");
+
+  g_clear_pointer (&encoded, g_variant_unref);
+  g_clear_pointer (&decoded, g_free);
+
+  encoded = g_variant_ref_sink (eins_cpu_flags_encode (""));
+  decoded = eins_cpu_flags_decode (encoded, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (decoded, ==, "");
+}
+
+static void
+test_cpu_flags_decode_bad (void)
+{
+  g_autoptr(GVariant) future = NULL;
+  g_autoptr(GVariant) truncated = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *decoded = NULL;
+
+  future = g_variant_ref_sink (g_variant_new_parsed ("(@q 65535, @ay [], '')"));
+  decoded = eins_cpu_flags_decode (future, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+  g_assert_null (decoded);
+  g_clear_error (&error);
+
+  truncated = g_variant_ref_sink (g_variant_new_parsed ("(@q 1, @ay [1], '')"));
+  decoded = eins_cpu_flags_decode (truncated, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_null (decoded);
 }
 
 int
@@ -246,7 +393,13 @@ main (int   argc,
 
   g_test_add_func ("/hwinfo/cpu/current", test_get_cpu_info_for_current_system);
 
+  g_test_add_func ("/hwinfo/cpu-flags/round-trip", test_cpu_flags_round_trip);
+  g_test_add_func ("/hwinfo/cpu-flags/overflow", test_cpu_flags_overflow);
+  g_test_add_func ("/hwinfo/cpu-flags/decode-bad", test_cpu_flags_decode_bad);
+
   g_test_add_func ("/hwinfo/computer/current", test_get_computer_hwinfo);
+  g_test_add_func ("/hwinfo/computer/from-helper",
+                   test_computer_hwinfo_from_helper);
 
   return g_test_run ();
 }
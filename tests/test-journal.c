@@ -0,0 +1,131 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-journal.h"
+
+static void
+test_unit_name (void)
+{
+  const struct {
+    const gchar *unit;
+    const gchar *user_unit;
+    const gchar *transport;
+    const gchar *name;
+  } cases[] = {
+    { "NetworkManager.service", NULL, "syslog", "NetworkManager.service" },
+    { "getty@tty1.service", NULL, "stdout", "getty@.service" },
+    { "user@1000.service", "app-gnome-org.gnome.Maps-4321.scope", "journal",
+      "org.gnome.Maps" },
+    { "user@1000.service", "pipewire.service", "journal", "pipewire.service" },
+    { "user@1000.service", NULL, "stdout", "user@.service" },
+    { "session-3.scope", NULL, "syslog", "session.scope" },
+    { NULL, NULL, "kernel", "kernel" },
+    { NULL, NULL, "syslog", "" },
+    { NULL, NULL, NULL, "" },
+  };
+
+  for (gsize i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      g_autofree gchar *name = eins_journal_unit_name (cases[i].unit,
+                                                       cases[i].user_unit,
+                                                       cases[i].transport);
+
+      g_assert_cmpstr (name, ==, cases[i].name);
+    }
+}
+
+static void
+test_summary (void)
+{
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) top = NULL;
+  const gchar *unit;
+  guint64 total, count;
+
+  g_assert_null (eins_journal_take_summary (2));
+
+  for (guint i = 0; i < 5; i++)
+    eins_journal_add ("kernel");
+  for (guint i = 0; i < 3; i++)
+    eins_journal_add ("bluetooth.service");
+  eins_journal_add ("cups.service");
+  eins_journal_add ("avahi-daemon.service");
+
+  summary = g_variant_ref_sink (eins_journal_take_summary (3));
+  g_assert_true (g_variant_is_of_type (summary, G_VARIANT_TYPE ("(ta(st))")));
+  g_variant_get (summary, "(t@a(st))", &total, &top);
+  g_assert_cmpuint (total, ==, 10);
+  g_assert_cmpuint (g_variant_n_children (top), ==, 3);
+
+  g_variant_get_child (top, 0, "(&st)", &unit, &count);
+  g_assert_cmpstr (unit, ==, "kernel");
+  g_assert_cmpuint (count, ==, 5);
+  g_variant_get_child (top, 1, "(&st)", &unit, &count);
+  g_assert_cmpstr (unit, ==, "bluetooth.service");
+  g_assert_cmpuint (count, ==, 3);
+  /* Ties are broken by name */
+  g_variant_get_child (top, 2, "(&st)", &unit, &count);
+  g_assert_cmpstr (unit, ==, "avahi-daemon.service");
+  g_assert_cmpuint (count, ==, 1);
+
+  g_assert_null (eins_journal_take_summary (3));
+}
+
+static void
+test_summary_bounded (void)
+{
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) top = NULL;
+  const gchar *unit;
+  guint64 total, count;
+
+  for (guint i = 0; i < EINS_JOURNAL_MAX_UNITS + 10; i++)
+    {
+      g_autofree gchar *name = g_strdup_printf ("unit%u.service", i);
+
+      eins_journal_add (name);
+    }
+
+  /* Units which have been seen are still counted separately */
+  eins_journal_add ("unit0.service");
+
+  summary = g_variant_ref_sink (eins_journal_take_summary (2));
+  g_variant_get (summary, "(t@a(st))", &total, &top);
+  g_assert_cmpuint (total, ==, EINS_JOURNAL_MAX_UNITS + 11);
+
+  g_variant_get_child (top, 0, "(&st)", &unit, &count);
+  g_assert_cmpstr (unit, ==, "");
+  g_assert_cmpuint (count, ==, 10);
+  g_variant_get_child (top, 1, "(&st)", &unit, &count);
+  g_assert_cmpstr (unit, ==, "unit0.service");
+  g_assert_cmpuint (count, ==, 2);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/journal/unit-name", test_unit_name);
+  g_test_add_func ("/journal/summary", test_summary);
+  g_test_add_func ("/journal/summary/bounded", test_summary_bounded);
+
+  return g_test_run ();
+}
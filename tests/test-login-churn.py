@@ -0,0 +1,326 @@
+#!/usr/bin/python3
+#
+# Copyright 2026 Endless OS Foundation LLC.
+#
+# This file is part of eos-metrics-instrumentation.
+#
+# eos-metrics-instrumentation is free software: you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or (at your
+# option) any later version.
+#
+# eos-metrics-instrumentation is distributed in the hope that it will be
+# useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+# Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with eos-metrics-instrumentation.  If not, see
+# <http://www.gnu.org/licenses/>.
+
+'''
+Runs the daemon against mocked login and systemd managers, and churns logins
+and logouts through it. Checks that every session the daemon starts is
+stopped again, and reports how long the daemon takes to start, how quickly it
+handles the login manager's signals, and its resident memory.
+
+The amount of churn is set by the environment, so that the same script serves
+as a quick test and as a benchmark:
+
+    EINS_DAEMON          path of the eos-metrics-instrumentation binary
+    EINS_CHURN_USERS     users logged in before the daemon starts
+    EINS_CHURN_PAIRS     UserNew/UserRemoved pairs to send
+'''
+
+import collections
+import os
+import random
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+import unittest
+
+import dbus
+import dbusmock
+from gi.repository import GLib
+
+LOGIN_NAME = 'org.freedesktop.login1'
+LOGIN_PATH = '/org/freedesktop/login1'
+LOGIN_IFACE = 'org.freedesktop.login1.Manager'
+
+SYSTEMD_NAME = 'org.freedesktop.systemd1'
+SYSTEMD_PATH = '/org/freedesktop/systemd1'
+SYSTEMD_IFACE = 'org.freedesktop.systemd1.Manager'
+
+# Must match eins-stats.h
+STATS_NAME = 'com.endlessm.MetricsInstrumentation'
+STATS_PATH = '/com/endlessm/MetricsInstrumentation'
+STATS_IFACE = 'com.endlessm.MetricsInstrumentation.Stats'
+
+# Must match eins-recorder.h
+RECORD_TYPE = '(yxuusmv)'
+
+# Must match the collectors table in eos-metrics-instrumentation.c
+COLLECTORS = ('peripherals', 'hwinfo', 'psi', 'diskstats', 'netdev',
+              'thermal', 'battery', 'app-launch', 'app-usage', 'oom',
+              'journal', 'sleep')
+
+MIN_HUMAN_USER_ID = 1000
+CHURN_FIRST_USER_ID = 100000
+CHURN_CONCURRENT_USERS = 64
+SIGNALS_PER_CALL = 1000
+
+
+def user_path(uid):
+    return '{}/user/_{}'.format(LOGIN_PATH, uid)
+
+
+def make_churn(n_pairs, seed=0):
+    '''
+    Returns a list of (signal name, user ID) in which each of n_pairs logins
+    is eventually followed by its logout. Logouts happen in a different order
+    from logins, a few user IDs are below MIN_HUMAN_USER_ID, and a few logouts
+    are for users who were never seen logging in.
+    '''
+    rng = random.Random(seed)
+    logged_in = []
+    signals = []
+    n_new = 0
+
+    while n_new < n_pairs or logged_in:
+        can_add = (n_new < n_pairs and
+                   len(logged_in) < CHURN_CONCURRENT_USERS)
+        if can_add and (not logged_in or rng.random() < 0.5):
+            uid = CHURN_FIRST_USER_ID + n_new
+            if rng.random() < 0.01:
+                uid = rng.randrange(1, MIN_HUMAN_USER_ID)
+            logged_in.append(uid)
+            signals.append(('UserNew', uid))
+            n_new += 1
+        else:
+            uid = logged_in.pop(rng.randrange(len(logged_in)))
+            signals.append(('UserRemoved', uid))
+
+        if rng.random() < 0.001:
+            signals.append(('UserRemoved', CHURN_FIRST_USER_ID - 1))
+
+    return signals
+
+
+def load_records(path):
+    '''Parses a file written by the daemon with EINS_RECORDER_FILE set.'''
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    records = []
+    offset = 0
+    while offset + 4 <= len(data):
+        size = int.from_bytes(data[offset:offset + 4], 'little')
+        offset += 4
+        variant = GLib.Variant.new_from_bytes(GLib.VariantType(RECORD_TYPE),
+                                              GLib.Bytes(data[offset:offset + size]),
+                                              False)
+        records.append(variant.unpack())
+        offset += size
+
+    return records
+
+
+def percentile(histogram, pct):
+    '''Mirrors eins_histogram_percentile() for a "(tttau)" histogram.'''
+    _, _, maximum, buckets = histogram
+    total = sum(buckets)
+    if total == 0:
+        return 0
+
+    rank = max(1, (total * pct + 99) // 100)
+    seen = 0
+    for i, n in enumerate(buckets):
+        seen += n
+        if seen >= rank:
+            return min(maximum, (1 << i) - 1) if i > 0 else 0
+
+    return maximum
+
+
+class TestLoginChurn(dbusmock.DBusTestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.start_system_bus()
+        cls.dbus_con = cls.get_dbus(system_bus=True)
+
+    def setUp(self):
+        self.daemon_path = os.environ['EINS_DAEMON']
+        self.n_users = int(os.environ.get('EINS_CHURN_USERS', '300'))
+        self.n_pairs = int(os.environ.get('EINS_CHURN_PAIRS', '1000'))
+
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.recorder_file = os.path.join(self.tmpdir.name, 'events')
+
+        # Keep the collectors away from the real /proc, /sys and journal, and
+        # the session timers from being restarted by checkpoints mid-test.
+        self.config_file = os.path.join(self.tmpdir.name, 'config.ini')
+        with open(self.config_file, 'w') as f:
+            f.write('[daemon]\ncheckpoint-interval=0\n')
+            for collector in COLLECTORS:
+                f.write('[{}]\nenabled=false\n'.format(collector))
+
+        self.daemon_log = open(os.path.join(self.tmpdir.name, 'daemon.log'),
+                               'w+')
+
+        self.systemd = self.spawn_server(SYSTEMD_NAME, SYSTEMD_PATH,
+                                         SYSTEMD_IFACE, system_bus=True,
+                                         stdout=subprocess.DEVNULL)
+        self.addCleanup(self.stop_process, self.systemd)
+        systemd_mock = dbus.Interface(
+            self.dbus_con.get_object(SYSTEMD_NAME, SYSTEMD_PATH),
+            dbusmock.MOCK_IFACE)
+        systemd_mock.AddMethod(SYSTEMD_IFACE, 'Subscribe', '', '', '')
+        systemd_mock.AddMethod(SYSTEMD_IFACE, 'Unsubscribe', '', '', '')
+
+        self.login = self.spawn_server(LOGIN_NAME, LOGIN_PATH, LOGIN_IFACE,
+                                       system_bus=True,
+                                       stdout=subprocess.DEVNULL)
+        self.addCleanup(self.stop_process, self.login)
+        self.login_obj = self.dbus_con.get_object(LOGIN_NAME, LOGIN_PATH)
+        self.login_mock = dbus.Interface(self.login_obj, dbusmock.MOCK_IFACE)
+
+        # A few system users, which the daemon should ignore
+        users = [(uid, 'system{}'.format(uid), user_path(uid))
+                 for uid in (0, 42, 999)]
+        users += [(uid, 'user{}'.format(uid), user_path(uid))
+                  for uid in range(MIN_HUMAN_USER_ID,
+                                   MIN_HUMAN_USER_ID + self.n_users)]
+        self.login_mock.AddMethod(LOGIN_IFACE, 'ListUsers', '', 'a(uso)',
+                                  'ret = {!r}'.format(users))
+
+        # Emitting each signal with a separate call to the mock would make
+        # the test runner, not the daemon, the bottleneck.
+        self.login_mock.AddMethod(
+            LOGIN_IFACE, 'EmitLoginSignals', 'a(su)', '',
+            'for (name, uid) in args[0]:\n'
+            '    self.EmitSignal({!r}, name, "uo",\n'
+            '                    [uid, "{}/user/_%u" % uid])\n'
+            .format(LOGIN_IFACE, LOGIN_PATH))
+
+    def tearDown(self):
+        self.daemon_log.close()
+        self.tmpdir.cleanup()
+
+    def stop_process(self, process):
+        if process.poll() is None:
+            process.terminate()
+            process.wait()
+
+    def start_daemon(self):
+        env = dict(os.environ)
+        env['EINS_RECORDER_FILE'] = self.recorder_file
+        env['EINS_CONFIG_FILE'] = self.config_file
+        start = time.monotonic()
+        self.daemon = subprocess.Popen([self.daemon_path], env=env,
+                                       stdout=self.daemon_log,
+                                       stderr=subprocess.STDOUT)
+        self.addCleanup(self.stop_process, self.daemon)
+
+        self.stats_proxy = None
+        self.wait_for_stats(lambda s: s['active-sessions'] == self.n_users,
+                            'the daemon to list users')
+        self.startup_time = time.monotonic() - start
+
+    def stop_daemon(self):
+        self.daemon.send_signal(signal.SIGTERM)
+        self.assertEqual(self.daemon.wait(timeout=30), 0, self.read_log())
+
+    def read_log(self):
+        self.daemon_log.seek(0)
+        return self.daemon_log.read()
+
+    def get_stats(self):
+        if self.stats_proxy is None:
+            self.stats_proxy = dbus.Interface(
+                self.dbus_con.get_object(STATS_NAME, STATS_PATH),
+                STATS_IFACE)
+
+        return self.stats_proxy.GetStats()
+
+    def wait_for_stats(self, predicate, what, timeout=60):
+        deadline = time.monotonic() + timeout
+        while True:
+            self.assertIsNone(self.daemon.poll(), self.read_log())
+            try:
+                stats = self.get_stats()
+                if predicate(stats):
+                    return stats
+            except dbus.exceptions.DBusException:
+                self.stats_proxy = None
+
+            if time.monotonic() > deadline:
+                self.fail('Timed out waiting for {}'.format(what))
+
+            time.sleep(0.05)
+
+    def test_churn(self):
+        churn = make_churn(self.n_pairs)
+        n_human_logins = sum(1 for (name, uid) in churn
+                             if name == 'UserNew' and uid >= MIN_HUMAN_USER_ID)
+
+        self.start_daemon()
+        before = self.get_stats()
+        expected_signals = before['login-signals'] + len(churn)
+
+        start = time.monotonic()
+        for i in range(0, len(churn), SIGNALS_PER_CALL):
+            self.login_obj.EmitLoginSignals(
+                dbus.Array(churn[i:i + SIGNALS_PER_CALL], signature='(su)'),
+                dbus_interface=LOGIN_IFACE)
+        after = self.wait_for_stats(
+            lambda s: s['login-signals'] >= expected_signals,
+            'the daemon to handle {} signals'.format(len(churn)))
+        elapsed = time.monotonic() - start
+
+        self.assertEqual(after['login-signals'], expected_signals)
+        self.assertEqual(after['active-sessions'], self.n_users)
+        self.assertEqual(after['sessions-started'] - before['sessions-started'],
+                         n_human_logins)
+        self.assertEqual(after['sessions-stopped'] - before['sessions-stopped'],
+                         n_human_logins)
+
+        latency = after['login-signal-us']
+        print('startup: {:.0f}ms'.format(self.startup_time * 1000))
+        print('rss at startup: {} KiB'.format(before['rss-bytes'] // 1024))
+        print('signals: {}'.format(len(churn)))
+        print('throughput: {:.0f} signals/s'.format(len(churn) / elapsed))
+        print('latency: mean={:.1f}us p50<={}us p99<={}us max={}us'.format(
+            latency[1] / max(latency[0], 1), percentile(latency, 50),
+            percentile(latency, 99), latency[2]))
+        print('rss growth: {} KiB'.format(
+            (after['rss-bytes'] - before['rss-bytes']) // 1024))
+
+        self.stop_daemon()
+
+        # Every aggregate timer started must have been stopped. A checkpoint
+        # starts a user's next timer before stopping the current one, so only
+        # a timer started while the user had none running is a new session.
+        running = {}
+        timers_by_uid = collections.Counter()
+        n_starts = 0
+        for (kind, _, uid, serial, _, _) in load_records(self.recorder_file):
+            if kind == ord('b'):
+                self.assertNotIn(serial, running)
+                if timers_by_uid[uid] == 0:
+                    n_starts += 1
+                running[serial] = uid
+                timers_by_uid[uid] += 1
+            elif kind == ord('f'):
+                self.assertEqual(running.pop(serial), uid)
+                timers_by_uid[uid] -= 1
+
+        self.assertEqual(running, {})
+        self.assertEqual(n_starts, self.n_users + n_human_logins)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=unittest.TextTestRunner(stream=sys.stdout,
+                                                     verbosity=2))
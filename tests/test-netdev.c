@@ -0,0 +1,161 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-netdev.h"
+#include "eins-test-util.h"
+
+static void
+test_parse (void)
+{
+  EinsNetdevLine line;
+
+  g_assert_true (eins_netdev_parse_line ("wlp2s0: 918273645 712345    0    3    0     0          0         0 "
+                                         "51234567  345678    0    0    0     0       0          0",
+                                         &line));
+  g_assert_cmpstr (line.name, ==, "wlp2s0");
+  g_assert_cmpuint (line.rx_bytes, ==, 918273645);
+  g_assert_cmpuint (line.rx_packets, ==, 712345);
+  g_assert_cmpuint (line.tx_bytes, ==, 51234567);
+  g_assert_cmpuint (line.tx_packets, ==, 345678);
+
+  /* Old kernels don't put a space after the colon */
+  g_assert_true (eins_netdev_parse_line ("  eth0:1234 5 0 0 0 0 0 0 6789 10 0 0 0 0 0 0",
+                                         &line));
+  g_assert_cmpstr (line.name, ==, "eth0");
+  g_assert_cmpuint (line.rx_bytes, ==, 1234);
+  g_assert_cmpuint (line.tx_packets, ==, 10);
+
+  /* Headers */
+  g_assert_false (eins_netdev_parse_line ("Inter-|   Receive                                                |  Transmit",
+                                          &line));
+  g_assert_false (eins_netdev_parse_line (" face |bytes    packets errs drop fifo frame compressed multicast|"
+                                          "bytes    packets errs drop fifo colls carrier compressed",
+                                          &line));
+  g_assert_false (eins_netdev_parse_line ("", &line));
+  g_assert_false (eins_netdev_parse_line ("eth0: 1 2 3", &line));
+  g_assert_false (eins_netdev_parse_line ("an-interface-name-too-long: 1 2 3 4 5 6 7 8 9 10",
+                                          &line));
+}
+
+static void
+test_counter_delta (void)
+{
+  g_assert_cmpuint (eins_netdev_counter_delta (100, 150), ==, 50);
+  g_assert_cmpuint (eins_netdev_counter_delta (100, 100), ==, 0);
+
+  /* A 32-bit counter wrapped */
+  g_assert_cmpuint (eins_netdev_counter_delta (G_MAXUINT32 - 9, 20), ==, 30);
+
+  /* A 64-bit counter was reset */
+  g_assert_cmpuint (eins_netdev_counter_delta (G_GUINT64_CONSTANT (1) << 40, 20),
+                    ==, 20);
+}
+
+static void
+test_read_ifindex (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = g_dir_make_tmp ("test-netdev-XXXXXX", &error);
+  g_autofree gchar *wlan = NULL;
+
+  g_assert_no_error (error);
+  wlan = g_build_filename (root, "wlan0", NULL);
+
+  g_assert_cmpuint (eins_netdev_read_ifindex (root, "wlan0"), ==, 0);
+
+  eins_test_write_file (wlan, "ifindex", "3\n");
+  g_assert_cmpuint (eins_netdev_read_ifindex (root, "wlan0"), ==, 3);
+
+  /* Unplugged and plugged in again */
+  eins_test_write_file (wlan, "ifindex", "12\n");
+  g_assert_cmpuint (eins_netdev_read_ifindex (root, "wlan0"), ==, 12);
+
+  eins_test_write_file (wlan, "ifindex", "garbage\n");
+  g_assert_cmpuint (eins_netdev_read_ifindex (root, "wlan0"), ==, 0);
+
+  eins_test_rm_rf (root);
+}
+
+static void
+test_totals_add (void)
+{
+  EinsNetdevTotals totals = { 0 };
+  EinsNetdevLine previous = { "eth0", 1000, 10, 2000, 20 };
+  EinsNetdevLine current = { "eth0", 7000, 15, 3200, 24 };
+
+  eins_netdev_totals_add (&totals, &previous, &current, 60 * G_USEC_PER_SEC);
+  g_assert_cmpuint (totals.rx_bytes, ==, 6000);
+  g_assert_cmpuint (totals.rx_packets, ==, 5);
+  g_assert_cmpuint (totals.tx_bytes, ==, 1200);
+  g_assert_cmpuint (totals.tx_packets, ==, 4);
+  g_assert_cmpuint (totals.peak_rx_rate, ==, 100);
+  g_assert_cmpuint (totals.peak_tx_rate, ==, 20);
+
+  /* Awake for only a fraction of the interval: the bytes count, but not
+   * towards the peak rates */
+  eins_netdev_totals_add (&totals, &previous, &current, G_USEC_PER_SEC / 2);
+  g_assert_cmpuint (totals.rx_bytes, ==, 12000);
+  g_assert_cmpuint (totals.peak_rx_rate, ==, 100);
+
+  eins_netdev_totals_reset (&totals);
+  g_assert_cmpuint (totals.rx_bytes, ==, 0);
+  g_assert_cmpuint (totals.peak_rx_rate, ==, 0);
+}
+
+static void
+test_totals_peak_hour (void)
+{
+  EinsNetdevTotals totals = { 0 };
+  EinsNetdevLine previous = { "eth0", 0, 0, 0, 0 };
+  EinsNetdevLine quiet = { "eth0", 1000, 1, 100, 1 };
+  EinsNetdevLine busy = { "eth0", 50000, 40, 5000, 20 };
+
+  /* A quiet hour, then a busy one, each in 60 samples of a minute */
+  for (guint i = 0; i < 60; i++)
+    eins_netdev_totals_add (&totals, &previous, &quiet, 60 * G_USEC_PER_SEC);
+  g_assert_cmpuint (totals.hour_rx_bytes, ==, 0);
+  g_assert_cmpuint (totals.peak_hour_rx_bytes, ==, 60000);
+
+  for (guint i = 0; i < 60; i++)
+    eins_netdev_totals_add (&totals, &previous, &busy, 60 * G_USEC_PER_SEC);
+  g_assert_cmpuint (totals.peak_hour_rx_bytes, ==, 3000000);
+  g_assert_cmpuint (totals.peak_hour_tx_bytes, ==, 300000);
+
+  /* An incomplete hour which is quieter doesn't replace it */
+  eins_netdev_totals_add (&totals, &previous, &quiet, 60 * G_USEC_PER_SEC);
+  eins_netdev_totals_finish_hour (&totals);
+  g_assert_cmpuint (totals.peak_hour_rx_bytes, ==, 3000000);
+  g_assert_cmpuint (totals.hour_rx_bytes, ==, 0);
+  g_assert_cmpuint (totals.rx_bytes, ==, 3061000);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/netdev/parse", test_parse);
+  g_test_add_func ("/netdev/counter-delta", test_counter_delta);
+  g_test_add_func ("/netdev/read-ifindex", test_read_ifindex);
+  g_test_add_func ("/netdev/totals/add", test_totals_add);
+  g_test_add_func ("/netdev/totals/peak-hour", test_totals_peak_hour);
+
+  return g_test_run ();
+}
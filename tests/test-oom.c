@@ -0,0 +1,173 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-oom.h"
+#include "eins-test-util.h"
+
+#include <glib/gstdio.h>
+
+static void
+test_parse_events (void)
+{
+  guint64 oom = 0, oom_kill = 0;
+
+  g_assert_true (eins_oom_parse_events ("low 0\nhigh 12\nmax 40\noom 3\n"
+                                        "oom_kill 2\noom_group_kill 0\n",
+                                        &oom, &oom_kill));
+  g_assert_cmpuint (oom, ==, 3);
+  g_assert_cmpuint (oom_kill, ==, 2);
+
+  g_assert_false (eins_oom_parse_events ("low 0\nhigh 0\nmax 0\n",
+                                         &oom, &oom_kill));
+  g_assert_false (eins_oom_parse_events ("", &oom, &oom_kill));
+}
+
+static void
+test_unit_name (void)
+{
+  const struct {
+    const gchar *path;
+    const gchar *unit;
+  } cases[] = {
+    { "/sys/fs/cgroup/system.slice/packagekit.service", "packagekit.service" },
+    { "/sys/fs/cgroup/system.slice/system-getty.slice/getty@tty1.service",
+      "getty@.service" },
+    { "/sys/fs/cgroup/user.slice/user-1000.slice/session-2.scope",
+      "session.scope" },
+    { "/sys/fs/cgroup/user.slice/user-1000.slice/user@1000.service/app.slice/"
+      "app-gnome-org.gnome.Nautilus-4321.scope", "org.gnome.Nautilus" },
+    { "/sys/fs/cgroup/user.slice/user-1000.slice/user@1000.service/app.slice/"
+      "app-flatpak-com.example.Game-1.scope/payload", "com.example.Game" },
+    { "/sys/fs/cgroup/user.slice", "user.slice" },
+  };
+
+  for (gsize i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      g_autofree gchar *unit = eins_oom_unit_name (cases[i].path);
+
+      g_assert_cmpstr (unit, ==, cases[i].unit);
+    }
+}
+
+static void
+write_events (const gchar *dir,
+              const gchar *name,
+              guint64      oom,
+              guint64      oom_kill)
+{
+  g_autofree gchar *path = g_build_filename (dir, name, NULL);
+  g_autofree gchar *contents = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+
+  contents = g_strdup_printf ("low 0\nhigh 0\nmax 0\noom %" G_GUINT64_FORMAT
+                              "\noom_kill %" G_GUINT64_FORMAT "\n",
+                              oom, oom_kill);
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+}
+
+static void
+assert_summary_has (GVariant    *summary,
+                    const gchar *unit,
+                    guint64      oom,
+                    guint64      oom_kill)
+{
+  for (gsize i = 0; i < g_variant_n_children (summary); i++)
+    {
+      const gchar *actual_unit;
+      guint64 actual_oom, actual_oom_kill;
+
+      g_variant_get_child (summary, i, "(&stt)", &actual_unit, &actual_oom,
+                           &actual_oom_kill);
+      if (g_strcmp0 (actual_unit, unit) == 0)
+        {
+          g_assert_cmpuint (actual_oom, ==, oom);
+          g_assert_cmpuint (actual_oom_kill, ==, oom_kill);
+          return;
+        }
+    }
+
+  g_assert_not_reached ();
+}
+
+static void
+test_scan (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *slice = NULL;
+  g_autofree gchar *service = NULL;
+  g_autofree gchar *app = NULL;
+  g_autoptr(GVariant) summary = NULL;
+
+  root = g_dir_make_tmp ("test-oom-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  slice = g_build_filename (root, "user.slice", NULL);
+  service = g_build_filename (slice, "user-1000.slice", "user@1000.service",
+                              NULL);
+  app = g_build_filename (service, "app.slice",
+                          "app-gnome-org.gnome.Nautilus-4321.scope", NULL);
+
+  /* Kills from before the daemon started are not counted */
+  write_events (slice, "memory.events", 1, 1);
+  write_events (slice, "memory.events.local", 0, 0);
+  write_events (app, "memory.events.local", 1, 1);
+  eins_oom_scan (slice, TRUE);
+  eins_oom_scan (slice, FALSE);
+  g_assert_null (eins_oom_take_summary ());
+
+  /* Two kills in the app and one elsewhere which can't be attributed */
+  write_events (slice, "memory.events", 2, 4);
+  write_events (app, "memory.events.local", 2, 3);
+  eins_oom_scan (slice, FALSE);
+
+  summary = g_variant_ref_sink (eins_oom_take_summary ());
+  g_assert_true (g_variant_is_of_type (summary, G_VARIANT_TYPE ("a(stt)")));
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 2);
+  assert_summary_has (summary, "org.gnome.Nautilus", 1, 2);
+  assert_summary_has (summary, "user.slice", 0, 1);
+
+  /* A unit created after the last scan counts from zero */
+  write_events (slice, "memory.events", 2, 5);
+  write_events (service, "memory.events.local", 0, 1);
+  eins_oom_scan (slice, FALSE);
+
+  g_clear_pointer (&summary, g_variant_unref);
+  summary = g_variant_ref_sink (eins_oom_take_summary ());
+  g_assert_cmpuint (g_variant_n_children (summary), ==, 1);
+  assert_summary_has (summary, "user@.service", 0, 1);
+
+  eins_test_rm_rf (root);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/oom/parse-events", test_parse_events);
+  g_test_add_func ("/oom/unit-name", test_unit_name);
+  g_test_add_func ("/oom/scan", test_scan);
+
+  return g_test_run ();
+}
@@ -0,0 +1,289 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "eins-peripherals.h"
+#include "eins-uevent-monitor.h"
+#include "eins-test-util.h"
+
+/* Uevents as the kernel sends them, with the trailing nul */
+static const gchar GPU_ADD[] =
+  "add@/devices/pci0000:00/0000:00:02.0\0"
+  "ACTION=add\0"
+  "DEVPATH=/devices/pci0000:00/0000:00:02.0\0"
+  "SUBSYSTEM=pci\0"
+  "PCI_CLASS=30000\0"
+  "PCI_ID=8086:1616\0"
+  "PCI_SUBSYS_ID=1028:0665\0"
+  "SEQNUM=1234\0";
+
+static const gchar XHCI_ADD[] =
+  "add@/devices/pci0000:00/0000:00:14.0\0"
+  "ACTION=add\0"
+  "DEVPATH=/devices/pci0000:00/0000:00:14.0\0"
+  "SUBSYSTEM=pci\0"
+  "PCI_CLASS=C0330\0"
+  "PCI_ID=8086:9CB1\0";
+
+static const gchar MOUSE_ADD[] =
+  "add@/devices/pci0000:00/0000:00:14.0/usb1/1-1\0"
+  "ACTION=add\0"
+  "DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-1\0"
+  "SUBSYSTEM=usb\0"
+  "DEVTYPE=usb_device\0"
+  "PRODUCT=46d/c52b/1211\0"
+  "TYPE=0/0/0\0";
+
+static const gchar MOUSE_INTERFACE_ADD[] =
+  "add@/devices/pci0000:00/0000:00:14.0/usb1/1-1/1-1:1.0\0"
+  "ACTION=add\0"
+  "DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-1/1-1:1.0\0"
+  "SUBSYSTEM=usb\0"
+  "DEVTYPE=usb_interface\0"
+  "PRODUCT=46d/c52b/1211\0"
+  "TYPE=0/0/0\0"
+  "INTERFACE=3/1/2\0";
+
+static const gchar HUB_ADD[] =
+  "add@/devices/pci0000:00/0000:00:14.0/usb1\0"
+  "ACTION=add\0"
+  "DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1\0"
+  "SUBSYSTEM=usb\0"
+  "DEVTYPE=usb_device\0"
+  "PRODUCT=1d6b/2/515\0"
+  "TYPE=9/0/1\0";
+
+static GHashTable *
+parse (const gchar *buf,
+       gsize        len)
+{
+  GHashTable *properties = eins_uevent_parse (buf, len);
+
+  g_assert_nonnull (properties);
+  return properties;
+}
+
+static void
+assert_entry (GVariant    *entry,
+              const gchar *expected)
+{
+  g_autofree gchar *printed = NULL;
+
+  g_assert_nonnull (entry);
+  printed = g_variant_print (entry, FALSE);
+  g_assert_cmpstr (printed, ==, expected);
+}
+
+static void
+test_parse_uevent (void)
+{
+  g_autoptr(GHashTable) properties = NULL;
+
+  properties = eins_uevent_parse (GPU_ADD, sizeof GPU_ADD);
+  g_assert_nonnull (properties);
+  g_assert_cmpstr (g_hash_table_lookup (properties, "ACTION"), ==, "add");
+  g_assert_cmpstr (g_hash_table_lookup (properties, "DEVPATH"), ==,
+                   "/devices/pci0000:00/0000:00:02.0");
+  g_assert_cmpstr (g_hash_table_lookup (properties, "PCI_ID"), ==,
+                   "8086:1616");
+  g_assert_cmpuint (g_hash_table_size (properties), ==, 7);
+}
+
+static void
+test_parse_uevent_bad (void)
+{
+  static const gchar no_header[] = "ACTION=add\0DEVPATH=/x\0SUBSYSTEM=pci\0";
+  static const gchar no_subsystem[] = "add@/x\0ACTION=add\0DEVPATH=/x\0";
+  static const gchar udev[] = "libudev\0ACTION=add\0DEVPATH=/x\0SUBSYSTEM=pci\0";
+
+  g_assert_null (eins_uevent_parse (no_header, sizeof no_header));
+  g_assert_null (eins_uevent_parse (no_subsystem, sizeof no_subsystem));
+  g_assert_null (eins_uevent_parse (udev, sizeof udev));
+
+  /* Truncated in the middle of a key */
+  g_assert_null (eins_uevent_parse (GPU_ADD, sizeof GPU_ADD - 3));
+}
+
+static void
+test_entry_from_uevent (void)
+{
+  g_autoptr(GHashTable) gpu = parse (GPU_ADD, sizeof GPU_ADD);
+  g_autoptr(GHashTable) xhci = parse (XHCI_ADD, sizeof XHCI_ADD);
+  g_autoptr(GHashTable) mouse = parse (MOUSE_ADD, sizeof MOUSE_ADD);
+  g_autoptr(GHashTable) mouse_interface = parse (MOUSE_INTERFACE_ADD,
+                                                 sizeof MOUSE_INTERFACE_ADD);
+  g_autoptr(GHashTable) hub = parse (HUB_ADD, sizeof HUB_ADD);
+  g_autoptr(GVariant) gpu_entry = NULL;
+  g_autoptr(GVariant) mouse_entry = NULL;
+
+  gpu_entry = eins_peripherals_entry_from_uevent (gpu);
+  assert_entry (gpu_entry, "('pci', 32902, 5654, 196608)");
+
+  mouse_entry = eins_peripherals_entry_from_uevent (mouse);
+  assert_entry (mouse_entry, "('usb', 1133, 50475, 0)");
+
+  /* Not a storage, network or display controller */
+  g_assert_null (eins_peripherals_entry_from_uevent (xhci));
+  g_assert_null (eins_peripherals_entry_from_uevent (mouse_interface));
+  g_assert_null (eins_peripherals_entry_from_uevent (hub));
+}
+
+typedef struct {
+  gchar *root;
+} Fixture;
+
+/* Adds a device under devices/ and its symlink under bus/BUS/devices/ */
+static gchar *
+add_device (Fixture     *fixture,
+            const gchar *bus,
+            const gchar *devpath)
+{
+  g_autofree gchar *dir = g_build_filename (fixture->root, devpath, NULL);
+  g_autofree gchar *bus_dir = g_build_filename (fixture->root, "bus", bus,
+                                                "devices", NULL);
+  g_autofree gchar *name = g_path_get_basename (devpath);
+  g_autofree gchar *link = g_build_filename (bus_dir, name, NULL);
+  g_autofree gchar *target = g_build_filename ("..", "..", "..", devpath,
+                                               NULL);
+
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+  g_assert_cmpint (g_mkdir_with_parents (bus_dir, 0755), ==, 0);
+  g_assert_cmpint (symlink (target, link), ==, 0);
+
+  return g_steal_pointer (&dir);
+}
+
+static void
+setup (Fixture       *fixture,
+       gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *gpu = NULL;
+  g_autofree gchar *xhci = NULL;
+  g_autofree gchar *root_hub = NULL;
+  g_autofree gchar *mouse = NULL;
+
+  fixture->root = g_dir_make_tmp ("test-peripherals-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  gpu = add_device (fixture, "pci", "devices/pci0000:00/0000:00:02.0");
+  eins_test_write_file (gpu, "vendor", "0x8086\n");
+  eins_test_write_file (gpu, "device", "0x1616\n");
+  eins_test_write_file (gpu, "class", "0x030000\n");
+
+  xhci = add_device (fixture, "pci", "devices/pci0000:00/0000:00:14.0");
+  eins_test_write_file (xhci, "vendor", "0x8086\n");
+  eins_test_write_file (xhci, "device", "0x9cb1\n");
+  eins_test_write_file (xhci, "class", "0x0c0330\n");
+
+  root_hub = add_device (fixture, "usb",
+                         "devices/pci0000:00/0000:00:14.0/usb1");
+  eins_test_write_file (root_hub, "idVendor", "1d6b\n");
+  eins_test_write_file (root_hub, "idProduct", "0002\n");
+  eins_test_write_file (root_hub, "bDeviceClass", "09\n");
+  eins_test_write_file (root_hub, "bDeviceSubClass", "00\n");
+  eins_test_write_file (root_hub, "bDeviceProtocol", "01\n");
+
+  mouse = add_device (fixture, "usb",
+                      "devices/pci0000:00/0000:00:14.0/usb1/1-1");
+  eins_test_write_file (mouse, "idVendor", "046d\n");
+  eins_test_write_file (mouse, "idProduct", "c52b\n");
+  eins_test_write_file (mouse, "bDeviceClass", "00\n");
+  eins_test_write_file (mouse, "bDeviceSubClass", "00\n");
+  eins_test_write_file (mouse, "bDeviceProtocol", "00\n");
+
+  /* Has no idVendor etc., and must be skipped anyway */
+  g_free (add_device (fixture, "usb",
+                      "devices/pci0000:00/0000:00:14.0/usb1/1-1/1-1:1.0"));
+}
+
+static void
+teardown (Fixture       *fixture,
+          gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_test_rm_rf (fixture->root);
+  g_free (fixture->root);
+}
+
+static void
+test_scan (Fixture       *fixture,
+           gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(GHashTable) devices = eins_peripherals_scan (fixture->root);
+  g_autoptr(GHashTable) gpu_add = parse (GPU_ADD, sizeof GPU_ADD);
+  g_autoptr(GHashTable) mouse_add = parse (MOUSE_ADD, sizeof MOUSE_ADD);
+  g_autoptr(GVariant) gpu_entry = eins_peripherals_entry_from_uevent (gpu_add);
+  g_autoptr(GVariant) mouse_entry =
+    eins_peripherals_entry_from_uevent (mouse_add);
+
+  g_assert_cmpuint (g_hash_table_size (devices), ==, 2);
+
+  /* Keyed and built the same way as from uevents */
+  g_assert_true (g_variant_equal (g_hash_table_lookup (devices,
+                                                       g_hash_table_lookup (gpu_add, "DEVPATH")),
+                                  gpu_entry));
+  g_assert_true (g_variant_equal (g_hash_table_lookup (devices,
+                                                       g_hash_table_lookup (mouse_add, "DEVPATH")),
+                                  mouse_entry));
+}
+
+static void
+test_inventory (Fixture       *fixture,
+                gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(GHashTable) devices = eins_peripherals_scan (fixture->root);
+  g_autoptr(GVariant) inventory = NULL;
+  g_autofree gchar *printed = NULL;
+
+  /* A second, identical mouse */
+  g_hash_table_insert (devices, g_strdup ("/devices/elsewhere/1-2"),
+                       g_variant_ref_sink (g_variant_new ("(sqqu)", "usb",
+                                                          0x046d, 0xc52b, 0)));
+
+  inventory = g_variant_ref_sink (eins_peripherals_build_inventory (devices));
+  printed = g_variant_print (inventory, FALSE);
+  g_assert_cmpstr (printed, ==,
+                   "[('pci', 32902, 5654, 196608), "
+                   "('usb', 1133, 50475, 0), "
+                   "('usb', 1133, 50475, 0)]");
+
+  g_hash_table_remove_all (devices);
+  g_clear_pointer (&inventory, g_variant_unref);
+  inventory = g_variant_ref_sink (eins_peripherals_build_inventory (devices));
+  g_assert_cmpuint (g_variant_n_children (inventory), ==, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/peripherals/uevent/parse", test_parse_uevent);
+  g_test_add_func ("/peripherals/uevent/parse-bad", test_parse_uevent_bad);
+  g_test_add_func ("/peripherals/uevent/entry", test_entry_from_uevent);
+  g_test_add ("/peripherals/scan", Fixture, NULL, setup, test_scan, teardown);
+  g_test_add ("/peripherals/inventory", Fixture, NULL, setup, test_inventory,
+              teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,96 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "eins-psi.h"
+
+static void
+test_parse (void)
+{
+  EinsPsiLine some, full;
+
+  g_assert_true (eins_psi_parse ("some avg10=1.53 avg60=0.87 avg300=0.34 total=123456\n"
+                                 "full avg10=0.50 avg60=0.20 avg300=0.10 total=6543\n",
+                                 &some, &full));
+  g_assert_cmpfloat_with_epsilon (some.avg10, 1.53, 0.001);
+  g_assert_cmpuint (some.total, ==, 123456);
+  g_assert_cmpfloat_with_epsilon (full.avg10, 0.5, 0.001);
+  g_assert_cmpuint (full.total, ==, 6543);
+}
+
+static void
+test_parse_cpu (void)
+{
+  EinsPsiLine some, full;
+
+  /* Kernels before 5.13 have no "full" line for CPU pressure */
+  g_assert_true (eins_psi_parse ("some avg10=0.00 avg60=0.00 avg300=0.00 total=42\n",
+                                 &some, &full));
+  g_assert_cmpuint (some.total, ==, 42);
+  g_assert_cmpuint (full.total, ==, 0);
+}
+
+static void
+test_parse_garbage (void)
+{
+  EinsPsiLine some, full;
+
+  g_assert_false (eins_psi_parse ("", &some, &full));
+  g_assert_false (eins_psi_parse ("full avg10=0.00 avg60=0.00 avg300=0.00 total=1\n",
+                                  &some, &full));
+  g_assert_false (eins_psi_parse ("something avg10=0.00 avg60=0.00 avg300=0.00 total=1\n",
+                                  &some, &full));
+  g_assert_false (eins_psi_parse ("some avg10=0.00\n", &some, &full));
+}
+
+static void
+test_summary (void)
+{
+  EinsPsiSummary summary = { 0 };
+
+  g_assert_cmpuint (eins_psi_summary_percentile (&summary, 50), ==, 0);
+
+  /* 90 samples at 0.2%, 9 at 40.6% and one beyond the range */
+  for (guint i = 0; i < 100; i++)
+    eins_psi_summary_add (&summary, i < 90 ? 0.2 : i < 99 ? 40.6 : 250.);
+
+  g_assert_cmpuint (summary.n_samples, ==, 100);
+  g_assert_cmpuint (eins_psi_summary_percentile (&summary, 50), ==, 0);
+  g_assert_cmpuint (eins_psi_summary_percentile (&summary, 90), ==, 0);
+  g_assert_cmpuint (eins_psi_summary_percentile (&summary, 99), ==, 41);
+  g_assert_cmpuint (eins_psi_summary_percentile (&summary, 100), ==, 100);
+
+  /* Below the range */
+  eins_psi_summary_add (&summary, -1.);
+  g_assert_cmpuint (summary.avg10_buckets[0], ==, 91);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/psi/parse", test_parse);
+  g_test_add_func ("/psi/parse/cpu", test_parse_cpu);
+  g_test_add_func ("/psi/parse/garbage", test_parse_garbage);
+  g_test_add_func ("/psi/summary", test_summary);
+
+  return g_test_run ();
+}
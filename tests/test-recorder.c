@@ -0,0 +1,152 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "eins-recorder.h"
+#include "eins-test-util.h"
+
+#define TEST_EVENT "5e7e7ac0-2d4b-4f5a-9d2c-6b8e0a1f3c42"
+
+typedef EinsTestTmpFixture Fixture;
+
+static void
+setup (Fixture       *fixture,
+       gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(GError) error = NULL;
+
+  eins_test_tmp_fixture_setup (fixture, "events");
+
+  eins_recorder_use_file (fixture->path, &error);
+  g_assert_no_error (error);
+}
+
+static void
+teardown (Fixture       *fixture,
+          gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_test_tmp_fixture_teardown (fixture);
+}
+
+static void
+assert_record (GVariant    *record,
+               gchar        expected_kind,
+               guint32      expected_user_id,
+               const gchar *expected_payload)
+{
+  g_autoptr(GVariant) payload = NULL;
+  const gchar *event_id;
+  guint32 user_id, serial;
+  gint64 timestamp;
+  guint8 kind;
+
+  g_variant_get (record, "(yxuu&smv)",
+                 &kind, &timestamp, &user_id, &serial, &event_id, &payload);
+
+  g_assert_cmpint (kind, ==, expected_kind);
+  g_assert_cmpint (timestamp, >, 0);
+  g_assert_cmpuint (user_id, ==, expected_user_id);
+  g_assert_cmpstr (event_id, ==, TEST_EVENT);
+
+  if (expected_payload == NULL)
+    {
+      g_assert_null (payload);
+    }
+  else
+    {
+      g_autofree gchar *printed = NULL;
+
+      g_assert_nonnull (payload);
+      printed = g_variant_print (payload, FALSE);
+      g_assert_cmpstr (printed, ==, expected_payload);
+    }
+}
+
+static void
+test_round_trip (Fixture       *fixture,
+                 gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(GPtrArray) records = NULL;
+  g_autoptr(GError) error = NULL;
+  EinsAggregateTimer *timer;
+  guint32 start_serial, stop_serial;
+
+  eins_recorder_record_event (TEST_EVENT, g_variant_new_uint32 (42));
+  eins_recorder_record_event_sync (TEST_EVENT, NULL);
+
+  timer = eins_recorder_start_aggregate_timer (1000, TEST_EVENT,
+                                               g_variant_new_string ("x"));
+  g_assert_nonnull (timer);
+  eins_aggregate_timer_stop (timer);
+
+  eins_recorder_flush_sync ();
+
+  records = eins_recorder_load_file (fixture->path, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (records->len, ==, 4);
+
+  assert_record (records->pdata[0], EINS_RECORD_KIND_EVENT, 0, "42");
+  assert_record (records->pdata[1], EINS_RECORD_KIND_EVENT, 0, NULL);
+  assert_record (records->pdata[2], EINS_RECORD_KIND_TIMER_START, 1000, "'x'");
+  assert_record (records->pdata[3], EINS_RECORD_KIND_TIMER_STOP, 1000, "'x'");
+
+  /* The start and stop of a timer can be paired up by their serial */
+  g_variant_get_child (records->pdata[2], 3, "u", &start_serial);
+  g_variant_get_child (records->pdata[3], 3, "u", &stop_serial);
+  g_assert_cmpuint (start_serial, !=, 0);
+  g_assert_cmpuint (start_serial, ==, stop_serial);
+}
+
+static void
+test_truncated (Fixture       *fixture,
+                gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(GPtrArray) records = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *contents = NULL;
+  gsize length;
+
+  eins_recorder_record_event (TEST_EVENT, g_variant_new_uint32 (1));
+  eins_recorder_record_event (TEST_EVENT, g_variant_new_uint32 (2));
+
+  /* Simulate the writer being killed halfway through the second record */
+  g_file_get_contents (fixture->path, &contents, &length, &error);
+  g_assert_no_error (error);
+  g_file_set_contents (fixture->path, contents, length - 3, &error);
+  g_assert_no_error (error);
+
+  records = eins_recorder_load_file (fixture->path, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (records->len, ==, 1);
+  assert_record (records->pdata[0], EINS_RECORD_KIND_EVENT, 0, "1");
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/recorder/round-trip", Fixture, NULL,
+              setup, test_round_trip, teardown);
+  g_test_add ("/recorder/truncated", Fixture, NULL,
+              setup, test_truncated, teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,279 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-ring-store.h"
+#include "eins-test-util.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+typedef EinsTestTmpFixture Fixture;
+
+static void
+setup (Fixture       *fixture,
+       gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_test_tmp_fixture_setup (fixture, "ring-store");
+}
+
+static void
+teardown (Fixture       *fixture,
+          gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_test_tmp_fixture_teardown (fixture);
+}
+
+static void
+assert_samples (GArray  *samples,
+                guint64  first_value,
+                guint    n_samples)
+{
+  g_assert_cmpuint (samples->len, ==, n_samples);
+
+  for (guint i = 0; i < n_samples; i++)
+    {
+      EinsRingSample *sample = &g_array_index (samples, EinsRingSample, i);
+
+      g_assert_cmpint (sample->time, ==, 1000 + first_value + i);
+      g_assert_cmpuint (sample->value, ==, first_value + i);
+    }
+}
+
+static void
+append_range (EinsRingStore *store,
+              gint           series,
+              guint64        first_value,
+              guint          n_samples)
+{
+  for (guint i = 0; i < n_samples; i++)
+    eins_ring_store_append (store, series, 1000 + first_value + i,
+                            first_value + i);
+}
+
+static EinsRingStore *
+open_store (Fixture *fixture,
+            guint    n_series,
+            guint    capacity)
+{
+  g_autoptr(GError) error = NULL;
+  EinsRingStore *store;
+
+  store = eins_ring_store_open (fixture->path, n_series, capacity, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (store);
+
+  return store;
+}
+
+static void
+test_take (Fixture       *fixture,
+           gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsRingStore) store = open_store (fixture, 2, 8);
+  g_autoptr(GArray) samples = NULL;
+  gint a, b;
+
+  a = eins_ring_store_get_series (store, "a");
+  b = eins_ring_store_get_series (store, "b");
+  g_assert_cmpint (a, >=, 0);
+  g_assert_cmpint (b, >=, 0);
+  g_assert_cmpint (a, !=, b);
+  g_assert_cmpint (eins_ring_store_get_series (store, "a"), ==, a);
+
+  append_range (store, a, 0, 3);
+  append_range (store, b, 100, 1);
+  g_assert_cmpuint (eins_ring_store_get_n_pending (store, a), ==, 3);
+  g_assert_cmpuint (eins_ring_store_get_n_pending (store, b), ==, 1);
+
+  samples = eins_ring_store_take (store, a);
+  assert_samples (samples, 0, 3);
+  g_assert_cmpuint (eins_ring_store_get_n_pending (store, a), ==, 0);
+  g_clear_pointer (&samples, g_array_unref);
+
+  samples = eins_ring_store_take (store, a);
+  assert_samples (samples, 0, 0);
+  g_clear_pointer (&samples, g_array_unref);
+
+  append_range (store, a, 3, 2);
+  samples = eins_ring_store_take (store, a);
+  assert_samples (samples, 3, 2);
+  g_clear_pointer (&samples, g_array_unref);
+
+  samples = eins_ring_store_take (store, b);
+  assert_samples (samples, 100, 1);
+}
+
+static void
+test_wrap (Fixture       *fixture,
+           gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsRingStore) store = open_store (fixture, 1, 4);
+  g_autoptr(GArray) samples = NULL;
+  gint series = eins_ring_store_get_series (store, "a");
+
+  /* Only the newest samples are kept */
+  append_range (store, series, 0, 10);
+  g_assert_cmpuint (eins_ring_store_get_n_pending (store, series), ==, 4);
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 6, 4);
+  g_clear_pointer (&samples, g_array_unref);
+
+  append_range (store, series, 10, 3);
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 10, 3);
+}
+
+static void
+test_survives_reopen (Fixture       *fixture,
+                      gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsRingStore) store = open_store (fixture, 2, 8);
+  g_autoptr(GArray) samples = NULL;
+  gint series = eins_ring_store_get_series (store, "a");
+
+  append_range (store, series, 0, 5);
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 0, 5);
+  g_clear_pointer (&samples, g_array_unref);
+  append_range (store, series, 5, 2);
+
+  /* Simulate the daemon dying before the samples were taken. */
+  g_clear_pointer (&store, eins_ring_store_free);
+  store = open_store (fixture, 2, 8);
+
+  g_assert_cmpint (eins_ring_store_get_series (store, "a"), ==, series);
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 5, 2);
+}
+
+static void
+test_geometry_changed (Fixture       *fixture,
+                       gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsRingStore) store = open_store (fixture, 2, 8);
+  g_autoptr(GArray) samples = NULL;
+  gint series = eins_ring_store_get_series (store, "a");
+
+  append_range (store, series, 0, 5);
+  g_clear_pointer (&store, eins_ring_store_free);
+
+  store = open_store (fixture, 2, 16);
+  series = eins_ring_store_get_series (store, "a");
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 0, 0);
+}
+
+static void
+test_corrupt (Fixture       *fixture,
+              gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsRingStore) store = NULL;
+  g_autoptr(GArray) samples = NULL;
+  g_autoptr(GError) error = NULL;
+  gint series;
+
+  g_file_set_contents (fixture->path, "not a ring store", -1, &error);
+  g_assert_no_error (error);
+
+  store = open_store (fixture, 1, 8);
+  series = eins_ring_store_get_series (store, "a");
+  g_assert_cmpint (series, ==, 0);
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 0, 0);
+}
+
+static void
+test_lost_write (Fixture       *fixture,
+                 gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsRingStore) store = open_store (fixture, 1, 4);
+  g_autoptr(GArray) samples = NULL;
+  gint series = eins_ring_store_get_series (store, "a");
+  /* The slots follow the 24-byte header and one 48-byte series header,
+   * rounded up to the 32-byte size of a slot, whose first field is the
+   * sequence number. */
+  const off_t second_slot_offset = 96 + 32;
+  const guint64 stale_sequence = 2;
+  int fd;
+
+  append_range (store, series, 0, 6);
+  g_clear_pointer (&store, eins_ring_store_free);
+
+  /* As if the last sample, in the second slot on its second lap, never
+   * reached the disk while the head did */
+  fd = g_open (fixture->path, O_RDWR, 0);
+  g_assert_cmpint (fd, >=, 0);
+  g_assert_cmpint (pwrite (fd, &stale_sequence, sizeof (stale_sequence),
+                           second_slot_offset), ==, sizeof (stale_sequence));
+  g_assert_cmpint (close (fd), ==, 0);
+
+  store = open_store (fixture, 1, 4);
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 2, 3);
+}
+
+static void
+test_full (Fixture       *fixture,
+           gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsRingStore) store = open_store (fixture, 2, 8);
+  g_autoptr(GHashTable) live_names = g_hash_table_new (g_str_hash, g_str_equal);
+  g_autoptr(GArray) samples = NULL;
+  gint series;
+
+  g_assert_cmpint (eins_ring_store_get_series (store, "a"), >=, 0);
+  series = eins_ring_store_get_series (store, "b");
+  g_assert_cmpint (series, >=, 0);
+  append_range (store, series, 0, 3);
+  g_assert_cmpint (eins_ring_store_get_series (store, "c"), ==, -1);
+
+  g_hash_table_add (live_names, (gpointer) "a");
+  g_assert_cmpuint (eins_ring_store_prune (store, live_names), ==, 1);
+
+  /* The freed series starts out empty */
+  series = eins_ring_store_get_series (store, "c");
+  g_assert_cmpint (series, >=, 0);
+  samples = eins_ring_store_take (store, series);
+  assert_samples (samples, 0, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/ring-store/take", Fixture, NULL,
+              setup, test_take, teardown);
+  g_test_add ("/ring-store/wrap", Fixture, NULL,
+              setup, test_wrap, teardown);
+  g_test_add ("/ring-store/survives-reopen", Fixture, NULL,
+              setup, test_survives_reopen, teardown);
+  g_test_add ("/ring-store/geometry-changed", Fixture, NULL,
+              setup, test_geometry_changed, teardown);
+  g_test_add ("/ring-store/corrupt", Fixture, NULL,
+              setup, test_corrupt, teardown);
+  g_test_add ("/ring-store/lost-write", Fixture, NULL,
+              setup, test_lost_write, teardown);
+  g_test_add ("/ring-store/full", Fixture, NULL,
+              setup, test_full, teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,290 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-clock.h"
+#include "eins-schedule.h"
+#include "eins-test-util.h"
+
+/* 2023-11-14 22:13:20 UTC */
+#define START_TIME (G_GINT64_CONSTANT (1700000000) * G_USEC_PER_SEC)
+
+typedef struct {
+  EinsTestTmpFixture tmp;
+  /* Boottime of each run of the task */
+  GArray *runs;
+} Fixture;
+
+static void
+setup (Fixture       *fixture,
+       gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_test_tmp_fixture_setup (&fixture->tmp, "record_time");
+  fixture->runs = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  eins_schedule_set_record_time_path (fixture->tmp.path);
+  eins_clock_use_virtual (START_TIME);
+}
+
+static void
+teardown (Fixture       *fixture,
+          gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_schedule_remove_all ();
+  eins_schedule_set_record_time_path (NULL);
+
+  eins_test_tmp_fixture_teardown (&fixture->tmp);
+  g_array_unref (fixture->runs);
+}
+
+static void
+record_run (gpointer user_data)
+{
+  Fixture *fixture = user_data;
+  gint64 now = eins_clock_get_boottime ();
+
+  g_array_append_val (fixture->runs, now);
+}
+
+static void
+add_task (Fixture           *fixture,
+          EinsScheduleFlags  flags)
+{
+  eins_schedule_add ("task", G_TIME_SPAN_DAY, flags, record_run, fixture);
+}
+
+static void
+assert_runs (Fixture      *fixture,
+             const gint64 *expected,
+             guint         n_expected)
+{
+  g_assert_cmpuint (fixture->runs->len, ==, n_expected);
+
+  for (guint i = 0; i < n_expected; i++)
+    g_assert_cmpint (g_array_index (fixture->runs, gint64, i), ==,
+                     expected[i]);
+}
+
+static gint64
+get_next_record_time (Fixture *fixture)
+{
+  g_autoptr(GKeyFile) kf = g_key_file_new ();
+  g_autoptr(GError) error = NULL;
+  gint64 next;
+
+  g_key_file_load_from_file (kf, fixture->tmp.path, G_KEY_FILE_NONE, &error);
+  g_assert_no_error (error);
+  next = g_key_file_get_int64 (kf, "task", "next-record-time", &error);
+  g_assert_no_error (error);
+
+  return next;
+}
+
+static void
+set_next_record_time (Fixture *fixture,
+                      gint64   next)
+{
+  g_autoptr(GKeyFile) kf = g_key_file_new ();
+  g_autoptr(GError) error = NULL;
+
+  g_key_file_set_int64 (kf, "task", "next-record-time", next);
+  g_key_file_save_to_file (kf, fixture->tmp.path, &error);
+  g_assert_no_error (error);
+}
+
+static void
+test_interval (Fixture       *fixture,
+               gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = {
+    1 * G_TIME_SPAN_DAY, 2 * G_TIME_SPAN_DAY, 3 * G_TIME_SPAN_DAY,
+    4 * G_TIME_SPAN_DAY, 5 * G_TIME_SPAN_DAY, 6 * G_TIME_SPAN_DAY,
+    7 * G_TIME_SPAN_DAY,
+  };
+
+  add_task (fixture, EINS_SCHEDULE_FLAGS_NONE);
+  eins_clock_advance (7 * G_TIME_SPAN_DAY + G_TIME_SPAN_HOUR);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+  g_assert_false (g_file_test (fixture->tmp.path, G_FILE_TEST_EXISTS));
+}
+
+static void
+test_run_immediately (Fixture       *fixture,
+                      gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = { 0, G_TIME_SPAN_DAY };
+
+  add_task (fixture, EINS_SCHEDULE_FLAGS_RUN_IMMEDIATELY);
+  eins_clock_advance (G_TIME_SPAN_DAY);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+static void
+test_persistent_first_run (Fixture       *fixture,
+                           gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = { G_TIME_SPAN_DAY };
+
+  /* Remembered at once, so that a restart doesn't postpone it */
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  g_assert_cmpint (get_next_record_time (fixture), ==,
+                   START_TIME + G_TIME_SPAN_DAY);
+
+  eins_clock_advance (G_TIME_SPAN_DAY);
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+  g_assert_cmpint (get_next_record_time (fixture), ==,
+                   START_TIME + 2 * G_TIME_SPAN_DAY);
+}
+
+static void
+test_persistent_stale (Fixture       *fixture,
+                       gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = { 0, G_TIME_SPAN_DAY };
+
+  /* The system was off when it was due */
+  set_next_record_time (fixture, START_TIME - 3 * G_TIME_SPAN_DAY);
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (G_TIME_SPAN_DAY);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+static void
+test_persistent_not_due (Fixture       *fixture,
+                         gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = {
+    6 * G_TIME_SPAN_HOUR, 6 * G_TIME_SPAN_HOUR + G_TIME_SPAN_DAY,
+  };
+
+  set_next_record_time (fixture, START_TIME + 6 * G_TIME_SPAN_HOUR);
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (2 * G_TIME_SPAN_DAY);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+static void
+test_persistent_clock_backwards (Fixture       *fixture,
+                                 gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = { G_TIME_SPAN_DAY };
+
+  /* Saved while the clock was 10 days fast: wait no more than an interval */
+  set_next_record_time (fixture, START_TIME + 10 * G_TIME_SPAN_DAY);
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (G_TIME_SPAN_DAY);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+static void
+test_real_time_jump (Fixture       *fixture,
+                     gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = { G_TIME_SPAN_DAY };
+  gint64 corrected_time = START_TIME + 5 * G_TIME_SPAN_DAY;
+
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (12 * G_TIME_SPAN_HOUR);
+
+  /* Setting the clock doesn't move a boottime timer, but the next time
+   * saved follows the new clock */
+  eins_clock_set_real_time (corrected_time);
+  eins_clock_advance (12 * G_TIME_SPAN_HOUR);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+  g_assert_cmpint (get_next_record_time (fixture), ==,
+                   corrected_time + 12 * G_TIME_SPAN_HOUR + G_TIME_SPAN_DAY);
+}
+
+static void
+test_persistent_restart (Fixture       *fixture,
+                         gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = {
+    1 * G_TIME_SPAN_DAY, 2 * G_TIME_SPAN_DAY, 3 * G_TIME_SPAN_DAY,
+    5 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR,
+    6 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR,
+  };
+
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (3 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR);
+
+  /* The daemon isn't running when the task is next due, so it runs as soon
+   * as the daemon starts again */
+  eins_schedule_remove_all ();
+  eins_clock_advance (2 * G_TIME_SPAN_DAY);
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (1 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+static void
+test_persistent_remove (Fixture       *fixture,
+                        gconstpointer  data G_GNUC_UNUSED)
+{
+  const gint64 expected[] = {
+    1 * G_TIME_SPAN_DAY,
+    2 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR,
+    3 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR,
+  };
+
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (1 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR);
+
+  /* As when its collector is disabled and enabled again */
+  eins_schedule_remove ("task");
+  eins_clock_advance (1 * G_TIME_SPAN_DAY);
+  add_task (fixture, EINS_SCHEDULE_FLAGS_PERSISTENT);
+  eins_clock_advance (1 * G_TIME_SPAN_DAY + 12 * G_TIME_SPAN_HOUR);
+
+  assert_runs (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/schedule/interval", Fixture, NULL,
+              setup, test_interval, teardown);
+  g_test_add ("/schedule/run-immediately", Fixture, NULL,
+              setup, test_run_immediately, teardown);
+  g_test_add ("/schedule/persistent/first-run", Fixture, NULL,
+              setup, test_persistent_first_run, teardown);
+  g_test_add ("/schedule/persistent/stale", Fixture, NULL,
+              setup, test_persistent_stale, teardown);
+  g_test_add ("/schedule/persistent/not-due", Fixture, NULL,
+              setup, test_persistent_not_due, teardown);
+  g_test_add ("/schedule/persistent/clock-backwards", Fixture, NULL,
+              setup, test_persistent_clock_backwards, teardown);
+  g_test_add ("/schedule/persistent/restart", Fixture, NULL,
+              setup, test_persistent_restart, teardown);
+  g_test_add ("/schedule/persistent/remove", Fixture, NULL,
+              setup, test_persistent_remove, teardown);
+  g_test_add ("/schedule/real-time-jump", Fixture, NULL,
+              setup, test_real_time_jump, teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,149 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-session-checkpoint.h"
+#include "eins-test-util.h"
+
+typedef EinsTestTmpFixture Fixture;
+
+static void
+setup (Fixture       *fixture,
+       gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_test_tmp_fixture_setup (fixture, "session-checkpoint");
+}
+
+static void
+teardown (Fixture       *fixture,
+          gconstpointer  data G_GNUC_UNUSED)
+{
+  eins_test_tmp_fixture_teardown (fixture);
+}
+
+static void
+test_survives_reopen (Fixture       *fixture,
+                      gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsSessionCheckpoint) checkpoint = NULL;
+  g_autoptr(GError) error = NULL;
+  gint64 start_time, accumulated;
+
+  checkpoint = eins_session_checkpoint_open (fixture->path, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (checkpoint);
+
+  g_assert_false (eins_session_checkpoint_lookup (checkpoint, 1000, NULL, NULL));
+  g_assert_true (eins_session_checkpoint_update (checkpoint, 1000, 12345, 600));
+  g_assert_true (eins_session_checkpoint_update (checkpoint, 1001, 23456, 0));
+
+  /* Simulate the daemon dying without removing its sessions. */
+  g_clear_pointer (&checkpoint, eins_session_checkpoint_free);
+
+  checkpoint = eins_session_checkpoint_open (fixture->path, &error);
+  g_assert_no_error (error);
+
+  g_assert_true (eins_session_checkpoint_lookup (checkpoint, 1000,
+                                                 &start_time, &accumulated));
+  g_assert_cmpint (start_time, ==, 12345);
+  g_assert_cmpint (accumulated, ==, 600);
+
+  eins_session_checkpoint_remove (checkpoint, 1000);
+  g_assert_false (eins_session_checkpoint_lookup (checkpoint, 1000, NULL, NULL));
+  g_assert_true (eins_session_checkpoint_lookup (checkpoint, 1001, NULL, NULL));
+}
+
+static void
+test_prune (Fixture       *fixture,
+            gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsSessionCheckpoint) checkpoint = NULL;
+  g_autoptr(GHashTable) live = g_hash_table_new (NULL, NULL);
+  g_autoptr(GError) error = NULL;
+
+  checkpoint = eins_session_checkpoint_open (fixture->path, &error);
+  g_assert_no_error (error);
+
+  g_assert_true (eins_session_checkpoint_update (checkpoint, 1000, 1, 0));
+  g_assert_true (eins_session_checkpoint_update (checkpoint, 1001, 2, 0));
+  g_assert_true (eins_session_checkpoint_update (checkpoint, 1002, 3, 0));
+
+  g_hash_table_add (live, GUINT_TO_POINTER (1001));
+
+  g_assert_cmpuint (eins_session_checkpoint_prune (checkpoint, live), ==, 2);
+  g_assert_false (eins_session_checkpoint_lookup (checkpoint, 1000, NULL, NULL));
+  g_assert_true (eins_session_checkpoint_lookup (checkpoint, 1001, NULL, NULL));
+  g_assert_false (eins_session_checkpoint_lookup (checkpoint, 1002, NULL, NULL));
+}
+
+static void
+test_full (Fixture       *fixture,
+           gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsSessionCheckpoint) checkpoint = NULL;
+  g_autoptr(GError) error = NULL;
+  guint32 user_id;
+
+  checkpoint = eins_session_checkpoint_open (fixture->path, &error);
+  g_assert_no_error (error);
+
+  for (user_id = 1000; eins_session_checkpoint_update (checkpoint, user_id, 0, 0); user_id++)
+    g_assert_cmpuint (user_id, <, 2000);
+
+  /* Existing slots can still be updated once the file is full. */
+  g_assert_true (eins_session_checkpoint_update (checkpoint, 1000, 1, 1));
+
+  eins_session_checkpoint_remove (checkpoint, 1000);
+  g_assert_true (eins_session_checkpoint_update (checkpoint, user_id, 0, 0));
+}
+
+static void
+test_garbage (Fixture       *fixture,
+              gconstpointer  data G_GNUC_UNUSED)
+{
+  g_autoptr(EinsSessionCheckpoint) checkpoint = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_file_set_contents (fixture->path, "not a checkpoint", -1, &error);
+  g_assert_no_error (error);
+
+  checkpoint = eins_session_checkpoint_open (fixture->path, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (checkpoint);
+
+  g_assert_false (eins_session_checkpoint_lookup (checkpoint, 1000, NULL, NULL));
+  g_assert_true (eins_session_checkpoint_update (checkpoint, 1000, 1, 0));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/session-checkpoint/survives-reopen", Fixture, NULL,
+              setup, test_survives_reopen, teardown);
+  g_test_add ("/session-checkpoint/prune", Fixture, NULL,
+              setup, test_prune, teardown);
+  g_test_add ("/session-checkpoint/full", Fixture, NULL,
+              setup, test_full, teardown);
+  g_test_add ("/session-checkpoint/garbage", Fixture, NULL,
+              setup, test_garbage, teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,106 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-sleep.h"
+#include "eins-stats.h"
+
+static void
+assert_histogram (GVariant *summary,
+                  gsize     index,
+                  guint64   count,
+                  guint64   sum,
+                  guint64   max)
+{
+  g_autoptr(GVariant) histogram = g_variant_get_child_value (summary, index);
+  guint64 actual_count, actual_sum, actual_max;
+
+  g_variant_get (histogram, "(ttt@au)",
+                 &actual_count, &actual_sum, &actual_max, NULL);
+  g_assert_cmpuint (actual_count, ==, count);
+  g_assert_cmpuint (actual_sum, ==, sum);
+  g_assert_cmpuint (actual_max, ==, max);
+}
+
+static void
+test_summary (void)
+{
+  EinsSleepTimestamp before = { 100 * G_USEC_PER_SEC, 100 * G_USEC_PER_SEC };
+  EinsSleepTimestamp after;
+  g_autoptr(GVariant) summary = NULL;
+
+  g_assert_null (eins_sleep_take_summary ());
+
+  /* 1.5 s awake in total, an hour asleep */
+  eins_sleep_prepare_for_sleep (TRUE, &before);
+  after.monotonic_us = before.monotonic_us + 1500 * 1000;
+  after.boottime_us = after.monotonic_us + G_TIME_SPAN_HOUR;
+  eins_sleep_prepare_for_sleep (FALSE, &after);
+
+  /* 500 ms awake, suspend failed */
+  before = after;
+  eins_sleep_prepare_for_sleep (TRUE, &before);
+  after.monotonic_us = before.monotonic_us + 500 * 1000;
+  after.boottime_us = before.boottime_us + 500 * 1000;
+  eins_sleep_prepare_for_sleep (FALSE, &after);
+
+  summary = g_variant_ref_sink (eins_sleep_take_summary ());
+  g_assert_true (g_variant_is_of_type (summary,
+                                       G_VARIANT_TYPE ("(" EINS_HISTOGRAM_TYPE_STRING
+                                                       EINS_HISTOGRAM_TYPE_STRING ")")));
+  assert_histogram (summary, 0, 2, 2000, 1500);
+  assert_histogram (summary, 1, 2, 3600, 3600);
+
+  g_assert_null (eins_sleep_take_summary ());
+}
+
+static void
+test_unmatched (void)
+{
+  EinsSleepTimestamp now = { G_USEC_PER_SEC, G_USEC_PER_SEC };
+  g_autoptr(GVariant) summary = NULL;
+
+  /* Resuming without having seen the system go to sleep */
+  eins_sleep_prepare_for_sleep (FALSE, &now);
+  g_assert_null (eins_sleep_take_summary ());
+
+  /* A second PrepareForSleep (true) restarts the interval */
+  eins_sleep_prepare_for_sleep (TRUE, &now);
+  now.monotonic_us += G_USEC_PER_SEC;
+  now.boottime_us += G_USEC_PER_SEC;
+  eins_sleep_prepare_for_sleep (TRUE, &now);
+  now.monotonic_us += 200 * 1000;
+  now.boottime_us += 200 * 1000;
+  eins_sleep_prepare_for_sleep (FALSE, &now);
+
+  summary = g_variant_ref_sink (eins_sleep_take_summary ());
+  assert_histogram (summary, 0, 1, 200, 200);
+  assert_histogram (summary, 1, 1, 0, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sleep/summary", test_summary);
+  g_test_add_func ("/sleep/unmatched", test_unmatched);
+
+  return g_test_run ();
+}
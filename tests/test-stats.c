@@ -0,0 +1,194 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-stats.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+static void
+test_histogram_empty (void)
+{
+  EinsHistogram histogram = { 0 };
+
+  g_assert_cmpuint (eins_histogram_percentile (&histogram, 50), ==, 0);
+  g_assert_cmpuint (eins_histogram_percentile (&histogram, 100), ==, 0);
+}
+
+static void
+test_histogram_percentiles (void)
+{
+  EinsHistogram histogram = { 0 };
+
+  for (guint64 i = 1; i <= 100; i++)
+    eins_histogram_add (&histogram, i);
+
+  g_assert_cmpuint (histogram.count, ==, 100);
+  g_assert_cmpuint (histogram.sum, ==, 5050);
+  g_assert_cmpuint (histogram.max, ==, 100);
+
+  /* 1 is alone in its bucket */
+  g_assert_cmpuint (eins_histogram_percentile (&histogram, 0), ==, 1);
+  /* 50 is in [32, 64) */
+  g_assert_cmpuint (eins_histogram_percentile (&histogram, 50), ==, 63);
+  /* 99 is in [64, 128), clamped to the maximum */
+  g_assert_cmpuint (eins_histogram_percentile (&histogram, 99), ==, 100);
+}
+
+static void
+test_histogram_extremes (void)
+{
+  EinsHistogram histogram = { 0 };
+
+  eins_histogram_add (&histogram, 0);
+  eins_histogram_add (&histogram, G_MAXUINT64);
+
+  g_assert_cmpuint (histogram.buckets[0], ==, 1);
+  g_assert_cmpuint (histogram.buckets[EINS_HISTOGRAM_N_BUCKETS - 1], ==, 1);
+  g_assert_cmpuint (eins_histogram_percentile (&histogram, 50), ==, 0);
+  g_assert_cmpuint (eins_histogram_percentile (&histogram, 100), ==, G_MAXUINT64);
+}
+
+static void
+test_histogram_variant (void)
+{
+  EinsHistogram histogram = { 0 }, copy;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariant) buckets = NULL;
+
+  eins_histogram_add (&histogram, 3);
+  eins_histogram_add (&histogram, 1000);
+
+  variant = g_variant_ref_sink (eins_histogram_to_variant (&histogram));
+  g_assert_cmpstr (g_variant_get_type_string (variant), ==,
+                   EINS_HISTOGRAM_TYPE_STRING);
+
+  /* 1000 is in [512, 1024); the empty buckets above it are left out */
+  buckets = g_variant_get_child_value (variant, 3);
+  g_assert_cmpuint (g_variant_n_children (buckets), ==, 11);
+
+  g_assert_true (eins_histogram_from_variant (variant, &copy));
+  g_assert_cmpmem (&histogram, sizeof histogram, &copy, sizeof copy);
+}
+
+static void
+test_percentile_rank (void)
+{
+  g_assert_cmpuint (eins_percentile_rank (0, 50), ==, 0);
+  g_assert_cmpuint (eins_percentile_rank (1, 0), ==, 1);
+  g_assert_cmpuint (eins_percentile_rank (100, 50), ==, 50);
+  g_assert_cmpuint (eins_percentile_rank (100, 100), ==, 100);
+  /* Rounded up */
+  g_assert_cmpuint (eins_percentile_rank (10, 95), ==, 10);
+  g_assert_cmpuint (eins_percentile_rank (3, 50), ==, 2);
+}
+
+static void
+test_buckets_percentile (void)
+{
+  guint32 buckets[4] = { 0 };
+
+  g_assert_cmpuint (eins_buckets_percentile (buckets, 4, 50), ==, 0);
+
+  buckets[1] = 90;
+  buckets[3] = 10;
+  g_assert_cmpuint (eins_buckets_percentile (buckets, 4, 0), ==, 1);
+  g_assert_cmpuint (eins_buckets_percentile (buckets, 4, 90), ==, 1);
+  g_assert_cmpuint (eins_buckets_percentile (buckets, 4, 91), ==, 3);
+  g_assert_cmpuint (eins_buckets_percentile (buckets, 4, 100), ==, 3);
+}
+
+static void
+test_read_fd (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+  gchar buffer[4];
+  gint64 value = 0;
+  int fd;
+
+  fd = g_file_open_tmp ("test-stats-XXXXXX", &path, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (write (fd, "42\n", 3), ==, 3);
+
+  /* Read from the start each time */
+  for (guint i = 0; i < 2; i++)
+    {
+      g_assert_true (eins_read_fd_int64 (fd, &value));
+      g_assert_cmpint (value, ==, 42);
+    }
+
+  /* Truncated to fit, and nul-terminated */
+  g_assert_cmpint (eins_read_fd (fd, buffer, 2), ==, 1);
+  g_assert_cmpstr (buffer, ==, "4");
+
+  g_assert_cmpint (pwrite (fd, "x", 1, 0), ==, 1);
+  g_assert_false (eins_read_fd_int64 (fd, &value));
+
+  g_assert_cmpint (ftruncate (fd, 0), ==, 0);
+  g_assert_false (eins_read_fd_int64 (fd, &value));
+
+  g_close (fd, NULL);
+  g_unlink (path);
+
+  g_assert_false (eins_read_fd_int64 (-1, &value));
+}
+
+static void
+test_snapshot (void)
+{
+  g_autoptr(GVariant) stats = NULL;
+  g_autofree gchar *formatted = NULL;
+  guint64 login_signals;
+
+  eins_stats_counter_inc (EINS_STATS_COUNTER_LOGIN_SIGNALS);
+  eins_stats_counter_inc (EINS_STATS_COUNTER_LOGIN_SIGNALS);
+  eins_stats_gauge_set (EINS_STATS_GAUGE_ACTIVE_SESSIONS, 7);
+  eins_stats_histogram_add (EINS_STATS_HISTOGRAM_DBUS_CALL_US, 250);
+
+  stats = g_variant_ref_sink (eins_stats_snapshot ());
+
+  g_assert_true (g_variant_lookup (stats, "login-signals", "t", &login_signals));
+  g_assert_cmpuint (login_signals, ==, 2);
+
+  formatted = eins_stats_format (stats);
+  g_assert_nonnull (strstr (formatted, "login-signals: 2\n"));
+  g_assert_nonnull (strstr (formatted, "active-sessions: 7\n"));
+  g_assert_nonnull (strstr (formatted, "dbus-call-us: count=1 mean=250 "));
+  g_assert_nonnull (strstr (formatted, "rss-bytes: "));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/stats/histogram/empty", test_histogram_empty);
+  g_test_add_func ("/stats/histogram/percentiles", test_histogram_percentiles);
+  g_test_add_func ("/stats/histogram/extremes", test_histogram_extremes);
+  g_test_add_func ("/stats/histogram/variant", test_histogram_variant);
+  g_test_add_func ("/stats/percentile-rank", test_percentile_rank);
+  g_test_add_func ("/stats/buckets-percentile", test_buckets_percentile);
+  g_test_add_func ("/stats/read-fd", test_read_fd);
+  g_test_add_func ("/stats/snapshot", test_snapshot);
+
+  return g_test_run ();
+}
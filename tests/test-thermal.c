@@ -0,0 +1,314 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "eins-thermal.h"
+#include "eins-test-util.h"
+
+static void
+test_percentile (void)
+{
+  EinsThermalSummary summary = { 0 };
+
+  g_assert_cmpuint (eins_thermal_summary_percentile (&summary, 50), ==, 0);
+
+  for (guint i = 0; i < 90; i++)
+    eins_thermal_summary_add (&summary, 45500);
+  for (guint i = 0; i < 9; i++)
+    eins_thermal_summary_add (&summary, 80000);
+  eins_thermal_summary_add (&summary, 250000);
+
+  g_assert_cmpuint (summary.n_samples, ==, 100);
+  g_assert_cmpuint (eins_thermal_summary_percentile (&summary, 50), ==, 45);
+  g_assert_cmpuint (eins_thermal_summary_percentile (&summary, 90), ==, 45);
+  g_assert_cmpuint (eins_thermal_summary_percentile (&summary, 99), ==, 80);
+  g_assert_cmpuint (eins_thermal_summary_percentile (&summary, 100), ==, 127);
+
+  /* Below freezing */
+  eins_thermal_summary_add (&summary, -5000);
+  g_assert_cmpuint (summary.buckets[0], ==, 1);
+}
+
+static void
+add_cpu (const gchar *root,
+         const gchar *name,
+         const gchar *package_id,
+         const gchar *core_id,
+         const gchar *package_throttles,
+         const gchar *core_throttles)
+{
+  g_autofree gchar *cpu = g_build_filename (root, "devices", "system", "cpu",
+                                            name, NULL);
+  g_autofree gchar *topology = g_build_filename (cpu, "topology", NULL);
+  g_autofree gchar *throttle = g_build_filename (cpu, "thermal_throttle", NULL);
+
+  eins_test_write_file (topology, "physical_package_id", package_id);
+  eins_test_write_file (topology, "core_id", core_id);
+  eins_test_write_file (throttle, "package_throttle_count", package_throttles);
+  eins_test_write_file (throttle, "core_throttle_count", core_throttles);
+}
+
+static void
+test_sample (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *cpufreq = NULL;
+  g_autofree gchar *zones = NULL;
+  g_autofree gchar *cooling_device = NULL;
+  g_autofree gchar *zone0 = NULL;
+  g_autofree gchar *zone2 = NULL;
+  g_autofree gchar *zone10 = NULL;
+  g_autofree gchar *store = NULL;
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) packages = NULL;
+  g_autoptr(GVariant) zone_summaries = NULL;
+  guint32 n_samples;
+  guint16 package_id;
+  guint64 package_throttles, core_throttles;
+  const gchar *type;
+  guint8 p50, p90, p99, max;
+
+  root = g_dir_make_tmp ("test-thermal-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  /* Two hyperthreads of one core, which share its count, then another
+   * package */
+  add_cpu (root, "cpu0", "0\n", "0\n", "10\n", "3\n");
+  add_cpu (root, "cpu1", "0\n", "0\n", "10\n", "3\n");
+  add_cpu (root, "cpu2", "1\n", "0\n", "0\n", "0\n");
+  cpufreq = g_build_filename (root, "devices", "system", "cpu", "cpufreq",
+                              NULL);
+  eins_test_write_file (cpufreq, "boost", "1\n");
+
+  zones = g_build_filename (root, "class", "thermal", NULL);
+  zone0 = g_build_filename (zones, "thermal_zone0", NULL);
+  zone2 = g_build_filename (zones, "thermal_zone2", NULL);
+  zone10 = g_build_filename (zones, "thermal_zone10", NULL);
+  cooling_device = g_build_filename (zones, "cooling_device0", NULL);
+  eins_test_write_file (zone0, "type", "x86_pkg_temp\n");
+  eins_test_write_file (zone0, "temp", "50000\n");
+  eins_test_write_file (zone2, "type", "acpitz\n");
+  eins_test_write_file (zone2, "temp", "40000\n");
+  eins_test_write_file (zone10, "type", "iwlwifi_1\n");
+  eins_test_write_file (zone10, "temp", "30000\n");
+  eins_test_write_file (cooling_device, "type", "Processor\n");
+  store = g_build_filename (root, "thermal-samples", NULL);
+
+  g_assert_true (eins_thermal_open (root, store));
+  eins_thermal_sample ();
+
+  add_cpu (root, "cpu0", "0\n", "0\n", "15\n", "7\n");
+  add_cpu (root, "cpu1", "0\n", "0\n", "15\n", "7\n");
+  eins_test_write_file (zone0, "temp", "90000\n");
+  eins_thermal_sample ();
+
+  summary = g_variant_ref_sink (eins_thermal_take_summary ());
+  g_assert_true (g_variant_is_of_type (summary,
+                                       G_VARIANT_TYPE ("(ua(qtt)a(syyyy))")));
+  g_variant_get (summary, "(u@a(qtt)@a(syyyy))", &n_samples, &packages,
+                 &zone_summaries);
+  g_assert_cmpuint (n_samples, ==, 2);
+
+  g_assert_cmpuint (g_variant_n_children (packages), ==, 2);
+  g_variant_get_child (packages, 0, "(qtt)", &package_id, &package_throttles,
+                       &core_throttles);
+  g_assert_cmpuint (package_id, ==, 0);
+  g_assert_cmpuint (package_throttles, ==, 5);
+  g_assert_cmpuint (core_throttles, ==, 4);
+  g_variant_get_child (packages, 1, "(qtt)", &package_id, &package_throttles,
+                       &core_throttles);
+  g_assert_cmpuint (package_id, ==, 1);
+  g_assert_cmpuint (package_throttles, ==, 0);
+
+  g_assert_cmpuint (g_variant_n_children (zone_summaries), ==, 3);
+  g_variant_get_child (zone_summaries, 0, "(&syyyy)", &type, &p50, &p90, &p99,
+                       &max);
+  g_assert_cmpstr (type, ==, "x86_pkg_temp");
+  g_assert_cmpuint (p50, ==, 50);
+  g_assert_cmpuint (max, ==, 90);
+  g_variant_get_child (zone_summaries, 1, "(&syyyy)", &type, &p50, &p90, &p99,
+                       &max);
+  g_assert_cmpstr (type, ==, "acpitz");
+  g_variant_get_child (zone_summaries, 2, "(&syyyy)", &type, &p50, &p90, &p99,
+                       &max);
+  g_assert_cmpstr (type, ==, "iwlwifi_1");
+
+  /* The next day carries on from the last sample */
+  g_clear_pointer (&summary, g_variant_unref);
+  g_clear_pointer (&packages, g_variant_unref);
+  eins_thermal_sample ();
+  summary = g_variant_ref_sink (eins_thermal_take_summary ());
+  g_variant_get (summary, "(u@a(qtt)@a(syyyy))", &n_samples, &packages, NULL);
+  g_assert_cmpuint (n_samples, ==, 1);
+  g_variant_get_child (packages, 0, "(qtt)", &package_id, &package_throttles,
+                       &core_throttles);
+  g_assert_cmpuint (package_throttles, ==, 0);
+  g_assert_cmpuint (core_throttles, ==, 0);
+
+  eins_thermal_close ();
+  eins_test_rm_rf (root);
+}
+
+/* As when the CPU goes offline: reads from the descriptors already open
+ * fail, and the files are gone */
+static void
+remove_cpu_throttle (const gchar *root,
+                     const gchar *name)
+{
+  g_autofree gchar *throttle = g_build_filename (root, "devices", "system",
+                                                 "cpu", name,
+                                                 "thermal_throttle", NULL);
+
+  eins_test_write_file (throttle, "package_throttle_count", "");
+  eins_test_write_file (throttle, "core_throttle_count", "");
+  eins_test_rm_rf (throttle);
+}
+
+static void
+test_cpu_offline (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *store = NULL;
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) packages = NULL;
+  guint16 package_id;
+  guint64 package_throttles, core_throttles;
+
+  root = g_dir_make_tmp ("test-thermal-XXXXXX", &error);
+  g_assert_no_error (error);
+  store = g_build_filename (root, "thermal-samples", NULL);
+
+  /* cpu1 is the only CPU of its package, so the package's count is read
+   * from a CPU which goes offline on suspend */
+  add_cpu (root, "cpu0", "0\n", "0\n", "100\n", "50\n");
+  add_cpu (root, "cpu1", "1\n", "0\n", "10\n", "4\n");
+
+  g_assert_true (eins_thermal_open (root, store));
+  eins_thermal_sample ();
+
+  add_cpu (root, "cpu1", "1\n", "0\n", "12\n", "6\n");
+  eins_thermal_sample ();
+
+  /* Suspend */
+  remove_cpu_throttle (root, "cpu1");
+  eins_thermal_sample ();
+
+  /* Resume, with the counts reset */
+  add_cpu (root, "cpu1", "1\n", "0\n", "1\n", "2\n");
+  eins_thermal_sample ();
+
+  add_cpu (root, "cpu1", "1\n", "0\n", "3\n", "5\n");
+  eins_thermal_sample ();
+
+  summary = g_variant_ref_sink (eins_thermal_take_summary ());
+  g_variant_get (summary, "(u@a(qtt)a(syyyy))", NULL, &packages, NULL);
+  g_assert_cmpuint (g_variant_n_children (packages), ==, 2);
+
+  g_variant_get_child (packages, 0, "(qtt)", &package_id, &package_throttles,
+                       &core_throttles);
+  g_assert_cmpuint (package_id, ==, 0);
+  g_assert_cmpuint (package_throttles, ==, 0);
+  g_assert_cmpuint (core_throttles, ==, 0);
+
+  /* 2 before the suspend, then 1 and 2 after it */
+  g_variant_get_child (packages, 1, "(qtt)", &package_id, &package_throttles,
+                       &core_throttles);
+  g_assert_cmpuint (package_id, ==, 1);
+  g_assert_cmpuint (package_throttles, ==, 5);
+  g_assert_cmpuint (core_throttles, ==, 7);
+
+  eins_thermal_close ();
+  eins_test_rm_rf (root);
+}
+
+static void
+test_restart (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *root = NULL;
+  g_autofree gchar *zone0 = NULL;
+  g_autofree gchar *store = NULL;
+  g_autoptr(GVariant) summary = NULL;
+  g_autoptr(GVariant) packages = NULL;
+  g_autoptr(GVariant) zone_summaries = NULL;
+  guint32 n_samples;
+  guint16 package_id;
+  guint64 package_throttles, core_throttles;
+  const gchar *type;
+  guint8 p50, p90, p99, max;
+
+  root = g_dir_make_tmp ("test-thermal-XXXXXX", &error);
+  g_assert_no_error (error);
+  zone0 = g_build_filename (root, "class", "thermal", "thermal_zone0", NULL);
+  store = g_build_filename (root, "thermal-samples", NULL);
+
+  add_cpu (root, "cpu0", "0\n", "0\n", "10\n", "3\n");
+  eins_test_write_file (zone0, "type", "acpitz\n");
+  eins_test_write_file (zone0, "temp", "40000\n");
+
+  g_assert_true (eins_thermal_open (root, store));
+  eins_thermal_sample ();
+  add_cpu (root, "cpu0", "0\n", "0\n", "14\n", "5\n");
+  eins_test_write_file (zone0, "temp", "80000\n");
+  eins_thermal_sample ();
+  eins_thermal_close ();
+
+  /* The samples taken before the restart are kept, and the counts carry on
+   * from wherever they are when the daemon is started again */
+  add_cpu (root, "cpu0", "0\n", "0\n", "20\n", "9\n");
+  eins_test_write_file (zone0, "temp", "60000\n");
+  g_assert_true (eins_thermal_open (root, store));
+  eins_thermal_sample ();
+  add_cpu (root, "cpu0", "0\n", "0\n", "21\n", "9\n");
+  eins_thermal_sample ();
+
+  summary = g_variant_ref_sink (eins_thermal_take_summary ());
+  g_variant_get (summary, "(u@a(qtt)@a(syyyy))", &n_samples, &packages,
+                 &zone_summaries);
+  g_assert_cmpuint (n_samples, ==, 4);
+
+  g_variant_get_child (packages, 0, "(qtt)", &package_id, &package_throttles,
+                       &core_throttles);
+  g_assert_cmpuint (package_throttles, ==, 5);
+  g_assert_cmpuint (core_throttles, ==, 2);
+
+  g_variant_get_child (zone_summaries, 0, "(&syyyy)", &type, &p50, &p90, &p99,
+                       &max);
+  g_assert_cmpstr (type, ==, "acpitz");
+  g_assert_cmpuint (p50, ==, 60);
+  g_assert_cmpuint (max, ==, 80);
+
+  eins_thermal_close ();
+  eins_test_rm_rf (root);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/thermal/percentile", test_percentile);
+  g_test_add_func ("/thermal/sample", test_sample);
+  g_test_add_func ("/thermal/cpu-offline", test_cpu_offline);
+  g_test_add_func ("/thermal/restart", test_restart);
+
+  return g_test_run ();
+}
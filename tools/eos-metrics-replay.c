@@ -0,0 +1,189 @@
+/* Copyright 2026 Endless OS Foundation LLC. */
+
+/* This file is part of eos-metrics-instrumentation.
+ *
+ * eos-metrics-instrumentation is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * eos-metrics-instrumentation is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with eos-metrics-instrumentation.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Replays events captured with EINS_RECORDER_FILE, for load testing. Events
+ * are sent through the same recorder backend as the daemon's, so by default
+ * they go to the real event recorder; set EINS_RECORDER_FILE to capture them
+ * again instead.
+ */
+
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "eins-recorder.h"
+
+static gdouble rate = 0;
+static gdouble speed = 0;
+static gint repeat = 1;
+
+static GOptionEntry entries[] = {
+  { "rate", 'r', 0, G_OPTION_ARG_DOUBLE, &rate,
+    "Replay this many records per second (default: as fast as possible)",
+    "N" },
+  { "speed", 's', 0, G_OPTION_ARG_DOUBLE, &speed,
+    "Keep the recorded spacing between records, sped up by this factor",
+    "FACTOR" },
+  { "repeat", 'n', 0, G_OPTION_ARG_INT, &repeat,
+    "Replay the file this many times (default: 1)", "N" },
+  { NULL }
+};
+
+static gint64
+timeval_to_usec (const struct timeval *tv)
+{
+  return (gint64) tv->tv_sec * G_USEC_PER_SEC + tv->tv_usec;
+}
+
+static void
+replay_record (GVariant   *record,
+               GHashTable *timer_by_serial)
+{
+  g_autoptr(GVariant) payload = NULL;
+  const gchar *event_id;
+  guint32 user_id, serial;
+  gint64 timestamp;
+  guint8 kind;
+  EinsAggregateTimer *timer;
+
+  g_variant_get (record, "(yxuu&smv)",
+                 &kind, &timestamp, &user_id, &serial, &event_id, &payload);
+
+  switch (kind)
+    {
+    case EINS_RECORD_KIND_EVENT:
+      eins_recorder_record_event (event_id, payload);
+      break;
+
+    case EINS_RECORD_KIND_TIMER_START:
+      timer = eins_recorder_start_aggregate_timer (user_id, event_id, payload);
+      if (timer != NULL)
+        g_hash_table_replace (timer_by_serial, GUINT_TO_POINTER (serial),
+                              timer);
+      break;
+
+    case EINS_RECORD_KIND_TIMER_STOP:
+      g_hash_table_remove (timer_by_serial, GUINT_TO_POINTER (serial));
+      break;
+
+    default:
+      g_warning ("Skipping record of unknown kind '%c'", kind);
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GPtrArray) records = NULL;
+  g_autoptr(GHashTable) timer_by_serial = NULL;
+  g_autoptr(GError) error = NULL;
+  struct rusage usage;
+  gint64 first_timestamp = 0, start_time, elapsed, cpu_time;
+  guint64 n_replayed = 0;
+
+  context = g_option_context_new ("FILE - replay captured metrics events");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (argc != 2 || rate < 0 || speed < 0 || repeat < 1)
+    {
+      g_autofree gchar *help = g_option_context_get_help (context, TRUE, NULL);
+
+      g_printerr ("%s", help);
+      return EXIT_FAILURE;
+    }
+
+  records = eins_recorder_load_file (argv[1], &error);
+  if (records == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (records->len > 0)
+    g_variant_get_child (records->pdata[0], 1, "x", &first_timestamp);
+
+  timer_by_serial =
+    g_hash_table_new_full (NULL, NULL, NULL,
+                           (GDestroyNotify) eins_aggregate_timer_stop);
+
+  start_time = g_get_monotonic_time ();
+
+  for (gint pass = 0; pass < repeat; pass++)
+    {
+      gint64 pass_start_time = g_get_monotonic_time ();
+
+      for (guint i = 0; i < records->len; i++)
+        {
+          gint64 due = 0;
+
+          if (speed > 0)
+            {
+              gint64 timestamp;
+
+              g_variant_get_child (records->pdata[i], 1, "x", &timestamp);
+              due = pass_start_time + (timestamp - first_timestamp) / speed;
+            }
+          else if (rate > 0)
+            {
+              due = start_time + n_replayed * G_USEC_PER_SEC / rate;
+            }
+
+          while (g_main_context_iteration (NULL, FALSE))
+            ;
+
+          if (due > g_get_monotonic_time ())
+            g_usleep (due - g_get_monotonic_time ());
+
+          replay_record (records->pdata[i], timer_by_serial);
+          n_replayed++;
+        }
+    }
+
+  /* Stop any timers whose stop record was missing. */
+  g_hash_table_remove_all (timer_by_serial);
+
+  eins_recorder_flush_sync ();
+
+  elapsed = g_get_monotonic_time () - start_time;
+  getrusage (RUSAGE_SELF, &usage);
+  cpu_time = timeval_to_usec (&usage.ru_utime) +
+             timeval_to_usec (&usage.ru_stime);
+
+  g_print ("records: %" G_GUINT64_FORMAT "\n", n_replayed);
+  g_print ("elapsed: %.3f s\n", (gdouble) elapsed / G_USEC_PER_SEC);
+  g_print ("throughput: %.1f records/s\n",
+           elapsed > 0 ? n_replayed * (gdouble) G_USEC_PER_SEC / elapsed : 0);
+  g_print ("cpu: %.3f s (%.1f us/record)\n",
+           (gdouble) cpu_time / G_USEC_PER_SEC,
+           n_replayed > 0 ? (gdouble) cpu_time / n_replayed : 0);
+  g_print ("max-rss: %ld KiB\n", usage.ru_maxrss);
+
+  return EXIT_SUCCESS;
+}